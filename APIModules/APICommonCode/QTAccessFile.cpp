@@ -89,6 +89,9 @@ void QTAccessFile::SetAccessFileName(const char *inQTAccessFileName)
     sQTAccessFileName = NEW char[strlen(inQTAccessFileName)+1];
     ::strcpy(sQTAccessFileName, inQTAccessFileName);
     
+    // The files cached under the old name don't count any more
+    QTAccessFileCache::Clear();
+    
 }
 
 
@@ -98,13 +101,22 @@ Bool16 QTAccessFile::AccessAllowed  (   char *userName, char**groupArray, UInt32
 {       
     if (NULL == accessFileBufPtr || NULL == accessFileBufPtr->Ptr || 0 == accessFileBufPtr->Len)
         return false; // nothing to check
+        
+    UInt32 numRules = QTAccessFile::ParseRules(accessFileBufPtr, NULL);
+    QTAccessRule* rules = NEW QTAccessRule[numRules];
+    OSArrayObjectDeleter<QTAccessRule> rulesDeleter(rules);
+    (void)QTAccessFile::ParseRules(accessFileBufPtr, rules);
+    
+    return QTAccessFile::RulesAllowAccess(userName, groupArray, numGroups, rules, numRules, inFlags, ioRealmNameStr);
+}
+
+Bool16 QTAccessFile::RulesAllowAccess(  char *userName, char**groupArray, UInt32 numGroups,
+                                        QTAccessRule* inRules, UInt32 inNumRules, QTSS_ActionFlags inFlags, StrPtrLen* ioRealmNameStr
+                                     )
+{
     if (ioRealmNameStr != NULL && ioRealmNameStr->Ptr != NULL && ioRealmNameStr->Len > 0)
         ioRealmNameStr->Ptr[0] = 0;
         
-    StringParser            accessFileParser(accessFileBufPtr);
-    QTSS_ActionFlags        currentFlags = qtssActionFlagsRead; 
-    StrPtrLen               line;
-    StrPtrLen               word;
     Bool16                  haveUserName = false;
     Bool16                  haveRealmResultBuffer = false;
     Bool16                  haveGroups = false;
@@ -118,6 +130,73 @@ Bool16 QTAccessFile::AccessAllowed  (   char *userName, char**groupArray, UInt32
     if (ioRealmNameStr != NULL && ioRealmNameStr->Ptr != NULL && ioRealmNameStr->Len > 0)
         haveRealmResultBuffer = true;
         
+    for (UInt32 ruleIndex = 0; ruleIndex < inNumRules; ruleIndex++)
+    {
+        QTAccessRule* rule = &inRules[ruleIndex];
+        if (0 == (rule->fActions & inFlags))
+            continue; // ignore rules because inFlags doesn't match their <Limit>
+            
+        switch (rule->fType)
+        {
+            case QTAccessRule::kAuthName: //realm name
+            {
+                if (!haveRealmResultBuffer)
+                    break;
+                    
+                UInt32 realmLen = rule->fValue.Len;
+                if (ioRealmNameStr->Len <= realmLen) 
+                    realmLen = ioRealmNameStr->Len -1; // just copy what we can
+                ::memcpy(ioRealmNameStr->Ptr, rule->fValue.Ptr, realmLen);
+                ioRealmNameStr->Ptr[realmLen] = 0; 
+                // we don't change the buffer len ioRealmNameStr->Len because we might have another AuthName tag to copy
+                break;
+            }
+            
+            case QTAccessRule::kRequireValidUser:
+                if (haveUserName)
+                    return true;
+                break;
+                
+            case QTAccessRule::kRequireAnyUser:
+                return true;
+                
+            case QTAccessRule::kRequireUser:
+                if (haveUserName && rule->fValue.Equal(userName))
+                    return true;
+                break;
+                
+            case QTAccessRule::kRequireGroup: // check if we have groups for the user
+                if (!haveUserName || !haveGroups)
+                    break;
+                for (UInt32 index = 0; index < numGroups; index ++)
+                {   if (rule->fValue.Equal(groupArray[index])) 
+                        return true;
+                }
+                break;
+        }
+    }
+    
+    return false; // user or group not found
+}
+
+static void AddRule(QTAccessRule* ioRules, UInt32* ioNumRules, UInt32 inType, QTSS_ActionFlags inActions, const StrPtrLen& inValue)
+{
+    if (ioRules != NULL)
+    {   ioRules[*ioNumRules].fType = inType;
+        ioRules[*ioNumRules].fActions = inActions;
+        ioRules[*ioNumRules].fValue = inValue;
+    }
+    (*ioNumRules)++;
+}
+
+UInt32 QTAccessFile::ParseRules(StrPtrLen* inData, QTAccessRule* outRules)
+{
+    StringParser            accessFileParser(inData);
+    QTSS_ActionFlags        currentFlags = qtssActionFlagsRead; 
+    StrPtrLen               line;
+    StrPtrLen               word;
+    UInt32                  numRules = 0;
+    
     while( accessFileParser.GetDataRemaining() != 0 ) 
     {
         accessFileParser.GetThruEOL(&line);  // Read each line  
@@ -139,11 +218,11 @@ Bool16 QTAccessFile::AccessAllowed  (   char *userName, char**groupArray, UInt32
             while (word.Len != 0) // compare each word in the line
             {   
                 if (word.Equal("WRITE")  ) 
-                {   currentFlags |= inFlags & qtssActionFlagsWrite; // accept following lines if inFlags has write
+                {   currentFlags |= qtssActionFlagsWrite; // the following lines apply to write requests
                 }
                 
                 if (word.Equal("READ") ) 
-                {   currentFlags |= inFlags & qtssActionFlagsRead; // accept following lines if inFlags has read
+                {   currentFlags |= qtssActionFlagsRead; // the following lines apply to read requests
                 }
                 lineParser.ConsumeWhitespace();
                 lineParser.ConsumeUntil(&word, sWhitespaceAndGreaterThanMask);
@@ -151,85 +230,68 @@ Bool16 QTAccessFile::AccessAllowed  (   char *userName, char**groupArray, UInt32
             continue; //done with limit line
         }
         if ( word.Equal("</Limit>") )
-            currentFlags = qtssActionFlagsRead; // set the current access state to the default of read access
+        {   currentFlags = qtssActionFlagsRead; // set the current access state to the default of read access
+            continue;
+        }
         
-        if (0 == (currentFlags & inFlags))
-            continue; // ignore lines because inFlags doesn't match the current access state
+        if (qtssActionFlagsNoFlags == currentFlags)
+            continue; // ignore lines that apply to no request
             
-        if (haveRealmResultBuffer && word.Equal("AuthName") ) //realm name
-        {   
+        if ( word.Equal("AuthName") || word.Equal("AuthUserFile") || word.Equal("AuthGroupFile") || word.Equal("AuthScheme") )
+        {
+            UInt32 ruleType = QTAccessRule::kAuthScheme;
+            if ( word.Equal("AuthName") ) //realm name
+                ruleType = QTAccessRule::kAuthName;
+            else if ( word.Equal("AuthUserFile") )
+                ruleType = QTAccessRule::kAuthUserFile;
+            else if ( word.Equal("AuthGroupFile") )
+                ruleType = QTAccessRule::kAuthGroupFile;
+                
             lineParser.ConsumeWhitespace();
             lineParser.GetThruEOL(&word);
             StringParser::UnQuote(&word);// if the parsed string is surrounded by quotes then remove them.
-            
-            if (ioRealmNameStr->Len <= word.Len) 
-                word.Len = ioRealmNameStr->Len -1; // just copy what we can
-            ::memcpy(ioRealmNameStr->Ptr, word.Ptr,word.Len);
-            ioRealmNameStr->Ptr[word.Len] = 0; 
-            // we don't change the buffer len ioRealmNameStr->Len because we might have another AuthName tag to copy
-            continue; // done with AuthName (realm)
+            AddRule(outRules, &numRules, ruleType, currentFlags, word);
+            continue;
         }
         
-        
         if (word.Equal("require") )
         {
             lineParser.ConsumeWhitespace();
             lineParser.ConsumeUntilWhitespace(&word);       
 
-            if (haveUserName && word.Equal("valid-user") ) 
-            {   return true; 
-            }
+            if ( word.Equal("valid-user") ) 
+                AddRule(outRules, &numRules, QTAccessRule::kRequireValidUser, currentFlags, word);
             
-            if ( word.Equal("any-user")  ) 
-            {   return true; 
-            }
+            if ( word.Equal("any-user") ) 
+                AddRule(outRules, &numRules, QTAccessRule::kRequireAnyUser, currentFlags, word);
     
-            if (!haveUserName)
-                continue;
+            if ( word.Equal("user") || word.Equal("group") )
+            {
+                UInt32 ruleType = word.Equal("user") ? QTAccessRule::kRequireUser : QTAccessRule::kRequireGroup;
                 
-            if (word.Equal("user") )
-            {   
                 lineParser.ConsumeWhitespace();
                 lineParser.ConsumeUntilWhitespace(&word);   
                     
-                while (word.Len != 0) // compare each word in the line
+                while (word.Len != 0) // a rule for each word in the line
                 {   
-                    if ( word.Equal(userName) ) 
-                    {   return true; 
-                    }
+                    AddRule(outRules, &numRules, ruleType, currentFlags, word);
                     lineParser.ConsumeWhitespace();
                     lineParser.ConsumeUntilWhitespace(&word);       
                 }
-                continue; // done with "require user" line
             }
-            
-            if (haveGroups && word.Equal("group")) // check if we have groups for the user
-            {
-                lineParser.ConsumeWhitespace();
-                lineParser.ConsumeUntilWhitespace(&word);       
-                
-                while (word.Len != 0) // compare each word in the line
-                {   
-                    for (UInt32 index = 0; index < numGroups; index ++)
-                    {   if(word.Equal(groupArray[index])) 
-                            return true;
-                    }
-                
-                    lineParser.ConsumeWhitespace();
-                    lineParser.ConsumeUntilWhitespace(&word);
-                }
-                continue; // done with "require group" line
-            }
-                    
-            continue; // done with unparsed "require" line
+            continue; // done with "require" line
         }
-        
     }
     
-    return false; // user or group not found
+    return numRules;
 }
 
 char*  QTAccessFile::GetAccessFile_Copy( const char* movieRootDir, const char* dirPath)
+{
+    return FindAccessFile(movieRootDir, dirPath, NULL);
+}
+
+char*  QTAccessFile::FindAccessFile( const char* movieRootDir, const char* dirPath, QTAccessFileCacheEntry** outEntry)
 {   
     OSMutexLocker locker(sAccessFileMutex);
 
@@ -258,12 +320,18 @@ char*  QTAccessFile::GetAccessFile_Copy( const char* movieRootDir, const char* d
         ::strcat(currentDir, kPathDelimiterString);
         ::strcat(currentDir, sQTAccessFileName);
     
-        QTSS_Object fileObject = NULL;
-        if( QTSS_OpenFileObject(currentDir, qtssOpenFileNoFlags, &fileObject) == QTSS_NoErr) 
+        // Folders without a qtaccess file are cached too, so that the walk
+        // is a lookup per folder
+        QTAccessFileCacheEntry* theEntry = QTAccessFileCache::Get(currentDir);
+        if (theEntry->Exists())
         {
-            (void)QTSS_CloseFileObject(fileObject);
+            if (outEntry != NULL)
+                *outEntry = theEntry;
+            else
+                QTAccessFileCache::Release(theEntry);
             return currentDir;
         }
+        QTAccessFileCache::Release(theEntry);
                 
         //strip off the "/qtaccess"
         lastSlash = ::strrchr(currentDir, kPathDelimiterChar);
@@ -289,7 +357,6 @@ char*  QTAccessFile::GetAccessFile_Copy( const char* movieRootDir, const char* d
 QTSS_AuthScheme QTAccessFile::FindUsersAndGroupsFilesAndAuthScheme(char* inAccessFilePath, QTSS_ActionFlags inAction, char** outUsersFilePath, char** outGroupsFilePath)
 {
     QTSS_AuthScheme authScheme = qtssAuthNone;
-    QTSS_ActionFlags currentFlags = qtssActionFlagsRead;
     
     if (inAccessFilePath == NULL)
     return authScheme;
@@ -299,94 +366,33 @@ QTSS_AuthScheme QTAccessFile::FindUsersAndGroupsFilesAndAuthScheme(char* inAcces
     //Assert(outUsersFilePath == NULL);
     //Assert(outGroupsFilePath == NULL);
     
-    StrPtrLen accessFileBuf;
-    (void)QTSSModuleUtils::ReadEntireFile(inAccessFilePath, &accessFileBuf);
-    OSCharArrayDeleter accessFileBufDeleter(accessFileBuf.Ptr);
+    QTAccessFileCacheEntry* accessFileEntry = QTAccessFileCache::Get(inAccessFilePath);
+    QTAccessFileCacheReleaser accessFileEntryReleaser(accessFileEntry);
     
-    StringParser accessFileParser(&accessFileBuf);
-    StrPtrLen line;
-    StrPtrLen word;
-    
-    while( accessFileParser.GetDataRemaining() != 0 ) 
-    {
-    accessFileParser.GetThruEOL(&line);     // Read each line   
-    StringParser lineParser(&line);
-    lineParser.ConsumeWhitespace();         //skip over leading whitespace
-    if (lineParser.GetDataRemaining() == 0)     // must be an empty line
-        continue;
-
-    char firstChar = lineParser.PeekFast();
-    if ( (firstChar == '#') || (firstChar == '\0') )
-        continue;               //skip over comments and blank lines...
-        
-        lineParser.ConsumeUntilWhitespace(&word);
-               
-        if ( word.Equal("<Limit") ) // a limit line
+    for (UInt32 ruleIndex = 0; ruleIndex < accessFileEntry->fNumRules; ruleIndex++)
     {
-        currentFlags = qtssActionFlagsNoFlags; // clear to no access
-        lineParser.ConsumeWhitespace();
-        lineParser.ConsumeUntil( &word, sWhitespaceAndGreaterThanMask); // the flag <limit Read> or <limit Read >
-        while (word.Len != 0) // compare each word in the line
-        {   
-            if (word.Equal("WRITE")  ) 
-            {   
-               currentFlags |= inAction & qtssActionFlagsWrite; // accept following lines if inFlags has write
-            }
-                
-            if (word.Equal("READ") ) 
-            {   
-               currentFlags |= inAction & qtssActionFlagsRead; // accept following lines if inFlags has read
-            }
-                        
-            lineParser.ConsumeWhitespace();
-            lineParser.ConsumeUntil(&word, sWhitespaceAndGreaterThanMask);
-                }
-                continue; //done with limit line
-        }
-        
-        if ( word.Equal("</Limit>") )
-                currentFlags = qtssActionFlagsRead; // set the current access state to the default of read access
-        
-        if (0 == (currentFlags & inAction))
-            continue; // ignore lines because inFlags doesn't match the current access state
+        QTAccessRule* rule = &accessFileEntry->fRules[ruleIndex];
+        if (0 == (rule->fActions & inAction))
+            continue; // ignore rules because inAction doesn't match their <Limit>
             
-        if (word.Equal("AuthUserFile") )
-    {
-                lineParser.ConsumeWhitespace();
-                lineParser.GetThruEOL(&word);
-                StringParser::UnQuote(&word);// if the parsed string is surrounded by quotes then remove them.
-        
-                if(*outUsersFilePath != NULL)       // we are encountering the AuthUserFile keyword twice!
-                    delete[] *outUsersFilePath; // The last one found takes precedence...delete the previous path
-                
-                *outUsersFilePath = word.GetAsCString();
-        continue;
+        if (rule->fType == QTAccessRule::kAuthUserFile)
+        {
+            if(*outUsersFilePath != NULL)       // we are encountering the AuthUserFile keyword twice!
+                delete[] *outUsersFilePath; // The last one found takes precedence...delete the previous path
+            *outUsersFilePath = rule->fValue.GetAsCString();
         }
-        
-        if (word.Equal("AuthGroupFile") )
+        else if (rule->fType == QTAccessRule::kAuthGroupFile)
         {
-            lineParser.ConsumeWhitespace();
-            lineParser.GetThruEOL(&word);
-            StringParser::UnQuote(&word);// if the parsed string is surrounded by quotes then remove them.
-
             if(*outGroupsFilePath != NULL)      // we are encountering the AuthGroupFile keyword twice!
                 delete[] *outGroupsFilePath;    // The last one found takes precedence...delete the previous path       
-        *outGroupsFilePath = word.GetAsCString();
-        continue;
+            *outGroupsFilePath = rule->fValue.GetAsCString();
         }
-        
-        if (word.Equal("AuthScheme") )
+        else if (rule->fType == QTAccessRule::kAuthScheme)
         {
-            lineParser.ConsumeWhitespace();
-            lineParser.GetThruEOL(&word);
-            StringParser::UnQuote(&word);// if the parsed string is surrounded by quotes then remove them.
-
-            if (word.Equal("basic"))
+            if (rule->fValue.Equal("basic"))
                 authScheme = qtssAuthBasic;
-            else if (word.Equal("digest"))
+            else if (rule->fValue.Equal("digest"))
                 authScheme = qtssAuthDigest;
-                
-            continue;
         }
     }
     
@@ -425,8 +431,10 @@ QTSS_Error QTAccessFile::AuthorizeRequest(QTSS_StandardRTSP_Params* inParams, Bo
     if (NULL == theUserProfile)
         return QTSS_RequestFailed;
 
-    char* accessFilePath = QTAccessFile::GetAccessFile_Copy(movieRootDirStr, pathBuffStr);
+    QTAccessFileCacheEntry* accessFileEntry = NULL;
+    char* accessFilePath = QTAccessFile::FindAccessFile(movieRootDirStr, pathBuffStr, &accessFileEntry);
     OSCharArrayDeleter accessFilePathDeleter(accessFilePath);
+    QTAccessFileCacheReleaser accessFileEntryReleaser(accessFileEntry);
     
     if (NULL == accessFilePath) // we are done nothing to do
     {   if (QTSS_NoErr != QTSS_SetValue(theRTSPRequest,qtssRTSPReqUserAllowed, 0, &allowNoAccessFiles, sizeof(allowNoAccessFiles)))
@@ -441,15 +449,12 @@ QTSS_Error QTAccessFile::AuthorizeRequest(QTSS_StandardRTSP_Params* inParams, Bo
     char** groupCharPtrArray =  QTSSModuleUtils::GetGroupsArray_Copy(theUserProfile, &numGroups);
     OSCharPointerArrayDeleter groupCharPtrArrayDeleter(groupCharPtrArray);
     
-    StrPtrLen accessFileBuf;
-    (void)QTSSModuleUtils::ReadEntireFile(accessFilePath, &accessFileBuf);
-    OSCharArrayDeleter accessFileBufDeleter(accessFileBuf.Ptr);
-        
     char realmName[kBuffLen] = { 0 };
     StrPtrLen   realmNameStr(realmName,kBuffLen -1);
     
-    //check if this user is allowed to see this movie
-    Bool16 allowRequest = QTAccessFile::AccessAllowed(username, groupCharPtrArray, numGroups,  &accessFileBuf, authorizeAction,&realmNameStr);
+    //check if this user is allowed to see this movie. The rules are shared with other requests, and only read
+    Bool16 allowRequest = QTAccessFile::RulesAllowAccess(username, groupCharPtrArray, numGroups, 
+                                                         accessFileEntry->fRules, accessFileEntry->fNumRules, authorizeAction, &realmNameStr);
     
     // Get the auth scheme
     QTSS_AuthScheme theAuthScheme = qtssAuthNone;
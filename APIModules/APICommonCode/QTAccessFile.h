@@ -24,6 +24,7 @@ LastUpdate:  2010-08-16
 #include "OSHeaders.h"
 #include "OSMutex.h"
 #include "QTSS.h"
+#include "QTAccessFileCache.h"
 
 class OSMutex;
 
@@ -64,8 +65,24 @@ class QTAccessFile
                 
         static QTSS_Error AuthorizeRequest(QTSS_StandardRTSP_Params* inParams, Bool16 allowNoAccessFiles, QTSS_ActionFlags noAction, QTSS_ActionFlags authorizeAction);
 
+        //ParseRules
+        //
+        // Puts the rules of the qtaccess file text in inData into outRules, in the order of the file,
+        // and returns how many there are. With outRules NULL, only counts them.
+        static UInt32 ParseRules(StrPtrLen* inData, QTAccessRule* outRules);
+
     private:
 
+        static Bool16 RulesAllowAccess( char *userName, char**groupArray, UInt32 numGroups,
+                                        QTAccessRule* inRules, UInt32 inNumRules, QTSS_ActionFlags inFlags, StrPtrLen* ioRealmNameStr
+                                      );
+
+        //
+        // Walks up from dirPath to movieRootDir, looking for a qtaccess file.
+        // Returns a copy of its path, and its cache entry with a reference
+        // held in outEntry if that isn't NULL; or NULL if there is none.
+        static char*  FindAccessFile(const char* movieRootDir, const char* dirPath, QTAccessFileCacheEntry** outEntry);
+
 		/* file name to access */
         static char* sQTAccessFileName; // managed by the QTAccess module
         static Bool16 sAllocatedName;
@@ -0,0 +1,291 @@
+/***************************************************************************
+
+Copyright (c) 1999-2003 Apple Computer, Inc.  All Rights Reserved.
+2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 QTAccessFileCache.cpp
+Description: Keep the qtaccess files QTAccessFile looks for in memory, parsed,
+             along with the directories that have none.
+Comment:     used by QTAccessFile
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-17
+LastUpdate:  2026-10-17
+
+****************************************************************************/
+
+
+#include <string.h>
+
+#include "QTAccessFileCache.h"
+#include "QTAccessFile.h"
+#include "QTSSModuleUtils.h"
+#include "OS.h"
+#include "OSMemory.h"
+#include "MyAssert.h"
+
+
+OSMutex                     QTAccessFileCache::sMutex;
+QTAccessFileCacheEntry**    QTAccessFileCache::sHashTable = NULL;
+UInt32                      QTAccessFileCache::sNumHashBuckets = 0;
+UInt32                      QTAccessFileCache::sNumEntries = 0;
+QTAccessFileCacheEntry*     QTAccessFileCache::sFirstEntry = NULL;
+QTAccessFileCacheEntry*     QTAccessFileCache::sLastEntry = NULL;
+
+
+QTAccessFileCacheEntry::QTAccessFileCacheEntry()
+:   fRules(NULL),
+    fNumRules(0),
+    fPath(NULL),
+    fModDate(-1),
+    fCheckTime(0),
+    fHashValue(0),
+    fRefCount(0),
+    fIsInTable(false),
+    fNextHashEntry(NULL),
+    fPrevEntry(NULL),
+    fNextEntry(NULL)
+{
+}
+
+QTAccessFileCacheEntry::~QTAccessFileCacheEntry()
+{
+    delete [] fRules;
+    delete [] fData.Ptr;
+    delete [] fPath;
+}
+
+
+QTAccessFileCacheEntry* QTAccessFileCache::Get(const char* inPath)
+{
+    UInt32 theHashValue = Hash(inPath);
+
+    while (true)
+    {
+        QTSS_TimeVal theModDate = -1;
+        {
+            OSMutexLocker locker(&sMutex);
+
+            QTAccessFileCacheEntry* theEntry = Lookup(inPath, theHashValue);
+            if (theEntry != NULL)
+            {
+                if (OS::Milliseconds() - theEntry->fCheckTime < kCheckIntervalInMSecs)
+                {
+                    Touch(theEntry);
+                    theEntry->fRefCount++;
+                    return theEntry;
+                }
+
+                if (theEntry->Exists())
+                    theModDate = theEntry->fModDate;
+            }
+        }
+
+        //
+        // Check the file without the lock held. If it hasn't been modified
+        // since theModDate, nothing is read.
+        StrPtrLen theData;
+        QTSS_TimeVal theNewModDate = -1;
+        QTSS_Error theErr = QTSSModuleUtils::ReadEntireFile((char*)inPath, &theData, theModDate, &theNewModDate);
+        Bool16 isUnchanged = (theModDate != -1) && (theErr == QTSS_NoErr) && (theData.Ptr == NULL);
+
+        QTAccessFileCacheEntry* theNewEntry = NULL;
+        if (!isUnchanged)
+        {
+            theNewEntry = NEW QTAccessFileCacheEntry();
+            theNewEntry->fData = theData;   // NULL if there is no file
+            if (theData.Ptr != NULL)
+            {
+                theNewEntry->fNumRules = QTAccessFile::ParseRules(&theData, NULL);
+                theNewEntry->fRules = NEW QTAccessRule[theNewEntry->fNumRules];
+                (void)QTAccessFile::ParseRules(&theData, theNewEntry->fRules);
+            }
+            theNewEntry->fModDate = theNewModDate;
+            theNewEntry->fPath = NEW char[::strlen(inPath) + 1];
+            ::strcpy(theNewEntry->fPath, inPath);
+            theNewEntry->fHashValue = theHashValue;
+        }
+
+        OSMutexLocker locker(&sMutex);
+
+        QTAccessFileCacheEntry* theOldEntry = Lookup(inPath, theHashValue);
+        if (isUnchanged)
+        {
+            // The entry may have been dropped meanwhile, then the file has to
+            // be read after all
+            if (theOldEntry == NULL)
+                continue;
+
+            if (theOldEntry->fModDate == theModDate)
+                theOldEntry->fCheckTime = OS::Milliseconds();
+            Touch(theOldEntry);
+            theOldEntry->fRefCount++;
+            return theOldEntry;
+        }
+
+        if (theOldEntry != NULL)
+        {
+            Remove(theOldEntry);
+            if (theOldEntry->fRefCount == 0)
+                delete theOldEntry;
+        }
+
+        theNewEntry->fCheckTime = OS::Milliseconds();
+        Insert(theNewEntry);
+        theNewEntry->fRefCount++;
+        return theNewEntry;
+    }
+}
+
+void QTAccessFileCache::Release(QTAccessFileCacheEntry* inEntry)
+{
+    OSMutexLocker locker(&sMutex);
+
+    Assert(inEntry->fRefCount > 0);
+    inEntry->fRefCount--;
+    if ((inEntry->fRefCount == 0) && !inEntry->fIsInTable)
+        delete inEntry;
+}
+
+void QTAccessFileCache::Clear()
+{
+    OSMutexLocker locker(&sMutex);
+
+    while (sFirstEntry != NULL)
+    {
+        QTAccessFileCacheEntry* theEntry = sFirstEntry;
+        Remove(theEntry);
+        if (theEntry->fRefCount == 0)
+            delete theEntry;
+    }
+}
+
+UInt32 QTAccessFileCache::Hash(const char* inPath)
+{
+    // FNV-1a. Paths of the same tree differ near the end, so all of it is hashed.
+    UInt32 theHashValue = 2166136261U;
+
+    for ( ; *inPath != '\0'; inPath++)
+    {
+        theHashValue ^= (UInt8)*inPath;
+        theHashValue *= 16777619;
+    }
+
+    return (UInt32)(theHashValue & 0xFFFFFFFF);
+}
+
+QTAccessFileCacheEntry* QTAccessFileCache::Lookup(const char* inPath, UInt32 inHashValue)
+{
+    if (sHashTable == NULL)
+        return NULL;
+
+    for (QTAccessFileCacheEntry* theEntry = sHashTable[inHashValue & (sNumHashBuckets - 1)];
+            theEntry != NULL; theEntry = theEntry->fNextHashEntry)
+    {
+        if ((theEntry->fHashValue == inHashValue) && (::strcmp(theEntry->fPath, inPath) == 0))
+            return theEntry;
+    }
+
+    return NULL;
+}
+
+void QTAccessFileCache::Touch(QTAccessFileCacheEntry* inEntry)
+{
+    // Move it to the tail of the LRU list
+    if (inEntry == sLastEntry)
+        return;
+
+    if (inEntry->fPrevEntry != NULL)
+        inEntry->fPrevEntry->fNextEntry = inEntry->fNextEntry;
+    else
+        sFirstEntry = inEntry->fNextEntry;
+    inEntry->fNextEntry->fPrevEntry = inEntry->fPrevEntry;
+
+    inEntry->fPrevEntry = sLastEntry;
+    inEntry->fNextEntry = NULL;
+    sLastEntry->fNextEntry = inEntry;
+    sLastEntry = inEntry;
+}
+
+void QTAccessFileCache::Insert(QTAccessFileCacheEntry* inEntry)
+{
+    Assert(!inEntry->fIsInTable);
+
+    if (sNumEntries >= sNumHashBuckets)
+        GrowHashTable();
+
+    UInt32 theBucket = inEntry->fHashValue & (sNumHashBuckets - 1);
+    inEntry->fNextHashEntry = sHashTable[theBucket];
+    sHashTable[theBucket] = inEntry;
+
+    inEntry->fPrevEntry = sLastEntry;
+    if (sLastEntry != NULL)
+        sLastEntry->fNextEntry = inEntry;
+    else
+        sFirstEntry = inEntry;
+    sLastEntry = inEntry;
+
+    inEntry->fIsInTable = true;
+    sNumEntries++;
+
+    // Drop the least recently used. Entries in use go when their last Release does.
+    while (sNumEntries > kMaxEntries)
+    {
+        QTAccessFileCacheEntry* theEntry = sFirstEntry;
+        Remove(theEntry);
+        if (theEntry->fRefCount == 0)
+            delete theEntry;
+    }
+}
+
+void QTAccessFileCache::Remove(QTAccessFileCacheEntry* inEntry)
+{
+    Assert(inEntry->fIsInTable);
+
+    QTAccessFileCacheEntry** theLink = &sHashTable[inEntry->fHashValue & (sNumHashBuckets - 1)];
+    while (*theLink != inEntry)
+        theLink = &(*theLink)->fNextHashEntry;
+    *theLink = inEntry->fNextHashEntry;
+
+    if (inEntry->fPrevEntry != NULL)
+        inEntry->fPrevEntry->fNextEntry = inEntry->fNextEntry;
+    else
+        sFirstEntry = inEntry->fNextEntry;
+    if (inEntry->fNextEntry != NULL)
+        inEntry->fNextEntry->fPrevEntry = inEntry->fPrevEntry;
+    else
+        sLastEntry = inEntry->fPrevEntry;
+
+    inEntry->fNextHashEntry = NULL;
+    inEntry->fPrevEntry = NULL;
+    inEntry->fNextEntry = NULL;
+    inEntry->fIsInTable = false;
+    sNumEntries--;
+}
+
+void QTAccessFileCache::GrowHashTable()
+{
+    UInt32 theNumBuckets = sNumHashBuckets * 2;
+    if (theNumBuckets < kMinHashBuckets)
+        theNumBuckets = kMinHashBuckets;
+
+    QTAccessFileCacheEntry** theHashTable = NEW QTAccessFileCacheEntry*[theNumBuckets];
+    ::memset(theHashTable, 0, sizeof(QTAccessFileCacheEntry*) * theNumBuckets);
+
+    for (UInt32 theBucket = 0; theBucket < sNumHashBuckets; theBucket++)
+    {
+        QTAccessFileCacheEntry* theNextEntry = NULL;
+        for (QTAccessFileCacheEntry* theEntry = sHashTable[theBucket]; theEntry != NULL; theEntry = theNextEntry)
+        {
+            theNextEntry = theEntry->fNextHashEntry;
+
+            UInt32 theNewBucket = theEntry->fHashValue & (theNumBuckets - 1);
+            theEntry->fNextHashEntry = theHashTable[theNewBucket];
+            theHashTable[theNewBucket] = theEntry;
+        }
+    }
+
+    delete [] sHashTable;
+    sHashTable = theHashTable;
+    sNumHashBuckets = theNumBuckets;
+}
@@ -0,0 +1,149 @@
+/***************************************************************************
+
+Copyright (c) 1999-2003 Apple Computer, Inc.  All Rights Reserved.
+2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 QTAccessFileCache.h
+Description: Keep the qtaccess files QTAccessFile looks for in memory, parsed,
+             along with the directories that have none.
+Comment:     used by QTAccessFile
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-17
+LastUpdate:  2026-10-17
+
+****************************************************************************/
+
+
+#ifndef __QTACCESSFILECACHE_H__
+#define __QTACCESSFILECACHE_H__
+
+#include "OSHeaders.h"
+#include "OSMutex.h"
+#include "StrPtrLen.h"
+#include "QTSS.h"
+
+//
+// One line of a qtaccess file, or one name of a "require user" or "require
+// group" line, that QTAccessFile acts on. fValue points into the text of the
+// file the entry keeps.
+
+struct QTAccessRule
+{
+    enum
+    {
+        kAuthName           = 0,
+        kAuthUserFile       = 1,
+        kAuthGroupFile      = 2,
+        kAuthScheme         = 3,
+        kRequireValidUser   = 4,
+        kRequireAnyUser     = 5,
+        kRequireUser        = 6,
+        kRequireGroup       = 7
+    };
+
+    UInt32              fType;
+    QTSS_ActionFlags    fActions;   // the requests it applies to, from its <Limit> (read outside of one)
+    StrPtrLen           fValue;
+};
+
+//
+// An entry is keyed by the full path of a qtaccess file, so by its folder. It
+// holds the rules of the file, or says that there is no such file, so that
+// walking up the movie folders and checking a request against the qtaccess
+// file that applies costs a hash lookup for each folder and a pass over the
+// rules, not reading and parsing the file.
+//
+// An entry is trusted for kCheckIntervalInMSecs after it was last checked.
+// After that, the next lookup opens the file again: if its mod date hasn't
+// changed the entry is kept, otherwise it is replaced by one made from the
+// file as it is now.
+
+class QTAccessFileCacheEntry
+{
+    public:
+
+        Bool16          Exists()    { return fData.Ptr != NULL; }
+
+        //
+        // The text of the qtaccess file, with a terminating 0 after it, and
+        // its rules in the order of the file
+        StrPtrLen       fData;
+        QTAccessRule*   fRules;
+        UInt32          fNumRules;
+
+    private:
+
+        QTAccessFileCacheEntry();
+        ~QTAccessFileCacheEntry();
+
+        char*           fPath;
+        QTSS_TimeVal    fModDate;
+        SInt64          fCheckTime;
+
+        UInt32          fHashValue;
+        UInt32          fRefCount;
+        Bool16          fIsInTable;         // if not, the last Release deletes it
+        QTAccessFileCacheEntry* fNextHashEntry;
+        QTAccessFileCacheEntry* fPrevEntry; // LRU list of the entries in the table,
+        QTAccessFileCacheEntry* fNextEntry; // most recently used at the tail
+
+        friend class QTAccessFileCache;
+};
+
+class QTAccessFileCache
+{
+    public:
+
+        //
+        // Returns the entry for the qtaccess file at inPath with a reference
+        // held. It is never NULL: a file that can't be read gets an entry that
+        // doesn't Exist.
+        static QTAccessFileCacheEntry*  Get(const char* inPath);
+
+        static void     Release(QTAccessFileCacheEntry* inEntry);
+
+        //
+        // Forgets every entry, as when the name of qtaccess files changes.
+        static void     Clear();
+
+    private:
+
+        enum
+        {
+            kMaxEntries             = 4096,     //UInt32
+            kMinHashBuckets         = 64,       //UInt32
+            kCheckIntervalInMSecs   = 1000      //SInt64
+        };
+
+        static UInt32   Hash(const char* inPath);
+        static QTAccessFileCacheEntry*  Lookup(const char* inPath, UInt32 inHashValue);
+        static void     Touch(QTAccessFileCacheEntry* inEntry);
+        static void     Insert(QTAccessFileCacheEntry* inEntry);
+        static void     Remove(QTAccessFileCacheEntry* inEntry);
+        static void     GrowHashTable();
+
+        static OSMutex                  sMutex;
+        static QTAccessFileCacheEntry** sHashTable;
+        static UInt32                   sNumHashBuckets;
+        static UInt32                   sNumEntries;
+        static QTAccessFileCacheEntry*  sFirstEntry;
+        static QTAccessFileCacheEntry*  sLastEntry;
+};
+
+//
+// Releases an entry when it goes out of scope
+
+class QTAccessFileCacheReleaser
+{
+    public:
+
+        QTAccessFileCacheReleaser(QTAccessFileCacheEntry* inEntry) : fEntry(inEntry) {}
+        ~QTAccessFileCacheReleaser() { if (fEntry != NULL) QTAccessFileCache::Release(fEntry); }
+
+    private:
+
+        QTAccessFileCacheEntry* fEntry;
+};
+
+#endif //__QTACCESSFILECACHE_H__
@@ -100,6 +100,29 @@ void QTSSRollingLog::WriteToLog(char* inLogData, Bool16 allowLogToRoll)
         this->CloseLog( false );
 }
 
+void QTSSRollingLog::WriteToLog(char* inLogData, UInt32 inLength, Bool16 allowLogToRoll)
+{
+    OSMutexLocker locker(&fMutex);
+    
+    if (fLogging == false)
+        return;
+     
+    if (sCloseOnWrite && fLog == NULL)
+        this->EnableLog(fAppendDotLog ); //re-open log file before we write
+    
+    if (allowLogToRoll)
+        (void)this->CheckRollLog();
+        
+    if (fLog != NULL)
+    {
+        (void)::fwrite(inLogData, 1, inLength, fLog);
+        ::fflush(fLog);
+    }
+    
+    if (sCloseOnWrite)
+        this->CloseLog( false );
+}
+
 /* ־ļ(ں.log),´־ļ,ٴøݳԱֵ */
 Bool16 QTSSRollingLog::RollLog()
 {
@@ -172,7 +195,7 @@ void QTSSRollingLog::EnableLog( Bool16 appendDotLog )
 
 	/* ׼Ӻ׺".log" */
 	/* extensionֵ(".log"򲻴) */
-    char *extension = ".log";
+    char *extension = this->GetLogExtension();
     if (!appendDotLog)
         extension = NULL;
     
@@ -352,7 +375,8 @@ Bool16 QTSSRollingLog::RenameLogFile(const char* inFileName)
     //QTStreamingServer.981217003.log
     //format the new file name
 	/* ļ(Ŀ¼\ļ+.+.)Ļ */
-    OSCharArrayDeleter theNewNameBuffer(NEW char[::strlen(logDirectory) + kMaxFilenameLengthInBytes + 3]);
+    char *extension = this->GetLogExtension();
+    OSCharArrayDeleter theNewNameBuffer(NEW char[::strlen(logDirectory) + kMaxFilenameLengthInBytes + 3 + ::strlen(extension)]);
     
     //copy over the directory - append a '/' if it's missing
 	/* Logļ·Ƶ½Ļ,ĩβ'/',һ'/' */
@@ -390,12 +414,12 @@ Bool16 QTSSRollingLog::RenameLogFile(const char* inFileName)
         {
             //add a bogus(ٵ,α) log number and exit the loop
 			/* Base Nameappend һʾ,˳ */
-            qtss_sprintf(theNewNameBuffer + theBaseNameLength, "---.log");
+            qtss_sprintf(theNewNameBuffer + theBaseNameLength, "---%s", extension);
             break;
         }
 
         //add the log number & suffix
-        qtss_sprintf(theNewNameBuffer + theBaseNameLength, "%03ld.log", x);
+        qtss_sprintf(theNewNameBuffer + theBaseNameLength, "%03ld%s", x, extension);
 
         //assume that when ::stat returns an error, it is becase
         //the file doesnt exist. Once that happens, we have a unique name
@@ -45,6 +45,10 @@ class QTSSRollingLog : public Task
 		/* ׷ӷʽ־ļ,Ƿ־? ַָʽ׷д־ļ,ر־ļ */
         void    WriteToLog(char* inLogData, Bool16 allowLogToRoll);
         
+        //
+        // Write inLength bytes of log data, which needn't be text
+        void    WriteToLog(char* inLogData, UInt32 inLength, Bool16 allowLogToRoll);
+        
         //log rolls automatically based on the configuration criteria,
         //but you may roll the log manually by calling this function.
         //Returns true if no error, false otherwise
@@ -105,6 +109,9 @@ class QTSSRollingLog : public Task
         virtual char*  GetLogDir() = 0;
         virtual UInt32 GetRollIntervalInDays() = 0;//0 means no interval
         virtual UInt32 GetMaxLogBytes() = 0;//0 means unlimited
+        
+        // Suffix of the log and of rolled logs, if EnableLog is told to append one
+        virtual char*  GetLogExtension() { return (char*)".log"; }
                     
         //to record the time the file was created (for time based rollingʱ־,ǻļС־)
 		/* ־ļlocalʱ׷ӽ־ļ,ٴ־ļжUTCʱ */
@@ -639,7 +639,23 @@ enum
     qtssSvrServerPlatform           = 39,   //read      //char array //Platform (OS) of the server
     qtssSvrRTSPServerComment        = 40,   //read      //char array //RTSP comment for the server header    
     qtssSvrNumThinned               = 41,    //r/w      //SInt32    //Number of thinned sessions
-    qtssSvrNumParams                = 42
+    qtssRTPSvrTotalUDPSendCalls     = 42,   //read      //UInt64    //Total number of system calls used to send RTP packets over UDP since startup
+    qtssRTPSvrTotalUDPSendPackets   = 43,   //read      //UInt64    //Total number of RTP packets sent over UDP since startup
+    qtssRTPSvrUDPPacketsPerSendCall = 44,   //read      //Float32   //RTP packets sent per UDP send system call over the last stats interval
+    qtssSvrTaskThreadQueueLengths   = 45,   //read      //UInt32    //Indexed parameter: tasks waiting in the queue of each task thread, sampled every stats interval
+    qtssSvrTaskThreadStolenTasks    = 46,   //read      //UInt32    //Indexed parameter: tasks each task thread has taken off the queues of other task threads since startup
+    qtssSvrFileBlockCacheHits       = 47,   //read      //UInt64    //Reads served from the shared file block cache since startup, one per block
+    qtssSvrFileBlockCacheMisses     = 48,   //read      //UInt64    //Blocks that had to be read from disk because they weren't in the shared file block cache
+    qtssSvrFileBlockCacheEvictions  = 49,   //read      //UInt64    //Blocks dropped from the shared file block cache to stay within its budget
+    qtssSvrFileBlockCacheBytesUsed  = 50,   //read      //UInt64    //Bytes currently held by the shared file block cache
+    qtssSvrRTSPListenerAccepts      = 51,   //read      //UInt32    //Indexed parameter: connections each RTSP listener has accepted since it was opened
+    qtssSvrRTSPListenerAcceptRates  = 52,   //read      //UInt32    //Indexed parameter: connections per second each RTSP listener accepted over the last stats interval
+    qtssRTPSvrTotalRetransmits      = 53,   //read      //UInt64    //Total number of RTP packets resent by reliable UDP since startup
+    qtssSvrMovieCacheHits           = 54,   //read      //UInt64    //Movie opens served by an already parsed movie since startup
+    qtssSvrMovieCacheMisses         = 55,   //read      //UInt64    //Movie opens that had to parse the movie since startup
+    qtssSvrMovieCacheEvictions      = 56,   //read      //UInt64    //Unused parsed movies closed to stay within max_cached_unused_movies
+    qtssSvrMovieCacheEntries        = 57,   //read      //UInt32    //Parsed movies currently open, in use or not
+    qtssSvrNumParams                = 58
 };
 typedef UInt32 QTSS_ServerAttributes;
 
@@ -737,7 +753,10 @@ enum
     qtssPrefsDisableThinning                = 69,   // "disable_thinning" //Bool16 // Usually used for performance testing. Turn off stream thinning from packet loss or stream lateness.
     qtssPrefsPlayersReqRTPHeader            = 70,   // "players_requires_rtp_header_info" //Char array //name of player to match against the player's user agent header
     qtssPrefsPlayersReqBandAdjust           = 71,   // "players_requires_bandwidth_adjustment //Char array //name of player to match against the player's user agent header
-    qtssPrefsNumParams                      = 72
+    qtssPrefsRunNumEventThreads             = 72,   //"run_num_event_threads" //UInt32 // if value is non-zero, will create that many socket event threads; otherwise one will be created for each processor
+    qtssPrefsEnableUDPGSO                   = 73,   //"enable_udp_gso" //Bool16 // Send runs of equal sized RTP packets as one UDP generic segmentation offload buffer.
+    qtssPrefsRTSPListenersPerPort           = 74,   //"rtsp_listeners_per_port" //UInt32 // number of SO_REUSEPORT listeners opened on each RTSP address and port, 0 means one per event thread
+    qtssPrefsNumParams                      = 75
 };
 
 typedef UInt32 QTSS_PrefsAttributes;
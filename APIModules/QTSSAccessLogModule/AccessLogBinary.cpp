@@ -0,0 +1,366 @@
+/***************************************************************************
+
+Copyright (c) 1999-2003 Apple Computer, Inc.  All Rights Reserved.
+2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 AccessLogBinary.cpp
+Description: The binary access log format, in which access log records are
+             kept as fixed width fields and interned strings.
+Comment:     used by QTSSAccessLogModule and AccessLogConverter
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-17
+LastUpdate:  2026-10-17
+
+****************************************************************************/
+
+
+#include <string.h>
+
+#include "AccessLogBinary.h"
+#include "OSMemory.h"
+#include "MyAssert.h"
+
+
+// The numbers of an entry: 3 64 bit fields, 14 32 bit fields and the transport
+static const UInt32 kEntryFieldsSize = (3 * 8) + (14 * 4) + 1;
+
+static UInt32   GetUInt16(char* inPtr);
+static UInt32   GetUInt32(char* inPtr);
+static UInt64   GetUInt64(char* inPtr);
+
+
+Bool16 AccessLogBinary::IsInterned(UInt32 inStringIndex)
+{
+    switch (inStringIndex)
+    {
+        case AccessLogRecord::kURL:
+        case AccessLogRecord::kPlayerID:
+        case AccessLogRecord::kUserAgent:
+        case AccessLogRecord::kAudioCodec:
+        case AccessLogRecord::kVideoCodec:
+        case AccessLogRecord::kLocalAddr:
+        case AccessLogRecord::kLocalDNS:
+            return true;
+    }
+    return false;
+}
+
+
+AccessLogBlockWriter::AccessLogBlockWriter(char* inBuffer, UInt32 inBufferSize)
+:   fBuffer(inBuffer),
+    fEndPut(inBuffer + inBufferSize),
+    fCurrentPut(NULL),
+    fNumStrings(0)
+{
+    Assert(inBufferSize > AccessLogBinary::kBlockHeaderSize);
+    this->Reset();
+}
+
+void AccessLogBlockWriter::Reset()
+{
+    fCurrentPut = fBuffer + AccessLogBinary::kBlockHeaderSize;
+    fNumStrings = 0;
+    ::memset(fHashSlots, 0, sizeof(fHashSlots));
+}
+
+StrPtrLen AccessLogBlockWriter::GetBlock()
+{
+    UInt32 theLength = (UInt32)(fCurrentPut - fBuffer);
+
+    fCurrentPut = fBuffer;
+    this->PutUInt32(AccessLogBinary::kBlockMagic);
+    this->PutUInt32(theLength - AccessLogBinary::kBlockHeaderSize);
+    fCurrentPut = fBuffer + theLength;
+
+    return StrPtrLen(fBuffer, theLength);
+}
+
+Bool16 AccessLogBlockWriter::AddEntry(AccessLogRecord* inRecord)
+{
+    StrPtrLen theStrings[AccessLogRecord::kNumStrings];
+    inRecord->GetStrings(theStrings);
+
+    //
+    // Work out the room the entry and its new string records take. A string
+    // that is in the entry twice is counted twice, which does no harm.
+    UInt32 theEntrySize = AccessLogBinary::kRecordHeaderSize + kEntryFieldsSize;
+    UInt32 theStringsSize = 0;
+    UInt32 theNumNewStrings = 0;
+    UInt32 theSlot = 0;
+
+    for (UInt32 x = 0; x < AccessLogRecord::kNumStrings; x++)
+    {
+        if (!AccessLogBinary::IsInterned(x))
+            theEntrySize += 2 + theStrings[x].Len;
+        else
+        {
+            theEntrySize += 2;
+            if (this->FindString(&theStrings[x], &theSlot) < 0)
+            {
+                theStringsSize += AccessLogBinary::kRecordHeaderSize + theStrings[x].Len;
+                theNumNewStrings++;
+            }
+        }
+    }
+
+    if ((theEntrySize > AccessLogBinary::kMaxRecordSize) ||
+        (fNumStrings + theNumNewStrings > kMaxStrings) ||
+        (theEntrySize + theStringsSize > (UInt32)(fEndPut - fCurrentPut)))
+        return false;
+
+    //
+    // Write the string records the entry needs first
+    UInt16 theStringIndexes[AccessLogRecord::kNumStrings];
+    for (UInt32 y = 0; y < AccessLogRecord::kNumStrings; y++)
+    {
+        if (!AccessLogBinary::IsInterned(y))
+            continue;
+
+        SInt32 theIndex = this->FindString(&theStrings[y], &theSlot);
+        if (theIndex < 0)
+        {
+            this->PutUInt16(AccessLogBinary::kRecordHeaderSize + theStrings[y].Len);
+            this->PutUInt8(AccessLogBinary::kStringRecord);
+
+            theIndex = (SInt32)fNumStrings++;
+            fStringPtr[theIndex] = fCurrentPut;
+            fStringLen[theIndex] = (UInt16)theStrings[y].Len;
+            fHashSlots[theSlot] = (UInt16)(theIndex + 1);
+
+            ::memcpy(fCurrentPut, theStrings[y].Ptr, theStrings[y].Len);
+            fCurrentPut += theStrings[y].Len;
+        }
+        theStringIndexes[y] = (UInt16)theIndex;
+    }
+
+    UInt64 theMovieDuration = 0;
+    Assert(sizeof(theMovieDuration) == sizeof(inRecord->fMovieDuration));
+    ::memcpy(&theMovieDuration, &inRecord->fMovieDuration, sizeof(theMovieDuration));
+
+    this->PutUInt16(theEntrySize);
+    this->PutUInt8(AccessLogBinary::kEntryRecord);
+    this->PutUInt64((UInt64)inRecord->fTime);
+    this->PutUInt64(theMovieDuration);
+    this->PutUInt64(inRecord->fMovieSize);
+    this->PutUInt32(inRecord->fStatusCode);
+    this->PutUInt32(inRecord->fStartPlayTime);
+    this->PutUInt32(inRecord->fDuration);
+    this->PutUInt32(inRecord->fAvgBandwidth);
+    this->PutUInt32(inRecord->fRTPBytesSent);
+    this->PutUInt32(inRecord->fRTCPBytesRecv);
+    this->PutUInt32(inRecord->fClientBytesRecv);
+    this->PutUInt32(inRecord->fRTPPacketsSent);
+    this->PutUInt32(inRecord->fClientPacketsRecv);
+    this->PutUInt32(inRecord->fClientPacketsLost);
+    this->PutUInt32(inRecord->fClientBufferTime);
+    this->PutUInt32(inRecord->fQuality);
+    this->PutUInt32(inRecord->fNumCurClients);
+    this->PutUInt32(inRecord->fCPUUtil);
+    this->PutUInt8(inRecord->fTransport);
+
+    for (UInt32 z = 0; z < AccessLogRecord::kNumStrings; z++)
+    {
+        if (AccessLogBinary::IsInterned(z))
+            this->PutUInt16(theStringIndexes[z]);
+        else
+        {
+            this->PutUInt16(theStrings[z].Len);
+            ::memcpy(fCurrentPut, theStrings[z].Ptr, theStrings[z].Len);
+            fCurrentPut += theStrings[z].Len;
+        }
+    }
+
+    return true;
+}
+
+Bool16 AccessLogBlockWriter::AddRemark(char* inRemark)
+{
+    UInt32 theLength = ::strlen(inRemark);
+    UInt32 theRecordSize = AccessLogBinary::kRecordHeaderSize + theLength;
+
+    if ((theRecordSize > AccessLogBinary::kMaxRecordSize) ||
+        (theRecordSize > (UInt32)(fEndPut - fCurrentPut)))
+        return false;
+
+    this->PutUInt16(theRecordSize);
+    this->PutUInt8(AccessLogBinary::kRemarkRecord);
+    ::memcpy(fCurrentPut, inRemark, theLength);
+    fCurrentPut += theLength;
+
+    return true;
+}
+
+SInt32 AccessLogBlockWriter::FindString(StrPtrLen* inString, UInt32* outSlot)
+{
+    // FNV-1a, probing linearly. The table is never more than half full.
+    UInt32 theHashValue = 2166136261U;
+    for (UInt32 x = 0; x < inString->Len; x++)
+    {
+        theHashValue ^= (UInt8)inString->Ptr[x];
+        theHashValue *= 16777619;
+    }
+
+    UInt32 theSlot = theHashValue & (kNumHashSlots - 1);
+    while (fHashSlots[theSlot] != 0)
+    {
+        UInt32 theIndex = fHashSlots[theSlot] - 1;
+        if ((fStringLen[theIndex] == inString->Len) &&
+            (::memcmp(fStringPtr[theIndex], inString->Ptr, inString->Len) == 0))
+        {
+            *outSlot = theSlot;
+            return (SInt32)theIndex;
+        }
+        theSlot = (theSlot + 1) & (kNumHashSlots - 1);
+    }
+
+    *outSlot = theSlot;
+    return -1;
+}
+
+void AccessLogBlockWriter::PutUInt8(UInt32 inValue)
+{
+    *fCurrentPut++ = (char)(inValue & 0xFF);
+}
+
+void AccessLogBlockWriter::PutUInt16(UInt32 inValue)
+{
+    *fCurrentPut++ = (char)((inValue >> 8) & 0xFF);
+    *fCurrentPut++ = (char)(inValue & 0xFF);
+}
+
+void AccessLogBlockWriter::PutUInt32(UInt32 inValue)
+{
+    this->PutUInt16((inValue >> 16) & 0xFFFF);
+    this->PutUInt16(inValue & 0xFFFF);
+}
+
+void AccessLogBlockWriter::PutUInt64(UInt64 inValue)
+{
+    this->PutUInt32((UInt32)((inValue >> 32) & 0xFFFFFFFF));
+    this->PutUInt32((UInt32)(inValue & 0xFFFFFFFF));
+}
+
+
+AccessLogBlockReader::AccessLogBlockReader(char* inRecords, UInt32 inLength)
+:   fCurrentGet(inRecords),
+    fEndGet(inRecords + inLength),
+    fNumStrings(0),
+    fStrings(NEW StrPtrLen[(inLength / AccessLogBinary::kRecordHeaderSize) + 1])
+{
+}
+
+UInt32 AccessLogBlockReader::Next(AccessLogRecord* ioRecord, StrPtrLen* outRemark)
+{
+    while (fCurrentGet < fEndGet)
+    {
+        if (fEndGet - fCurrentGet < AccessLogBinary::kRecordHeaderSize)
+            return kBadBlock;
+
+        char* theRecord = fCurrentGet;
+        UInt32 theLength = GetUInt16(theRecord);
+        if ((theLength < AccessLogBinary::kRecordHeaderSize) || (theLength > (UInt32)(fEndGet - fCurrentGet)))
+            return kBadBlock;
+
+        fCurrentGet += theLength;
+
+        char* theBody = theRecord + AccessLogBinary::kRecordHeaderSize;
+        UInt32 theBodyLen = theLength - AccessLogBinary::kRecordHeaderSize;
+
+        switch ((UInt8)theRecord[2])
+        {
+            case AccessLogBinary::kStringRecord:
+                fStrings[fNumStrings++].Set(theBody, theBodyLen);
+                break;
+
+            case AccessLogBinary::kEntryRecord:
+                return this->ReadEntry(theBody, theBodyLen, ioRecord);
+
+            case AccessLogBinary::kRemarkRecord:
+                outRemark->Set(theBody, theBodyLen);
+                return kRemark;
+
+            default:
+                // Newer record types are skipped
+                break;
+        }
+    }
+
+    return kEndOfBlock;
+}
+
+UInt32 AccessLogBlockReader::ReadEntry(char* inRecord, UInt32 inLength, AccessLogRecord* ioRecord)
+{
+    if (inLength < kEntryFieldsSize)
+        return kBadBlock;
+
+    char* theEnd = inRecord + inLength;
+    char* theGet = inRecord;
+
+    ::memset(ioRecord, 0, sizeof(AccessLogRecord));
+    ioRecord->fTime = (SInt64)GetUInt64(theGet);                theGet += 8;
+    UInt64 theMovieDuration = GetUInt64(theGet);                theGet += 8;
+    ::memcpy(&ioRecord->fMovieDuration, &theMovieDuration, sizeof(theMovieDuration));
+    ioRecord->fMovieSize = GetUInt64(theGet);                   theGet += 8;
+    ioRecord->fStatusCode = GetUInt32(theGet);                  theGet += 4;
+    ioRecord->fStartPlayTime = GetUInt32(theGet);               theGet += 4;
+    ioRecord->fDuration = GetUInt32(theGet);                    theGet += 4;
+    ioRecord->fAvgBandwidth = GetUInt32(theGet);                theGet += 4;
+    ioRecord->fRTPBytesSent = GetUInt32(theGet);                theGet += 4;
+    ioRecord->fRTCPBytesRecv = GetUInt32(theGet);               theGet += 4;
+    ioRecord->fClientBytesRecv = GetUInt32(theGet);             theGet += 4;
+    ioRecord->fRTPPacketsSent = GetUInt32(theGet);              theGet += 4;
+    ioRecord->fClientPacketsRecv = GetUInt32(theGet);           theGet += 4;
+    ioRecord->fClientPacketsLost = GetUInt32(theGet);           theGet += 4;
+    ioRecord->fClientBufferTime = GetUInt32(theGet);            theGet += 4;
+    ioRecord->fQuality = GetUInt32(theGet);                     theGet += 4;
+    ioRecord->fNumCurClients = GetUInt32(theGet);               theGet += 4;
+    ioRecord->fCPUUtil = GetUInt32(theGet);                     theGet += 4;
+    ioRecord->fTransport = (UInt8)*theGet;                      theGet += 1;
+
+    StrPtrLen theStrings[AccessLogRecord::kNumStrings];
+    for (UInt32 x = 0; x < AccessLogRecord::kNumStrings; x++)
+    {
+        if (theEnd - theGet < 2)
+            return kBadBlock;
+        UInt32 theValue = GetUInt16(theGet);
+        theGet += 2;
+
+        if (AccessLogBinary::IsInterned(x))
+        {
+            if (theValue >= fNumStrings)
+                return kBadBlock;
+            theStrings[x] = fStrings[theValue];
+        }
+        else
+        {
+            if (theValue > (UInt32)(theEnd - theGet))
+                return kBadBlock;
+            theStrings[x].Set(theGet, theValue);
+            theGet += theValue;
+        }
+    }
+
+    // The strings of an entry can't add up to more than a record
+    if (AccessLogRecord::GetSize(theStrings) > kMaxEntrySize)
+        return kBadBlock;
+
+    ioRecord->SetStrings(theStrings);
+    return kEntry;
+}
+
+
+UInt32 GetUInt16(char* inPtr)
+{
+    return ((UInt32)(UInt8)inPtr[0] << 8) | (UInt32)(UInt8)inPtr[1];
+}
+
+UInt32 GetUInt32(char* inPtr)
+{
+    return (GetUInt16(inPtr) << 16) | GetUInt16(inPtr + 2);
+}
+
+UInt64 GetUInt64(char* inPtr)
+{
+    return ((UInt64)GetUInt32(inPtr) << 32) | (UInt64)GetUInt32(inPtr + 4);
+}
@@ -0,0 +1,160 @@
+/***************************************************************************
+
+Copyright (c) 1999-2003 Apple Computer, Inc.  All Rights Reserved.
+2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 AccessLogBinary.h
+Description: The binary access log format, in which access log records are
+             kept as fixed width fields and interned strings.
+Comment:     used by QTSSAccessLogModule and AccessLogConverter
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-17
+LastUpdate:  2026-10-17
+
+****************************************************************************/
+
+
+#ifndef __ACCESSLOGBINARY_H__
+#define __ACCESSLOGBINARY_H__
+
+#include "OSHeaders.h"
+#include "StrPtrLen.h"
+#include "AccessLogRecord.h"
+
+//
+// A binary access log starts with the same "#" header lines as the text log,
+// so that QTSSRollingLog can read its create time. Blocks follow, each one
+// written to the log at once:
+//
+//      UInt32      kBlockMagic
+//      UInt32      length of the records that follow
+//      records
+//
+// and each record is
+//
+//      UInt16      length of the record, these 3 bytes included
+//      UInt8       type
+//      ...
+//
+// A kStringRecord holds a string, which is given the next index in the block,
+// starting at 0. A kEntryRecord holds an AccessLogRecord: its numbers as
+// fixed width fields, and for each string either the index of a string
+// record earlier in the block (for the strings that repeat from one entry to
+// the next, such as the URL and the user agent) or a UInt16 length and the
+// string. A kRemarkRecord holds a "#Remark:" line of the log.
+//
+// Everything is in network byte order. As string indexes don't outlive their
+// block, a block can be read on its own, and a log rolled between two
+// blocks needs nothing from the previous file.
+
+class AccessLogBinary
+{
+    public:
+
+        enum
+        {
+            kBlockMagic         = 0x00414C42,   // "\0ALB", never the start of a text line
+            kBlockHeaderSize    = 8,
+            kRecordHeaderSize   = 3,
+            kMaxRecordSize      = 0xFFFF
+        };
+
+        enum
+        {
+            kStringRecord   = 1,
+            kEntryRecord    = 2,
+            kRemarkRecord   = 3
+        };
+
+        // Whether each AccessLogRecord string is interned
+        static Bool16   IsInterned(UInt32 inStringIndex);
+};
+
+//
+// Builds a block in the buffer given. Add returns false, and adds nothing, if
+// the record doesn't fit; the caller then writes out the block, resets it and
+// adds the record again.
+
+class AccessLogBlockWriter
+{
+    public:
+
+        AccessLogBlockWriter(char* inBuffer, UInt32 inBufferSize);
+        ~AccessLogBlockWriter() {}
+
+        Bool16      AddEntry(AccessLogRecord* inRecord);
+        Bool16      AddRemark(char* inRemark);
+
+        Bool16      IsEmpty() { return fCurrentPut == fBuffer + AccessLogBinary::kBlockHeaderSize; }
+
+        //
+        // Returns the block as it is to be written
+        StrPtrLen   GetBlock();
+
+        //
+        // Starts a new block. The strings of the old one are forgotten.
+        void        Reset();
+
+    private:
+
+        enum
+        {
+            kMaxStrings     = 2048,     //UInt32
+            kNumHashSlots   = 4096      //UInt32, twice kMaxStrings and a power of 2
+        };
+
+        SInt32      FindString(StrPtrLen* inString, UInt32* outSlot);
+        void        PutUInt8(UInt32 inValue);
+        void        PutUInt16(UInt32 inValue);
+        void        PutUInt32(UInt32 inValue);
+        void        PutUInt64(UInt64 inValue);
+
+        char*       fBuffer;
+        char*       fEndPut;
+        char*       fCurrentPut;
+
+        UInt32      fNumStrings;
+        char*       fStringPtr[kMaxStrings];
+        UInt16      fStringLen[kMaxStrings];
+        UInt16      fHashSlots[kNumHashSlots];  // string index + 1, or 0 if free
+};
+
+//
+// Reads the records of a block, given without its header
+
+class AccessLogBlockReader
+{
+    public:
+
+        AccessLogBlockReader(char* inRecords, UInt32 inLength);
+        ~AccessLogBlockReader() { delete [] fStrings; }
+
+        enum
+        {
+            kEndOfBlock     = 0,
+            kEntry          = 1,
+            kRemark         = 2,
+            kBadBlock       = 3,
+
+            // ioRecord must have room for the largest entry, header included
+            kMaxEntrySize   = sizeof(AccessLogRecord) + AccessLogBinary::kMaxRecordSize + 8
+        };
+
+        //
+        // Skips string records, and returns the next entry in ioRecord or the
+        // next remark in outRemark.
+        UInt32      Next(AccessLogRecord* ioRecord, StrPtrLen* outRemark);
+
+    private:
+
+        UInt32      ReadEntry(char* inRecord, UInt32 inLength, AccessLogRecord* ioRecord);
+
+        char*       fCurrentGet;
+        char*       fEndGet;
+
+        UInt32      fNumStrings;
+        StrPtrLen*  fStrings;   // enough for a block of nothing but string records
+};
+
+#endif //__ACCESSLOGBINARY_H__
@@ -0,0 +1,167 @@
+/***************************************************************************
+
+Copyright (c) 1999-2003 Apple Computer, Inc.  All Rights Reserved.
+2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 AccessLogConverter.cpp
+Description: Converts binary access logs ("StreamingServer*.binlog") to the
+             W3C text format of the access log, written to stdout.
+Comment:     usage: AccessLogConverter binlog ...
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-17
+LastUpdate:  2026-10-17
+
+****************************************************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SafeStdLib.h"
+#include "StringFormatter.h"
+#include "AccessLogRecord.h"
+#include "AccessLogBinary.h"
+
+enum
+{
+    kMaxHeaderLineSizeInBytes = 1024,   //UInt32
+    kMaxLineSizeInBytes = 70000         //UInt32, a line of the largest entry
+};
+
+static AccessLogFormatter   sFormatter;
+static char                 sLineBuffer[kMaxLineSizeInBytes];
+static char                 sRecordBuffer[AccessLogBlockReader::kMaxEntrySize];
+
+static Bool16 ConvertBlock(char* inRecords, UInt32 inLength)
+{
+    AccessLogBlockReader theReader(inRecords, inLength);
+    AccessLogRecord* theRecord = (AccessLogRecord*)sRecordBuffer;
+    StrPtrLen theRemark;
+
+    while (true)
+    {
+        switch (theReader.Next(theRecord, &theRemark))
+        {
+            case AccessLogBlockReader::kEndOfBlock:
+                return true;
+
+            case AccessLogBlockReader::kEntry:
+            {
+                StringFormatter theLine(sLineBuffer, kMaxLineSizeInBytes);
+                sFormatter.FormatW3C(theRecord, &theLine);
+                (void)::fwrite(theLine.GetBufPtr(), 1, theLine.GetCurrentOffset(), stdout);
+                break;
+            }
+
+            case AccessLogBlockReader::kRemark:
+                (void)::fwrite(theRemark.Ptr, 1, theRemark.Len, stdout);
+                break;
+
+            default:
+                return false;
+        }
+    }
+}
+
+static Bool16 ConvertLog(const char * logPath)
+{
+    FILE*   file;
+    char    *block = NULL;
+    UInt32  blockSize = 0;
+    UInt32  numBlocks = 0;
+    Bool16  converted = true;
+
+    file = ::fopen(logPath, "rb");
+    if( file == NULL )
+    {
+        qtss_fprintf(stderr, "%s: can't open the log.\n", logPath);
+        return false;
+    }
+
+    while( true )
+    {
+        int firstChar = ::getc(file);
+        if( firstChar == EOF )
+            break;
+
+        //
+        // The header lines are text, as in the text log. The last one tells
+        // whether the times are in GMT.
+        if( firstChar == '#' )
+        {
+            char line[kMaxHeaderLineSizeInBytes];
+            line[0] = '#';
+            if( ::fgets(&line[1], sizeof(line) - 1, file) == NULL )
+                line[1] = '\0';
+
+            if( ::strstr(line, "#Remark: all time values are in") == line )
+                sFormatter.SetLogTimeInGMT(::strstr(line, "local time") == NULL);
+
+            (void)::fputs(line, stdout);
+            continue;
+        }
+
+        unsigned char header[AccessLogBinary::kBlockHeaderSize];
+        header[0] = (unsigned char)firstChar;
+        if( ::fread(&header[1], 1, sizeof(header) - 1, file) != sizeof(header) - 1 )
+        {
+            qtss_fprintf(stderr, "%s: block %lu is cut short.\n", logPath, numBlocks);
+            converted = false;
+            break;
+        }
+
+        UInt32 magic = ((UInt32)header[0] << 24) | ((UInt32)header[1] << 16) | ((UInt32)header[2] << 8) | header[3];
+        UInt32 length = ((UInt32)header[4] << 24) | ((UInt32)header[5] << 16) | ((UInt32)header[6] << 8) | header[7];
+        if( magic != AccessLogBinary::kBlockMagic )
+        {
+            qtss_fprintf(stderr, "%s: block %lu has a bad header.\n", logPath, numBlocks);
+            converted = false;
+            break;
+        }
+
+        if( length > blockSize )
+        {
+            delete [] block;
+            blockSize = length;
+            block = new char[blockSize];
+        }
+
+        if( ::fread(block, 1, length, file) != length )
+        {
+            qtss_fprintf(stderr, "%s: block %lu is cut short.\n", logPath, numBlocks);
+            converted = false;
+            break;
+        }
+
+        // A bad block is reported, and the next one is read anyway
+        if( !ConvertBlock(block, length) )
+        {
+            qtss_fprintf(stderr, "%s: block %lu is bad.\n", logPath, numBlocks);
+            converted = false;
+        }
+        numBlocks++;
+    }
+
+    delete [] block;
+    ::fclose(file);
+    return converted;
+}
+
+int main(int argc, char * argv[])
+{
+    int     result = 0;
+
+    if( argc < 2 )
+    {
+        qtss_fprintf(stderr, "usage: %s binlog ...\n", argv[0]);
+        return 1;
+    }
+
+    for( int curArg = 1; curArg < argc; curArg++ )
+        if( !ConvertLog(argv[curArg]) )
+            result = 1;
+
+    return result;
+}
@@ -0,0 +1,149 @@
+/***************************************************************************
+
+Copyright (c) 1999-2003 Apple Computer, Inc.  All Rights Reserved.
+2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 AccessLogQueue.cpp
+Description: Per thread rings that carry access log records from the threads
+             closing client sessions to the thread writing the access log.
+Comment:     used by QTSSAccessLogModule
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-17
+LastUpdate:  2026-10-17
+
+****************************************************************************/
+
+
+#include <string.h>
+
+#include "AccessLogQueue.h"
+#include "OSThread.h"
+#include "OSMemory.h"
+#include "atomic.h"
+#include "MyAssert.h"
+
+
+AccessLogQueue::Ring*   AccessLogQueue::sRings[kMaxThreads];
+OSMutex                 AccessLogQueue::sSharedRingMutex;
+UInt32                  AccessLogQueue::sRingSize = 65536;
+unsigned int            AccessLogQueue::sNumDropped = 0;
+
+
+void AccessLogQueue::SetRingSize(UInt32 inRingSize)
+{
+    UInt32 theRingSize = kMinRingSize;
+    while ((theRingSize < inRingSize) && (theRingSize < 0x40000000))
+        theRingSize <<= 1;
+
+    sRingSize = theRingSize;
+}
+
+AccessLogQueue::Ring* AccessLogQueue::MakeRing()
+{
+    Ring* theRing = NEW Ring;
+    theRing->fHead = 0;
+    theRing->fTail = 0;
+    theRing->fSize = sRingSize;
+    theRing->fBuffer = NEW char[theRing->fSize];
+    return theRing;
+}
+
+Bool16 AccessLogQueue::Push(AccessLogRecord* inRecord, StrPtrLen* inStrings, Bool16* outNeedsDraining)
+{
+    *outNeedsDraining = false;
+
+    OSThread* theThread = OSThread::GetCurrent();
+    UInt32 theIndex = (theThread == NULL) ? 0 : theThread->GetThreadIndex();
+    if (theIndex >= kMaxThreads)
+        theIndex = 0;
+
+    // Ring 0 is the only one with more than one producer
+    OSMutexLocker locker((theIndex == 0) ? &sSharedRingMutex : NULL);
+
+    Ring* theRing = sRings[theIndex];
+    if (theRing == NULL)
+    {
+        // Only this thread stores to the slot. The swap's barrier makes the
+        // ring whole before the draining thread can see it.
+        theRing = MakeRing();
+        (void)atomic_swap_ptr((void**)&sRings[theIndex], theRing);
+    }
+
+    UInt32 theRecordSize = AccessLogRecord::GetSize(inStrings);
+    unsigned int theHead = theRing->fHead;
+    unsigned int theTail = atomic_add(&theRing->fTail, 0);
+    UInt32 theUsed = theHead - theTail;
+    UInt32 theOffset = theHead & (theRing->fSize - 1);
+
+    // A record is never split across the end of the buffer. The space up to
+    // the end is skipped instead, marked by a 0 length.
+    UInt32 theSkip = 0;
+    if (theRecordSize > theRing->fSize - theOffset)
+        theSkip = theRing->fSize - theOffset;
+
+    if (theUsed + theSkip + theRecordSize > theRing->fSize)
+    {
+        (void)atomic_add(&sNumDropped, 1);
+        *outNeedsDraining = true;
+        return false;
+    }
+
+    if (theSkip > 0)
+    {
+        *(UInt32*)&theRing->fBuffer[theOffset] = 0;
+        theOffset = 0;
+    }
+
+    AccessLogRecord* theRecord = (AccessLogRecord*)&theRing->fBuffer[theOffset];
+    ::memcpy(theRecord, inRecord, sizeof(AccessLogRecord));
+    theRecord->SetStrings(inStrings);
+
+    (void)atomic_add(&theRing->fHead, (int)(theSkip + theRecordSize));
+
+    *outNeedsDraining = (theUsed + theSkip + theRecordSize > theRing->fSize / 2);
+    return true;
+}
+
+UInt32 AccessLogQueue::Drain(DrainProc inProc, void* inRefCon)
+{
+    UInt32 theNumRecords = 0;
+
+    for (UInt32 theIndex = 0; theIndex < kMaxThreads; theIndex++)
+    {
+        Ring* theRing = sRings[theIndex];
+        if (theRing == NULL)
+            continue;
+
+        unsigned int theHead = atomic_add(&theRing->fHead, 0);
+        unsigned int theTail = theRing->fTail;
+        if (theHead == theTail)
+            continue;
+
+        while (theTail != theHead)
+        {
+            UInt32 theOffset = theTail & (theRing->fSize - 1);
+            AccessLogRecord* theRecord = (AccessLogRecord*)&theRing->fBuffer[theOffset];
+            if (theRecord->fLength == 0)
+            {
+                theTail += theRing->fSize - theOffset;
+                continue;
+            }
+
+            Assert(theRecord->fLength <= theHead - theTail);
+            inProc(theRecord, inRefCon);
+            theTail += theRecord->fLength;
+            theNumRecords++;
+        }
+
+        // Hand the space back once the records have all been used
+        (void)atomic_add(&theRing->fTail, (int)(theHead - theRing->fTail));
+    }
+
+    return theNumRecords;
+}
+
+UInt32 AccessLogQueue::GetNumDropped()
+{
+    return atomic_add(&sNumDropped, 0);
+}
@@ -0,0 +1,92 @@
+/***************************************************************************
+
+Copyright (c) 1999-2003 Apple Computer, Inc.  All Rights Reserved.
+2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 AccessLogQueue.h
+Description: Per thread rings that carry access log records from the threads
+             closing client sessions to the thread writing the access log.
+Comment:     used by QTSSAccessLogModule
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-17
+LastUpdate:  2026-10-17
+
+****************************************************************************/
+
+
+#ifndef __ACCESSLOGQUEUE_H__
+#define __ACCESSLOGQUEUE_H__
+
+#include "OSHeaders.h"
+#include "OSMutex.h"
+#include "AccessLogRecord.h"
+
+//
+// Each OSThread pushes onto its own ring, found by OSThread::GetThreadIndex,
+// and a single thread at a time drains them all. A ring has one producer and
+// one consumer, so neither takes a lock: the producer alone moves a ring's
+// head and the consumer alone its tail, each with atomic_add, whose barrier
+// makes the record bytes visible before the new position is.
+//
+// Threads that aren't OSThreads, and any OSThreads beyond the first
+// kMaxThreads - 1, share ring 0 under a mutex. Rings are made the first time
+// their thread pushes a record, with the ring size of the time. A record that
+// doesn't fit in its ring is dropped and counted.
+
+class AccessLogQueue
+{
+    public:
+
+        enum
+        {
+            kMaxThreads     = 128,      //UInt32
+            kMinRingSize    = 4096      //UInt32
+        };
+
+        typedef void (*DrainProc)(AccessLogRecord* inRecord, void* inRefCon);
+
+        //
+        // Size in bytes of rings made from now on. Rounded up to a power of 2.
+        static void     SetRingSize(UInt32 inRingSize);
+
+        //
+        // Copies the record and its strings onto the calling thread's ring.
+        // Returns false if it was dropped. Returns true if the ring is now more
+        // than half full, in outNeedsDraining.
+        static Bool16   Push(AccessLogRecord* inRecord, StrPtrLen* inStrings, Bool16* outNeedsDraining);
+
+        //
+        // Calls inProc for each record pushed so far, in order for each ring,
+        // then frees their space. The record is only valid during the call.
+        // Returns the number of records. Callers must not drain at the same time.
+        static UInt32   Drain(DrainProc inProc, void* inRefCon);
+
+        //
+        // Records dropped since startup
+        static UInt32   GetNumDropped();
+
+    private:
+
+        struct Ring
+        {
+            // Positions, in bytes pushed and drained since the ring was made.
+            // They wrap, and the ring size divides 2^32.
+            unsigned int    fHead;
+            char            fHeadPad[60];
+            unsigned int    fTail;
+            char            fTailPad[60];
+
+            char*           fBuffer;
+            UInt32          fSize;
+        };
+
+        static Ring*    MakeRing();
+
+        static Ring*        sRings[kMaxThreads];
+        static OSMutex      sSharedRingMutex;
+        static UInt32       sRingSize;
+        static unsigned int sNumDropped;
+};
+
+#endif //__ACCESSLOGQUEUE_H__
@@ -0,0 +1,270 @@
+/***************************************************************************
+
+Copyright (c) 1999-2003 Apple Computer, Inc.  All Rights Reserved.
+2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 AccessLogRecord.cpp
+Description: The fields of one access log entry, as gathered when a client
+             session closes, and their W3C extended log file format line.
+Comment:     used by QTSSAccessLogModule
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-17
+LastUpdate:  2026-10-17
+
+****************************************************************************/
+
+
+#include <string.h>
+#include <time.h>
+
+#include "SafeStdLib.h"
+#include "AccessLogRecord.h"
+#include "StringParser.h"
+#include "UserAgentParser.h"
+#include "MyAssert.h"
+
+
+static char*    sVoidField = "-";
+
+static void     ReplaceSpaces(StrPtrLen *sourcePtr, StrPtrLen *destPtr, char *replaceStr);
+static void     PutField(StringFormatter* ioLine, char* inField);
+static void     PutField(StringFormatter* ioLine, StrPtrLen* inField, UInt32 inMaxLen);
+static void     PutNumber(StringFormatter* ioLine, UInt64 inNumber);
+
+
+UInt32 AccessLogRecord::GetSize(StrPtrLen* inStrings)
+{
+    UInt32 theSize = sizeof(AccessLogRecord);
+    for (UInt32 x = 0; x < kNumStrings; x++)
+        theSize += inStrings[x].Len;
+
+    return (theSize + 7) & ~7UL;
+}
+
+void AccessLogRecord::SetStrings(StrPtrLen* inStrings)
+{
+    char* theStringPtr = (char*)(this + 1);
+    for (UInt32 x = 0; x < kNumStrings; x++)
+    {
+        Assert(inStrings[x].Len <= 0xFFFF);
+        ::memcpy(theStringPtr, inStrings[x].Ptr, inStrings[x].Len);
+        theStringPtr += inStrings[x].Len;
+        fStringLen[x] = (UInt16)inStrings[x].Len;
+    }
+    fLength = GetSize(inStrings);
+}
+
+void AccessLogRecord::GetStrings(StrPtrLen* outStrings)
+{
+    char* theStringPtr = (char*)(this + 1);
+    for (UInt32 x = 0; x < kNumStrings; x++)
+    {
+        outStrings[x].Set(theStringPtr, fStringLen[x]);
+        theStringPtr += fStringLen[x];
+    }
+}
+
+
+void AccessLogFormatter::SetLogTimeInGMT(Bool16 inLogTimeInGMT)
+{
+    if (inLogTimeInGMT != fLogTimeInGMT)
+        fLastTime = -1;
+    fLogTimeInGMT = inLogTimeInGMT;
+}
+
+void AccessLogFormatter::FormatW3C(AccessLogRecord* inRecord, StringFormatter* ioLine)
+{
+    enum
+    {
+        eTempLogItemSize    = 256,
+        eUserAgentSize      = 256,
+        ePlayerFieldSize    = 32
+    };
+
+    StrPtrLen theStrings[AccessLogRecord::kNumStrings];
+    inRecord->GetStrings(theStrings);
+
+    char userAgentBuf[eUserAgentSize] = { 0 };
+    StrPtrLen userAgent(userAgentBuf, eUserAgentSize - 1);
+    ReplaceSpaces(&theStrings[AccessLogRecord::kUserAgent], &userAgent, "%20");
+
+    UserAgentParser userAgentParser(&userAgent);
+
+    char lastUserNameBuf[eTempLogItemSize + 1] = { 0 };
+    StrPtrLen lastUserName(lastUserNameBuf, eTempLogItemSize);
+    ReplaceSpaces(&theStrings[AccessLogRecord::kUserName], &lastUserName, "%20");
+
+    char lastURLRealmBuf[eTempLogItemSize + 1] = { 0 };
+    StrPtrLen lastURLRealm(lastURLRealmBuf, eTempLogItemSize);
+    ReplaceSpaces(&theStrings[AccessLogRecord::kRealm], &lastURLRealm, "%20");
+
+    PutField(ioLine, &theStrings[AccessLogRecord::kRemoteAddr], 0);            //c-ip*
+    this->PutDate(inRecord->fTime, ioLine);                                     //date* time*
+    PutField(ioLine, &theStrings[AccessLogRecord::kRemoteDNS], 0);             //c-dns
+    PutField(ioLine, &theStrings[AccessLogRecord::kURL], 0);                   //cs-uri-stem*
+    PutNumber(ioLine, inRecord->fStartPlayTime);                                //c-starttime
+    PutNumber(ioLine, inRecord->fDuration);                                     //x-duration*
+    PutNumber(ioLine, 1);                                                       //c-rate
+    PutNumber(ioLine, inRecord->fStatusCode);                                   //c-status*
+    PutField(ioLine, &theStrings[AccessLogRecord::kPlayerID], 0);              //c-playerid*
+    PutField(ioLine, userAgentParser.GetUserVersion(), ePlayerFieldSize - 1);   //c-playerversion
+    PutField(ioLine, userAgentParser.GetUserLanguage(), ePlayerFieldSize - 1);  //c-playerlanguage*
+    PutField(ioLine, userAgentBuf);                                             //cs(User-Agent)
+    PutField(ioLine, userAgentParser.GetrUserOS(), ePlayerFieldSize - 1);       //c-os*
+    PutField(ioLine, userAgentParser.GetUserOSVersion(), ePlayerFieldSize - 1); //c-osversion
+    PutField(ioLine, userAgentParser.GetUserCPU(), ePlayerFieldSize - 1);       //c-cpu*
+
+    // Rounded the way printf rounds
+    char theDurationBuf[64];
+    qtss_snprintf(theDurationBuf, sizeof(theDurationBuf), "%0.0f", inRecord->fMovieDuration);
+    PutField(ioLine, theDurationBuf);                                           //filelength in secs*
+
+    PutNumber(ioLine, inRecord->fMovieSize);                                    //filesize in bytes*
+    PutNumber(ioLine, inRecord->fAvgBandwidth);                                 //avgbandwidth in bits per second
+    PutField(ioLine, "RTP");                                                    //protocol
+    if (inRecord->fTransport == AccessLogRecord::kTransportUDP)                 //transport
+        PutField(ioLine, "UDP");
+    else if (inRecord->fTransport == AccessLogRecord::kTransportTCP)
+        PutField(ioLine, "TCP");
+    else
+        PutField(ioLine, sVoidField);
+    PutField(ioLine, &theStrings[AccessLogRecord::kAudioCodec], 0);            //audiocodec*
+    PutField(ioLine, &theStrings[AccessLogRecord::kVideoCodec], 0);            //videocodec*
+    PutNumber(ioLine, inRecord->fRTPBytesSent);                                 //sc-bytes*
+    PutNumber(ioLine, inRecord->fRTCPBytesRecv);                                //cs-bytes*
+    PutNumber(ioLine, inRecord->fClientBytesRecv);                              //c-bytes
+    PutNumber(ioLine, inRecord->fRTPPacketsSent);                               //s-pkts-sent*
+    PutNumber(ioLine, inRecord->fClientPacketsRecv);                            //c-pkts-recieved
+    PutNumber(ioLine, inRecord->fClientPacketsLost);                            //c-pkts-lost-client*
+    PutNumber(ioLine, 1);                                                       //c-buffercount
+    PutNumber(ioLine, inRecord->fClientBufferTime);                             //c-totalbuffertime*
+    PutNumber(ioLine, inRecord->fQuality);                                      //c-quality
+    PutField(ioLine, &theStrings[AccessLogRecord::kLocalAddr], 0);             //s-ip
+    PutField(ioLine, &theStrings[AccessLogRecord::kLocalDNS], 0);              //s-dns
+    PutNumber(ioLine, inRecord->fNumCurClients);                                //s-totalclients
+    PutNumber(ioLine, inRecord->fCPUUtil);                                      //s-cpu-util
+    PutField(ioLine, &theStrings[AccessLogRecord::kQuery], 0);                 //cs-uri-query
+    PutField(ioLine, lastUserNameBuf);                                          //c-username
+    PutField(ioLine, lastURLRealmBuf);                                          //sc(Realm)
+
+    ioLine->PutChar('\n');
+}
+
+void AccessLogFormatter::PutDate(SInt64 inTime, StringFormatter* ioLine)
+{
+    if (inTime != fLastTime)
+    {
+        fDateBuffer[0] = '\0';
+        fLastTime = inTime;
+
+        // date time needs to look like this for extended log file format: 2001-03-16 23:34:54
+        time_t calendarTime = (time_t)inTime;
+        struct tm  timeResult;
+        struct tm* theTime = NULL;
+        if (fLogTimeInGMT)
+            theTime = ::qtss_gmtime(&calendarTime, &timeResult);
+        else
+            theTime = qtss_localtime(&calendarTime, &timeResult);
+
+        if (theTime != NULL)
+            qtss_strftime(fDateBuffer, kMaxDateBufferSizeInBytes, "%Y-%m-%d %H:%M:%S", theTime);
+    }
+
+    PutField(ioLine, fDateBuffer);
+}
+
+
+void ReplaceSpaces(StrPtrLen *sourcePtr, StrPtrLen *destPtr, char *replaceStr)
+{
+
+    if ( (NULL != destPtr) && (NULL != destPtr->Ptr) && (0 < destPtr->Len) ) destPtr->Ptr[0] = 0;
+    do
+    {
+        if  (  (NULL == sourcePtr)
+            || (NULL == destPtr)
+            || (NULL == sourcePtr->Ptr)
+            || (NULL == destPtr->Ptr)
+            || (0 == sourcePtr->Len)
+            || (0 == destPtr->Len)
+            )    break;
+
+        if (0 == sourcePtr->Ptr[0])
+        {
+            destPtr->Len = 0;
+            break;
+        }
+
+        const StrPtrLen replaceValue(replaceStr);
+        StringFormatter formattedString(destPtr->Ptr, destPtr->Len);
+        StringParser sourceStringParser(sourcePtr);
+        StrPtrLen preStopChars;
+
+        do
+        {   sourceStringParser.ConsumeUntil(&preStopChars, StringParser::sEOLWhitespaceMask);
+            if (preStopChars.Len > 0)
+            {   formattedString.Put(preStopChars);// copy the string up to the space or eol. it will be truncated if there's not enough room.
+                if ( sourceStringParser.Expect(' ') && (formattedString.GetSpaceLeft() > replaceValue.Len) )
+                {   formattedString.Put(replaceValue.Ptr, replaceValue.Len);
+                }
+                else //no space character or no room for replacement
+                {    break;
+                }
+            }
+
+        } while ( preStopChars.Len != 0);
+
+        destPtr->Set(formattedString.GetBufPtr(), formattedString.GetBytesWritten() );
+
+    } while (false);
+}
+
+//
+// Puts the string up to its terminator, or "-" if it is empty, then a space
+void PutField(StringFormatter* ioLine, char* inField)
+{
+    if (inField[0] == '\0')
+        ioLine->Put(sVoidField, 1);
+    else
+        ioLine->Put(inField, ::strlen(inField));
+    ioLine->PutChar(' ');
+}
+
+//
+// The same for a string that may not be terminated, cut to inMaxLen if that
+// isn't 0
+void PutField(StringFormatter* ioLine, StrPtrLen* inField, UInt32 inMaxLen)
+{
+    UInt32 theLen = 0;
+    if (inField->Ptr != NULL)
+    {
+        theLen = inField->Len;
+        if ((inMaxLen > 0) && (theLen > inMaxLen))
+            theLen = inMaxLen;
+
+        char* theTerminator = (char*)::memchr(inField->Ptr, '\0', theLen);
+        if (theTerminator != NULL)
+            theLen = (UInt32)(theTerminator - inField->Ptr);
+    }
+
+    if (theLen == 0)
+        ioLine->Put(sVoidField, 1);
+    else
+        ioLine->Put(inField->Ptr, theLen);
+    ioLine->PutChar(' ');
+}
+
+void PutNumber(StringFormatter* ioLine, UInt64 inNumber)
+{
+    char theDigits[24];
+    char* theDigitPtr = &theDigits[sizeof(theDigits)];
+
+    *--theDigitPtr = ' ';
+    do
+    {
+        *--theDigitPtr = (char)('0' + (inNumber % 10));
+        inNumber /= 10;
+    } while (inNumber != 0);
+
+    ioLine->Put(theDigitPtr, (UInt32)(&theDigits[sizeof(theDigits)] - theDigitPtr));
+}
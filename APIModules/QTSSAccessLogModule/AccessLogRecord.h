@@ -0,0 +1,130 @@
+/***************************************************************************
+
+Copyright (c) 1999-2003 Apple Computer, Inc.  All Rights Reserved.
+2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 AccessLogRecord.h
+Description: The fields of one access log entry, as gathered when a client
+             session closes, and their W3C extended log file format line.
+Comment:     used by QTSSAccessLogModule
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-17
+LastUpdate:  2026-10-17
+
+****************************************************************************/
+
+
+#ifndef __ACCESSLOGRECORD_H__
+#define __ACCESSLOGRECORD_H__
+
+#include <time.h>
+
+#include "OSHeaders.h"
+#include "StrPtrLen.h"
+#include "StringFormatter.h"
+
+//
+// A record is this header followed by its strings, without terminators, in
+// the order of the string indexes below. The strings are kept as the server
+// returned them; replacing spaces and parsing the user agent are left to
+// whoever formats the record, so that LogRequest does as little as it can.
+// fLength covers the header and the strings and is a multiple of 8, so that
+// records can be laid end to end.
+
+class AccessLogRecord
+{
+    public:
+
+        enum
+        {
+            kRemoteAddr     = 0,    // c-ip
+            kRemoteDNS      = 1,    // c-dns
+            kURL            = 2,    // cs-uri-stem
+            kPlayerID       = 3,    // c-playerid
+            kUserAgent      = 4,    // cs(User-Agent)
+            kAudioCodec     = 5,    // audiocodec
+            kVideoCodec     = 6,    // videocodec
+            kLocalAddr      = 7,    // s-ip
+            kLocalDNS       = 8,    // s-dns
+            kQuery          = 9,    // cs-uri-query
+            kUserName       = 10,   // c-username
+            kRealm          = 11,   // sc(Realm)
+            kNumStrings     = 12
+        };
+
+        enum
+        {
+            kTransportUnknown   = 0,
+            kTransportUDP       = 1,
+            kTransportTCP       = 2
+        };
+
+        UInt32      fLength;
+        UInt32      fStatusCode;            // c-status
+        SInt64      fTime;                  // date time, in secs since 1970
+        Float64     fMovieDuration;         // filelength, in secs
+        UInt64      fMovieSize;             // filesize
+        UInt32      fStartPlayTime;         // c-starttime, in secs
+        UInt32      fDuration;              // x-duration, in secs
+        UInt32      fAvgBandwidth;          // avgbandwidth
+        UInt32      fRTPBytesSent;          // sc-bytes
+        UInt32      fRTCPBytesRecv;         // cs-bytes
+        UInt32      fClientBytesRecv;       // c-bytes
+        UInt32      fRTPPacketsSent;        // s-pkts-sent
+        UInt32      fClientPacketsRecv;     // c-pkts-received
+        UInt32      fClientPacketsLost;     // c-pkts-lost-client
+        UInt32      fClientBufferTime;      // c-totalbuffertime, in secs
+        UInt32      fQuality;               // c-quality, in percent
+        UInt32      fNumCurClients;         // s-totalclients
+        UInt32      fCPUUtil;               // s-cpu-util, in percent
+        UInt16      fTransport;
+        UInt16      fStringLen[kNumStrings];
+
+        //
+        // The size of a record holding these strings
+        static UInt32   GetSize(StrPtrLen* inStrings);
+
+        //
+        // Copies the strings in after the header, and sets fStringLen and fLength.
+        // The record must have GetSize(inStrings) bytes.
+        void        SetStrings(StrPtrLen* inStrings);
+
+        //
+        // Points outStrings at the strings of the record
+        void        GetStrings(StrPtrLen* outStrings);
+};
+
+//
+// Formats records as lines of the access log, the fields in the order of the
+// log header's "#Fields:" line. Numbers are converted by hand, and the date of
+// the previous record is kept, as most lines in a batch share it.
+
+class AccessLogFormatter
+{
+    public:
+
+        AccessLogFormatter() : fLogTimeInGMT(true), fLastTime(-1) { fDateBuffer[0] = '\0'; }
+        ~AccessLogFormatter() {}
+
+        void        SetLogTimeInGMT(Bool16 inLogTimeInGMT);
+
+        //
+        // Appends the line, with its "\n", to ioLine
+        void        FormatW3C(AccessLogRecord* inRecord, StringFormatter* ioLine);
+
+    private:
+
+        enum
+        {
+            kMaxDateBufferSizeInBytes = 30  //UInt32
+        };
+
+        void        PutDate(SInt64 inTime, StringFormatter* ioLine);
+
+        Bool16      fLogTimeInGMT;
+        SInt64      fLastTime;
+        char        fDateBuffer[kMaxDateBufferSizeInBytes];
+};
+
+#endif //__ACCESSLOGRECORD_H__
@@ -17,21 +17,25 @@ LastUpdate:  2010-08-18
 #include "QTSSAccessLogModule.h"
 #include "QTSSModuleUtils.h"
 #include "QTSSRollingLog.h"
+#include "AccessLogRecord.h"
+#include "AccessLogQueue.h"
+#include "AccessLogBinary.h"
 #include "OSMutex.h"
+#include "OSCond.h"
+#include "OSThread.h"
 #include "OSMemory.h"
 #include "MyAssert.h"
 #include <time.h>
 #include "StringParser.h"
 #include "StringFormatter.h"
-#include "StringTranslator.h"
 #include "StrPtrLen.h"
-#include "UserAgentParser.h"
 #include "Task.h"
 
 #define TESTUNIXTIME 0
 
 class QTSSAccessLog;
 class LogCheckTask;
+class AccessLogWriter;
 
 // STATIC DATA
 
@@ -43,7 +47,8 @@ static QTSS_PrefsObject     sServerPrefs = NULL;
  
 static UInt32   sDefaultMaxLogBytes         = 10240000;
 static UInt32   sDefaultRollInterval        = 7;
-static char*    sVoidField                  = "-";
+static UInt32   sDefaultLogBufferSize       = 65536;
+static Bool16   sDefaultLogBinary           = false;
 static Bool16   sStartedUp                  = false;
 static Bool16   sDefaultLogTimeInGMT        = true;//ĬʱGTMʱ
 
@@ -54,6 +59,8 @@ static Bool16   sLogEnabled     = true;
 static UInt32   sMaxLogBytes        = 51200000;
 static UInt32   sRollInterval       = 7;
 static Bool16   sLogTimeInGMT       = true;
+static UInt32   sLogBufferSize      = 65536;
+static Bool16   sLogBinary          = false;
 
 static OSMutex*             sLogMutex   = NULL;//Log module isn't reentrant
 static QTSSAccessLog*       sAccessLog  = NULL;
@@ -61,6 +68,19 @@ static QTSS_ServerObject    sServer     = NULL;
 static QTSS_ModulePrefsObject sPrefs   	= NULL;
 static LogCheckTask* sLogCheckTask = NULL;
 
+// Only one thread at a time drains the log queue, and formats into sLogBatch,
+// or into sLogBlock when the log is binary. sLogIsBinary only changes between
+// batches, under both mutexes, so that a batch is written to a log of its own
+// format.
+static AccessLogWriter*     sLogWriter  = NULL;
+static OSMutex*             sDrainMutex = NULL;
+static AccessLogFormatter   sLogFormatter;
+static char                 sLogBatchBuffer[65536];
+static StringFormatter      sLogBatch(sLogBatchBuffer, sizeof(sLogBatchBuffer));
+static AccessLogBlockWriter sLogBlock(sLogBatchBuffer, sizeof(sLogBatchBuffer));
+static Bool16               sLogIsBinary = false;
+static UInt32               sNumDroppedLogged = 0;
+
 // This header conforms to the W3C "Extended Log File Format". 
 // (See "http://www.w3.org/TR/WD-logfile.html" for details.)
 // The final remark filed of the log header tells us if the logged times are in GMT or in system local time.
@@ -94,15 +114,49 @@ class QTSSAccessLog : public QTSSRollingLog
 {
     public:
     
-        QTSSAccessLog() : QTSSRollingLog() { this->SetTaskName("QTSSAccessLog");  }
+        QTSSAccessLog(Bool16 inBinary) : QTSSRollingLog(), fBinary(inBinary) { this->SetTaskName("QTSSAccessLog");  }
         virtual ~QTSSAccessLog() {}
+        
+        Bool16 IsBinary() { return fBinary; }
     
         virtual char* GetLogName() { return QTSSModuleUtils::GetStringAttribute(sPrefs, "request_logfile_name", sDefaultLogName); }
         virtual char* GetLogDir()  { return QTSSModuleUtils::GetStringAttribute(sPrefs, "request_logfile_dir", sDefaultLogDir); }
         virtual UInt32 GetRollIntervalInDays()  { return sRollInterval; }
         virtual UInt32 GetMaxLogBytes()         { return sMaxLogBytes; }
         virtual time_t WriteLogHeader(FILE *inFile);
+        
+        // A binary log is named differently, so the two are never mixed up
+        virtual char* GetLogExtension() { if (fBinary) return (char*)".binlog"; return (char*)".log"; }
+        
+    private:
     
+        Bool16 fBinary;
+};
+
+//
+// Writes the records LogRequest queues, every kWriteIntervalInMsec or as
+// soon as a thread's queue is half full, so that the threads closing
+// sessions never wait on the log file.
+class AccessLogWriter : public OSThread
+{
+    public:
+    
+        AccessLogWriter() : OSThread() {}
+        virtual ~AccessLogWriter() {}
+        
+        void    Wake() { fCond.Signal(); }
+        
+    private:
+    
+        enum
+        {
+            kWriteIntervalInMsec = 250  //SInt32
+        };
+        
+        virtual void Entry();
+        
+        OSMutex fMutex;
+        OSCond  fCond;
 };
 
 // FUNCTION PROTOTYPES
@@ -118,7 +172,10 @@ static QTSS_Error   LogRequest( QTSS_ClientSessionObject inClientSession,
                             QTSS_RTSPSessionObject inRTSPSession,QTSS_CliSesClosingReason *inCloseReasonPtr);
 static void             CheckAccessLogState(Bool16 forceEnabled);
 static QTSS_Error   RollAccessLog(QTSS_ServiceFunctionArgsPtr inArgs);
-static void         ReplaceSpaces(StrPtrLen *sourcePtr, StrPtrLen *destPtr, char *replaceStr);
+static void         WriteQueuedRecords(char* inRemark = NULL);
+static void         FormatQueuedRecord(AccessLogRecord* inRecord, void* inRefCon);
+static void         PutRemark(char* inRemark);
+static void         WriteLogBatch();
 
 static QTSS_Error   StateChange(QTSS_StateChange_Params* stateChangeParams);
 static void         WriteStartupMessage();
@@ -157,6 +214,7 @@ QTSS_Error QTSSAccessLogModuleDispatch(QTSS_Role inRole, QTSS_RoleParamPtr inPar
 QTSS_Error Register(QTSS_Register_Params* inParams)
 {
     sLogMutex = NEW OSMutex();
+    sDrainMutex = NEW OSMutex();
     
     // Do role & service setup
     
@@ -192,6 +250,9 @@ QTSS_Error Initialize(QTSS_Initialize_Params* inParams)
     RereadPrefs();
     WriteStartupMessage();
     sLogCheckTask = NEW LogCheckTask();
+    
+    sLogWriter = NEW AccessLogWriter();
+    sLogWriter->Start();
     return QTSS_NoErr;
 }
 
@@ -209,7 +270,19 @@ QTSS_Error RereadPrefs()
                                 &sRollInterval, &sDefaultRollInterval, sizeof(sRollInterval));
     QTSSModuleUtils::GetAttribute(sPrefs, "request_logtime_in_gmt",     qtssAttrDataTypeBool16,
                                 &sLogTimeInGMT, &sDefaultLogTimeInGMT, sizeof(sLogTimeInGMT));
+    QTSSModuleUtils::GetAttribute(sPrefs, "request_log_buffer_size",   qtssAttrDataTypeUInt32,
+                                &sLogBufferSize, &sDefaultLogBufferSize, sizeof(sLogBufferSize));
+    QTSSModuleUtils::GetAttribute(sPrefs, "request_log_binary",    qtssAttrDataTypeBool16,
+                                &sLogBinary, &sDefaultLogBinary, sizeof(sLogBinary));
 
+    // Only queues made from now on get the new size
+    AccessLogQueue::SetRingSize(sLogBufferSize);
+
+    // The batch is empty unless the queue is being drained, so the format
+    // can be switched once draining is done
+    OSMutexLocker drainLocker(sDrainMutex);
+    OSMutexLocker locker(sLogMutex);
+    sLogIsBinary = sLogBinary;
     CheckAccessLogState(false);
 
     return QTSS_NoErr;
@@ -218,6 +291,14 @@ QTSS_Error RereadPrefs()
 
 QTSS_Error Shutdown()
 {
+    if (sLogWriter != NULL)
+    {
+        // Sessions may still close and call Wake, so the thread object is kept
+        sLogWriter->SendStopRequest();
+        sLogWriter->Wake();
+        sLogWriter->StopAndWaitForThread();
+    }
+    
     WriteShutdownMessage();
     if (sLogCheckTask != NULL)
     {
@@ -296,74 +377,17 @@ QTSS_Error ClientSessionClosing(QTSS_ClientSessionClosing_Params* inParams)
     return LogRequest(inParams->inClientSession, NULL, &inParams->inReason);
 }
 
-void ReplaceSpaces(StrPtrLen *sourcePtr, StrPtrLen *destPtr, char *replaceStr)
-{
-
-    if ( (NULL != destPtr) && (NULL != destPtr->Ptr) && (0 < destPtr->Len) ) destPtr->Ptr[0] = 0;
-    do
-    {
-        if  (  (NULL == sourcePtr) 
-            || (NULL == destPtr)
-            || (NULL == sourcePtr->Ptr)
-            || (NULL == destPtr->Ptr) 
-            || (0 == sourcePtr->Len) 
-            || (0 == destPtr->Len) 
-            )    break;
-        
-        if (0 == sourcePtr->Ptr[0]) 
-        {    
-            destPtr->Len = 0;
-            break;
-        }
-    
-        const StrPtrLen replaceValue(replaceStr);
-        StringFormatter formattedString(destPtr->Ptr, destPtr->Len);
-        StringParser sourceStringParser(sourcePtr);
-        StrPtrLen preStopChars;
-        
-        do
-        {   sourceStringParser.ConsumeUntil(&preStopChars, StringParser::sEOLWhitespaceMask);
-            if (preStopChars.Len > 0)
-            {   formattedString.Put(preStopChars);// copy the string up to the space or eol. it will be truncated if there's not enough room.
-                if ( sourceStringParser.Expect(' ') && (formattedString.GetSpaceLeft() > replaceValue.Len) )
-                {   formattedString.Put(replaceValue.Ptr, replaceValue.Len);
-                }
-                else //no space character or no room for replacement
-                {    break; 
-                }
-            }
-
-        } while ( preStopChars.Len != 0);
-        
-        destPtr->Set(formattedString.GetBufPtr(), formattedString.GetBytesWritten() );
-        
-    } while (false);
-}   
-
-
 QTSS_Error LogRequest( QTSS_ClientSessionObject inClientSession,
-                            QTSS_RTSPSessionObject inRTSPSession, QTSS_CliSesClosingReason *inCloseReasonPtr)
+                            QTSS_RTSPSessionObject /*inRTSPSession*/, QTSS_CliSesClosingReason *inCloseReasonPtr)
 {
-    static StrPtrLen sUnknownStr(sVoidField);
-    static StrPtrLen sTCPStr("TCP");
-    static StrPtrLen sUDPStr("UDP");
-    
     //Fetch the URL, user agent, movielength & movie bytes to log out of the RTP session
     enum {  
             eTempLogItemSize    = 256, // must be same or larger than others
             eURLSize            = 256, 
             eUserAgentSize      = 256, 
-            ePlayerIDSize       = 32, 
-            ePlayerVersionSize  = 32, 
-            ePlayerLangSize     = 32, 
-            ePlayerOSSize       = 32, 
-            ePlayerOSVersSize   = 32,
-            ePlayerCPUSize      = 32 
+            ePlayerIDSize       = 32
         };
     
-    char tempLogItemBuf[eTempLogItemSize] = { 0 };  
-    StrPtrLen tempLogStr(tempLogItemBuf, eTempLogItemSize -1);
-    
     //
     // Check to see if this session is closing because authorization failed. If that's
     // the case, we've logged that already, let's not log it twice
@@ -377,26 +401,15 @@ QTSS_Error LogRequest( QTSS_ClientSessionObject inClientSession,
     ///inClientSession should never be NULL
     //inRTSPRequest may be NULL if this is a timeout
     
-    OSMutexLocker locker(sLogMutex);
-    CheckAccessLogState(false);
-    if (sAccessLog == NULL)
+    // This runs on the thread closing the session, so it only gathers the
+    // fields and queues them. The log writer thread formats and writes them.
+    if (!sLogEnabled || (sLogWriter == NULL))
         return QTSS_NoErr;
         
     //if logging is on, then log the request... first construct a timestamp
-    char theDateBuffer[QTSSRollingLog::kMaxDateBufferSizeInBytes];
-    //ȡGMTʽ2010-03-16 23:34:54ʱ,theDateBuffer,true
-    Bool16 result = QTSSRollingLog::FormatDate(theDateBuffer, sLogTimeInGMT);
-    
-
-    //for now, just ignore the error.
-	//ȡʱ
-    if (!result)
-        theDateBuffer[0] = '\0';
-    
-    theLen = sizeof(QTSS_RTSPSessionObject);
-    QTSS_RTSPSessionObject theRTSPSession = inRTSPSession;
-    if (theRTSPSession == NULL)
-        (void)QTSS_GetValue(inClientSession, qtssCliSesLastRTSPSession, 0, (void*) &theRTSPSession, &theLen);
+    AccessLogRecord theRecord;
+    ::memset(&theRecord, 0, sizeof(theRecord));
+    theRecord.fTime = ::time(NULL);
     
     // Get lots of neat info to log from the various dictionaries
 
@@ -410,7 +423,6 @@ QTSS_Error LogRequest( QTSS_ClientSessionObject inClientSession,
     UInt32* movieAverageBitRatePtr = 0;
     UInt32 clientPacketsReceived = 0;
     UInt32 clientPacketsLost = 0;
-    StrPtrLen* theTransportType = &sUnknownStr;
     SInt64* theCreateTime = NULL;
     SInt64* thePlayTime = NULL;
     
@@ -475,48 +487,10 @@ QTSS_Error LogRequest( QTSS_ClientSessionObject inClientSession,
     
     clientBytesRecv = (UInt32)((*rtcpBytesRecv * (100.0 - *packetLossPercent))/100.0);
     
-    tempLogStr.Ptr[0] = 0; tempLogStr.Len = eUserAgentSize;
-    (void)QTSS_GetValue(inClientSession, qtssCliSesFirstUserAgent, 0, tempLogStr.Ptr, &tempLogStr.Len);
-    
-    char userAgentBuf[eUserAgentSize] = { 0 };  
-    StrPtrLen userAgent(userAgentBuf, eUserAgentSize -1);
-    ReplaceSpaces(&tempLogStr, &userAgent, "%20");
-    
-    UserAgentParser userAgentParser(&userAgent);
-    
-//  StrPtrLen* playerID = userAgentParser.GetUserID() ;
-    StrPtrLen* playerVersion = userAgentParser.GetUserVersion() ;
-    StrPtrLen* playerLang = userAgentParser.GetUserLanguage()  ;
-    StrPtrLen* playerOS = userAgentParser.GetrUserOS()  ;
-    StrPtrLen* playerOSVers = userAgentParser.GetUserOSVersion()  ;
-    StrPtrLen* playerCPU = userAgentParser.GetUserCPU()  ;
-    
-//  char playerIDBuf[ePlayerIDSize] = {};   
-    char playerVersionBuf[ePlayerVersionSize] = { 0 };  
-    char playerLangBuf[ePlayerLangSize] = { 0 };        
-    char playerOSBuf[ePlayerOSSize] = { 0 };    
-    char playerOSVersBuf[ePlayerOSVersSize] = { 0 };    
-    char playerCPUBuf[ePlayerCPUSize] = { 0 };  
-    
-    UInt32 size;
-//  (ePlayerIDSize < playerID->Len ) ? size = ePlayerIDSize -1 : size = playerID->Len;
-//  if (playerID->Ptr != NULL) memcpy (playerIDBuf, playerID->Ptr, size);
-
-    (ePlayerVersionSize < playerVersion->Len ) ? size = ePlayerVersionSize -1 : size = playerVersion->Len;
-    if (playerVersion->Ptr != NULL) memcpy (playerVersionBuf, playerVersion->Ptr, size);
-
-    (ePlayerLangSize < playerLang->Len ) ? size = ePlayerLangSize -1 : size = playerLang->Len;
-    if (playerLang->Ptr != NULL) memcpy (playerLangBuf, playerLang->Ptr, size);
-
-    (ePlayerOSSize < playerOS->Len ) ? size = ePlayerOSSize -1 : size = playerOS->Len;
-    if (playerOS->Ptr != NULL)  memcpy (playerOSBuf, playerOS->Ptr, size);
-
-    (ePlayerOSVersSize < playerOSVers->Len ) ? size = ePlayerOSVersSize -1 : size = playerOSVers->Len;
-    if (playerOSVers->Ptr != NULL) memcpy (playerOSVersBuf, playerOSVers->Ptr, size);
-    
-    (ePlayerCPUSize < playerCPU->Len ) ? size = ePlayerCPUSize -1 : size = playerCPU->Len;
-    if (playerCPU->Ptr != NULL) memcpy (playerCPUBuf, playerCPU->Ptr, size);
-
+    // The user agent is parsed when the record is written
+    char userAgentBuf[eUserAgentSize + 1] = { 0 };  
+    StrPtrLen userAgent(userAgentBuf, eUserAgentSize);
+    (void)QTSS_GetValue(inClientSession, qtssCliSesFirstUserAgent, 0, userAgent.Ptr, &userAgent.Len);
     
     // clientPacketsReceived, clientPacketsLost, videoPayloadName and audioPayloadName
     // are all stored on a per-stream basis, so let's iterate through all the streams,
@@ -568,9 +542,9 @@ QTSS_Error LogRequest( QTSS_ClientSessionObject inClientSession,
             (void)QTSS_GetValuePtr(theRTPStreamObject, qtssRTPStrIsTCP, 0, (void**)&isTCPPtr, &theLen);
             if (isTCPPtr != NULL)
             {   if (*isTCPPtr == false)
-                    theTransportType = &sUDPStr;
+                    theRecord.fTransport = AccessLogRecord::kTransportUDP;
                 else
-                    theTransportType = &sTCPStr;
+                    theRecord.fTransport = AccessLogRecord::kTransportTCP;
             }
         }
         
@@ -680,135 +654,61 @@ QTSS_Error LogRequest( QTSS_ClientSessionObject inClientSession,
     qtss_printf("%s\n",thetestDateBuffer);
 #endif
     
-    float zeroFloat = 0;
-    UInt64 zeroUInt64 = 0;
-    
     UInt32 cpuUtilized = 0; // percent
         
-    char lastUserName[eTempLogItemSize] ={ 0 };
+    char lastUserName[eTempLogItemSize + 1] ={ 0 };
     StrPtrLen lastUserNameStr(lastUserName,eTempLogItemSize);
     
-    char lastURLRealm[eTempLogItemSize] ={ 0 };
+    char lastURLRealm[eTempLogItemSize + 1] ={ 0 };
     StrPtrLen lastURLRealmStr(lastURLRealm,eTempLogItemSize);
     
-    //qtss_printf("logging of saved params are in dictionary \n");
-        
-    tempLogStr.Ptr[0] = 0; tempLogStr.Len = eTempLogItemSize;
-    (void)QTSS_GetValue(inClientSession, qtssCliRTSPSesUserName, 0, tempLogStr.Ptr, &tempLogStr.Len);
-    ReplaceSpaces(&tempLogStr, &lastUserNameStr, "%20");
-    //qtss_printf("qtssRTSPSesLastUserName dictionary item = %s len = %ld\n",lastUserNameStr.Ptr,lastUserNameStr.Len);
-        
-    tempLogStr.Ptr[0] = 0; tempLogStr.Len = eTempLogItemSize;
-    (void)QTSS_GetValue(inClientSession, qtssCliRTSPSesURLRealm, 0, tempLogStr.Ptr, &tempLogStr.Len);
-    ReplaceSpaces(&tempLogStr, &lastURLRealmStr, "%20");
-    //qtss_printf("qtssRTSPSesLastURLRealm dictionary  item = %s len = %ld\n",lastURLRealmStr.Ptr,lastURLRealmStr.Len);  
-
-    char respMsgBuffer[1024] = { 0 };
-    StrPtrLen theRespMsg;   
-    (void)QTSS_GetValuePtr(inClientSession, qtssCliRTSPReqRespMsg, 0, (void**)&theRespMsg.Ptr, &theRespMsg.Len);
-    StrPtrLen respMsgEncoded(respMsgBuffer, 1024 -1);
-    SInt32 theErr = StringTranslator::EncodeURL(theRespMsg.Ptr, theRespMsg.Len, respMsgEncoded.Ptr, respMsgEncoded.Len);
-    if (theErr <= 0)
-        respMsgEncoded.Ptr[0] = '\0';
-    else
-    {
-        respMsgEncoded.Len = theErr;
-        respMsgEncoded.Ptr[respMsgEncoded.Len] = '\0';
-    }
-    
+    (void)QTSS_GetValue(inClientSession, qtssCliRTSPSesUserName, 0, lastUserNameStr.Ptr, &lastUserNameStr.Len);
+    (void)QTSS_GetValue(inClientSession, qtssCliRTSPSesURLRealm, 0, lastURLRealmStr.Ptr, &lastURLRealmStr.Len);
+
     //cs-uri-query
     char urlQryBuf[eURLSize] = { 0 };
     StrPtrLen urlQry(urlQryBuf, eURLSize -1);
     (void)QTSS_GetValue(inClientSession, qtssCliSesReqQueryString, 0, urlQry.Ptr, &urlQry.Len);
     
-    char tempLogBuffer[1024];
-    char logBuffer[2048];
     // compatible fields (no respMsgEncoded field)
-    ::memset(logBuffer, 0, 2048);
-    qtss_sprintf(tempLogBuffer, "%s ", (remoteAddr.Ptr[0] == '\0') ? sVoidField : remoteAddr.Ptr); //c-ip*
-    ::strcpy(logBuffer, tempLogBuffer);
-    qtss_sprintf(tempLogBuffer, "%s ", (theDateBuffer[0] == '\0') ? sVoidField : theDateBuffer);   //date* time* //עʱд!
-    ::strcat(logBuffer, tempLogBuffer);
-    qtss_sprintf(tempLogBuffer, "%s ", (remoteDNS.Ptr[0] == '\0') ? sVoidField : remoteDNS.Ptr); //c-dns
-    ::strcat(logBuffer, tempLogBuffer);
-    qtss_sprintf(tempLogBuffer, "%s ", (url.Ptr[0] == '\0') ? sVoidField : url.Ptr);   //cs-uri-stem*
-    ::strcat(logBuffer, tempLogBuffer);
-    qtss_sprintf(tempLogBuffer, "%lu ", startPlayTimeInSecs);  //c-starttime 
-    ::strcat(logBuffer, tempLogBuffer);
-    qtss_sprintf(tempLogBuffer, "%lu ", theCreateTime == NULL ? 0UL : (UInt32) (QTSS_MilliSecsTo1970Secs(curTime)  
-                        - QTSS_MilliSecsTo1970Secs(*theCreateTime)));   //x-duration* 
-    ::strcat(logBuffer, tempLogBuffer);
-    qtss_sprintf(tempLogBuffer, "%ld ", 1UL);  //c-rate
-    ::strcat(logBuffer, tempLogBuffer);
-    qtss_sprintf(tempLogBuffer, "%ld ", *theStatusCode);   //c-status*
-    ::strcat(logBuffer, tempLogBuffer);
-    qtss_sprintf(tempLogBuffer, "%s ", (playerIDBuf[0] == '\0') ? sVoidField : playerIDBuf);   //c-playerid*
-    ::strcat(logBuffer, tempLogBuffer);
-    qtss_sprintf(tempLogBuffer, "%s ", (playerVersionBuf[0] == '\0') ? sVoidField : playerVersionBuf); //c-playerversion
-    ::strcat(logBuffer, tempLogBuffer);
-    qtss_sprintf(tempLogBuffer, "%s ", (playerLangBuf[0] == '\0') ? sVoidField : playerLangBuf);   //c-playerlanguage*
-    ::strcat(logBuffer, tempLogBuffer);
-    qtss_sprintf(tempLogBuffer, "%s ", (userAgent.Ptr[0] == '\0') ? sVoidField : userAgent.Ptr);   //cs(User-Agent) 
-    ::strcat(logBuffer, tempLogBuffer);
-    qtss_sprintf(tempLogBuffer, "%s ", (playerOSBuf[0] == '\0') ? sVoidField : playerOSBuf);   //c-os*
-    ::strcat(logBuffer, tempLogBuffer);
-    qtss_sprintf(tempLogBuffer, "%s ", (playerOSVersBuf[0] == '\0') ? sVoidField : playerOSVersBuf);   //c-osversion
-    ::strcat(logBuffer, tempLogBuffer);
-    qtss_sprintf(tempLogBuffer, "%s ", (playerCPUBuf[0] == '\0') ? sVoidField : playerCPUBuf); //c-cpu*
-    ::strcat(logBuffer, tempLogBuffer);
-    qtss_sprintf(tempLogBuffer, "%0.0f ", movieDuration == NULL ? zeroFloat : *movieDuration); //filelength in secs*
-    ::strcat(logBuffer, tempLogBuffer);
-    qtss_sprintf(tempLogBuffer, "%"_64BITARG_"d ", movieSizeInBytes == NULL ? zeroUInt64 : *movieSizeInBytes); //filesize in bytes*
-    ::strcat(logBuffer, tempLogBuffer);
-    qtss_sprintf(tempLogBuffer, "%lu ", movieAverageBitRatePtr == NULL ? (UInt32) 0 : *movieAverageBitRatePtr);    //avgbandwidth in bits per second
-    ::strcat(logBuffer, tempLogBuffer);
-    qtss_sprintf(tempLogBuffer, "%s ", "RTP"); //protocol
-    ::strcat(logBuffer, tempLogBuffer);
-    qtss_sprintf(tempLogBuffer, "%s ", (theTransportType->Ptr[0] == '\0') ? sVoidField : theTransportType->Ptr);   //transport
-    ::strcat(logBuffer, tempLogBuffer);
-    qtss_sprintf(tempLogBuffer, "%s ", (audioPayloadName.Ptr[0] == '\0') ? sVoidField : audioPayloadName.Ptr); //audiocodec*
-    ::strcat(logBuffer, tempLogBuffer);
-    qtss_sprintf(tempLogBuffer, "%s ", (videoPayloadName.Ptr[0] == '\0') ? sVoidField : videoPayloadName.Ptr); //videocodec*
-    ::strcat(logBuffer, tempLogBuffer);
-    qtss_sprintf(tempLogBuffer, "%lu ",rtpBytesSent == NULL ? 0UL : *rtpBytesSent);    //sc-bytes*
-    ::strcat(logBuffer, tempLogBuffer);
-    qtss_sprintf(tempLogBuffer, "%lu ",rtcpBytesRecv == NULL ? 0UL : *rtcpBytesRecv);    //cs-bytes*
-    ::strcat(logBuffer, tempLogBuffer);
-    qtss_sprintf(tempLogBuffer, "%lu ", clientBytesRecv);  //c-bytes
-    ::strcat(logBuffer, tempLogBuffer);
-    qtss_sprintf(tempLogBuffer, "%lu ", rtpPacketsSent == NULL ? 0UL : *rtpPacketsSent);   //s-pkts-sent*
-    ::strcat(logBuffer, tempLogBuffer);
-    qtss_sprintf(tempLogBuffer, "%lu ", clientPacketsReceived);    //c-pkts-recieved
-    ::strcat(logBuffer, tempLogBuffer);
-    qtss_sprintf(tempLogBuffer, "%lu ", clientPacketsLost);    //c-pkts-lost-client*
-    ::strcat(logBuffer, tempLogBuffer);
-    qtss_sprintf(tempLogBuffer, "%lu ", 1UL);  //c-buffercount 
-    ::strcat(logBuffer, tempLogBuffer);
-    qtss_sprintf(tempLogBuffer, "%lu ", clientBufferTime);     //c-totalbuffertime*
-    ::strcat(logBuffer, tempLogBuffer);
-    qtss_sprintf(tempLogBuffer, "%lu ", qualityLevel); //c-quality 
-    ::strcat(logBuffer, tempLogBuffer);
-    qtss_sprintf(tempLogBuffer, "%s ", (localIPAddr.Ptr[0] == '\0') ? sVoidField : localIPAddr.Ptr);   //s-ip 
-    ::strcat(logBuffer, tempLogBuffer);
-    qtss_sprintf(tempLogBuffer, "%s ", (localDNS.Ptr[0] == '\0') ? sVoidField : localDNS.Ptr); //s-dns
-    ::strcat(logBuffer, tempLogBuffer);
-    qtss_sprintf(tempLogBuffer, "%lu ", numCurClients);    //s-totalclients
-    ::strcat(logBuffer, tempLogBuffer);
-    qtss_sprintf(tempLogBuffer, "%lu ", cpuUtilized);  //s-cpu-util
-    ::strcat(logBuffer, tempLogBuffer);
-    qtss_sprintf(tempLogBuffer, "%s ", (urlQry.Ptr[0] == '\0') ? sVoidField : urlQry.Ptr); //cs-uri-query
-    ::strcat(logBuffer, tempLogBuffer);
-    qtss_sprintf(tempLogBuffer, "%s ", (lastUserName[0] == '\0') ? sVoidField : lastUserName); //c-username
-    ::strcat(logBuffer, tempLogBuffer);
-    qtss_sprintf(tempLogBuffer, "%s ", (lastURLRealm[0] == '\0') ? sVoidField : lastURLRealm); //sc(Realm)
-    ::strcat(logBuffer, tempLogBuffer);
-    
-    ::strcat(logBuffer, "\n");
-
-    Assert(::strlen(logBuffer) < 2048);
-    
-    //finally, write the log message
-    sAccessLog->WriteToLog(logBuffer, kAllowLogToRoll);
+    theRecord.fStatusCode = *theStatusCode;
+    theRecord.fMovieDuration = (movieDuration == NULL) ? 0 : *movieDuration;
+    theRecord.fMovieSize = (movieSizeInBytes == NULL) ? 0 : *movieSizeInBytes;
+    theRecord.fStartPlayTime = startPlayTimeInSecs;
+    theRecord.fDuration = (theCreateTime == NULL) ? 0 : (UInt32)(QTSS_MilliSecsTo1970Secs(curTime)
+                            - QTSS_MilliSecsTo1970Secs(*theCreateTime));
+    theRecord.fAvgBandwidth = (movieAverageBitRatePtr == NULL) ? 0 : *movieAverageBitRatePtr;
+    theRecord.fRTPBytesSent = (rtpBytesSent == NULL) ? 0 : *rtpBytesSent;
+    theRecord.fRTCPBytesRecv = (rtcpBytesRecv == NULL) ? 0 : *rtcpBytesRecv;
+    theRecord.fClientBytesRecv = clientBytesRecv;
+    theRecord.fRTPPacketsSent = (rtpPacketsSent == NULL) ? 0 : *rtpPacketsSent;
+    theRecord.fClientPacketsRecv = clientPacketsReceived;
+    theRecord.fClientPacketsLost = clientPacketsLost;
+    theRecord.fClientBufferTime = clientBufferTime;
+    theRecord.fQuality = qualityLevel;
+    theRecord.fNumCurClients = numCurClients;
+    theRecord.fCPUUtil = cpuUtilized;
+
+    // A value too long for its buffer isn't copied out, which leaves the buffer empty
+    StrPtrLen theStrings[AccessLogRecord::kNumStrings];
+    theStrings[AccessLogRecord::kRemoteAddr].Set(remoteAddrBuf, ::strlen(remoteAddrBuf));
+    theStrings[AccessLogRecord::kRemoteDNS].Set(remoteDNSBuf, ::strlen(remoteDNSBuf));
+    theStrings[AccessLogRecord::kURL].Set(urlBuf, ::strlen(urlBuf));
+    theStrings[AccessLogRecord::kPlayerID].Set(playerIDBuf, ::strlen(playerIDBuf));
+    theStrings[AccessLogRecord::kUserAgent].Set(userAgentBuf, ::strlen(userAgentBuf));
+    theStrings[AccessLogRecord::kAudioCodec].Set(audioPayloadNameBuf, ::strlen(audioPayloadNameBuf));
+    theStrings[AccessLogRecord::kVideoCodec].Set(videoPayloadNameBuf, ::strlen(videoPayloadNameBuf));
+    theStrings[AccessLogRecord::kLocalAddr].Set(localIPAddrBuf, ::strlen(localIPAddrBuf));
+    theStrings[AccessLogRecord::kLocalDNS].Set(localDNSBuf, ::strlen(localDNSBuf));
+    theStrings[AccessLogRecord::kQuery].Set(urlQryBuf, ::strlen(urlQryBuf));
+    theStrings[AccessLogRecord::kUserName].Set(lastUserName, ::strlen(lastUserName));
+    theStrings[AccessLogRecord::kRealm].Set(lastURLRealm, ::strlen(lastURLRealm));
+
+    //finally, queue the log message
+    Bool16 needsDraining = false;
+    (void)AccessLogQueue::Push(&theRecord, theStrings, &needsDraining);
+    if (needsDraining)
+        sLogWriter->Wake();
     
     return QTSS_NoErr;
 }
@@ -819,9 +719,15 @@ void CheckAccessLogState(Bool16 forceEnabled)
     //this function makes sure the logging state is in synch with the preferences.
     //extern variable declared in QTSSPreferences.h
     //check error log.
+    if ((NULL != sAccessLog) && (sAccessLog->IsBinary() != sLogIsBinary))
+    {
+        sAccessLog->Delete(); //the new log has another name
+        sAccessLog = NULL;
+    }
+
     if ((NULL == sAccessLog) && (forceEnabled || sLogEnabled))
     {
-        sAccessLog = NEW QTSSAccessLog();
+        sAccessLog = NEW QTSSAccessLog(sLogIsBinary);
         sAccessLog->EnableLog();
     }
 
@@ -832,6 +738,109 @@ void CheckAccessLogState(Bool16 forceEnabled)
     }
 }
 
+void AccessLogWriter::Entry()
+{
+    OSMutexLocker locker(&fMutex);
+    while (!this->IsStopRequested())
+    {
+        fCond.Wait(&fMutex, kWriteIntervalInMsec);
+        WriteQueuedRecords();
+    }
+}
+
+void WriteQueuedRecords(char* inRemark)
+{
+    OSMutexLocker locker(sDrainMutex);
+    
+    sLogFormatter.SetLogTimeInGMT(sLogTimeInGMT);
+    (void)AccessLogQueue::Drain(FormatQueuedRecord, NULL);
+    
+    // Say how many records didn't fit in their queue since the last time
+    UInt32 theNumDropped = AccessLogQueue::GetNumDropped();
+    if (theNumDropped != sNumDroppedLogged)
+    {
+        char tempBuffer[128];
+        qtss_sprintf(tempBuffer, "#Remark: %lu access log entries were dropped, the log queue was full\n",
+                    theNumDropped - sNumDroppedLogged);
+        PutRemark(tempBuffer);
+        sNumDroppedLogged = theNumDropped;
+    }
+    
+    if (inRemark != NULL)
+        PutRemark(inRemark);
+        
+    WriteLogBatch();
+}
+
+void FormatQueuedRecord(AccessLogRecord* inRecord, void* /*inRefCon*/)
+{
+    enum
+    {
+        kMaxLineSizeInBytes = 4096  //UInt32
+    };
+    
+    if (sLogIsBinary)
+    {
+        if (!sLogBlock.AddEntry(inRecord))
+        {
+            WriteLogBatch();
+            (void)sLogBlock.AddEntry(inRecord);
+        }
+        return;
+    }
+    
+    if (sLogBatch.GetSpaceLeft() < kMaxLineSizeInBytes)
+        WriteLogBatch();
+        
+    sLogFormatter.FormatW3C(inRecord, &sLogBatch);
+}
+
+void PutRemark(char* inRemark)
+{
+    if (sLogIsBinary)
+    {
+        if (!sLogBlock.AddRemark(inRemark))
+        {
+            WriteLogBatch();
+            (void)sLogBlock.AddRemark(inRemark);
+        }
+        return;
+    }
+    
+    if (sLogBatch.GetSpaceLeft() <= ::strlen(inRemark))
+        WriteLogBatch();
+        
+    sLogBatch.Put(inRemark);
+}
+
+void WriteLogBatch()
+{
+    StrPtrLen theBatch;
+    if (sLogIsBinary)
+    {
+        if (sLogBlock.IsEmpty())
+            return;
+        theBatch = sLogBlock.GetBlock();
+    }
+    else
+    {
+        if (sLogBatch.GetCurrentOffset() == 0)
+            return;
+        theBatch.Set(sLogBatch.GetBufPtr(), sLogBatch.GetCurrentOffset());
+    }
+    
+    // Rolling the log, if it is time to, happens here as well
+    {
+        OSMutexLocker locker(sLogMutex);
+        CheckAccessLogState(false);
+        if (sAccessLog != NULL)
+            sAccessLog->WriteToLog(theBatch.Ptr, theBatch.Len, kAllowLogToRoll);
+    }
+    
+    sLogBlock.Reset();
+    sLogBatch.Reset();
+}
+
 // SERVICE ROUTINES
 
 QTSS_Error RollAccessLog(QTSS_ServiceFunctionArgsPtr /*inArgs*/)
@@ -916,8 +925,8 @@ void    WriteStartupMessage()
         qtss_sprintf(tempBuffer, "#Remark: Streaming beginning STARTUP %s\n", theDateBuffer);
         
     // log startup message to error log as well.
-    if ((result) && (sAccessLog != NULL))
-        sAccessLog->WriteToLog(tempBuffer, kAllowLogToRoll);
+    if (result)
+        WriteQueuedRecords(tempBuffer);
 }
 
 void    WriteShutdownMessage()
@@ -937,8 +946,8 @@ void    WriteShutdownMessage()
     if (result)
         qtss_sprintf(tempBuffer, "#Remark: Streaming beginning SHUTDOWN %s\n", theDateBuffer);
 
-    if ( result && sAccessLog != NULL )
-        sAccessLog->WriteToLog(tempBuffer, kAllowLogToRoll);
+    // What is still queued goes ahead of the shutdown remark
+    WriteQueuedRecords(result ? tempBuffer : NULL);
 }
 
 
@@ -0,0 +1,293 @@
+/***************************************************************************
+
+Copyright (c) 1999-2003 Apple Computer, Inc.  All Rights Reserved.
+2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 DescribeCache.cpp
+Description: Keep the SDP that DoDescribe generates for a movie, so that
+             further DESCRIBEs of it send a prebuilt body.
+Comment:     used by QTSSFileModule::DoDescribe
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-17
+LastUpdate:  2026-10-17
+
+****************************************************************************/
+
+
+#include <string.h>
+
+#include "DescribeCache.h"
+#include "OSMemory.h"
+#include "MyAssert.h"
+
+
+OSMutex                 DescribeCache::sMutex;
+DescribeCacheEntry**    DescribeCache::sHashTable = NULL;
+UInt32                  DescribeCache::sNumHashBuckets = 0;
+UInt32                  DescribeCache::sNumEntries = 0;
+UInt32                  DescribeCache::sMaxEntries = 0;
+DescribeCacheEntry*     DescribeCache::sFirstEntry = NULL;
+DescribeCacheEntry*     DescribeCache::sLastEntry = NULL;
+unsigned int            DescribeCache::sPrefsGeneration = 0;
+
+
+DescribeCacheEntry::DescribeCacheEntry()
+:   fOwnerOffset(0),
+    fOwnerLen(0),
+    fPath(NULL),
+    fRequestPath(NULL),
+    fModDate(0),
+    fPrefsGeneration(0),
+    fAdjustBandwidth(false),
+    fHashValue(0),
+    fRefCount(0),
+    fIsInTable(false),
+    fNextHashEntry(NULL),
+    fPrevEntry(NULL),
+    fNextEntry(NULL)
+{
+}
+
+DescribeCacheEntry::~DescribeCacheEntry()
+{
+    // The headers and the movie SDP share the one buffer
+    delete [] fSessionHeaders.Ptr;
+    delete [] fPath;
+    delete [] fRequestPath;
+}
+
+
+void DescribeCache::SetCacheSize(UInt32 inMaxEntries)
+{
+    OSMutexLocker locker(&sMutex);
+
+    sMaxEntries = inMaxEntries;
+    TrimToSize();
+}
+
+DescribeCacheEntry* DescribeCache::Find(const char* inPath, const char* inRequestPath, SInt64 inModDate,
+                                        Bool16 inAdjustBandwidth)
+{
+    UInt32 theHashValue = Hash(inPath, inRequestPath, inAdjustBandwidth);
+
+    OSMutexLocker locker(&sMutex);
+
+    DescribeCacheEntry* theEntry = Lookup(inPath, inRequestPath, inAdjustBandwidth, theHashValue);
+    if (theEntry == NULL)
+        return NULL;
+
+    if ((theEntry->fModDate != inModDate) || (theEntry->fPrefsGeneration != sPrefsGeneration))
+    {
+        Remove(theEntry);
+        if (theEntry->fRefCount == 0)
+            delete theEntry;
+        return NULL;
+    }
+
+    // Move it to the tail of the LRU list
+    if (theEntry != sLastEntry)
+    {
+        if (theEntry->fPrevEntry != NULL)
+            theEntry->fPrevEntry->fNextEntry = theEntry->fNextEntry;
+        else
+            sFirstEntry = theEntry->fNextEntry;
+        theEntry->fNextEntry->fPrevEntry = theEntry->fPrevEntry;
+
+        theEntry->fPrevEntry = sLastEntry;
+        theEntry->fNextEntry = NULL;
+        sLastEntry->fNextEntry = theEntry;
+        sLastEntry = theEntry;
+    }
+
+    theEntry->fRefCount++;
+    return theEntry;
+}
+
+void DescribeCache::Add(const char* inPath, const char* inRequestPath, SInt64 inModDate,
+                        Bool16 inAdjustBandwidth, UInt32 inPrefsGeneration,
+                        StrPtrLen* inSessionHeaders, StrPtrLen* inMediaHeaders,
+                        StrPtrLen* inMovieSDP, UInt32 inOwnerOffset, UInt32 inOwnerLen)
+{
+    if (sMaxEntries == 0)
+        return;
+
+    Assert(inOwnerOffset + inOwnerLen <= inSessionHeaders->Len);
+
+    //
+    // Build the entry before taking the lock
+    DescribeCacheEntry* theEntry = NEW DescribeCacheEntry();
+    UInt32 theBufferLen = inSessionHeaders->Len + inMediaHeaders->Len + inMovieSDP->Len;
+    char* theBuffer = NEW char[theBufferLen];
+
+    ::memcpy(theBuffer, inSessionHeaders->Ptr, inSessionHeaders->Len);
+    theEntry->fSessionHeaders.Set(theBuffer, inSessionHeaders->Len);
+    theBuffer += inSessionHeaders->Len;
+
+    ::memcpy(theBuffer, inMediaHeaders->Ptr, inMediaHeaders->Len);
+    theEntry->fMediaHeaders.Set(theBuffer, inMediaHeaders->Len);
+    theBuffer += inMediaHeaders->Len;
+
+    ::memcpy(theBuffer, inMovieSDP->Ptr, inMovieSDP->Len);
+    theEntry->fMovieSDP.Set(theBuffer, inMovieSDP->Len);
+
+    theEntry->fOwnerOffset = inOwnerOffset;
+    theEntry->fOwnerLen = inOwnerLen;
+    theEntry->fPath = NEW char[::strlen(inPath) + 1];
+    ::strcpy(theEntry->fPath, inPath);
+    theEntry->fRequestPath = NEW char[::strlen(inRequestPath) + 1];
+    ::strcpy(theEntry->fRequestPath, inRequestPath);
+    theEntry->fModDate = inModDate;
+    theEntry->fPrefsGeneration = inPrefsGeneration;
+    theEntry->fAdjustBandwidth = inAdjustBandwidth;
+    theEntry->fHashValue = Hash(inPath, inRequestPath, inAdjustBandwidth);
+
+    OSMutexLocker locker(&sMutex);
+
+    if ((sMaxEntries == 0) || (inPrefsGeneration != sPrefsGeneration))
+    {
+        delete theEntry;
+        return;
+    }
+
+    DescribeCacheEntry* theOldEntry = Lookup(inPath, inRequestPath, inAdjustBandwidth, theEntry->fHashValue);
+    if (theOldEntry != NULL)
+    {
+        Remove(theOldEntry);
+        if (theOldEntry->fRefCount == 0)
+            delete theOldEntry;
+    }
+
+    if (sNumEntries >= sNumHashBuckets)
+        GrowHashTable();
+
+    UInt32 theBucket = theEntry->fHashValue & (sNumHashBuckets - 1);
+    theEntry->fNextHashEntry = sHashTable[theBucket];
+    sHashTable[theBucket] = theEntry;
+
+    theEntry->fPrevEntry = sLastEntry;
+    if (sLastEntry != NULL)
+        sLastEntry->fNextEntry = theEntry;
+    else
+        sFirstEntry = theEntry;
+    sLastEntry = theEntry;
+
+    theEntry->fIsInTable = true;
+    sNumEntries++;
+
+    TrimToSize();
+}
+
+void DescribeCache::Release(DescribeCacheEntry* inEntry)
+{
+    OSMutexLocker locker(&sMutex);
+
+    Assert(inEntry->fRefCount > 0);
+    inEntry->fRefCount--;
+    if ((inEntry->fRefCount == 0) && !inEntry->fIsInTable)
+        delete inEntry;
+}
+
+UInt32 DescribeCache::Hash(const char* inPath, const char* inRequestPath, Bool16 inAdjustBandwidth)
+{
+    // FNV-1a over both paths, which mostly differ near the end
+    UInt32 theHashValue = 2166136261U;
+
+    for ( ; *inPath != '\0'; inPath++)
+    {
+        theHashValue ^= (UInt8)*inPath;
+        theHashValue *= 16777619;
+    }
+    for ( ; *inRequestPath != '\0'; inRequestPath++)
+    {
+        theHashValue ^= (UInt8)*inRequestPath;
+        theHashValue *= 16777619;
+    }
+    theHashValue ^= (UInt8)(inAdjustBandwidth != false);
+    theHashValue *= 16777619;
+
+    return (UInt32)(theHashValue & 0xFFFFFFFF);
+}
+
+DescribeCacheEntry* DescribeCache::Lookup(const char* inPath, const char* inRequestPath, Bool16 inAdjustBandwidth,
+                                          UInt32 inHashValue)
+{
+    if (sHashTable == NULL)
+        return NULL;
+
+    for (DescribeCacheEntry* theEntry = sHashTable[inHashValue & (sNumHashBuckets - 1)];
+            theEntry != NULL; theEntry = theEntry->fNextHashEntry)
+    {
+        if ((theEntry->fHashValue == inHashValue) &&
+            ((theEntry->fAdjustBandwidth != false) == (inAdjustBandwidth != false)) &&
+            (::strcmp(theEntry->fPath, inPath) == 0) &&
+            (::strcmp(theEntry->fRequestPath, inRequestPath) == 0))
+            return theEntry;
+    }
+
+    return NULL;
+}
+
+void DescribeCache::Remove(DescribeCacheEntry* inEntry)
+{
+    Assert(inEntry->fIsInTable);
+
+    DescribeCacheEntry** theLink = &sHashTable[inEntry->fHashValue & (sNumHashBuckets - 1)];
+    while (*theLink != inEntry)
+        theLink = &(*theLink)->fNextHashEntry;
+    *theLink = inEntry->fNextHashEntry;
+
+    if (inEntry->fPrevEntry != NULL)
+        inEntry->fPrevEntry->fNextEntry = inEntry->fNextEntry;
+    else
+        sFirstEntry = inEntry->fNextEntry;
+    if (inEntry->fNextEntry != NULL)
+        inEntry->fNextEntry->fPrevEntry = inEntry->fPrevEntry;
+    else
+        sLastEntry = inEntry->fPrevEntry;
+
+    inEntry->fNextHashEntry = NULL;
+    inEntry->fPrevEntry = NULL;
+    inEntry->fNextEntry = NULL;
+    inEntry->fIsInTable = false;
+    sNumEntries--;
+}
+
+void DescribeCache::TrimToSize()
+{
+    // Entries still being sent go when their last Release does
+    while (sNumEntries > sMaxEntries)
+    {
+        DescribeCacheEntry* theEntry = sFirstEntry;
+        Remove(theEntry);
+        if (theEntry->fRefCount == 0)
+            delete theEntry;
+    }
+}
+
+void DescribeCache::GrowHashTable()
+{
+    UInt32 theNumBuckets = sNumHashBuckets * 2;
+    if (theNumBuckets < kMinHashBuckets)
+        theNumBuckets = kMinHashBuckets;
+
+    DescribeCacheEntry** theHashTable = NEW DescribeCacheEntry*[theNumBuckets];
+    ::memset(theHashTable, 0, sizeof(DescribeCacheEntry*) * theNumBuckets);
+
+    for (UInt32 theBucket = 0; theBucket < sNumHashBuckets; theBucket++)
+    {
+        DescribeCacheEntry* theNextEntry = NULL;
+        for (DescribeCacheEntry* theEntry = sHashTable[theBucket]; theEntry != NULL; theEntry = theNextEntry)
+        {
+            theNextEntry = theEntry->fNextHashEntry;
+
+            UInt32 theNewBucket = theEntry->fHashValue & (theNumBuckets - 1);
+            theEntry->fNextHashEntry = theHashTable[theNewBucket];
+            theHashTable[theNewBucket] = theEntry;
+        }
+    }
+
+    delete [] sHashTable;
+    sHashTable = theHashTable;
+    sNumHashBuckets = theNumBuckets;
+}
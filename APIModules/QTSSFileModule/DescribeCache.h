@@ -0,0 +1,126 @@
+/***************************************************************************
+
+Copyright (c) 1999-2003 Apple Computer, Inc.  All Rights Reserved.
+2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 DescribeCache.h
+Description: Keep the SDP that DoDescribe generates for a movie, so that
+             further DESCRIBEs of it send a prebuilt body.
+Comment:     used by QTSSFileModule::DoDescribe
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-17
+LastUpdate:  2026-10-17
+
+****************************************************************************/
+
+
+#ifndef __DESCRIBECACHE_H__
+#define __DESCRIBECACHE_H__
+
+#include "OSHeaders.h"
+#include "OSMutex.h"
+#include "atomic.h"
+#include "StrPtrLen.h"
+
+//
+// An entry holds the sorted session and media headers DoDescribe sent for a
+// movie, and the movie's own SDP (what the FileSession parses). Everything in
+// the headers but the "o=" line is the same for every DESCRIBE of the movie,
+// as long as the movie, the module prefs and whether the player's bandwidth
+// is adjusted stay the same. The "o=" line holds the time of the request and
+// the address it came in on, so DoDescribe writes it fresh each time, in
+// place of the one at fOwnerOffset.
+//
+// Entries are keyed by the movie's full path, the path of the request (which
+// is the "s=" line) and whether the bandwidth was adjusted. An entry whose
+// movie mod date or prefs generation is out of date is replaced rather than
+// returned.
+
+class DescribeCacheEntry
+{
+    public:
+
+        StrPtrLen       fSessionHeaders;
+        StrPtrLen       fMediaHeaders;
+        StrPtrLen       fMovieSDP;
+        UInt32          fOwnerOffset;       // of the "o=" line, in fSessionHeaders
+        UInt32          fOwnerLen;          // without its EOL
+
+    private:
+
+        DescribeCacheEntry();
+        ~DescribeCacheEntry();
+
+        char*           fPath;
+        char*           fRequestPath;
+        SInt64          fModDate;
+        UInt32          fPrefsGeneration;
+        Bool16          fAdjustBandwidth;
+
+        UInt32          fHashValue;
+        UInt32          fRefCount;
+        Bool16          fIsInTable;         // if not, the last Release deletes it
+        DescribeCacheEntry* fNextHashEntry;
+        DescribeCacheEntry* fPrevEntry;     // LRU list of the entries in the table,
+        DescribeCacheEntry* fNextEntry;     // most recently used at the tail
+
+        friend class DescribeCache;
+};
+
+class DescribeCache
+{
+    public:
+
+        //
+        // Keeps up to inMaxEntries entries, dropping the least recently used
+        // beyond that. 0 turns the cache off and empties it.
+        static void     SetCacheSize(UInt32 inMaxEntries);
+
+        //
+        // Makes every entry out of date. Called whenever the prefs that go
+        // into the SDP are reread.
+        static void     IncrementPrefsGeneration() { (void)atomic_add(&sPrefsGeneration, 1); }
+        static UInt32   GetPrefsGeneration() { return sPrefsGeneration; }
+
+        //
+        // Returns the entry for the movie with a reference held, or NULL.
+        static DescribeCacheEntry*  Find(const char* inPath, const char* inRequestPath, SInt64 inModDate,
+                                        Bool16 inAdjustBandwidth);
+
+        //
+        // Copies the SDP into a new entry, replacing any old one. inPrefsGeneration
+        // is the generation read before the SDP was built, so that SDP built
+        // with prefs that have since changed isn't kept.
+        static void     Add(const char* inPath, const char* inRequestPath, SInt64 inModDate,
+                            Bool16 inAdjustBandwidth, UInt32 inPrefsGeneration,
+                            StrPtrLen* inSessionHeaders, StrPtrLen* inMediaHeaders,
+                            StrPtrLen* inMovieSDP, UInt32 inOwnerOffset, UInt32 inOwnerLen);
+
+        static void     Release(DescribeCacheEntry* inEntry);
+
+    private:
+
+        enum
+        {
+            kMinHashBuckets = 64
+        };
+
+        static UInt32   Hash(const char* inPath, const char* inRequestPath, Bool16 inAdjustBandwidth);
+        static DescribeCacheEntry*  Lookup(const char* inPath, const char* inRequestPath, Bool16 inAdjustBandwidth,
+                                        UInt32 inHashValue);
+        static void     Remove(DescribeCacheEntry* inEntry);
+        static void     TrimToSize();
+        static void     GrowHashTable();
+
+        static OSMutex              sMutex;
+        static DescribeCacheEntry** sHashTable;
+        static UInt32               sNumHashBuckets;
+        static UInt32               sNumEntries;
+        static UInt32               sMaxEntries;
+        static DescribeCacheEntry*  sFirstEntry;
+        static DescribeCacheEntry*  sLastEntry;
+        static unsigned int         sPrefsGeneration;
+};
+
+#endif //__DESCRIBECACHE_H__
@@ -21,11 +21,14 @@ LastUpdate:  2010-08-16
 
 #include "QTSSFileModule.h"
 #include "QTSSModuleUtils.h"
+#include "QTAccessFile.h"
 #include "QTSSMemoryDeleter.h"
 #include "QTRTPFile.h"
 #include "QTFile.h"
 #include "OSMemory.h"
 #include "OSArrayObjectDeleter.h"
+#include "OSFileBlockCache.h"
+#include "DescribeCache.h"
 #include "SDPSourceInfo.h"
 #include "SDPUtils.h"
 #include "StringParser.h"
@@ -43,10 +46,11 @@ class FileSession
         FileSession() : fAdjustedPlayTime(0), fNextPacketLen(0), fLastQualityCheck(0),
                         fAllowNegativeTTs(false), fSpeed(1),
                         fStartTime(-1), fStopTime(-1), fStopTrackID(0), fStopPN(0),
-                        fLastRTPTime(0), fLastPauseTime(0),fTotalPauseTime(0), fPaused(false)
+                        fLastRTPTime(0), fLastPauseTime(0),fTotalPauseTime(0), fPaused(false),
+                        fReadAheadFile(NULL), fNextReadAheadTime(0)
         {}
         
-        ~FileSession() {}
+        ~FileSession() { if (fReadAheadFile != NULL) (void)QTSS_CloseFileObject(fReadAheadFile); }
         
         QTRTPFile           fFile; /* specific file to send RTP packets which close related to QTHintTrack */
         QTSS_PacketStruct   fPacketStruct;/* store rtp packet data to write into rtp stream, used in RTPSession::run() */
@@ -66,6 +70,12 @@ class FileSession
         UInt64              fLastPauseTime; /* ϴPAUSEʱʱ(λms,μDoPlay()) */
         SInt64              fTotalPauseTime;/* ۻжʱ (λms,μDoPlay()) */
         Bool16              fPaused; /*ǰfile session״̬PAUSE? */
+
+        // A second handle on the movie, opened for read ahead. SendPackets has the
+        // file system module read the next read_ahead_msec of the movie ahead of
+        // GetNextPacket, and waits for it if it isn't in yet.
+        QTSS_Object         fReadAheadFile;
+        SInt64              fNextReadAheadTime;
 };
 
 // ref to the prefs dictionary object
@@ -132,6 +142,23 @@ static UInt32               sPrivateBufferUnitKSize = 0;
 static UInt32               sPrivateBufferUnitSize  = 0;
 static UInt32               sPrivateBufferMaxUnits  = 0;
 
+/* process wide block cache shared by all OSFileSources, 0 turns it off */
+static UInt32               sSharedBlockCacheKSize  = 0;
+
+/* read movies through a memory mapping of the whole file instead of the file buffers */
+static Bool16               sMapMovieFiles          = false;
+
+/* parsed movies kept open after their last session ends, 0 closes them right away */
+static UInt32               sMaxCachedUnusedMovies  = 0;
+
+/* prebuilt DESCRIBE responses kept by DescribeCache, 0 turns it off */
+static UInt32               sMaxCachedDescribes     = 0;
+
+/* read ahead of GetNextPacket, see SendPackets() */
+static Bool16               sEnableReadAhead        = true;
+static UInt32               sReadAheadMsec          = 2000;
+static UInt32               sReadAheadMaxWaitMsec   = 100;
+
 static Float32              sAddClientBufferDelaySecs = 0;/* used in DoDescribe() */
 
 static Bool16               sRecordMovieFileSDP = false;/* whether record movie file? */
@@ -160,6 +187,7 @@ static QTSS_Error Register(QTSS_Register_Params* inParams);
 static QTSS_Error Initialize(QTSS_Initialize_Params* inParamBlock);
 static QTSS_Error RereadPrefs();
 static QTSS_Error ProcessRTSPRequest(QTSS_StandardRTSP_Params* inParamBlock);
+static QTSS_Error AuthorizeRequest(QTSS_StandardRTSP_Params* inParamBlock);
 static QTSS_Error DoDescribe(QTSS_StandardRTSP_Params* inParamBlock);
 static QTSS_Error CreateQTRTPFile(QTSS_StandardRTSP_Params* inParamBlock, char* inPath, FileSession** outFile);/* important tie */
 static QTSS_Error DoSetup(QTSS_StandardRTSP_Params* inParamBlock);
@@ -168,6 +196,7 @@ static QTSS_Error SendPackets(QTSS_RTPSendPackets_Params* inParams); //note impo
 static QTSS_Error DestroySession(QTSS_ClientSessionClosing_Params* inParams);
 /* additional functions comparing with QTSSRTPFileModule.cpp */
 static void       DeleteFileSession(FileSession* inFileSession);
+static Bool16     ReadAhead(FileSession* inFile, SInt64 inCurrentTime);
 static UInt32   WriteSDPHeader(FILE* sdpFile, iovec *theSDPVec, SInt16 *ioVectorIndex, StrPtrLen *sdpHeader);
 static void     BuildPrefBasedHeaders();
 
@@ -315,6 +344,8 @@ QTSS_Error  QTSSFileModuleDispatch(QTSS_Role inRole, QTSS_RoleParamPtr inParamBl
             return RereadPrefs();
         case QTSS_RTSPRequest_Role:/* RTSP requestsend packet to use */
             return ProcessRTSPRequest(&inParamBlock->rtspRequestParams);
+        case QTSS_RTSPAuthorize_Role:
+            return AuthorizeRequest(&inParamBlock->rtspAuthParams);
         case QTSS_RTPSendPackets_Role: /* we are use it in RTPSession.cpp soon */
             return SendPackets(&inParamBlock->rtpSendPacketsParams);
         case QTSS_ClientSessionClosing_Role:
@@ -331,6 +362,7 @@ QTSS_Error Register(QTSS_Register_Params* inParams)
 	/* ΪģעRole(ʼ,Ԥֵ,RTSP,RTPỰر),ΪûQTSS_RTPSendPackets_Role ? */
     (void)QTSS_AddRole(QTSS_Initialize_Role);
     (void)QTSS_AddRole(QTSS_RTSPRequest_Role);
+    (void)QTSS_AddRole(QTSS_RTSPAuthorize_Role);
     (void)QTSS_AddRole(QTSS_ClientSessionClosing_Role);
     (void)QTSS_AddRole(QTSS_RereadPrefs_Role);
 
@@ -396,6 +428,7 @@ QTSS_Error Register(QTSS_Register_Params* inParams)
 QTSS_Error Initialize(QTSS_Initialize_Params* inParams)
 {
     QTRTPFile::Initialize();
+    QTAccessFile::Initialize();
     QTSSModuleUtils::Initialize(inParams->inMessages, inParams->inServer, inParams->inErrorLogStream);//̬ʼ
 
 	/* 濪ͷж */
@@ -534,6 +567,36 @@ QTSS_Error RereadPrefs()
     sPrivateBufferMaxUnits = 8;
     QTSSModuleUtils::GetIOAttribute(sPrefs, "max_private_buffer_units_per_buffer", qtssAttrDataTypeUInt32, &sPrivateBufferMaxUnits, sizeof(sPrivateBufferMaxUnits));
 
+    sSharedBlockCacheKSize = 32768;
+    QTSSModuleUtils::GetIOAttribute(sPrefs, "shared_block_cache_k_size", qtssAttrDataTypeUInt32, &sSharedBlockCacheKSize, sizeof(sSharedBlockCacheKSize));
+    OSFileBlockCache::SetMaxBytes((UInt64)sSharedBlockCacheKSize * 1024);
+
+    sMapMovieFiles = false;
+    QTSSModuleUtils::GetIOAttribute(sPrefs, "map_movie_files", qtssAttrDataTypeBool16, &sMapMovieFiles, sizeof(sMapMovieFiles));
+    QTFile::SetMapFiles(sMapMovieFiles);
+
+    sMaxCachedUnusedMovies = 100;
+    QTSSModuleUtils::GetIOAttribute(sPrefs, "max_cached_unused_movies", qtssAttrDataTypeUInt32, &sMaxCachedUnusedMovies, sizeof(sMaxCachedUnusedMovies));
+    QTRTPFile::SetFileCacheSize(sMaxCachedUnusedMovies);
+
+    sMaxCachedDescribes = 100;
+    QTSSModuleUtils::GetIOAttribute(sPrefs, "max_cached_describe_responses", qtssAttrDataTypeUInt32, &sMaxCachedDescribes, sizeof(sMaxCachedDescribes));
+    DescribeCache::SetCacheSize(sMaxCachedDescribes);
+
+    sEnableReadAhead = true;
+    QTSSModuleUtils::GetIOAttribute(sPrefs, "enable_async_read_ahead", qtssAttrDataTypeBool16, &sEnableReadAhead, sizeof(sEnableReadAhead));
+
+    sReadAheadMsec = 2000;
+    QTSSModuleUtils::GetIOAttribute(sPrefs, "read_ahead_msec", qtssAttrDataTypeUInt32, &sReadAheadMsec, sizeof(sReadAheadMsec));
+    if (sReadAheadMsec < 100)
+        sReadAheadMsec = 100;
+
+    // A session waiting on a read ahead is woken up at the latest after this
+    sReadAheadMaxWaitMsec = 100;
+    QTSSModuleUtils::GetIOAttribute(sPrefs, "read_ahead_max_wait_msec", qtssAttrDataTypeUInt32, &sReadAheadMaxWaitMsec, sizeof(sReadAheadMaxWaitMsec));
+    if (sReadAheadMaxWaitMsec < 10)
+        sReadAheadMaxWaitMsec = 10;
+
 	//sAddClientBufferDelaySecs
     sAddClientBufferDelaySecs = 0;
     QTSSModuleUtils::GetIOAttribute(sPrefs, "add_seconds_to_client_buffer_delay", qtssAttrDataTypeFloat32, &sAddClientBufferDelaySecs, sizeof(sAddClientBufferDelaySecs));
@@ -567,6 +630,9 @@ QTSS_Error RereadPrefs()
     (void) QTSS_GetValue(sServerPrefs, qtssPrefsDisableThinning, 0, (void*)&sDisableThinning, &len);
 
     BuildPrefBasedHeaders();
+
+    // Whatever was built with the old prefs is out of date now
+    DescribeCache::IncrementPrefsGeneration();
     
     return QTSS_NoErr;
 }
@@ -630,6 +696,14 @@ QTSS_Error ProcessRTSPRequest(QTSS_StandardRTSP_Params* inParamBlock)
     return QTSS_NoErr;
 }
 
+/* Checks read requests against the qtaccess file of the movie's folder, if it has one */
+QTSS_Error AuthorizeRequest(QTSS_StandardRTSP_Params* inParamBlock)
+{
+    // Folders without a qtaccess file are open to everyone. Requests that
+    // aren't only reads are left to the other modules.
+    return QTAccessFile::AuthorizeRequest(inParamBlock, true, ~qtssActionFlagsRead, qtssActionFlagsRead);
+}
+
 /* жýļıصַ󼸸ַǷ".sdp",Ǿͷtrue,ͷfalse  */
 Bool16 isSDP(QTSS_StandardRTSP_Params* inParamBlock)
 {
@@ -678,6 +752,7 @@ QTSS_Error DoDescribe(QTSS_StandardRTSP_Params* inParamBlock)
     Bool16          pathEndsWithMOV = false;/* ·ĩβMOV? */
     static StrPtrLen sMOVSuffix(".mov");
     SInt16 vectorIndex = 1; /* λSDPļĵһ */
+    DescribeCacheEntry* theCacheEntry = NULL;
     ResizeableStringFormatter theFullSDPBuffer(NULL,0);/* شSDPļĻ */
     StrPtrLen bufferDelayStr;/* sdpļеĻӳַ,Ӧü */
     char tempBufferDelay[64];/* Żӳٵַ"a=x-bufferdelay:0.2254",Ϊ64ַ,Ӧü */
@@ -879,6 +954,46 @@ QTSS_Error DoDescribe(QTSS_StandardRTSP_Params* inParamBlock)
         StrPtrLen ownerStr(ownerLine);
         theFullSDPBuffer.Put(ownerStr); 
         theFullSDPBuffer.Put(sEOL); 
+
+        // The rest of the sdp only changes with the movie, the prefs and whether
+        // the player gets its bandwidth adjusted, so send the prebuilt one if
+        // we have it (and aren't recording the sdp to a file).
+        Bool16 adjustMediaBandwidth = false;
+        if (sPlayerCompatibility )//ֵĬΪtrue,ݲ
+			/* ҷԤֵǷAdjustBandwidth,boolֵ */
+            adjustMediaBandwidth = QTSSModuleUtils::HavePlayerProfile(sServerPrefs, inParamBlock,QTSSModuleUtils::kAdjustBandwidth);
+
+        UInt32 thePrefsGeneration = DescribeCache::GetPrefsGeneration();
+        if ((sdpFile == NULL) && (fileNameStr != NULL))
+            theCacheEntry = DescribeCache::Find(thePath.GetObject(), fileNameStr,
+                                        theFile->fFile.GetQTFile()->GetModDate(), adjustMediaBandwidth);
+        if (theCacheEntry != NULL)
+        {
+            // Send the cached headers with this request's "o=" line in place of the cached one
+            StrPtrLen* theSessionHeaders = &theCacheEntry->fSessionHeaders;
+            UInt32 theOwnerEnd = theCacheEntry->fOwnerOffset + theCacheEntry->fOwnerLen;
+
+            theSDPVec[1].iov_base = theSessionHeaders->Ptr;
+            theSDPVec[1].iov_len = theCacheEntry->fOwnerOffset;
+            theSDPVec[2].iov_base = ownerStr.Ptr;
+            theSDPVec[2].iov_len = ownerStr.Len;
+            theSDPVec[3].iov_base = theSessionHeaders->Ptr + theOwnerEnd;
+            theSDPVec[3].iov_len = theSessionHeaders->Len - theOwnerEnd;
+            theSDPVec[4].iov_base = theCacheEntry->fMediaHeaders.Ptr;
+            theSDPVec[4].iov_len = theCacheEntry->fMediaHeaders.Len;
+            totalSDPLength = theSDPVec[1].iov_len + theSDPVec[2].iov_len + theSDPVec[3].iov_len + theSDPVec[4].iov_len;
+
+            (void)QTSS_AppendRTSPHeader(inParamBlock->inRTSPRequest, qtssLastModifiedHeader,
+                                            theFile->fFile.GetQTFile()->GetModDateStr(), DateBuffer::kDateBufferLen);
+            (void)QTSS_AppendRTSPHeader(inParamBlock->inRTSPRequest, qtssCacheControlHeader,
+                                            kCacheControlHeader.Ptr, kCacheControlHeader.Len);
+            QTSSModuleUtils::SendDescribeResponse(inParamBlock->inRTSPRequest, inParamBlock->inClientSession,
+                                                                            &theSDPVec[0], 5, totalSDPLength);
+
+            theFile->fSDPSource.Parse(theCacheEntry->fMovieSDP.Ptr, theCacheEntry->fMovieSDP.Len);
+            DescribeCache::Release(theCacheEntry);
+            return QTSS_NoErr;
+        }
         
 // -------- session header
 
@@ -1010,10 +1125,6 @@ QTSS_Error DoDescribe(QTSS_StandardRTSP_Params* inParamBlock)
 		
 // ------------ reorder the sdp headers to make them proper.ǡ˳SDPͷ
         Float32 adjustMediaBandwidthPercent = 1.0;
-        Bool16 adjustMediaBandwidth = false;
-        if (sPlayerCompatibility )//ֵĬΪtrue,ݲ
-			/* ҷԤֵǷAdjustBandwidth,boolֵ */
-            adjustMediaBandwidth = QTSSModuleUtils::HavePlayerProfile(sServerPrefs, inParamBlock,QTSSModuleUtils::kAdjustBandwidth);
 		    
 		if (adjustMediaBandwidth)
 		    adjustMediaBandwidthPercent = (Float32) sAdjustMediaBandwidthPercent / 100.0;//õٷֱΪ50%,sortedSDPҪ
@@ -1025,6 +1136,13 @@ QTSS_Error DoDescribe(QTSS_StandardRTSP_Params* inParamBlock)
 		StrPtrLen *theSessionHeadersPtr = sortedSDP.GetSessionHeaders();
 		/* ÿauido/video track,ӶӦmͷԺҵܵbͷ,MediaBandwidth,ʼԱfMediaHeaders */
 		StrPtrLen *theMediaHeadersPtr = sortedSDP.GetMediaHeaders();
+
+        // Keep the result for the next DESCRIBE of the movie
+        char* theOwnerPtr = theSessionHeadersPtr->FindString(ownerLine);
+        if ((theOwnerPtr != NULL) && (fileNameStr != NULL))
+            DescribeCache::Add(thePath.GetObject(), fileNameStr, theFile->fFile.GetQTFile()->GetModDate(),
+                                adjustMediaBandwidth, thePrefsGeneration, theSessionHeadersPtr, theMediaHeadersPtr,
+                                &theSDPData, (UInt32)(theOwnerPtr - theSessionHeadersPtr->Ptr), ownerStr.Len);
 		
 // ----------- write out the sdp
 
@@ -1111,6 +1229,10 @@ QTSS_Error CreateQTRTPFile(QTSS_StandardRTSP_Params* inParamBlock, char* inPath,
 
         AssertV(0, theErr);
     }
+
+    // No read ahead handle just means reading without it
+    if (sEnableReadAhead && (*outFile != NULL))
+        (void)QTSS_OpenFileObject(inPath, qtssOpenFileReadAhead, &(*outFile)->fReadAheadFile);
     
     return QTSS_NoErr;
 }
@@ -1601,6 +1723,9 @@ QTSS_Error DoPlay(QTSS_StandardRTSP_Params* inParamBlock)
 	/* set fAdjustedPlayTime(ms) */
 	/* fAdjustedPlayTimeclient㲥ýļʱʱRTSP Rangeͷ"Range: npt=0.00000-70.00000\r\n"пʼŵʱļ! */
     (*theFile)->fAdjustedPlayTime = *thePlayTime - ((SInt64)((*theFile)->fStartTime * 1000));
+
+    // We may have seeked, start reading ahead from the new position
+    (*theFile)->fNextReadAheadTime = 0;
     
 	/*************** theSpeed,RTSPͷ"Speed: 2.0\r\n" ************************/
     // This module supports the Speed header if the client wants the stream faster than normal.
@@ -1703,6 +1828,20 @@ QTSS_Error SendPackets(QTSS_RTPSendPackets_Params* inParams)
         /* when we find that the buffer to save packet date is empty */
         if ((*theFile)->fPacketStruct.packetData == NULL)
         {
+            // Don't let GetNextPacket touch the disk. If the movie data it is about
+            // to read isn't in memory yet, come back once the file system module
+            // has read it (or after sReadAheadMaxWaitMsec, whichever is first).
+            if (((*theFile)->fReadAheadFile != NULL) && (inParams->inCurrentTime >= (*theFile)->fNextReadAheadTime))
+            {
+                if (!ReadAhead(*theFile, inParams->inCurrentTime))
+                {
+                    (void)QTSS_RequestEvent((*theFile)->fReadAheadFile, QTSS_ReadableEvent);
+                    (*theFile)->fNextReadAheadTime = 0;
+                    inParams->outNextPacketTime = sReadAheadMaxWaitMsec;
+                    return QTSS_NoErr;
+                }
+            }
+
 			/* refer to QTRTPFile::GetNextPacket() */
 			/* theTransmitTime is very important, used by much places below ! */
 			/* theTransmitTimeǵõһpacketʱ(ʱ) */
@@ -1912,6 +2051,22 @@ QTSS_Error SendPackets(QTSS_RTPSendPackets_Params* inParams)
 }
 
 /* ȡFileSessionʵ,лȡskip,еRTPSessionеqtssCliSesFramesSkipped,ɾFileSessionʵ */
+// Asks the file system module to read the next sReadAheadMsec of the movie, and
+// returns false if the part GetNextPacket is about to read isn't in yet. The
+// range is refreshed every quarter of sReadAheadMsec, so the rest of it has
+// had time to come in by the time packets get to it.
+Bool16 ReadAhead(FileSession* inFile, SInt64 inCurrentTime)
+{
+    inFile->fNextReadAheadTime = inCurrentTime + (sReadAheadMsec / 4);
+
+    UInt64 theOffset = 0;
+    UInt32 theLength = 0;
+    if (!inFile->fFile.GetReadAheadRange(sReadAheadMsec / 1000.0, &theOffset, &theLength))
+        return true;
+
+    return QTSS_Advise(inFile->fReadAheadFile, theOffset, theLength) != QTSS_WouldBlock;
+}
+
 QTSS_Error DestroySession(QTSS_ClientSessionClosing_Params* inParams)
 {
 	//acquire file session attributes
@@ -19,11 +19,16 @@ LastUpdate:  2010-08-23
 #include "OSMemory.h"
 #include "OSFileSource.h"
 #include "Socket.h"
+#include "ReadAheadEngine.h"
 
 
 // ATTRIBUTES
 static QTSS_AttributeID         sOSFileSourceAttr = qtssIllegalAttrID;
 static QTSS_AttributeID         sEventContextAttr = qtssIllegalAttrID;
+static QTSS_AttributeID         sReadAheadFileAttr = qtssIllegalAttrID;
+
+// PREFS
+static UInt32                   sNumReadAheadThreads = 2;
 
 // FUNCTION PROTOTYPES
 
@@ -83,6 +88,10 @@ QTSS_Error Register(QTSS_Register_Params* inParams)
     static char*        sEventContextName   = "QTSSPosixFileSysModuleEventContext";
     (void)QTSS_AddStaticAttribute(qtssFileObjectType, sEventContextName, NULL, qtssAttrDataTypeVoidPointer);
     (void)QTSS_IDForAttr(qtssFileObjectType, sEventContextName, &sEventContextAttr);
+
+    static char*        sReadAheadFileName  = "QTSSPosixFileSysModuleReadAheadFile";
+    (void)QTSS_AddStaticAttribute(qtssFileObjectType, sReadAheadFileName, NULL, qtssAttrDataTypeVoidPointer);
+    (void)QTSS_IDForAttr(qtssFileObjectType, sReadAheadFileName, &sReadAheadFileAttr);
     
     // Tell the server our name!
     static char* sModuleName = "QTSSPosixFileSysModule";
@@ -95,6 +104,11 @@ QTSS_Error Initialize(QTSS_Initialize_Params* inParams)
 {
     // Setup module utils
     QTSSModuleUtils::Initialize(inParams->inMessages, inParams->inServer, inParams->inErrorLogStream);
+
+    // The I/O threads are started once, changing the pref takes a restart
+    QTSS_ModulePrefsObject thePrefs = QTSSModuleUtils::GetModulePrefsObject(inParams->inModule);
+    QTSSModuleUtils::GetIOAttribute(thePrefs, "num_read_ahead_threads", qtssAttrDataTypeUInt32, &sNumReadAheadThreads, sizeof(sNumReadAheadThreads));
+    ReadAheadEngine::Initialize(sNumReadAheadThreads);
     return QTSS_NoErr;
 }
 
@@ -143,6 +157,14 @@ QTSS_Error  OpenFile(QTSS_OpenFile_Params* inParams)
         }
     }
     
+    //
+    // Files read from start to end get the I/O threads to read ahead of them
+    if ((inParams->inFlags & qtssOpenFileReadAhead) && ReadAheadEngine::IsEnabled())
+    {
+        ReadAheadFile* theReadAheadFile = ReadAheadEngine::Open(theFileSource);
+        (void)QTSS_SetValue(inParams->inFileObject, sReadAheadFileAttr, 0, &theReadAheadFile, sizeof(theReadAheadFile));
+    }
+
     //
     // Set up the other attribute values in the file object
     (void)QTSS_SetValue(inParams->inFileObject, qtssFlObjLength, 0, &theLength, sizeof(theLength));
@@ -156,6 +178,17 @@ QTSS_Error  AdviseFile(QTSS_AdviseFile_Params* inParams)
     OSFileSource** theFile = NULL;
     UInt32 theLen = 0;
     
+    //
+    // With read ahead, the I/O threads read the range. Let the caller know
+    // if it is going to block on it.
+    ReadAheadFile** theReadAheadFile = NULL;
+    if (QTSS_GetValuePtr(inParams->inFileObject, sReadAheadFileAttr, 0, (void**)&theReadAheadFile, &theLen) == QTSS_NoErr)
+    {
+        if (ReadAheadEngine::Advise(*theReadAheadFile, inParams->inPosition, inParams->inSize))
+            return QTSS_NoErr;
+        return QTSS_WouldBlock;
+    }
+
     (void)QTSS_GetValuePtr(inParams->inFileObject, sOSFileSourceAttr, 0, (void**)&theFile, &theLen);
     Assert(theLen == sizeof(OSFileSource*));
     (*theFile)->Advise(inParams->inPosition, inParams->inSize);
@@ -199,6 +232,16 @@ QTSS_Error  CloseFile(QTSS_CloseFile_Params* inParams)
         (*theFile)->ResetFD();
         delete *theContext;
     }
+
+    //
+    // The read ahead engine may still be reading the file, it deletes the
+    // OSFileSource when it is done with it
+    ReadAheadFile** theReadAheadFile = NULL;
+    if (QTSS_GetValuePtr(inParams->inFileObject, sReadAheadFileAttr, 0, (void**)&theReadAheadFile, &theLen) == QTSS_NoErr)
+    {
+        ReadAheadEngine::Close(*theReadAheadFile);
+        return QTSS_NoErr;
+    }
     delete *theFile;
     return QTSS_NoErr;
 }
@@ -213,6 +256,15 @@ QTSS_Error  RequestEventFile(QTSS_RequestEventFile_Params* inParams)
     
     EventContext** theContext = NULL;
     UInt32 theLen = 0;
+
+    //
+    // Read ahead files signal the task once the last advised range is in
+    ReadAheadFile** theReadAheadFile = NULL;
+    if (QTSS_GetValuePtr(inParams->inFileObject, sReadAheadFileAttr, 0, (void**)&theReadAheadFile, &theLen) == QTSS_NoErr)
+    {
+        ReadAheadEngine::RequestEvent(*theReadAheadFile, theState->curTask);
+        return QTSS_NoErr;
+    }
     
     QTSS_Error theErr = QTSS_GetValuePtr(inParams->inFileObject, sEventContextAttr, 0, (void**)&theContext, &theLen);
     if (theErr == QTSS_NoErr)
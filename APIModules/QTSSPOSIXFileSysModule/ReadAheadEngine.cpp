@@ -0,0 +1,226 @@
+/***************************************************************************
+
+Copyright (c) 1999-2003 Apple Computer, Inc.  All Rights Reserved.
+2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 ReadAheadEngine.cpp
+Description: Provide a pool of I/O threads that read files ahead of their
+             readers, so TaskThreads don't block on cold disk reads.
+Comment:     used by QTSSPosixFileSysModule for files opened with qtssOpenFileReadAhead
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-17
+LastUpdate:  2026-10-17
+
+****************************************************************************/
+
+
+#include <unistd.h>
+#include <errno.h>
+
+#include "ReadAheadEngine.h"
+#include "OSFileBlockCache.h"
+#include "OSMemory.h"
+#include "MyAssert.h"
+
+
+class ReadAheadThread : public OSThread
+{
+    public:
+        ReadAheadThread() : fBuffer(NEW char[ReadAheadEngine::kChunkSize]) {}
+        virtual ~ReadAheadThread() { delete [] fBuffer; }
+
+    private:
+        virtual void Entry() { ReadAheadEngine::Run(fBuffer); }
+
+        char*   fBuffer;    // where the data goes when it isn't read into the block cache
+};
+
+
+OSMutex     ReadAheadEngine::sMutex;
+OSCond*     ReadAheadEngine::sCond = NULL;
+OSQueue     ReadAheadEngine::sQueue;
+UInt32      ReadAheadEngine::sNumThreads = 0;
+
+
+ReadAheadFile::ReadAheadFile(OSFileSource* inFile)
+:   fQueueElem(this),
+    fFile(inFile),
+    fResidentStart(0),
+    fResidentEnd(0),
+    fRequestedEnd(0),
+    fWaitEnd(0),
+    fWaitingTask(NULL),
+    fBusy(false),
+    fClosed(false)
+{
+}
+
+ReadAheadFile::~ReadAheadFile()
+{
+    delete fFile;
+}
+
+
+void ReadAheadEngine::Initialize(UInt32 inNumThreads)
+{
+    Assert(sNumThreads == 0);
+    if (inNumThreads == 0)
+        return;
+
+    sCond = NEW OSCond();
+    for (UInt32 x = 0; x < inNumThreads; x++)
+    {
+        ReadAheadThread* theThread = NEW ReadAheadThread();
+        theThread->Start();
+    }
+    sNumThreads = inNumThreads;
+}
+
+ReadAheadFile* ReadAheadEngine::Open(OSFileSource* inFile)
+{
+    return NEW ReadAheadFile(inFile);
+}
+
+void ReadAheadEngine::Close(ReadAheadFile* inFile)
+{
+    {
+        OSMutexLocker locker(&sMutex);
+        inFile->fClosed = true;
+        inFile->fWaitingTask = NULL;
+
+        // The I/O thread deletes it when it is done
+        if (inFile->fBusy)
+            return;
+
+        if (inFile->fQueueElem.IsMemberOfAnyQueue())
+            sQueue.Remove(&inFile->fQueueElem);
+    }
+    delete inFile;
+}
+
+Bool16 ReadAheadEngine::Advise(ReadAheadFile* inFile, UInt64 inPosition, UInt32 inLength)
+{
+    OSMutexLocker locker(&sMutex);
+
+    UInt64 theEnd = inPosition + inLength;
+    if (theEnd - inPosition > kMaxReadAheadBytes)
+        theEnd = inPosition + kMaxReadAheadBytes;
+
+    if ((inPosition < inFile->fResidentStart) || (inPosition > inFile->fResidentEnd))
+    {
+        // Nothing we have read is of use, start over from here
+        inFile->fResidentEnd = inPosition;
+        inFile->fRequestedEnd = inPosition;
+    }
+    inFile->fResidentStart = inPosition;
+
+    if (theEnd > inFile->fRequestedEnd)
+        inFile->fRequestedEnd = theEnd;
+
+    inFile->fWaitEnd = inPosition + kResidentCheckBytes;
+    if (inFile->fWaitEnd > theEnd)
+        inFile->fWaitEnd = theEnd;
+
+    if (inFile->fResidentEnd < inFile->fRequestedEnd)
+        Enqueue(inFile);
+
+    return inFile->fResidentEnd >= inFile->fWaitEnd;
+}
+
+void ReadAheadEngine::RequestEvent(ReadAheadFile* inFile, Task* inTask)
+{
+    OSMutexLocker locker(&sMutex);
+    inFile->fWaitingTask = inTask;
+    SignalIfResident(inFile);
+}
+
+// Everything below is called with sMutex held
+
+void ReadAheadEngine::Enqueue(ReadAheadFile* inFile)
+{
+    // A busy file gets put back on the queue by its I/O thread
+    if (inFile->fBusy || inFile->fQueueElem.IsMemberOfAnyQueue())
+        return;
+
+    sQueue.EnQueue(&inFile->fQueueElem);
+    sCond->Signal();
+}
+
+void ReadAheadEngine::SignalIfResident(ReadAheadFile* inFile)
+{
+    if ((inFile->fWaitingTask != NULL) && (inFile->fResidentEnd >= inFile->fWaitEnd))
+    {
+        inFile->fWaitingTask->Signal(Task::kReadEvent);
+        inFile->fWaitingTask = NULL;
+    }
+}
+
+void ReadAheadEngine::Run(char* inBuffer)
+{
+    OSMutexLocker locker(&sMutex);
+    while (true)
+    {
+        OSQueueElem* theElem = sQueue.DeQueue();
+        if (theElem == NULL)
+        {
+            sCond->Wait(&sMutex);
+            continue;
+        }
+
+        ReadAheadFile* theFile = (ReadAheadFile*)theElem->GetEnclosingObject();
+        UInt64 thePosition = theFile->fResidentEnd;
+        if (thePosition >= theFile->fRequestedEnd)
+            continue;
+
+        UInt32 theLength = kChunkSize;
+        if (theFile->fRequestedEnd - thePosition < theLength)
+            theLength = (UInt32)(theFile->fRequestedEnd - thePosition);
+
+        theFile->fBusy = true;
+        locker.Unlock();
+
+        OSFileSource* theSource = theFile->GetFileSource();
+        OS_Error theErr = OS_NoErr;
+        UInt32 theRcvLen = 0;
+        if (OSFileBlockCache::IsEnabled())
+            theErr = theSource->ReadFromBlockCache(thePosition, inBuffer, theLength, &theRcvLen);
+        else
+        {
+            ssize_t theLen = -1;
+            do
+            {
+                theLen = ::pread(theSource->GetFD(), inBuffer, theLength, thePosition);
+            } while ((theLen == -1) && (OSThread::GetErrno() == EINTR));
+
+            if (theLen < 0)
+                theErr = OSThread::GetErrno();
+            else
+                theRcvLen = (UInt32)theLen;
+        }
+
+        locker.Lock();
+        theFile->fBusy = false;
+
+        if (theFile->fClosed)
+        {
+            delete theFile;
+            continue;
+        }
+
+        // Unless the reader moved somewhere else while we were reading
+        if (theFile->fResidentEnd == thePosition)
+        {
+            // An error or the end of the file: the reader will find out for itself,
+            // don't keep it waiting on data that isn't coming
+            if ((theErr != OS_NoErr) || (theRcvLen < theLength))
+                theFile->fResidentEnd = theFile->fRequestedEnd;
+            else
+                theFile->fResidentEnd += theRcvLen;
+        }
+
+        SignalIfResident(theFile);
+        if (theFile->fResidentEnd < theFile->fRequestedEnd)
+            Enqueue(theFile);
+    }
+}
@@ -0,0 +1,118 @@
+/***************************************************************************
+
+Copyright (c) 1999-2003 Apple Computer, Inc.  All Rights Reserved.
+2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 ReadAheadEngine.h
+Description: Provide a pool of I/O threads that read files ahead of their
+             readers, so TaskThreads don't block on cold disk reads.
+Comment:     used by QTSSPosixFileSysModule for files opened with qtssOpenFileReadAhead
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-17
+LastUpdate:  2026-10-17
+
+****************************************************************************/
+
+
+#ifndef __READAHEADENGINE_H__
+#define __READAHEADENGINE_H__
+
+#include "OSHeaders.h"
+#include "OSQueue.h"
+#include "OSMutex.h"
+#include "OSCond.h"
+#include "OSThread.h"
+#include "OSFileSource.h"
+#include "Task.h"
+
+//
+// A reader tells the engine which part of a file it is about to need with
+// Advise. The I/O threads read that range through the file's OSFileSource,
+// which leaves it in the shared OSFileBlockCache if that is on and in the
+// kernel page cache in any case, so that the reader's own read (or a mapping
+// of the file) finds it resident.
+//
+// Each file keeps one window [fResidentStart, fResidentEnd) of data that has
+// been read, and how far the window has been asked to grow. Reads happen a
+// chunk at a time, in order, with the files taking turns on the threads.
+// Advising a range that doesn't start inside the window (a seek) starts a new
+// window there.
+//
+// A task that finds its range isn't in yet can ask to be signalled (with a
+// Task::kReadEvent) once it is.
+
+class ReadAheadFile
+{
+    public:
+
+        OSFileSource*   GetFileSource() { return fFile; }
+
+    private:
+
+        ReadAheadFile(OSFileSource* inFile);
+        ~ReadAheadFile();
+
+        OSQueueElem     fQueueElem;
+        OSFileSource*   fFile;          // owned once Close has been called
+
+        UInt64          fResidentStart;
+        UInt64          fResidentEnd;
+        UInt64          fRequestedEnd;
+        UInt64          fWaitEnd;       // fWaitingTask is signalled once fResidentEnd gets here
+        Task*           fWaitingTask;
+
+        Bool16          fBusy;          // an I/O thread is reading for this file right now
+        Bool16          fClosed;
+
+        friend class ReadAheadEngine;
+};
+
+class ReadAheadEngine
+{
+    public:
+
+        enum
+        {
+            kChunkSize          = 128 * 1024,       // read per turn of a file on an I/O thread
+            kResidentCheckBytes = 64 * 1024,        // Advise reports resident once this much of the range is in
+            kMaxReadAheadBytes  = 8 * 1024 * 1024   // longest window a single Advise can ask for
+        };
+
+        //
+        // Starts the I/O threads. With 0 threads the engine stays off, and
+        // callers should advise the kernel directly.
+        static void             Initialize(UInt32 inNumThreads);
+        static Bool16           IsEnabled()     { return sNumThreads > 0; }
+
+        //
+        // Open wraps an OSFileSource, Close hands it over to the engine, which
+        // deletes it (and the ReadAheadFile) as soon as no I/O thread uses it.
+        static ReadAheadFile*   Open(OSFileSource* inFile);
+        static void             Close(ReadAheadFile* inFile);
+
+        //
+        // Queues whatever part of the range isn't read yet. Returns true if the
+        // start of the range (kResidentCheckBytes of it) is already resident.
+        static Bool16           Advise(ReadAheadFile* inFile, UInt64 inPosition, UInt32 inLength);
+
+        //
+        // Signals inTask once the start of the range last advised is resident,
+        // right away if it already is.
+        static void             RequestEvent(ReadAheadFile* inFile, Task* inTask);
+
+    private:
+
+        static void             Run(char* inBuffer);
+        static void             Enqueue(ReadAheadFile* inFile);
+        static void             SignalIfResident(ReadAheadFile* inFile);
+
+        static OSMutex          sMutex;
+        static OSCond*          sCond;          // never deleted, the I/O threads wait on it until exit
+        static OSQueue          sQueue;         // files with data left to read
+        static UInt32           sNumThreads;
+
+        friend class ReadAheadThread;
+};
+
+#endif //__READAHEADENGINE_H__
@@ -20,6 +20,8 @@ LastUpdate:  2010-08-16
 #define ASSERT 1
 #define MEMORY_DEBUGGING  0 /* 20091030taoyxmodified*/ //enable this to turn on really fancy debugging of memory leaks, etc...
 #define QTFILE_MEMORY_DEBUGGING 0 //QuickTime file memory debugging
+#define QTFILE_PACKET_INDEX 1 //seek RTP-Meta-Info streams through a per movie packet index (<movie>.pidx)
+#define QTFILE_SAMPLE_TABLE_INDEX 1 //binary search the stts/stsc/stss tables through cumulative tables built when the movie is opened
 
 #define PLATFORM_SERVER_BIN_NAME "DarwinStreamingServer"
 #define PLATFORM_SERVER_TEXT_NAME "Darwin Streaming Server"
@@ -34,6 +36,7 @@ LastUpdate:  2010-08-16
 
 #define USE_ATOMICLIB 0
 #define MACOSXEVENTQUEUE 0
+#define EPOLL_EVENTQUEUE 1 //use the epoll event queue (epollev.cpp) instead of the select() shim (ev.cpp)
 #define __PTHREADS__    1
 #define __PTHREADS_MUTEXES__    1
 #define ALLOW_NON_WORD_ALIGN_ACCESS 1
@@ -0,0 +1,89 @@
+/***************************************************************************
+
+Copyright (c) 1999-2003 Apple Computer, Inc.  All Rights Reserved.
+2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 CheckDriver.cpp
+Description: What the check tools share: picking the check to run from the
+             command line, and reporting what it found.
+Comment:     used by CommonUtilitiesCheck and MP4PacketizerCheck
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-17
+LastUpdate:  2026-10-17
+
+****************************************************************************/
+
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+
+#include "SafeStdLib.h"
+#include "OS.h"
+#include "OSThread.h"
+#include "atomic.h"
+#include "CheckDriver.h"
+
+
+enum
+{
+    kMaxPrintedErrors   = 10,   //UInt32
+    kMaxLineLength      = 1024  //UInt32
+};
+
+static const char*  sCheckName = "check";
+static unsigned int sNumFailed = 0;
+
+static void PrintLine(const char* inFormat, va_list inArgs)
+{
+    char theLine[kMaxLineLength];
+    (void)::vsnprintf(theLine, sizeof(theLine), inFormat, inArgs);
+    qtss_printf("%s: %s\n", sCheckName, theLine);
+}
+
+void CheckPrintf(const char* inFormat, ...)
+{
+    va_list theArgs;
+    va_start(theArgs, inFormat);
+    PrintLine(inFormat, theArgs);
+    va_end(theArgs);
+}
+
+void CheckFailed(const char* inFormat, ...)
+{
+    if (atomic_add(&sNumFailed, 1) > kMaxPrintedErrors)
+        return;
+
+    va_list theArgs;
+    va_start(theArgs, inFormat);
+    PrintLine(inFormat, theArgs);
+    va_end(theArgs);
+}
+
+UInt32 CheckNumFailed()
+{
+    return sNumFailed;
+}
+
+int RunCheck(int argc, char* argv[], CheckEntry* inChecks, UInt32 inNumChecks)
+{
+    OS::Initialize();
+    OSThread::Initialize();
+
+    for (UInt32 x = 0; (argc >= 2) && (x < inNumChecks); x++)
+    {
+        if (::strcmp(argv[1], inChecks[x].fName) != 0)
+            continue;
+
+        sCheckName = inChecks[x].fName;
+        (inChecks[x].fProc)(argc - 2, argv + 2);
+        CheckPrintf("%lu errors", CheckNumFailed());
+        return (CheckNumFailed() == 0) ? 0 : 1;
+    }
+
+    qtss_fprintf(stderr, "usage: %s check [args]\n", argv[0]);
+    for (UInt32 x = 0; x < inNumChecks; x++)
+        qtss_fprintf(stderr, "    %s %s\n", inChecks[x].fName, inChecks[x].fUsage);
+    return 1;
+}
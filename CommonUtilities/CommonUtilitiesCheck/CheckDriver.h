@@ -0,0 +1,46 @@
+/***************************************************************************
+
+Copyright (c) 1999-2003 Apple Computer, Inc.  All Rights Reserved.
+2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 CheckDriver.h
+Description: What the check tools share: picking the check to run from the
+             command line, and reporting what it found.
+Comment:     a check reports each thing that didn't hold with CheckFailed,
+             and its results with CheckPrintf
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-17
+LastUpdate:  2026-10-17
+
+****************************************************************************/
+
+
+#ifndef __CHECKDRIVER_H__
+#define __CHECKDRIVER_H__
+
+#include "OSHeaders.h"
+
+typedef void (*CheckProc)(int argc, char* argv[]);
+
+struct CheckEntry
+{
+    const char* fName;
+    CheckProc   fProc;
+    const char* fUsage;
+};
+
+// Runs the check named by argv[1] with the arguments after it, and prints how
+// many errors it found. Returns 0 if there were none, 1 if there were, or if
+// there is no such check, after printing the usage.
+int     RunCheck(int argc, char* argv[], CheckEntry* inChecks, UInt32 inNumChecks);
+
+// Prints a line, starting with the name of the check. Any thread may call these.
+void    CheckPrintf(const char* inFormat, ...);
+
+// Counts an error, and prints it like CheckPrintf if it is one of the first 10.
+void    CheckFailed(const char* inFormat, ...);
+
+UInt32  CheckNumFailed();
+
+#endif //__CHECKDRIVER_H__
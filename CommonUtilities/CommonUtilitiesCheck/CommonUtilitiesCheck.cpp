@@ -0,0 +1,34 @@
+/***************************************************************************
+
+Copyright (c) 1999-2003 Apple Computer, Inc.  All Rights Reserved.
+2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 CommonUtilitiesCheck.cpp
+Description: Runs behavior checks and timings of CommonUtilities classes
+             outside of the server.
+Comment:     usage: CommonUtilitiesCheck check [args]
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-17
+LastUpdate:  2026-10-17
+
+****************************************************************************/
+
+
+#include "OSHeaders.h"
+#include "CheckDriver.h"
+#include "CommonUtilitiesCheck.h"
+
+
+static CheckEntry sChecks[] =
+{
+    { "timingwheel",        TimingWheelCheck,       "[seed]" },
+    { "udpsocketpool",      UDPSocketPoolCheck,     "[clients] [threads]" },
+    { "timeouttask",        TimeoutTaskCheck,       "[sessions]" },
+    { "osthreadcounters",   OSThreadCountersCheck,  "[threads] [adds]" }
+};
+
+int main(int argc, char* argv[])
+{
+    return RunCheck(argc, argv, sChecks, sizeof(sChecks) / sizeof(CheckEntry));
+}
@@ -0,0 +1,33 @@
+/***************************************************************************
+
+Copyright (c) 1999-2003 Apple Computer, Inc.  All Rights Reserved.
+2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 CommonUtilitiesCheck.h
+Description: The checks and timings CommonUtilitiesCheck can run.
+Comment:     each one reports what didn't hold through CheckDriver
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-17
+LastUpdate:  2026-10-17
+
+****************************************************************************/
+
+
+#ifndef __COMMONUTILITIESCHECK_H__
+#define __COMMONUTILITIESCHECK_H__
+
+// TimingWheel against a brute force model, and against OSHeap for speed
+void TimingWheelCheck(int argc, char* argv[]);
+
+// UDPSocketPool SETUPs and TEARDOWNs, from one thread and from several, and
+// with thousands of pairs in the pool that can't take the clients
+void UDPSocketPoolCheck(int argc, char* argv[]);
+
+// TimeoutTasks of many idle sessions, which of them time out and when
+void TimeoutTaskCheck(int argc, char* argv[]);
+
+// OSThreadCounters added to from many threads, and summed while they are
+void OSThreadCountersCheck(int argc, char* argv[]);
+
+#endif //__COMMONUTILITIESCHECK_H__
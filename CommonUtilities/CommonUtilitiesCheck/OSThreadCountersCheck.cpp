@@ -0,0 +1,204 @@
+/***************************************************************************
+
+Copyright (c) 1999-2003 Apple Computer, Inc.  All Rights Reserved.
+2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 OSThreadCountersCheck.cpp
+Description: Adds to OSThreadCounters from many threads while summing them up,
+             and times an add against an atomic add and a mutex.
+Comment:     usage: CommonUtilitiesCheck osthreadcounters [threads] [adds]
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-17
+LastUpdate:  2026-10-17
+
+****************************************************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "SafeStdLib.h"
+#include "OS.h"
+#include "OSThread.h"
+#include "OSMutex.h"
+#include "OSMemory.h"
+#include "OSThreadCounters.h"
+#include "atomic.h"
+#include "CheckDriver.h"
+#include "CommonUtilitiesCheck.h"
+
+
+// The counters, used the way QTSServerInterface uses its statistics
+enum
+{
+    kPackets    = 0,    // always 1 at a time
+    kBytes      = 1,    // a packet size at a time
+    kPlaying    = 2     // a current value, +1 then -1
+};
+
+// How an AddThread adds
+enum
+{
+    kThreadCounters = 0,
+    kAtomicAdd      = 1,
+    kMutex          = 2
+};
+
+static OSThreadCounters sCounters;
+static unsigned int     sAtomicCounter = 0;
+static OSMutex          sMutex;
+static SInt64           sMutexCounter = 0;
+
+class AddThread : public OSThread
+{
+    public:
+
+        AddThread(UInt32 inMode, UInt32 inNumAdds) : fMode(inMode), fNumAdds(inNumAdds) {}
+        virtual ~AddThread() {}
+
+        virtual void Entry()
+        {
+            switch (fMode)
+            {
+                case kThreadCounters:
+                    for (UInt32 x = 0; x < fNumAdds; x++)
+                    {
+                        sCounters.Add(kPlaying, 1);
+                        sCounters.Add(kPackets, 1);
+                        sCounters.Add(kBytes, 1000 + (x % 500));
+                        sCounters.Add(kPlaying, -1);
+                    }
+                    break;
+
+                case kAtomicAdd:
+                    for (UInt32 x = 0; x < fNumAdds; x++)
+                        (void)atomic_add(&sAtomicCounter, 1);
+                    break;
+
+                case kMutex:
+                    for (UInt32 x = 0; x < fNumAdds; x++)
+                    {
+                        OSMutexLocker locker(&sMutex);
+                        sMutexCounter++;
+                    }
+                    break;
+            }
+        }
+
+    private:
+
+        UInt32  fMode;
+        UInt32  fNumAdds;
+};
+
+static SInt64 BytesAdded(UInt32 inNumAdds)
+{
+    // What one thread adds to kBytes
+    SInt64 theBytes = 0;
+    for (UInt32 x = 0; x < inNumAdds; x++)
+        theBytes += 1000 + (x % 500);
+    return theBytes;
+}
+
+//
+// Runs the threads, and returns how long they took in microseconds. The main
+// thread adds inNumMainAdds packets while they run. If asked to, it then sums
+// the counters until the threads are done: the sums of counters that only go
+// up must never go down, and no more sessions may be playing than there are
+// threads.
+static SInt64 RunThreads(UInt32 inMode, UInt32 inNumThreads, UInt32 inNumAdds, UInt32 inNumMainAdds, Bool16 inSum)
+{
+    AddThread** theThreads = NEW AddThread*[inNumThreads];
+    for (UInt32 x = 0; x < inNumThreads; x++)
+        theThreads[x] = NEW AddThread(inMode, inNumAdds);
+
+    SInt64 theStart = OS::Microseconds();
+    for (UInt32 x = 0; x < inNumThreads; x++)
+        theThreads[x]->Start();
+
+    for (UInt32 x = 0; x < inNumMainAdds; x++)
+        sCounters.Add(kPackets, 1);
+
+    if (inSum)
+    {
+        SInt64 theLastPackets = 0;
+        SInt64 theLastBytes = 0;
+        UInt32 theNumSums = 0;
+        while ((theLastPackets < (SInt64)inNumThreads * (SInt64)inNumAdds) && (OS::Microseconds() - theStart < 60000000))
+        {
+            SInt64 thePackets = sCounters.Sum(kPackets);
+            SInt64 theBytes = sCounters.Sum(kBytes);
+            SInt64 thePlaying = sCounters.Sum(kPlaying);
+            if ((thePackets < theLastPackets) || (theBytes < theLastBytes) || (thePlaying < 0) || (thePlaying > (SInt64)inNumThreads))
+                CheckFailed("sum %lu: %" _64BITARG_ "d packets, %" _64BITARG_ "d bytes, %" _64BITARG_ "d playing",
+                            theNumSums, thePackets, theBytes, thePlaying);
+            theLastPackets = thePackets;
+            theLastBytes = theBytes;
+            theNumSums++;
+        }
+    }
+
+    for (UInt32 x = 0; x < inNumThreads; x++)
+    {
+        theThreads[x]->Join();
+        delete theThreads[x];
+    }
+    SInt64 theElapsed = OS::Microseconds() - theStart;
+    delete [] theThreads;
+    return theElapsed;
+}
+
+//
+// Every add of inNumThreads threads, and of the main thread, must be in the
+// sums, on top of what they were before
+static void CheckSums(SInt64 inPackets, SInt64 inBytes, UInt32 inNumThreads, UInt32 inNumAdds, UInt32 inNumMainAdds)
+{
+    SInt64 thePackets = sCounters.Sum(kPackets) - inPackets;
+    SInt64 theBytes = sCounters.Sum(kBytes) - inBytes;
+    SInt64 thePlaying = sCounters.Sum(kPlaying);
+    if ((thePackets != (SInt64)inNumThreads * (SInt64)inNumAdds + (SInt64)inNumMainAdds) || (theBytes != (SInt64)inNumThreads * BytesAdded(inNumAdds)) || (thePlaying != 0))
+        CheckFailed("%lu threads added %" _64BITARG_ "d packets, %" _64BITARG_ "d bytes, and left %" _64BITARG_ "d playing",
+                    inNumThreads, thePackets, theBytes, thePlaying);
+}
+
+void OSThreadCountersCheck(int argc, char* argv[])
+{
+    UInt32 theNumThreads = (argc > 0) ? (UInt32)::atoi(argv[0]) : 8;
+    UInt32 theNumAdds = (argc > 1) ? (UInt32)::atoi(argv[1]) : 10000000;
+    if (theNumThreads == 0)
+        theNumThreads = 1;
+
+    //
+    // What one add costs when every thread adds to the same statistic, over
+    // all the adds of all the threads. Thread
+    // indexes are never reused, so this runs first, while the threads still
+    // get slots of their own.
+    SInt64 theTotalAdds = (SInt64)theNumThreads * (SInt64)theNumAdds;
+    SInt64 theCountersNSecs = (RunThreads(kThreadCounters, theNumThreads, theNumAdds, 0, false) * 1000) / (theTotalAdds * 4);
+    CheckSums(0, 0, theNumThreads, theNumAdds, 0);
+
+    //
+    // Sums taken while the threads add must make sense, and must come out
+    // right once they are done.
+    SInt64 thePackets = sCounters.Sum(kPackets);
+    SInt64 theBytes = sCounters.Sum(kBytes);
+    (void)RunThreads(kThreadCounters, theNumThreads, theNumAdds, 0, true);
+    CheckSums(thePackets, theBytes, theNumThreads, theNumAdds, 0);
+
+    SInt64 theAtomicNSecs = (RunThreads(kAtomicAdd, theNumThreads, theNumAdds, 0, false) * 1000) / theTotalAdds;
+    SInt64 theMutexNSecs = (RunThreads(kMutex, theNumThreads, theNumAdds / 10, 0, false) * 1000) / (theTotalAdds / 10);
+    CheckPrintf("%lu threads, %" _64BITARG_ "d ns per add, atomic_add %" _64BITARG_ "d ns, OSMutex %" _64BITARG_ "d ns",
+                theNumThreads, theCountersNSecs, theAtomicNSecs, theMutexNSecs);
+
+    //
+    // More threads than slots, so that some share slot 0, along with the main
+    // thread, which isn't an OSThread.
+    UInt32 theNumSharing = OSThreadCounters::kMaxThreads + 8;
+    UInt32 theNumSharingAdds = theNumAdds / 100;
+    thePackets = sCounters.Sum(kPackets);
+    theBytes = sCounters.Sum(kBytes);
+    (void)RunThreads(kThreadCounters, theNumSharing, theNumSharingAdds, theNumSharingAdds, true);
+    CheckSums(thePackets, theBytes, theNumSharing, theNumSharingAdds, theNumSharingAdds);
+    CheckPrintf("%lu threads, some sharing slot 0 with the main thread, checked", theNumSharing);
+}
@@ -0,0 +1,197 @@
+/***************************************************************************
+
+Copyright (c) 1999-2003 Apple Computer, Inc.  All Rights Reserved.
+2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 TimeoutTaskCheck.cpp
+Description: Keeps a lot of idle sessions' TimeoutTasks on the TimeoutTaskThread,
+             checks which of them time out and when, and measures what it costs.
+Comment:     usage: CommonUtilitiesCheck timeouttask [sessions]
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-17
+LastUpdate:  2026-10-17
+
+****************************************************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "SafeStdLib.h"
+#include "OS.h"
+#include "OSThread.h"
+#include "OSMemory.h"
+#include "Task.h"
+#include "TimeoutTask.h"
+#include "CheckDriver.h"
+#include "CommonUtilitiesCheck.h"
+
+
+enum
+{
+    kNumTaskThreads     = 4,        //UInt32
+    kShortTimeoutMilli  = 2000,     //UInt32
+    kLongTimeoutMilli   = 60000,    //UInt32
+    kRefreshMilli       = 250,      //UInt32
+    kIdleMilli          = 6000,     //UInt32
+    kLateMilli          = 1500      //UInt32, the thread looks every second, plus some slack
+};
+
+// What the sessions do with their TimeoutTask
+enum
+{
+    kTimesOut       = 0,    // never refreshed, must time out
+    kRefreshed      = 1,    // refreshed well within its timeout, must not
+    kNoTimeout      = 2,    // a timeout of 0, must not
+    kLongTimeout    = 3,    // idle, but its timeout is past the end of the check
+    kNumKinds       = 4
+};
+
+// Stands in for an RTSPSession or RTPSession: counts the timeouts it gets
+class CheckSession : public Task
+{
+    public:
+
+        CheckSession() : Task(), fTimeout(NEW TimeoutTask(this, 0)), fNumTimeouts(0), fFirstTimeoutAt(0), fCreatedAt(0)
+            { this->SetTaskName("CheckSession"); }
+        virtual ~CheckSession() { delete fTimeout; }
+
+        virtual SInt64 Run()
+        {
+            EventFlags theEvents = this->GetEvents();
+            if (theEvents & Task::kKillEvent)
+                return -1;
+
+            if (theEvents & Task::kTimeoutEvent)
+            {
+                if (fNumTimeouts == 0)
+                    fFirstTimeoutAt = OS::Milliseconds();
+                fNumTimeouts++;
+            }
+            return 0;
+        }
+
+        TimeoutTask*    fTimeout;
+        UInt32          fNumTimeouts;
+        SInt64          fFirstTimeoutAt;
+        SInt64          fCreatedAt;
+};
+
+// CPU time of the other threads of the process, the task threads and the
+// TimeoutTaskThread running on them
+static SInt64 OtherThreadsCPUMicroseconds()
+{
+    struct timespec theProcess, theThread;
+    (void)::clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &theProcess);
+    (void)::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &theThread);
+    return ((SInt64)theProcess.tv_sec - theThread.tv_sec) * 1000000 + (theProcess.tv_nsec - theThread.tv_nsec) / 1000;
+}
+
+void TimeoutTaskCheck(int argc, char* argv[])
+{
+    UInt32 theNumSessions = (argc > 0) ? (UInt32)::atoi(argv[0]) : 200000;
+    if (theNumSessions < kNumKinds)
+        theNumSessions = kNumKinds;
+
+    TaskThreadPool::AddThreads(kNumTaskThreads);
+    TimeoutTask::Initialize();
+
+    //
+    // Set up the sessions, as RTSP and RTP sessions do when they are created.
+    CheckSession** theSessions = NEW CheckSession*[theNumSessions];
+    SInt64 theStart = OS::Microseconds();
+    for (UInt32 x = 0; x < theNumSessions; x++)
+    {
+        theSessions[x] = NEW CheckSession();
+        theSessions[x]->fCreatedAt = OS::Milliseconds();
+        switch (x % kNumKinds)
+        {
+            case kTimesOut:     theSessions[x]->fTimeout->SetTimeout(kShortTimeoutMilli); break;
+            case kRefreshed:    theSessions[x]->fTimeout->SetTimeout(kShortTimeoutMilli); break;
+            case kLongTimeout:  theSessions[x]->fTimeout->SetTimeout(kLongTimeoutMilli); break;
+            default:            break;
+        }
+    }
+    CheckPrintf("%lu sessions set up in %" _64BITARG_ "d ms",
+                theNumSessions, (OS::Microseconds() - theStart) / 1000);
+
+    //
+    // Wait, refreshing the sessions that are being played to.
+    SInt64 theEnd = OS::Milliseconds() + kIdleMilli;
+    while (OS::Milliseconds() < theEnd)
+    {
+        for (UInt32 x = kRefreshed; x < theNumSessions; x += kNumKinds)
+            theSessions[x]->fTimeout->RefreshTimeout();
+        OSThread::Sleep(kRefreshMilli);
+    }
+
+    UInt32 theNumTimedOut = 0;
+    SInt64 theMaxLate = 0;
+    for (UInt32 x = 0; x < theNumSessions; x++)
+    {
+        CheckSession* theSession = theSessions[x];
+        if ((x % kNumKinds) != kTimesOut)
+        {
+            if (theSession->fNumTimeouts != 0)
+                CheckFailed("session %lu of kind %lu timed out %lu times",
+                            x, x % kNumKinds, theSession->fNumTimeouts);
+            continue;
+        }
+
+        if (theSession->fNumTimeouts == 0)
+        {
+            CheckFailed("session %lu never timed out", x);
+            continue;
+        }
+
+        theNumTimedOut++;
+        SInt64 theLate = theSession->fFirstTimeoutAt - (theSession->fCreatedAt + kShortTimeoutMilli);
+        if ((theLate < 0) || (theLate > kLateMilli))
+            CheckFailed("session %lu timed out %" _64BITARG_ "d ms after its timeout", x, theLate);
+        if (theLate > theMaxLate)
+            theMaxLate = theLate;
+    }
+    CheckPrintf("%lu sessions timed out, at most %" _64BITARG_ "d ms late", theNumTimedOut, theMaxLate);
+
+    //
+    // Then every session is kept alive, with timeouts of 2 to 60 seconds, and
+    // nothing times out. That is what the TimeoutTaskThread costs a server
+    // whose clients are all still there.
+    for (UInt32 x = 0; x < theNumSessions; x++)
+        theSessions[x]->fTimeout->SetTimeout(kShortTimeoutMilli + (x % 59) * 1000);
+    OSThread::Sleep(kRefreshMilli); // for the timeouts already signalled to be run
+    for (UInt32 x = 0; x < theNumSessions; x++)
+        theSessions[x]->fNumTimeouts = 0;
+
+    SInt64 theCPUStart = OtherThreadsCPUMicroseconds();
+    theEnd = OS::Milliseconds() + kIdleMilli;
+    while (OS::Milliseconds() < theEnd)
+    {
+        for (UInt32 x = 0; x < theNumSessions; x++)
+            theSessions[x]->fTimeout->RefreshTimeout();
+        OSThread::Sleep(kRefreshMilli);
+    }
+    CheckPrintf("%lu sessions kept alive for %u s, %" _64BITARG_ "d ms of CPU outside the refreshing thread",
+                theNumSessions, kIdleMilli / 1000, (OtherThreadsCPUMicroseconds() - theCPUStart) / 1000);
+
+    for (UInt32 x = 0; x < theNumSessions; x++)
+        if (theSessions[x]->fNumTimeouts != 0)
+            CheckFailed("session %lu timed out while it was kept alive", x);
+
+    //
+    // Tear them down, as the sessions do when they go away.
+    theStart = OS::Microseconds();
+    for (UInt32 x = 0; x < theNumSessions; x++)
+    {
+        delete theSessions[x]->fTimeout;
+        theSessions[x]->fTimeout = NULL;
+    }
+    CheckPrintf("%lu sessions torn down in %" _64BITARG_ "d ms",
+                theNumSessions, (OS::Microseconds() - theStart) / 1000);
+
+    for (UInt32 x = 0; x < theNumSessions; x++)
+        theSessions[x]->Signal(Task::kKillEvent);
+    delete [] theSessions;
+}
@@ -0,0 +1,226 @@
+/***************************************************************************
+
+Copyright (c) 1999-2003 Apple Computer, Inc.  All Rights Reserved.
+2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 TimingWheelCheck.cpp
+Description: Checks TimingWheel against a brute force model of what is due,
+             then times it against OSHeap the way TaskThread uses them.
+Comment:     usage: CommonUtilitiesCheck timingwheel [seed]
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-17
+LastUpdate:  2026-10-17
+
+****************************************************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "SafeStdLib.h"
+#include "OS.h"
+#include "OSHeap.h"
+#include "OSMemory.h"
+#include "TimingWheel.h"
+#include "CheckDriver.h"
+#include "CommonUtilitiesCheck.h"
+
+
+enum
+{
+    kModelElems     = 2000,     //UInt32
+    kModelSteps     = 200000,   //UInt32
+    kBenchMSecs     = 10000     //UInt32
+};
+
+static SInt64 RandomDelay()
+{
+    // Mostly send tick sized delays, some up to a day and a half out
+    switch (::rand() % 8)
+    {
+        case 0:     return 0;
+        case 1:     return ::rand() % 300000;
+        case 2:     return ((SInt64)::rand() % 36) * 3600000 + ::rand() % 3600000;
+        default:    return ::rand() % 300;
+    }
+}
+
+static SInt64 RandomTimeStep()
+{
+    switch (::rand() % 64)
+    {
+        case 0:     return -(SInt64)(::rand() % 100000);        // the clock went back
+        case 1:     return (SInt64)(::rand() % 8) * 3600000;    // the machine slept
+        case 2:     return ::rand() % 100000;
+        default:    return ::rand() % 20;
+    }
+}
+
+//
+// Every element the model thinks is in the wheel and due by inTime must come
+// out of ExtractExpired, and nothing else may.
+static void CheckExpired(TimingWheel* inWheel, TimingWheelElem* inElems, Bool16* inInWheel, SInt64 inTime)
+{
+    TimingWheelElem* theElem = NULL;
+    while ((theElem = inWheel->ExtractExpired(inTime)) != NULL)
+    {
+        UInt32 theIndex = (UInt32)(theElem - inElems);
+        if (!inInWheel[theIndex] || (theElem->GetValue() > inTime))
+            CheckFailed("element %lu came out early at %" _64BITARG_ "d, due at %" _64BITARG_ "d",
+                        theIndex, inTime, theElem->GetValue());
+        inInWheel[theIndex] = false;
+    }
+
+    SInt64 theEarliest = -1;
+    UInt32 theNumInWheel = 0;
+    for (UInt32 x = 0; x < kModelElems; x++)
+    {
+        if (!inInWheel[x])
+            continue;
+
+        theNumInWheel++;
+        if (inElems[x].GetValue() <= inTime)
+            CheckFailed("element %lu was due at %" _64BITARG_ "d and didn't come out at %" _64BITARG_ "d",
+                        x, inElems[x].GetValue(), inTime);
+        if ((theEarliest == -1) || (inElems[x].GetValue() < theEarliest))
+            theEarliest = inElems[x].GetValue();
+    }
+
+    if (inWheel->CurrentWheelSize() != theNumInWheel)
+        CheckFailed("wheel holds %lu elements, should be %lu", inWheel->CurrentWheelSize(), theNumInWheel);
+
+    // GetNextExpiry may be early, never late
+    SInt64 theNextExpiry = inWheel->GetNextExpiry();
+    if ((theEarliest == -1) ? (theNextExpiry != -1) : ((theNextExpiry == -1) || (theNextExpiry > theEarliest)))
+        CheckFailed("next expiry %" _64BITARG_ "d at %" _64BITARG_ "d, earliest element is due at %" _64BITARG_ "d",
+                    theNextExpiry, inTime, theEarliest);
+}
+
+static void CheckAgainstModel()
+{
+    TimingWheel theWheel;
+    TimingWheelElem* theElems = NEW TimingWheelElem[kModelElems];
+    Bool16* theInWheel = NEW Bool16[kModelElems];
+    SInt64 theTime = 1000000;
+
+    for (UInt32 x = 0; x < kModelElems; x++)
+        theInWheel[x] = false;
+
+    for (UInt32 theStep = 0; (theStep < kModelSteps) && (CheckNumFailed() < 10); theStep++)
+    {
+        UInt32 theIndex = ::rand() % kModelElems;
+        if (theInWheel[theIndex])
+        {
+            if (theWheel.Remove(&theElems[theIndex]) != &theElems[theIndex])
+                CheckFailed("element %lu could not be removed", theIndex);
+            theInWheel[theIndex] = false;
+        }
+        else
+        {
+            // Deadlines already in the past are allowed too
+            theElems[theIndex].SetValue(theTime + RandomDelay() - ((::rand() % 16 == 0) ? 50 : 0));
+            theWheel.Insert(&theElems[theIndex]);
+            theInWheel[theIndex] = true;
+        }
+
+        if ((theStep % 4) == 0)
+        {
+            theTime += RandomTimeStep();
+            CheckExpired(&theWheel, theElems, theInWheel, theTime);
+        }
+    }
+
+    for (UInt32 x = 0; x < kModelElems; x++)
+        if (theInWheel[x])
+            (void)theWheel.Remove(&theElems[x]);
+
+    delete [] theElems;
+    delete [] theInWheel;
+}
+
+//
+// Each timer is rescheduled 20-50 ms out every time it fires, and the clock
+// moves 1 ms at a time, like RTPSessions on a TaskThread. Returns the time per
+// reschedule in nanoseconds, rand() included.
+static SInt64 TimeWheel(UInt32 inNumTimers)
+{
+    TimingWheel theWheel;
+    TimingWheelElem* theElems = NEW TimingWheelElem[inNumTimers];
+    SInt64 theNumFired = 0;
+
+    for (UInt32 x = 0; x < inNumTimers; x++)
+    {
+        theElems[x].SetValue(20 + ::rand() % 31);
+        theWheel.Insert(&theElems[x]);
+    }
+
+    SInt64 theStart = OS::Microseconds();
+    for (SInt64 theTime = 0; theTime < kBenchMSecs; theTime++)
+    {
+        TimingWheelElem* theElem = NULL;
+        while ((theElem = theWheel.ExtractExpired(theTime)) != NULL)
+        {
+            theElem->SetValue(theTime + 20 + ::rand() % 31);
+            theWheel.Insert(theElem);
+            theNumFired++;
+        }
+    }
+    SInt64 theElapsed = OS::Microseconds() - theStart;
+
+    for (UInt32 x = 0; x < inNumTimers; x++)
+        (void)theWheel.Remove(&theElems[x]);
+    delete [] theElems;
+
+    return (theNumFired > 0) ? (theElapsed * 1000) / theNumFired : 0;
+}
+
+static SInt64 TimeHeap(UInt32 inNumTimers)
+{
+    OSHeap theHeap;
+    OSHeapElem* theElems = NEW OSHeapElem[inNumTimers];
+    SInt64 theNumFired = 0;
+
+    for (UInt32 x = 0; x < inNumTimers; x++)
+    {
+        theElems[x].SetValue(20 + ::rand() % 31);
+        theHeap.Insert(&theElems[x]);
+    }
+
+    SInt64 theStart = OS::Microseconds();
+    for (SInt64 theTime = 0; theTime < kBenchMSecs; theTime++)
+    {
+        while ((theHeap.PeekMin() != NULL) && (theHeap.PeekMin()->GetValue() <= theTime))
+        {
+            OSHeapElem* theElem = theHeap.ExtractMin();
+            theElem->SetValue(theTime + 20 + ::rand() % 31);
+            theHeap.Insert(theElem);
+            theNumFired++;
+        }
+    }
+    SInt64 theElapsed = OS::Microseconds() - theStart;
+
+    while (theHeap.ExtractMin() != NULL)
+        ;
+    delete [] theElems;
+
+    return (theNumFired > 0) ? (theElapsed * 1000) / theNumFired : 0;
+}
+
+void TimingWheelCheck(int argc, char* argv[])
+{
+    unsigned int theSeed = (argc > 0) ? (unsigned int)::atoi(argv[0]) : 1;
+    ::srand(theSeed);
+
+    CheckAgainstModel();
+    CheckPrintf("%lu steps against the model, seed %u", (UInt32)kModelSteps, theSeed);
+
+    UInt32 theNumTimers[] = { 10000, 100000 };
+    for (UInt32 x = 0; x < sizeof(theNumTimers) / sizeof(UInt32); x++)
+    {
+        SInt64 theWheelNSecs = TimeWheel(theNumTimers[x]);
+        SInt64 theHeapNSecs = TimeHeap(theNumTimers[x]);
+        CheckPrintf("%6lu timers, %" _64BITARG_ "d ns per reschedule, OSHeap %" _64BITARG_ "d ns",
+                    theNumTimers[x], theWheelNSecs, theHeapNSecs);
+    }
+}
@@ -0,0 +1,299 @@
+/***************************************************************************
+
+Copyright (c) 1999-2003 Apple Computer, Inc.  All Rights Reserved.
+2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 UDPSocketPoolCheck.cpp
+Description: Sets up and tears down RTP clients through a UDPSocketPool, from
+             one thread and from several, and times the SETUPs, also with
+             thousands of pairs in the pool that can't take a new client.
+Comment:     usage: CommonUtilitiesCheck udpsocketpool [clients] [threads]
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-17
+LastUpdate:  2026-10-17
+
+****************************************************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+
+#include "SafeStdLib.h"
+#include "OS.h"
+#include "OSThread.h"
+#include "OSMemory.h"
+#include "Socket.h"
+#include "UDPSocket.h"
+#include "UDPDemuxer.h"
+#include "UDPSocketPool.h"
+#include "CheckDriver.h"
+#include "CommonUtilitiesCheck.h"
+
+
+enum
+{
+    kLocalAddr      = 0x7F000001,   //UInt32, 127.0.0.1
+    kOtherLocalAddr = 0x7F000002,   //UInt32, 127.0.0.2
+    kTopRTPPort     = 65534,        //UInt16, the last pair UDPSocketPool binds
+    kTimingBatch    = 1000,         //UInt32
+    kThreadSetups   = 20000         //UInt32, per thread
+};
+
+// Like RTPSocketPool: RTP goes out of socket A, RTCP comes in on B through its demuxer
+class CheckSocketPool : public UDPSocketPool
+{
+    protected:
+
+        virtual UDPSocketPair*  ConstructUDPSocketPair()
+            {   return NEW UDPSocketPair(NEW UDPSocket(NULL, Socket::kNonBlockingSocketType),
+                                         NEW UDPSocket(NULL, UDPSocket::kWantsDemuxer | Socket::kNonBlockingSocketType)); }
+
+        virtual void            DestructUDPSocketPair(UDPSocketPair* inPair)
+            {   delete inPair->GetSocketA(); delete inPair->GetSocketB(); delete inPair; }
+};
+
+struct CheckClient
+{
+    UDPDemuxerTask  fTask;
+    UInt32          fAddr;
+    UInt16          fPort;      // RTCP port, always odd
+    UDPSocketPair*  fPair;
+};
+
+//
+// What RTPStream::Setup does with the pool: get a pair, then put the client in
+// its RTCP demuxer. The pool must never hand out a pair that already has it.
+static Bool16 SetUp(UDPSocketPool* inPool, CheckClient* inClient)
+{
+    inClient->fPair = inPool->GetUDPSocketPair(kLocalAddr, 0, inClient->fAddr, inClient->fPort);
+    if (inClient->fPair == NULL)
+    {
+        CheckFailed("no pair for client %lx:%u", inClient->fAddr, inClient->fPort);
+        return false;
+    }
+
+    if (inClient->fPair->GetSocketB()->GetDemuxer()->RegisterTask(inClient->fAddr, inClient->fPort, &inClient->fTask) != OS_NoErr)
+    {
+        CheckFailed("client %lx:%u got a pair it is already on", inClient->fAddr, inClient->fPort);
+        inPool->ReleaseUDPSocketPair(inClient->fPair);
+        inClient->fPair = NULL;
+        return false;
+    }
+    return true;
+}
+
+static void TearDown(UDPSocketPool* inPool, CheckClient* inClient)
+{
+    if (inClient->fPair == NULL)
+        return;
+
+    (void)inClient->fPair->GetSocketB()->GetDemuxer()->UnregisterTask(inClient->fAddr, inClient->fPort, &inClient->fTask);
+    inPool->ReleaseUDPSocketPair(inClient->fPair);
+    inClient->fPair = NULL;
+}
+
+static void MakeClient(CheckClient* inClient, UInt32 inIndex)
+{
+    // A few thousand addresses, several clients (ports) behind some of them
+    inClient->fAddr = 0x0A000000 | (inIndex % 4093);
+    inClient->fPort = (UInt16)(6971 + 2 * (inIndex / 4093));
+    inClient->fPair = NULL;
+}
+
+class SetupThread : public OSThread
+{
+    public:
+
+        SetupThread(UDPSocketPool* inPool, UInt32 inFirstClient, UInt32 inNumClients)
+            : fPool(inPool), fFirstClient(inFirstClient), fNumClients(inNumClients) {}
+        virtual ~SetupThread() {}
+
+        virtual void Entry()
+        {
+            CheckClient* theClients = NEW CheckClient[fNumClients];
+            for (UInt32 x = 0; x < fNumClients; x++)
+                MakeClient(&theClients[x], fFirstClient + x);
+
+            // Clients come and go in random order
+            for (UInt32 x = 0; x < kThreadSetups; x++)
+            {
+                CheckClient* theClient = &theClients[::rand() % fNumClients];
+                if (theClient->fPair == NULL)
+                    (void)SetUp(fPool, theClient);
+                else
+                    TearDown(fPool, theClient);
+            }
+
+            for (UInt32 x = 0; x < fNumClients; x++)
+                TearDown(fPool, &theClients[x]);
+            delete [] theClients;
+        }
+
+    private:
+
+        UDPSocketPool*  fPool;
+        UInt32          fFirstClient;
+        UInt32          fNumClients;
+};
+
+//
+// Times SETUPs with inNumPairs pairs in the pool that can't take the clients:
+// half are on another local address, half have a demuxer that takes everything,
+// as reflected broadcasts do. They are bound to ports from the top of the range
+// down, so new pairs for the clients are still found at the bottom.
+static void TimeFullPool(UInt32 inNumPairs)
+{
+    CheckSocketPool thePool;
+    UDPDemuxerTask theWildcardTask;
+    UDPSocketPair** thePairs = NEW UDPSocketPair*[inNumPairs];
+    UInt32 theNumPairs = 0;
+
+    for (UInt32 x = 0; x < inNumPairs; x++)
+    {
+        UInt32 theAddr = (x % 2 == 0) ? kOtherLocalAddr : kLocalAddr;
+        UInt16 thePort = (UInt16)(kTopRTPPort - 2 * (x / 2));
+        thePairs[theNumPairs] = thePool.GetUDPSocketPair(theAddr, thePort, 0, 0);
+        if (thePairs[theNumPairs] == NULL)
+        {
+            CheckFailed("no pair for %lx:%u", theAddr, thePort);
+            continue;
+        }
+        if (theAddr == kLocalAddr)
+            (void)thePairs[theNumPairs]->GetSocketB()->GetDemuxer()->RegisterTask(0, 0, &theWildcardTask);
+        theNumPairs++;
+    }
+
+    //
+    // The first clients find a pair for their shard, the timed ones use them.
+    CheckClient* theClients = NEW CheckClient[2 * kTimingBatch];
+    for (UInt32 x = 0; x < kTimingBatch; x++)
+    {
+        MakeClient(&theClients[x], x);
+        (void)SetUp(&thePool, &theClients[x]);
+    }
+    SInt64 theStart = OS::Microseconds();
+    for (UInt32 x = kTimingBatch; x < 2 * kTimingBatch; x++)
+    {
+        MakeClient(&theClients[x], x);
+        (void)SetUp(&thePool, &theClients[x]);
+    }
+    SInt64 theSetupNSecs = ((OS::Microseconds() - theStart) * 1000) / kTimingBatch;
+    CheckPrintf("%6lu pairs that can't take the clients, %lu SETUPs took %" _64BITARG_ "d ns each",
+                theNumPairs, (UInt32)kTimingBatch, theSetupNSecs);
+
+    for (UInt32 x = 0; x < 2 * kTimingBatch; x++)
+        TearDown(&thePool, &theClients[x]);
+    delete [] theClients;
+
+    for (UInt32 x = 0; x < theNumPairs; x++)
+    {
+        if (thePairs[x]->GetSocketA()->GetLocalAddr() == kLocalAddr)
+            (void)thePairs[x]->GetSocketB()->GetDemuxer()->UnregisterTask(0, 0, &theWildcardTask);
+        thePool.ReleaseUDPSocketPair(thePairs[x]);
+    }
+    delete [] thePairs;
+
+    if (thePool.GetSocketQueue()->GetLength() != 0)
+        CheckFailed("%lu pairs left after the full pool was emptied", thePool.GetSocketQueue()->GetLength());
+}
+
+void UDPSocketPoolCheck(int argc, char* argv[])
+{
+    UInt32 theNumClients = (argc > 0) ? (UInt32)::atoi(argv[0]) : 20000;
+    UInt32 theNumThreads = (argc > 1) ? (UInt32)::atoi(argv[1]) : 8;
+    if (theNumClients == 0)
+        theNumClients = 1;
+
+    Socket::Initialize();
+    CheckSocketPool thePool;
+
+    //
+    // SETUP every client, timing batches of them as the pool fills up.
+    CheckClient* theClients = NEW CheckClient[theNumClients];
+    UInt32 theReportEvery = ((theNumClients / 4) / kTimingBatch) * kTimingBatch;
+    if (theReportEvery == 0)
+        theReportEvery = kTimingBatch;
+
+    SInt64 theStart = OS::Microseconds();
+    for (UInt32 x = 0; x < theNumClients; x++)
+    {
+        MakeClient(&theClients[x], x);
+        (void)SetUp(&thePool, &theClients[x]);
+
+        if ((x + 1) % kTimingBatch != 0)
+            continue;
+
+        if ((x + 1) % theReportEvery == 0)
+            CheckPrintf("%6lu clients on %lu pairs, the last %lu SETUPs took %" _64BITARG_ "d ns each",
+                        x + 1, thePool.GetSocketQueue()->GetLength(), (UInt32)kTimingBatch,
+                        ((OS::Microseconds() - theStart) * 1000) / kTimingBatch);
+        theStart = OS::Microseconds();
+    }
+
+    //
+    // Asking for a specific port gets that pair, if it can take the client.
+    UDPSocketPair* thePair = theClients[0].fPair;
+    if (thePair != NULL)
+    {
+        UDPSocketPair* theSamePair = thePool.GetUDPSocketPair(kLocalAddr, thePair->GetSocketA()->GetLocalPort(), 0x0B000001, 6971);
+        if (theSamePair != thePair)
+            CheckFailed("asking for port %u didn't get its pair", thePair->GetSocketA()->GetLocalPort());
+        if (theSamePair != NULL)
+            thePool.ReleaseUDPSocketPair(theSamePair);
+
+        if (thePool.GetUDPSocketPair(kLocalAddr, thePair->GetSocketA()->GetLocalPort(), theClients[0].fAddr, theClients[0].fPort) != NULL)
+            CheckFailed("asking for port %u got a pair that already has the client", thePair->GetSocketA()->GetLocalPort());
+    }
+
+    for (UInt32 x = 0; x < theNumClients; x++)
+        TearDown(&thePool, &theClients[x]);
+    delete [] theClients;
+
+    if (thePool.GetSocketQueue()->GetLength() != 0)
+        CheckFailed("%lu pairs left after every client went away", thePool.GetSocketQueue()->GetLength());
+
+    //
+    // Clients of several threads coming and going at once. A client is only
+    // ever set up by one thread, as it is by one RTSP session in the server.
+    SetupThread** theThreads = NEW SetupThread*[theNumThreads];
+    for (UInt32 x = 0; x < theNumThreads; x++)
+    {
+        theThreads[x] = NEW SetupThread(&thePool, x * (theNumClients / theNumThreads + 1), theNumClients / theNumThreads + 1);
+        theThreads[x]->Start();
+    }
+    theStart = OS::Microseconds();
+    for (UInt32 x = 0; x < theNumThreads; x++)
+    {
+        theThreads[x]->Join();
+        delete theThreads[x];
+    }
+    CheckPrintf("%lu threads did %lu SETUPs and TEARDOWNs each in %" _64BITARG_ "d ms",
+                theNumThreads, (UInt32)kThreadSetups, (OS::Microseconds() - theStart) / 1000);
+    delete [] theThreads;
+
+    if (thePool.GetSocketQueue()->GetLength() != 0)
+        CheckFailed("%lu pairs left after the threads finished", thePool.GetSocketQueue()->GetLength());
+
+    //
+    // A pair is two sockets, so the larger pools need more descriptors than
+    // some machines let a process have.
+    struct rlimit theLimit;
+    UInt32 theMaxPairs = 0;
+    if (::getrlimit(RLIMIT_NOFILE, &theLimit) == 0)
+        theMaxPairs = (theLimit.rlim_cur > 256) ? (UInt32)((theLimit.rlim_cur - 256) / 2) : 0;
+
+    UInt32 theNumPairs[] = { 1000, 10000, 50000 };
+    for (UInt32 x = 0; x < sizeof(theNumPairs) / sizeof(UInt32); x++)
+    {
+        if (theNumPairs[x] > theMaxPairs)
+        {
+            CheckPrintf("%6lu pairs need more than the %lu descriptors a process may have here, %lu pairs timed instead",
+                        theNumPairs[x], (UInt32)theLimit.rlim_cur, theMaxPairs);
+            TimeFullPool(theMaxPairs);
+            break;
+        }
+        TimeFullPool(theNumPairs[x]);
+    }
+}
@@ -21,6 +21,7 @@ LastUpdate:  2010-08-19
 #include <sys/types.h>
 #include <sys/stat.h> /* struct stat */
 #include <sys/time.h>
+#include <time.h>
 #include <errno.h>
 #include <math.h>
 
@@ -42,6 +43,7 @@ SInt64  OS::sMsecSince1900 = 0;
 SInt64  OS::sInitialMsec = 0;/* OS::Initialize()Ҫ,OS::Milliseconds(),ֵֻһ */
 SInt64  OS::sWrapTime = 0;
 SInt64  OS::sCompareWrap = 0;
+SInt64  OS::sInitialMonotonicUsec = 0;
 SInt64  OS::sLastTimeMilli = 0;/* ¼һεļʱʱ */
 OSMutex OS::sStdLibOSMutex;/* ,Ҫ */
 
@@ -76,13 +78,16 @@ void OS::Initialize()
 	/* 仯϶ */
     sLastTimeMilli = 0;
     
-	/*********** ǳҪ:static variablesʼ **********/
-	/* ǰʱ(ʱ)̬,ֻڴ˴һ */
-    sInitialMsec = OS::Milliseconds(); //Milliseconds uses sInitialMsec so this assignment is valid only once.
+    // Microseconds and Milliseconds count from here
+    sInitialMonotonicUsec = OS::Microseconds();
 
     /* 1970110߹.עֵֻڴ˴һ,ǳʼʱʱ,Ժ󲻻ı */
     sMsecSince1970 = ::time(NULL);  // POSIX time always returns seconds since 1970
     sMsecSince1970 *= 1000;         // Convert to msec()
+
+	/*********** ǳҪ:static variablesʼ **********/
+	/* ǰʱ(ʱ)̬,ֻڴ˴һ */
+    sInitialMsec = OS::Milliseconds();
     
 #if DEBUG 
 	/*************** NOTE!! ***********************/
@@ -91,39 +96,43 @@ void OS::Initialize()
 #endif
 }
 
-/* ע漸:curTimeMillisLastTimeMilli,sInitialMsec,úֻOS::Initialize()еһ */
-/* ȡǰʱ,ϴεʱsLastTimeMilli(λms),ķֵsInitialMsec */
+// The wall clock at startup plus the time elapsed since, in msec
 SInt64 OS::Milliseconds()
 {
-    struct timeval t;
-    struct timezone tz;
-    int theErr = ::gettimeofday(&t, &tz);
-    Assert(theErr == 0);
-
-    SInt64 curTime;
-    curTime = t.tv_sec;
-    curTime *= 1000;                // sec -> msec
-    curTime += t.tv_usec / 1000;    // usec -> msec
-
-    return (curTime - sInitialMsec) + sMsecSince1970;
+    return (OS::Microseconds() / 1000) + sMsecSince1970;
 }
 
 /* üƵ */
-/* ȡʱ(microseconds ΢,֮һ),ҪõsInitialMsec */
+/* ȡʱ(microseconds ΢,֮һ),ҪõsInitialMonotonicUsec */
 SInt64 OS::Microseconds()
 {
-    struct timeval t;
-    struct timezone tz;
-	/* õǰʱʱϢ */
-    int theErr = ::gettimeofday(&t, &tz);
+    struct timespec t;
+    int theErr = ::clock_gettime(CLOCK_MONOTONIC, &t);
     Assert(theErr == 0);
 
     SInt64 curTime;
     curTime = t.tv_sec;
-    curTime *= 1000000;     // sec -> usec //* תΪ΢(1000000) */
-    curTime += t.tv_usec;/* ۼƵǰʱ(΢) */
+    curTime *= 1000000;             // sec -> usec
+    curTime += t.tv_nsec / 1000;    // nsec -> usec
+
+    return curTime - sInitialMonotonicUsec;
+}
+
+SInt64 OS::CachedMilliseconds()
+{
+    return (OS::CachedMicroseconds() / 1000) + sMsecSince1970;
+}
 
-    return curTime - (sInitialMsec * 1000);
+SInt64 OS::CachedMicroseconds()
+{
+    OSThread* theThread = OSThread::GetCurrent();
+    if (theThread != NULL)
+    {
+        SInt64 theCachedTime = theThread->GetCachedMicroseconds();
+        if (theCachedTime != OSThread::kNoCachedTime)
+            return theCachedTime;
+    }
+    return OS::Microseconds();
 }
 
 /* ȡǰʱGMTСʱ? */
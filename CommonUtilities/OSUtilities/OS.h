@@ -39,6 +39,17 @@ class OS
         static SInt64   Milliseconds(); //붨
 
         static SInt64   Microseconds(); //΢붨
+
+        // Both are based on CLOCK_MONOTONIC, so they never jump when the wall
+        // clock is set: Milliseconds is the wall clock at OS::Initialize plus the
+        // time elapsed since, Microseconds is just the time elapsed since.
+        //
+        // The Cached versions return the time the current thread cached at the
+        // start of what it is doing now (a TaskThread caches it before each call
+        // to Task::Run), and fall back to reading the clock on threads that
+        // don't cache. Use them in code that looks at the clock once per packet.
+        static SInt64   CachedMilliseconds();
+        static SInt64   CachedMicroseconds();
         
         // Some processors (MIPS, Sparc) cannot handle non word aligned memory
         // accesses. So, we need to provide functions to safely get at non-word
@@ -115,6 +126,7 @@ class OS
 		/* 1970110߹,::time(NULL)ɵPOSIX time,ٽתΪ */
         static SInt64 sMsecSince1970;
         static SInt64 sInitialMsec;
+        static SInt64 sInitialMonotonicUsec;
         static SInt32 sMemoryErr;
         static void SetDivisor();
         static SInt64 sWrapTime;
@@ -0,0 +1,271 @@
+/***************************************************************************
+
+Copyright (c) 1999-2003 Apple Computer, Inc.  All Rights Reserved.
+2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 OSFileBlockCache.cpp
+Description: Provide a process wide cache of file blocks, shared by every
+             OSFileSource that reads the same file.
+Comment:     used by OSFileSource when file caching is enabled
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-17
+LastUpdate:  2026-10-17
+
+****************************************************************************/
+
+
+#include <string.h>
+
+#include "OSFileBlockCache.h"
+#include "OSMemory.h"
+#include "MyAssert.h"
+
+
+OSMutex         OSFileBlockCache::sMutex;
+OSFileBlock**   OSFileBlockCache::sHashTable = NULL;
+UInt32          OSFileBlockCache::sNumHashBuckets = 0;
+UInt32          OSFileBlockCache::sNumBlocks = 0;
+OSFileBlock*    OSFileBlockCache::sClockHand = NULL;
+UInt64          OSFileBlockCache::sMaxBytes = 0;
+UInt64          OSFileBlockCache::sBytesUsed = 0;
+UInt64          OSFileBlockCache::sNumHits = 0;
+UInt64          OSFileBlockCache::sNumMisses = 0;
+UInt64          OSFileBlockCache::sNumEvictions = 0;
+
+
+OSFileBlock::OSFileBlock(const OSFileBlockKey& inKey)
+:   fKey(inKey),
+    fHash(0),
+    fData(NEW char[OSFileBlockCache::kBlockSize]),
+    fLength(0),
+    fRefCount(1),
+    fReferenced(true),
+    fInTable(false),
+    fHashNext(NULL),
+    fClockNext(NULL),
+    fClockPrev(NULL)
+{
+}
+
+OSFileBlock::~OSFileBlock()
+{
+    delete [] fData;
+}
+
+
+void OSFileBlockCache::SetMaxBytes(UInt64 inMaxBytes)
+{
+    OSMutexLocker locker(&sMutex);
+    sMaxBytes = inMaxBytes;
+
+    while ((sBytesUsed > sMaxBytes) && EvictOne())
+        {}
+}
+
+OSFileBlock* OSFileBlockCache::Find(const OSFileBlockKey& inKey)
+{
+    OSMutexLocker locker(&sMutex);
+
+    OSFileBlock* theBlock = Lookup(inKey, Hash(inKey));
+    if (theBlock == NULL)
+    {
+        sNumMisses++;
+        return NULL;
+    }
+
+    sNumHits++;
+    theBlock->fRefCount++;
+    theBlock->fReferenced = true;
+    return theBlock;
+}
+
+OSFileBlock* OSFileBlockCache::NewBlock(const OSFileBlockKey& inKey)
+{
+    OSFileBlock* theBlock = NEW OSFileBlock(inKey);
+    theBlock->fHash = Hash(inKey);
+    return theBlock;
+}
+
+OSFileBlock* OSFileBlockCache::Add(OSFileBlock* inBlock)
+{
+    Assert(inBlock != NULL);
+    Assert(!inBlock->fInTable);
+    Assert(inBlock->fRefCount == 1);
+
+    {
+        OSMutexLocker locker(&sMutex);
+
+        // Two sessions missed on the same block at the same time, keep the first one
+        OSFileBlock* theBlock = Lookup(inBlock->fKey, inBlock->fHash);
+        if (theBlock != NULL)
+        {
+            theBlock->fRefCount++;
+            theBlock->fReferenced = true;
+            delete inBlock;
+            return theBlock;
+        }
+
+        while ((sBytesUsed + kBlockSize > sMaxBytes) && EvictOne())
+            {}
+
+        // If everything in the cache is in use the caller still gets its
+        // block, it just isn't shared, and goes away on Release.
+        if (sBytesUsed + kBlockSize <= sMaxBytes)
+            Insert(inBlock);
+    }
+    return inBlock;
+}
+
+void OSFileBlockCache::Release(OSFileBlock* inBlock)
+{
+    Assert(inBlock != NULL);
+    {
+        OSMutexLocker locker(&sMutex);
+        Assert(inBlock->fRefCount > 0);
+        inBlock->fRefCount--;
+        if ((inBlock->fRefCount > 0) || inBlock->fInTable)
+            return;
+    }
+    delete inBlock;
+}
+
+UInt32 OSFileBlockCache::Hash(const OSFileBlockKey& inKey)
+{
+    UInt64 theHash = inKey.fInode * 0x9E3779B97F4A7C15ULL;
+    theHash ^= inKey.fDevice + (theHash >> 29);
+    theHash ^= inKey.fBlockIndex * 0xC2B2AE3D27D4EB4FULL;
+    return (UInt32)(theHash ^ (theHash >> 32));
+}
+
+Bool16 OSFileBlockCache::Equal(const OSFileBlockKey& inKey1, const OSFileBlockKey& inKey2)
+{
+    return (inKey1.fBlockIndex == inKey2.fBlockIndex) &&
+           (inKey1.fInode == inKey2.fInode) &&
+           (inKey1.fDevice == inKey2.fDevice) &&
+           (inKey1.fModDate == inKey2.fModDate) &&
+           (inKey1.fFileLength == inKey2.fFileLength);
+}
+
+// Everything below is called with sMutex held
+
+OSFileBlock* OSFileBlockCache::Lookup(const OSFileBlockKey& inKey, UInt32 inHash)
+{
+    if (sHashTable == NULL)
+        return NULL;
+
+    OSFileBlock* theBlock = sHashTable[inHash & (sNumHashBuckets - 1)];
+    while ((theBlock != NULL) && ((theBlock->fHash != inHash) || !Equal(theBlock->fKey, inKey)))
+        theBlock = theBlock->fHashNext;
+    return theBlock;
+}
+
+void OSFileBlockCache::Insert(OSFileBlock* inBlock)
+{
+    if (sNumBlocks >= sNumHashBuckets)
+        GrowTable();
+
+    UInt32 theBucket = inBlock->fHash & (sNumHashBuckets - 1);
+    inBlock->fHashNext = sHashTable[theBucket];
+    sHashTable[theBucket] = inBlock;
+
+    // New blocks go right behind the hand, so they get a full turn of the
+    // clock before they can be evicted
+    if (sClockHand == NULL)
+    {
+        inBlock->fClockNext = inBlock;
+        inBlock->fClockPrev = inBlock;
+        sClockHand = inBlock;
+    }
+    else
+    {
+        inBlock->fClockNext = sClockHand;
+        inBlock->fClockPrev = sClockHand->fClockPrev;
+        sClockHand->fClockPrev->fClockNext = inBlock;
+        sClockHand->fClockPrev = inBlock;
+    }
+
+    inBlock->fInTable = true;
+    sNumBlocks++;
+    sBytesUsed += kBlockSize;
+}
+
+void OSFileBlockCache::Remove(OSFileBlock* inBlock)
+{
+    Assert(inBlock->fInTable);
+
+    OSFileBlock** theLink = &sHashTable[inBlock->fHash & (sNumHashBuckets - 1)];
+    while (*theLink != inBlock)
+        theLink = &(*theLink)->fHashNext;
+    *theLink = inBlock->fHashNext;
+
+    if (inBlock->fClockNext == inBlock)
+        sClockHand = NULL;
+    else
+    {
+        if (sClockHand == inBlock)
+            sClockHand = inBlock->fClockNext;
+        inBlock->fClockPrev->fClockNext = inBlock->fClockNext;
+        inBlock->fClockNext->fClockPrev = inBlock->fClockPrev;
+    }
+
+    inBlock->fHashNext = NULL;
+    inBlock->fClockNext = NULL;
+    inBlock->fClockPrev = NULL;
+    inBlock->fInTable = false;
+    sNumBlocks--;
+    sBytesUsed -= kBlockSize;
+}
+
+// Turns the clock until it finds a block nobody is using that hasn't been
+// hit since the last time around, and frees it. Returns false if no block
+// can be evicted right now.
+Bool16 OSFileBlockCache::EvictOne()
+{
+    // Two turns: the first may only clear reference bits
+    UInt32 theNumSteps = 2 * sNumBlocks;
+    for (UInt32 x = 0; (x < theNumSteps) && (sClockHand != NULL); x++)
+    {
+        OSFileBlock* theBlock = sClockHand;
+        sClockHand = theBlock->fClockNext;
+
+        if (theBlock->fRefCount > 0)
+            continue;
+
+        if (theBlock->fReferenced)
+        {
+            theBlock->fReferenced = false;
+            continue;
+        }
+
+        Remove(theBlock);
+        delete theBlock;
+        sNumEvictions++;
+        return true;
+    }
+    return false;
+}
+
+void OSFileBlockCache::GrowTable()
+{
+    UInt32 theNumBuckets = (sNumHashBuckets == 0) ? (UInt32)kMinHashBuckets : sNumHashBuckets * 2;
+    OSFileBlock** theTable = NEW OSFileBlock*[theNumBuckets];
+    ::memset(theTable, 0, sizeof(OSFileBlock*) * theNumBuckets);
+
+    for (UInt32 x = 0; x < sNumHashBuckets; x++)
+    {
+        OSFileBlock* theBlock = sHashTable[x];
+        while (theBlock != NULL)
+        {
+            OSFileBlock* theNext = theBlock->fHashNext;
+            UInt32 theBucket = theBlock->fHash & (theNumBuckets - 1);
+            theBlock->fHashNext = theTable[theBucket];
+            theTable[theBucket] = theBlock;
+            theBlock = theNext;
+        }
+    }
+
+    delete [] sHashTable;
+    sHashTable = theTable;
+    sNumHashBuckets = theNumBuckets;
+}
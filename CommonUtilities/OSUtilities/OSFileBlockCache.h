@@ -0,0 +1,149 @@
+/***************************************************************************
+
+Copyright (c) 1999-2003 Apple Computer, Inc.  All Rights Reserved.
+2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 OSFileBlockCache.h
+Description: Provide a process wide cache of file blocks, shared by every
+             OSFileSource that reads the same file.
+Comment:     used by OSFileSource when file caching is enabled
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-17
+LastUpdate:  2026-10-17
+
+****************************************************************************/
+
+
+#ifndef __OSFILEBLOCKCACHE_H__
+#define __OSFILEBLOCKCACHE_H__
+
+#include "OSHeaders.h"
+#include "OSMutex.h"
+
+//
+// Blocks are identified by the file they come from (device and inode, plus
+// the mod date and length so that a file rewritten in place doesn't hit its
+// old blocks) and their index in the file. All OSFileSources open on the same
+// file therefore share one copy of each block, no matter how many sessions
+// are playing it.
+//
+// A block never changes once it is in the cache. Whoever finds or adds one
+// holds a reference on it until Release, and blocks are only evicted while
+// nobody holds a reference, so the data can be copied out without the lock.
+//
+// Eviction is CLOCK (second chance) over all blocks, against the byte budget
+// given to SetMaxBytes.
+
+struct OSFileBlockKey
+{
+    UInt64      fDevice;
+    UInt64      fInode;
+    SInt64      fModDate;
+    UInt64      fFileLength;
+    UInt64      fBlockIndex;
+};
+
+class OSFileBlock
+{
+    public:
+
+        char*       GetData()       { return fData; }
+
+        //
+        // Number of bytes of file data in the block. This is only less than
+        // OSFileBlockCache::kBlockSize for the last block of a file.
+        UInt32      GetLength()     { return fLength; }
+        void        SetLength(UInt32 inLength) { fLength = inLength; }
+
+    private:
+
+        OSFileBlock(const OSFileBlockKey& inKey);
+        ~OSFileBlock();
+
+        OSFileBlockKey  fKey;
+        UInt32          fHash;
+        char*           fData;
+        UInt32          fLength;
+
+        UInt32          fRefCount;
+        Bool16          fReferenced;    // CLOCK bit, set on every hit
+        Bool16          fInTable;       // false if the cache had no room for it
+
+        OSFileBlock*    fHashNext;
+        OSFileBlock*    fClockNext;
+        OSFileBlock*    fClockPrev;
+
+        friend class OSFileBlockCache;
+};
+
+class OSFileBlockCache
+{
+    public:
+
+        enum
+        {
+            kBlockSizeExp   = 15,
+            kBlockSize      = 1 << kBlockSizeExp    // 32K, the size of a FileBlockPool unit
+        };
+
+        //
+        // Sets the byte budget, evicting whatever is over it. 0 turns the cache off.
+        static void         SetMaxBytes(UInt64 inMaxBytes);
+        static Bool16       IsEnabled()     { return sMaxBytes > 0; }
+
+        //
+        // Returns the block with a reference held, or NULL if it isn't cached.
+        static OSFileBlock* Find(const OSFileBlockKey& inKey);
+
+        //
+        // On a miss, the caller gets an empty block from NewBlock, fills it out
+        // and hands it to Add. Add returns the block to use from then on: if
+        // someone else added the same block in the meantime, that one is
+        // returned (with a reference held) and inBlock is freed.
+        static OSFileBlock* NewBlock(const OSFileBlockKey& inKey);
+        static OSFileBlock* Add(OSFileBlock* inBlock);
+
+        //
+        // Drops a reference obtained from Find, NewBlock or Add
+        static void         Release(OSFileBlock* inBlock);
+
+        //
+        // Counters since startup
+        static UInt64       GetNumHits()        { return sNumHits; }
+        static UInt64       GetNumMisses()      { return sNumMisses; }
+        static UInt64       GetNumEvictions()   { return sNumEvictions; }
+        static UInt64       GetBytesUsed()      { return sBytesUsed; }
+        static UInt64       GetMaxBytes()       { return sMaxBytes; }
+
+    private:
+
+        enum
+        {
+            kMinHashBuckets = 1024      // must be a power of 2
+        };
+
+        static UInt32       Hash(const OSFileBlockKey& inKey);
+        static Bool16       Equal(const OSFileBlockKey& inKey1, const OSFileBlockKey& inKey2);
+        static OSFileBlock* Lookup(const OSFileBlockKey& inKey, UInt32 inHash);
+        static void         Insert(OSFileBlock* inBlock);
+        static void         Remove(OSFileBlock* inBlock);
+        static Bool16       EvictOne();
+        static void         GrowTable();
+
+        static OSMutex      sMutex;
+
+        static OSFileBlock** sHashTable;
+        static UInt32       sNumHashBuckets;
+        static UInt32       sNumBlocks;
+
+        static OSFileBlock* sClockHand;     // next block the clock looks at
+
+        static UInt64       sMaxBytes;
+        static UInt64       sBytesUsed;
+        static UInt64       sNumHits;
+        static UInt64       sNumMisses;
+        static UInt64       sNumEvictions;
+};
+
+#endif //__OSFILEBLOCKCACHE_H__
@@ -395,6 +395,8 @@ void OSFileSource::Set(const char *inPath)
         if (::fstat(fFile, &buf) >= 0)
         {
             fLength = buf.st_size;
+            fDevice = buf.st_dev;
+            fInode = buf.st_ino;
             fModDate = buf.st_mtime;
             if (fModDate < 0)
                 fModDate = 0;
@@ -447,6 +449,9 @@ static SInt32 sBuffCount = 1;
 ýݶָȵָbuffer,¼ʵʸݵĳ */
 OS_Error    OSFileSource::Read(UInt64 inPosition, void* inBuffer, UInt32 inLength, UInt32* outRcvLen)
 { 
+    if (fCacheEnabled && OSFileBlockCache::IsEnabled())
+        return this->ReadFromBlockCache(inPosition, inBuffer, inLength, outRcvLen);
+
     /* : */    
     if  ( ( !fFileMap.Initialized() )/* ûз˽л,ʹfFileMapArray=NULL */
             || ( !fCacheEnabled ) /* 粻ܻļ */
@@ -683,6 +688,71 @@ OS_Error    OSFileSource::ReadFromPos(UInt64 inPosition, void* inBuffer, UInt32
     return err;
 }
 
+OS_Error    OSFileSource::ReadFromBlockCache(UInt64 inPosition, void* inBuffer, UInt32 inLength, UInt32* outRcvLen)
+{
+    UInt32 theRcvLen = 0;
+    char* theBufferOut = (char*)inBuffer;
+
+    OSFileBlockKey theKey;
+    theKey.fDevice = fDevice;
+    theKey.fInode = fInode;
+    theKey.fModDate = fModDate;
+    theKey.fFileLength = fLength;
+
+    while ((theRcvLen < inLength) && (inPosition < fLength))
+    {
+        theKey.fBlockIndex = inPosition >> OSFileBlockCache::kBlockSizeExp;
+        UInt32 theBlockOffset = (UInt32)(inPosition & (OSFileBlockCache::kBlockSize - 1));
+
+        OSFileBlock* theBlock = OSFileBlockCache::Find(theKey);
+        if (theBlock == NULL)
+        {
+            theBlock = OSFileBlockCache::NewBlock(theKey);
+            UInt64 theBlockStart = theKey.fBlockIndex << OSFileBlockCache::kBlockSizeExp;
+            UInt32 theFillLen = 0;
+            while (theFillLen < OSFileBlockCache::kBlockSize)
+            {
+                ssize_t theLen = ::pread(fFile, theBlock->GetData() + theFillLen, OSFileBlockCache::kBlockSize - theFillLen, theBlockStart + theFillLen);
+                if (theLen == -1)
+                {
+                    OS_Error theErr = OSThread::GetErrno();
+                    if (theErr == EINTR)
+                        continue;
+                    OSFileBlockCache::Release(theBlock);
+                    return theErr;
+                }
+                if (theLen == 0)
+                    break; // eof
+                theFillLen += theLen;
+            }
+            theBlock->SetLength(theFillLen);
+            theBlock = OSFileBlockCache::Add(theBlock);
+        }
+
+        // A block can come up short if the file was truncated under us
+        if (theBlockOffset >= theBlock->GetLength())
+        {
+            OSFileBlockCache::Release(theBlock);
+            break;
+        }
+
+        UInt32 theCopyLen = theBlock->GetLength() - theBlockOffset;
+        if (theCopyLen > inLength - theRcvLen)
+            theCopyLen = inLength - theRcvLen;
+
+        ::memcpy(theBufferOut, theBlock->GetData() + theBlockOffset, theCopyLen);
+        OSFileBlockCache::Release(theBlock);
+
+        theBufferOut += theCopyLen;
+        theRcvLen += theCopyLen;
+        inPosition += theCopyLen;
+    }
+
+    if (outRcvLen != NULL)
+        *outRcvLen = theRcvLen;
+    return OS_NoErr;
+}
+
 void OSFileSource::SetTrackID(UInt32 trackID)   
 { 
 #if READ_LOG
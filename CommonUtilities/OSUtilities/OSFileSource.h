@@ -24,6 +24,7 @@ LastUpdate:  2010-08-19
 #include "OSHeaders.h"
 #include "StrPtrLen.h"
 #include "OSQueue.h"
+#include "OSFileBlockCache.h"
 
 /* ¼ļ־ĺ꿪 */
 #define READ_LOG 0
@@ -197,7 +198,7 @@ class OSFileSource
 {
     public:
     
-        OSFileSource() :    fFile(-1), fLength(0), fPosition(0), fReadPos(0), fShouldClose(true), fIsDir(false)/* Ŀ¼ļ? */, fCacheEnabled(false)/* Ĭϲļ */                       
+        OSFileSource() :    fFile(-1), fDevice(0), fInode(0), fLength(0), fPosition(0), fReadPos(0), fShouldClose(true), fIsDir(false)/* Ŀ¼ļ? */, fCacheEnabled(false)/* Ĭϲļ */                       
         {
         
         #if READ_LOG 
@@ -208,7 +209,7 @@ class OSFileSource
         
         }
                 
-        OSFileSource(const char *inPath) :  fFile(-1), fLength(0), fPosition(0), fReadPos(0), fShouldClose(true), fIsDir(false),fCacheEnabled(false)
+        OSFileSource(const char *inPath) :  fFile(-1), fDevice(0), fInode(0), fLength(0), fPosition(0), fReadPos(0), fShouldClose(true), fIsDir(false),fCacheEnabled(false)
         {
          Set(inPath); /* Windows xp,һҪд */
          
@@ -246,6 +247,12 @@ class OSFileSource
         OS_Error    ReadFromCache(UInt64 inPosition, void* inBuffer, UInt32 inLength, UInt32* outRcvLen = NULL);
         OS_Error    ReadFromPos(UInt64 inPosition, void* inBuffer, UInt32 inLength, UInt32* outRcvLen = NULL);
 
+        //
+        // Reads through the process wide OSFileBlockCache, which Read uses instead
+        // of the private FileMap whenever file caching is enabled and the block
+        // cache is turned on. Blocks are filled with pread, without fMutex.
+        OS_Error    ReadFromBlockCache(UInt64 inPosition, void* inBuffer, UInt32 inLength, UInt32* outRcvLen = NULL);
+
 		/********************************************************************************************************************/
 
 		/* ͨļǷԻ? */
@@ -258,7 +265,9 @@ class OSFileSource
 		/* ļû,ýļǡСһָṹ,Щָ */
         void        AllocateFileCache(UInt32 inUnitSizeInK = 32, UInt32 bufferSizeUnits = 0, UInt32 incBuffers = 1, UInt32 inMaxBitRateBuffSizeInBlocks = 8, UInt32 inBitRate = 32768 /* 2^15 */) 
                     {   
-						fFileMap.AllocateBufferMap(inUnitSizeInK, bufferSizeUnits,incBuffers, inMaxBitRateBuffSizeInBlocks, fLength, inBitRate);
+						// The shared block cache makes the private buffers unnecessary
+						if (!OSFileBlockCache::IsEnabled())
+							fFileMap.AllocateBufferMap(inUnitSizeInK, bufferSizeUnits,incBuffers, inMaxBitRateBuffSizeInBlocks, fLength, inBitRate);
                     } 
 
 		/* ļĸ */
@@ -301,6 +310,10 @@ class OSFileSource
 
 		/* ļ */
         int     fFile;
+
+        // identify the file in the OSFileBlockCache
+        UInt64  fDevice;
+        UInt64  fInode;
 		/* ļ */
         UInt64  fLength;
 		/* ļǰƫλ(ļһ̶) */
@@ -16,6 +16,14 @@ LastUpdate:  2010-08-19
 
 
 #include "OSQueue.h"
+#include "atomic.h"
+
+#if __linux__
+#include <unistd.h>
+#include <time.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
 
 
 OSQueue::OSQueue() : fLength(0)
@@ -276,3 +284,90 @@ void OSQueue_Blocking::EnQueue(OSQueueElem* obj)
 	/* ź֪ͨⲿѸı */
     fCond.Signal();
 }
+
+void OSQueue_MPSC::EnQueue(OSQueueElem* obj)
+{
+    Assert(obj != NULL);
+    Assert(obj->fQueue == NULL);
+
+    OSQueueElem* theHead;
+    do
+    {
+        theHead = fHead;
+        obj->fNext = theHead;
+    } while (!compare_and_store_ptr(theHead, obj, (void**)&fHead));
+    (void)atomic_add(&fLength, 1);
+
+    // The owner sets fWaiting before it looks at fHead one last time, and we
+    // look at fWaiting after we changed fHead, so one of us sees the other.
+    if (fWaiting != 0)
+        this->Wake();
+}
+
+OSQueueElem* OSQueue_MPSC::DeQueueAll()
+{
+    if (fHead == NULL)
+        return NULL;
+
+    OSQueueElem* theElem = (OSQueueElem*)atomic_swap_ptr((void**)&fHead, NULL);
+
+    // The list comes off newest first, turn it around
+    OSQueueElem* theOldest = NULL;
+    UInt32 theCount = 0;
+    while (theElem != NULL)
+    {
+        OSQueueElem* theNext = theElem->fNext;
+        theElem->fNext = theOldest;
+        theOldest = theElem;
+        theElem = theNext;
+        theCount++;
+    }
+    (void)atomic_sub(&fLength, theCount);
+    return theOldest;
+}
+
+#if __linux__
+
+void OSQueue_MPSC::Wait(SInt32 inTimeoutInMilSecs)
+{
+    if (!compare_and_store(0, 1, &fWaiting))
+        return;
+    if (fHead != NULL)
+    {
+        fWaiting = 0;
+        return;
+    }
+
+    struct timespec theTimeout;
+    theTimeout.tv_sec = inTimeoutInMilSecs / 1000;
+    theTimeout.tv_nsec = (inTimeoutInMilSecs % 1000) * 1000000;
+
+    // Goes right back if EnQueue already cleared fWaiting
+    (void)::syscall(SYS_futex, &fWaiting, FUTEX_WAIT_PRIVATE, 1, &theTimeout, NULL, 0);
+    fWaiting = 0;
+}
+
+void OSQueue_MPSC::Wake()
+{
+    if (compare_and_store(1, 0, &fWaiting))
+        (void)::syscall(SYS_futex, &fWaiting, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+
+#else
+
+void OSQueue_MPSC::Wait(SInt32 inTimeoutInMilSecs)
+{
+    OSMutexLocker theLocker(&fMutex);
+    fWaiting = 1;
+    if (fHead == NULL)
+        fCond.Wait(&fMutex, inTimeoutInMilSecs);
+    fWaiting = 0;
+}
+
+void OSQueue_MPSC::Wake()
+{
+    OSMutexLocker theLocker(&fMutex);
+    fCond.Signal();
+}
+
+#endif
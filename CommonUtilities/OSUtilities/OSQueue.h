@@ -68,6 +68,7 @@ class OSQueueElem {
 
 		/* öԪعĶ */
         friend class    OSQueue;
+        friend class    OSQueue_MPSC;
 };
 
 /* ˶мϵԪӺɾ */
@@ -182,6 +183,50 @@ class OSQueue_Blocking
         OSQueue             fQueue;
 };
 
+//
+// A queue any number of threads may add to without taking a lock (multiple
+// producers), drained by the thread that owns it (single consumer). Elements
+// are only ever taken off all at once, which is a single atomic swap and so
+// is safe for any thread to do. The owner may park in Wait() when the queue
+// is empty; EnQueue only makes a system call to wake it up if it is parked.
+//
+// Elements are linked through OSQueueElem::fNext and are not a member of any
+// OSQueue while they are here.
+class OSQueue_MPSC
+{
+    public:
+        OSQueue_MPSC() : fHead(NULL), fLength(0), fWaiting(0) {}
+        ~OSQueue_MPSC() {}
+
+        void            EnQueue(OSQueueElem* obj);//never blocks
+
+        // Empties the queue and returns what was in it, oldest first, linked
+        // through OSQueueElem::Next(). Returns NULL if the queue was empty.
+        OSQueueElem*    DeQueueAll();
+
+        // Blocks the calling thread until an element is added, Wake() is called
+        // or the timeout expires, unless the queue isn't empty to begin with.
+        // May also return early for no reason, callers just look again.
+        void            Wait(SInt32 inTimeoutInMilSecs);
+        void            Wake();
+
+        Bool16          IsEmpty()   { return fHead == NULL; }
+
+        // Only a snapshot. DeQueueAll may take an element before EnQueue has
+        // counted it, so fLength can briefly go below zero, that reads as 0.
+        UInt32          GetLength() { SInt32 theLength = (SInt32)fLength; return (theLength > 0) ? (UInt32)theLength : 0; }
+
+    private:
+
+        OSQueueElem* volatile   fHead;      // newest first
+        unsigned int            fLength;
+        unsigned int            fWaiting;   // 1 while the owner is parked in Wait()
+#if !__linux__
+        OSCond                  fCond;
+        OSMutex                 fMutex;
+#endif
+};
+
 /* ǰж,ȥǰԪ(),ʵʵͬOSQueue::Remove() */
 void    OSQueueElem::Remove()
 {
@@ -20,7 +20,9 @@ LastUpdate:  2010-08-19
 
 
 #include "OSRef.h"
+#include "OSMemory.h"
 #include <errno.h>
+#include <string.h>
 
 
 /* һַͨHashַ㷨 */
@@ -201,3 +203,304 @@ void    OSRefTable::Swap(OSRef* newRef)
         Assert(0);
 }
 
+
+
+OSStripedRefTable::OSStripedRefTable(UInt32 tableSize)
+{
+    UInt32 theNumBuckets = kMinBucketsPerStripe;
+    while (theNumBuckets * kNumStripes < tableSize)
+        theNumBuckets <<= 1;
+
+    for (UInt32 x = 0; x < kNumStripes; x++)
+    {
+        fStripes[x].fBuckets = NEW OSRef*[theNumBuckets];
+        ::memset(fStripes[x].fBuckets, 0, sizeof(OSRef*) * theNumBuckets);
+        fStripes[x].fNumBuckets = theNumBuckets;
+        fStripes[x].fNumRefs = 0;
+    }
+}
+
+OSStripedRefTable::~OSStripedRefTable()
+{
+    for (UInt32 x = 0; x < kNumStripes; x++)
+        delete [] fStripes[x].fBuckets;
+}
+
+// FNV-1a over the whole ID. HashString only looks at 5 characters, which is
+// fine for a small table but puts too many session IDs in the same chain once
+// there are tens of thousands of them.
+UInt32 OSStripedRefTable::HashID(StrPtrLen* inString)
+{
+    Assert(inString != NULL);
+    Assert(inString->Ptr != NULL);
+
+    UInt8* theData = (UInt8*)inString->Ptr;
+    UInt32 theHash = 2166136261U;
+    for (UInt32 x = 0; x < inString->Len; x++)
+    {
+        theHash ^= theData[x];
+        theHash *= 16777619U;
+    }
+    return theHash;
+}
+
+OS_Error OSStripedRefTable::Register(OSRef* inRef)
+{
+    Assert(inRef != NULL);
+#if DEBUG
+    Assert(!inRef->fInATable);
+#endif
+    Assert(inRef->fRefCount == 0);
+
+    UInt32 theHash = HashID(&inRef->fString);
+    Stripe* theStripe = GetStripe(theHash);
+    OSMutexLocker locker(&theStripe->fMutex);
+
+    // Check for a duplicate. In this function, if there is a duplicate,
+    // return an error, don't resolve the duplicate
+    if (this->Map(theStripe, &inRef->fString, theHash) != NULL)
+        return EPERM;
+
+#if DEBUG
+    inRef->fInATable = true;
+#endif
+    this->Add(theStripe, inRef);
+    return OS_NoErr;
+}
+
+OSRef* OSStripedRefTable::RegisterOrResolve(OSRef* inRef)
+{
+    Assert(inRef != NULL);
+#if DEBUG
+    Assert(!inRef->fInATable);
+#endif
+    Assert(inRef->fRefCount == 0);
+
+    UInt32 theHash = HashID(&inRef->fString);
+    Stripe* theStripe = GetStripe(theHash);
+    OSMutexLocker locker(&theStripe->fMutex);
+
+    // Check for a duplicate. If there is one, resolve it and return it to the caller
+    OSRef* duplicateRef = this->Map(theStripe, &inRef->fString, theHash);
+    if (duplicateRef != NULL)
+    {
+        duplicateRef->fRefCount++;
+        return duplicateRef;
+    }
+
+#if DEBUG
+    inRef->fInATable = true;
+#endif
+    this->Add(theStripe, inRef);
+    return NULL;
+}
+
+void OSStripedRefTable::UnRegister(OSRef* ref, UInt32 refCount)
+{
+    Assert(ref != NULL);
+    Stripe* theStripe = GetStripe(HashID(&ref->fString));
+    OSMutexLocker locker(&theStripe->fMutex);
+
+    //make sure that no one else is using the object
+    while (ref->fRefCount > refCount)
+        ref->fCond.Wait(&theStripe->fMutex);
+
+#if DEBUG
+    ref->fInATable = false;
+#endif
+    this->Remove(theStripe, ref);
+}
+
+Bool16 OSStripedRefTable::TryUnRegister(OSRef* ref, UInt32 refCount)
+{
+    Assert(ref != NULL);
+    Stripe* theStripe = GetStripe(HashID(&ref->fString));
+    OSMutexLocker locker(&theStripe->fMutex);
+    if (ref->fRefCount > refCount)
+        return false;
+
+#if DEBUG
+    ref->fInATable = false;
+#endif
+    this->Remove(theStripe, ref);
+    return true;
+}
+
+OSRef* OSStripedRefTable::Resolve(StrPtrLen* inUniqueID)
+{
+    Assert(inUniqueID != NULL);
+    UInt32 theHash = HashID(inUniqueID);
+    Stripe* theStripe = GetStripe(theHash);
+
+    OSMutexLocker locker(&theStripe->fMutex);
+    OSRef* ref = this->Map(theStripe, inUniqueID, theHash);
+    if (ref != NULL)
+    {
+        ref->fRefCount++;
+        Assert(ref->fRefCount > 0);
+    }
+    return ref;
+}
+
+void OSStripedRefTable::Release(OSRef* ref)
+{
+    Assert(ref != NULL);
+    Stripe* theStripe = GetStripe(HashID(&ref->fString));
+
+    OSMutexLocker locker(&theStripe->fMutex);
+    ref->fRefCount--;
+    Assert(ref->fRefCount < 1048576L);
+    //make sure to wakeup anyone who may be waiting for this resource to be released
+    ref->fCond.Signal();
+}
+
+void OSStripedRefTable::Swap(OSRef* newRef)
+{
+    Assert(newRef != NULL);
+    UInt32 theHash = HashID(&newRef->fString);
+    Stripe* theStripe = GetStripe(theHash);
+    OSMutexLocker locker(&theStripe->fMutex);
+
+    OSRef* oldRef = this->Map(theStripe, &newRef->fString, theHash);
+    if (oldRef != NULL)
+    {
+        this->Remove(theStripe, oldRef);
+        this->Add(theStripe, newRef);
+#if DEBUG
+        newRef->fInATable = true;
+        oldRef->fInATable = false;
+        oldRef->fSwapCalled = true;
+#endif
+    }
+    else
+        Assert(0);
+}
+
+UInt32 OSStripedRefTable::GetNumRefsInTable()
+{
+    UInt32 theNumRefs = 0;
+    for (UInt32 x = 0; x < kNumStripes; x++)
+        theNumRefs += fStripes[x].fNumRefs;
+    return theNumRefs;
+}
+
+// Everything below is called with the stripe's mutex held. The stripe takes
+// the low bits of the hash, so the bucket is picked with the bits above them.
+
+OSRef* OSStripedRefTable::Map(Stripe* inStripe, StrPtrLen* inString, UInt32 inHash)
+{
+    UInt32 theBucket = (inHash / kNumStripes) & (inStripe->fNumBuckets - 1);
+    OSRef* theRef = inStripe->fBuckets[theBucket];
+    while ((theRef != NULL) && !inString->Equal(theRef->fString))
+        theRef = theRef->fNextHashEntry;
+    return theRef;
+}
+
+void OSStripedRefTable::Add(Stripe* inStripe, OSRef* inRef)
+{
+    if (inStripe->fNumRefs >= 2 * inStripe->fNumBuckets)
+        this->Grow(inStripe);
+
+    UInt32 theBucket = (HashID(&inRef->fString) / kNumStripes) & (inStripe->fNumBuckets - 1);
+    inRef->fNextHashEntry = inStripe->fBuckets[theBucket];
+    inStripe->fBuckets[theBucket] = inRef;
+    inStripe->fNumRefs++;
+}
+
+void OSStripedRefTable::Remove(Stripe* inStripe, OSRef* inRef)
+{
+    UInt32 theBucket = (HashID(&inRef->fString) / kNumStripes) & (inStripe->fNumBuckets - 1);
+    OSRef** theLink = &inStripe->fBuckets[theBucket];
+    while ((*theLink != NULL) && (*theLink != inRef))
+        theLink = &(*theLink)->fNextHashEntry;
+
+    Assert(*theLink == inRef);
+    if (*theLink == NULL)
+        return;
+
+    *theLink = inRef->fNextHashEntry;
+    inRef->fNextHashEntry = NULL;
+    inStripe->fNumRefs--;
+}
+
+void OSStripedRefTable::Grow(Stripe* inStripe)
+{
+    UInt32 theNumBuckets = inStripe->fNumBuckets * 2;
+    OSRef** theBuckets = NEW OSRef*[theNumBuckets];
+    ::memset(theBuckets, 0, sizeof(OSRef*) * theNumBuckets);
+
+    for (UInt32 x = 0; x < inStripe->fNumBuckets; x++)
+    {
+        OSRef* theRef = inStripe->fBuckets[x];
+        while (theRef != NULL)
+        {
+            OSRef* theNext = theRef->fNextHashEntry;
+            UInt32 theBucket = (HashID(&theRef->fString) / kNumStripes) & (theNumBuckets - 1);
+            theRef->fNextHashEntry = theBuckets[theBucket];
+            theBuckets[theBucket] = theRef;
+            theRef = theNext;
+        }
+    }
+
+    delete [] inStripe->fBuckets;
+    inStripe->fBuckets = theBuckets;
+    inStripe->fNumBuckets = theNumBuckets;
+}
+
+
+OSStripedRefTableIter::OSStripedRefTableIter(OSStripedRefTable* inTable)
+:   fTable(inTable),
+    fStripeIndex(0),
+    fBucketIndex(0),
+    fCurrent(NULL),
+    fLocked(false)
+{
+    this->Advance();
+}
+
+OSStripedRefTableIter::~OSStripedRefTableIter()
+{
+    if (fLocked)
+        fTable->fStripes[fStripeIndex].fMutex.Unlock();
+}
+
+void OSStripedRefTableIter::Next()
+{
+    Assert(fCurrent != NULL);
+    if (fCurrent == NULL)
+        return;
+
+    fCurrent = fCurrent->fNextHashEntry;
+    if (fCurrent == NULL)
+    {
+        fBucketIndex++;
+        this->Advance();
+    }
+}
+
+void OSStripedRefTableIter::Advance()
+{
+    while (fStripeIndex < OSStripedRefTable::kNumStripes)
+    {
+        OSStripedRefTable::Stripe* theStripe = &fTable->fStripes[fStripeIndex];
+        if (!fLocked)
+        {
+            theStripe->fMutex.Lock();
+            fLocked = true;
+        }
+
+        for ( ; fBucketIndex < theStripe->fNumBuckets; fBucketIndex++)
+        {
+            fCurrent = theStripe->fBuckets[fBucketIndex];
+            if (fCurrent != NULL)
+                return;
+        }
+
+        // Done with this stripe, let registrations in it go on
+        theStripe->fMutex.Unlock();
+        fLocked = false;
+        fStripeIndex++;
+        fBucketIndex = 0;
+    }
+    fCurrent = NULL;
+}
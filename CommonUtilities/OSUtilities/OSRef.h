@@ -31,6 +31,8 @@ LastUpdate:  2010-08-19
 class OSRef;
 class OSRefKey;
 class OSRefTable;
+class OSStripedRefTable;
+class OSStripedRefTableIter;
 
 class OSRefTableUtils
 {
@@ -110,6 +112,8 @@ class OSRef
         friend class OSHashTable<OSRef, OSRefKey>;
         friend class OSHashTableIter<OSRef, OSRefKey>;
         friend class OSRefTable;
+        friend class OSStripedRefTable;
+        friend class OSStripedRefTableIter;
 
 };
 
@@ -257,6 +261,96 @@ class OSRefTable
 };
 
 
+//
+// OSStripedRefTable has the same interface and semantics as OSRefTable, for
+// tables that hold many refs and are hit from many threads at once (the RTP
+// session map). The table is split into kNumStripes stripes, each with its own
+// lock and bucket array. A ref goes to the stripe picked by a hash of its whole
+// ID string, so Resolve, Register, Release and UnRegister only lock that one
+// stripe. A stripe doubles its buckets when its refs outnumber them twice over;
+// this only holds up the refs of that stripe, so the table grows a little at a
+// time instead of all at once.
+//
+// There is no table-wide mutex to lock down the table between operations. Walk
+// the refs with OSStripedRefTableIter, which locks one stripe at a time, so
+// refs keep being registered & resolved in the other stripes meanwhile.
+class OSStripedRefTable
+{
+    public:
+
+        enum
+        {
+            kNumStripes = 64,           //UInt32, a power of 2
+            kMinBucketsPerStripe = 16   //UInt32, a power of 2
+        };
+
+        //tableSize is the number of refs the table is expected to hold at first
+        OSStripedRefTable(UInt32 tableSize = OSRefTable::kDefaultTableSize);
+        ~OSStripedRefTable();
+
+        OS_Error    Register(OSRef* ref);
+        OSRef*      RegisterOrResolve(OSRef* inRef);
+        void        UnRegister(OSRef* ref, UInt32 refCount = 0);
+        Bool16      TryUnRegister(OSRef* ref, UInt32 refCount = 0);
+        OSRef*      Resolve(StrPtrLen*  inString);
+        void        Release(OSRef*  inRef);
+        void        Swap(OSRef* newRef);
+
+        //The sum of the stripes' counts, which may be stale by the time it returns
+        UInt32      GetNumRefsInTable();
+
+    private:
+
+        struct Stripe
+        {
+            OSMutex     fMutex;
+            OSRef**     fBuckets;
+            UInt32      fNumBuckets;    // a power of 2
+            UInt32      fNumRefs;
+        };
+
+        static UInt32   HashID(StrPtrLen* inString);
+        Stripe*         GetStripe(UInt32 inHash)    { return &fStripes[inHash & (kNumStripes - 1)]; }
+
+        //These are called with the stripe's mutex held
+        OSRef*          Map(Stripe* inStripe, StrPtrLen* inString, UInt32 inHash);
+        void            Add(Stripe* inStripe, OSRef* inRef);
+        void            Remove(Stripe* inStripe, OSRef* inRef);
+        void            Grow(Stripe* inStripe);
+
+        Stripe      fStripes[kNumStripes];
+
+        friend class OSStripedRefTableIter;
+};
+
+//
+// Walks all the refs of an OSStripedRefTable. While the iterator is on a
+// ref, the stripe of that ref is locked, so the ref can't go away, but don't
+// block on anything else while holding an iterator.
+class OSStripedRefTableIter
+{
+    public:
+
+        OSStripedRefTableIter(OSStripedRefTable* inTable);
+        ~OSStripedRefTableIter();
+
+        void    Next();
+        Bool16  IsDone()        { return fCurrent == NULL; }
+        OSRef*  GetCurrent()    { return fCurrent; }
+
+    private:
+
+        //Moves on to the first ref at or after the current bucket, locking
+        //and unlocking stripes as needed
+        void    Advance();
+
+        OSStripedRefTable*  fTable;
+        UInt32              fStripeIndex;
+        UInt32              fBucketIndex;
+        OSRef*              fCurrent;
+        Bool16              fLocked;
+};
+
 class OSRefReleaser
 {
     public:
@@ -26,6 +26,7 @@ LastUpdate:  2010-08-19
 #include "OSThread.h"
 #include "MyAssert.h"
 #include "SafeStdLib.h"
+#include "atomic.h"
 
 
 /* ȶԼݳԱʼ */
@@ -34,6 +35,7 @@ pthread_key_t OSThread::gMainKey = 0;
 char  OSThread::sUser[128]= "";
 char  OSThread::sGroup[128]= "";
 Bool16  OSThread::sWrapSleep = true;
+unsigned int OSThread::sNumThreadIndexes = 0;
 
 /* ͬһ̹߳TLS洢,ȡthread index */
 void OSThread::Initialize()
@@ -44,7 +46,9 @@ void OSThread::Initialize()
 OSThread::OSThread()
 :   fStopRequested(false),/* δĳ߳stop */
     fJoined(false),/* δĳ߳ */
-    fThreadData(NULL) /*  ߳(洢TlsAllocĴ洢Ԫ)Ϊ */
+    fThreadData(NULL), /*  ߳(洢TlsAllocĴ洢Ԫ)Ϊ */
+    fThreadIndex(atomic_add(&sNumThreadIndexes, 1)),
+    fCachedMicroseconds(kNoCachedTime)
 {
 }
 
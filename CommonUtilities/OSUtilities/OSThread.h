@@ -89,6 +89,20 @@ public:
 	/* ڵǰ߳еTLSȡֵ */
 	/* ȡǰ߳TLSдʶ */
     static  OSThread*   GetCurrent();
+
+    //
+    // Every OSThread gets a number of its own, starting at 1, in the order the
+    // OSThread objects are created. 0 is never used, so it can stand for
+    // threads that aren't OSThreads (such as the main thread).
+                UInt32          GetThreadIndex()        { return fThreadIndex; }
+
+    //
+    // The time OS::CachedMicroseconds (and CachedMilliseconds) hand out on this
+    // thread, as an OS::Microseconds value. Only the thread itself may set it,
+    // kNoCachedTime makes them read the clock.
+    enum { kNoCachedTime = -1 };
+                SInt64          GetCachedMicroseconds() { return fCachedMicroseconds; }
+                void            SetCachedMicroseconds(SInt64 inTime) { fCachedMicroseconds = inTime; }
  
 private:
 
@@ -109,10 +123,13 @@ private:
 	/* ߳(洢TlsAllocĴ洢Ԫ)ʱʽݻ */
     void*           fThreadData;
     DateBuffer      fDateBuffer;
+    UInt32          fThreadIndex;
+    SInt64          fCachedMicroseconds;
     
 	/* ߳,TlsAlloc̴߳洢δʹóԱ߳,߳ */
     static void*    sMainThreadData;
     static Bool16   sWrapSleep;
+    static unsigned int sNumThreadIndexes;
 	/* ں,ǳҪ! */
     static void*    _Entry(void* inThread);
 };
@@ -0,0 +1,54 @@
+/***************************************************************************
+
+Copyright (c) 1999-2003 Apple Computer, Inc.  All Rights Reserved.
+2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 OSThreadCounters.cpp
+Description: Provide a set of 64 bit counters that every thread bumps in a
+             copy of its own, summed up when they are read.
+Comment:     used by QTSServerInterface for the server wide statistics
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-17
+LastUpdate:  2026-10-17
+
+****************************************************************************/
+
+
+#include <string.h>
+
+#include "OSThreadCounters.h"
+#include "OSThread.h"
+#include "MyAssert.h"
+
+
+OSThreadCounters::OSThreadCounters()
+{
+    ::memset((void*)fSlots, 0, sizeof(fSlots));
+}
+
+void OSThreadCounters::Add(UInt32 inCounter, SInt64 inValue)
+{
+    Assert(inCounter < kMaxCounters);
+
+    OSThread* theThread = OSThread::GetCurrent();
+    UInt32 theIndex = (theThread == NULL) ? 0 : theThread->GetThreadIndex();
+    if ((theIndex == 0) || (theIndex >= kMaxThreads))
+    {
+        OSMutexLocker locker(&fSharedSlotMutex);
+        fSlots[0].fCounters[inCounter] += inValue;
+        return;
+    }
+
+    fSlots[theIndex].fCounters[inCounter] += inValue;
+}
+
+SInt64 OSThreadCounters::Sum(UInt32 inCounter)
+{
+    Assert(inCounter < kMaxCounters);
+
+    SInt64 theSum = 0;
+    for (UInt32 x = 0; x < kMaxThreads; x++)
+        theSum += fSlots[x].fCounters[inCounter];
+    return theSum;
+}
@@ -0,0 +1,66 @@
+/***************************************************************************
+
+Copyright (c) 1999-2003 Apple Computer, Inc.  All Rights Reserved.
+2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 OSThreadCounters.h
+Description: Provide a set of 64 bit counters that every thread bumps in a
+             copy of its own, summed up when they are read.
+Comment:     used by QTSServerInterface for the server wide statistics
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-17
+LastUpdate:  2026-10-17
+
+****************************************************************************/
+
+
+#ifndef __OSTHREADCOUNTERS_H__
+#define __OSTHREADCOUNTERS_H__
+
+#include "OSHeaders.h"
+#include "OSMutex.h"
+
+//
+// Each OSThread adds to its own slot, found by OSThread::GetThreadIndex, so
+// writers never share a cache line and need neither a lock nor an atomic
+// instruction. Only the thread a slot belongs to ever writes it, and reads of
+// an aligned 64 bit value are atomic on the platforms we build for, so readers
+// just add the slots up. A sum may miss additions made while it is being taken,
+// but never sees half of one.
+//
+// Threads that aren't OSThreads, and any OSThreads beyond the first
+// kMaxThreads - 1, share slot 0 under a mutex.
+//
+// Counters are signed, so that a counter can track a current value (such as a
+// number of sessions) by adding 1 and -1, from whichever threads.
+
+class OSThreadCounters
+{
+    public:
+
+        enum
+        {
+            kMaxCounters    = 16,       //UInt32
+            kMaxThreads     = 128       //UInt32
+        };
+
+        OSThreadCounters();
+        ~OSThreadCounters() {}
+
+        void        Add(UInt32 inCounter, SInt64 inValue);
+        SInt64      Sum(UInt32 inCounter);
+
+    private:
+
+        // kMaxCounters * 8 bytes is a multiple of the cache line size
+        struct Slot
+        {
+            volatile SInt64 fCounters[kMaxCounters];
+        };
+
+        Slot        fSlots[kMaxThreads];
+        OSMutex     fSharedSlotMutex;
+};
+
+#endif //__OSTHREADCOUNTERS_H__
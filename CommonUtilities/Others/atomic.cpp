@@ -15,6 +15,50 @@ LastUpdate:  2010-08-19
 
 
 #include "atomic.h"
+
+#if defined(__GNUC__)
+
+//
+// The compiler knows how to do all of these without a lock. They are all
+// full memory barriers, just like taking and releasing sAtomicMutex was.
+
+unsigned int atomic_add(unsigned int *area, int val)
+{
+    return __sync_add_and_fetch(area, val);
+}
+
+unsigned int atomic_sub(unsigned int *area,int val)
+{
+    return __sync_sub_and_fetch(area, val);
+}
+
+unsigned int atomic_or(unsigned int *area, unsigned int val)
+{
+    return __sync_fetch_and_or(area, val);
+}
+
+unsigned int compare_and_store(unsigned int oval, unsigned int nval, unsigned int *area)
+{
+    return __sync_bool_compare_and_swap(area, oval, nval) ? 1 : 0;
+}
+
+unsigned int compare_and_store_ptr(void* oval, void* nval, void** area)
+{
+    return __sync_bool_compare_and_swap(area, oval, nval) ? 1 : 0;
+}
+
+void* atomic_swap_ptr(void** area, void* val)
+{
+    void* oldval;
+    do
+    {
+        oldval = *(void* volatile*)area;
+    } while (!__sync_bool_compare_and_swap(area, oldval, val));
+    return oldval;
+}
+
+#else
+
 #include "OSMutex.h"
 
 static OSMutex sAtomicMutex;
@@ -55,3 +99,22 @@ unsigned int compare_and_store(unsigned int oval, unsigned int nval, unsigned in
     rv=0;
     return rv;
 }
+
+unsigned int compare_and_store_ptr(void* oval, void* nval, void** area)
+{
+    OSMutexLocker locker(&sAtomicMutex);
+    if (oval != *area)
+        return 0;
+    *area = nval;
+    return 1;
+}
+
+void* atomic_swap_ptr(void** area, void* val)
+{
+    OSMutexLocker locker(&sAtomicMutex);
+    void* oldval = *area;
+    *area = val;
+    return oldval;
+}
+
+#endif
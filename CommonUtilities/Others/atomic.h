@@ -30,6 +30,11 @@ extern unsigned int atomic_or(unsigned int *area, unsigned int mask);
 
 extern unsigned int atomic_sub(unsigned int *area, int val);
 
+/* pointer sized versions, for lock free lists */
+extern unsigned int compare_and_store_ptr(void* oval, void* nval, void** area);
+
+extern void* atomic_swap_ptr(void** area, void* val);
+
 
 #ifdef __cplusplus
 }
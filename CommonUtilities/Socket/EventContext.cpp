@@ -72,7 +72,7 @@ void EventContext::Cleanup()
         {
             fEventThread->fRefTable.UnRegister(&fRef);
 			/* Ӷдɾsocket fd */
-            select_removeevent(fFileDesc);//The eventqueue / select shim requires this
+            select_removeevent(fFileDesc, fEventThread->fEventQueue);//The eventqueue / select shim requires this
         }
         else
             err = ::close(fFileDesc);
@@ -102,6 +102,10 @@ void EventContext::SnarfEventContext( EventContext &fromContext )
     
 	/* øݳԱֵ */
     fromContext.fFileDesc = kInvalidFileDesc;
+
+    // The fd stays on the event queue it was registered with, so take over
+    // the other context's EventThread as well
+    fEventThread = fromContext.fEventThread;
     
     fWatchEventCalled = fromContext.fWatchEventCalled; 
     fUniqueID = fromContext.fUniqueID;
@@ -146,7 +150,7 @@ void EventContext::RequestEvent(int theMask)
 		/* EV_RE,ָeventreqļfd,дɾ;
           EV_WR,ָeventreqļfdд,Ӷɾ.
           ļsMaxFDPos,¼req->er_datasCookieArray[],дpipe,Ƿغֵ0 */
-        if (select_modwatch(&fEventReq, theMask) != 0)
+        if (select_modwatch(&fEventReq, theMask, fEventThread->fEventQueue) != 0)
             AssertV(false, OSThread::GetErrno());
     }
 	// ǵһ룬Ҫselect_watchevent()ȷһΨһıʶ
@@ -185,7 +189,7 @@ void EventContext::RequestEvent(int theMask)
 
 		/* ָeventreqļfd,дɾ,ļsMaxFDPos,¼¼ID req->er_datasCookieArray[],дpipe */
 		/* ʵϵõselect_modwatch() */
-        if (select_watchevent(&fEventReq, theMask) != 0)
+        if (select_watchevent(&fEventReq, theMask, fEventThread->fEventQueue) != 0)
             //this should never fail, but if it does, cleanup.
             AssertV(false, OSThread::GetErrno());
             
@@ -210,7 +214,7 @@ void EventThread::Entry()
         {
 			/* ,ȡMessage,עһû,ֵֻ0,ֵEINTR(4) */
 			/* select_waiteventselect() */
-            int theReturnValue = select_waitevent(&theCurrentEvent, NULL);
+            int theReturnValue = select_waitevent(&theCurrentEvent, NULL, fEventQueue);
 
             //Sort of a hack. In the POSIX version of the server, waitevent can return
             //an actual POSIX errorcode.
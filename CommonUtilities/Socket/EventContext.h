@@ -85,6 +85,17 @@ class EventContext
         
         // Don't cleanup this socket automatically
         void            DontAutoCleanup() { fAutoCleanup = false; }
+
+        //
+        // Moves this context to another EventThread. The fd is owned by one
+        // event queue from the first RequestEvent until Cleanup, so this may
+        // only be called before this context has been armed.
+        void            SetEventThread(EventThread* inThread)
+        {
+            Assert(!fWatchEventCalled);
+            fEventThread = inThread;
+        }
+        EventThread*    GetEventThread()    { return fEventThread; }
         
         // Direct access to the FD(ļ) is not recommended, but is needed for modules
         // that want to use the Socket classes and need to request events(¼) on the fd.
@@ -168,8 +179,12 @@ class EventThread : public OSThread
 {
     public:
     
-        EventThread() : OSThread() {}
+        //
+        // Pass in the event queue (see select_addeventqueue) this thread waits on
+        EventThread(int inEventQueue = 0) : OSThread(), fEventQueue(inEventQueue) {}
         virtual ~EventThread() {}
+
+        int             GetEventQueue()     { return fEventQueue; }
     
     private:
     
@@ -179,6 +194,8 @@ class EventThread : public OSThread
 
 		/* Socketϵunique ID */
         OSRefTable      fRefTable;
+
+        int             fEventQueue;
         
         friend class EventContext;
 };
@@ -29,16 +29,53 @@ LastUpdate:  2010-08-19
 #include "Socket.h"
 #include "SocketUtils.h"
 #include "OSMemory.h"
+#include "atomic.h"
+
+#ifndef SO_REUSEPORT
+#define SO_REUSEPORT 15 // asm-generic/socket.h, older C libraries don't have it yet
+#endif
 
 #ifdef USE_NETLOG
 	#include <netlog.h>
 #endif
 
 /* ʼȫ־̬ */
-EventThread* Socket::sEventThread = NULL;
+EventThread*    Socket::sEventThreadArray[kMaxEventThreads];
+UInt32          Socket::sNumEventThreads = 0;
+unsigned int    Socket::sEventThreadPicker = 0;
+
+UInt32 Socket::SetNumEventThreads(UInt32 inNumThreads)
+{
+    if (inNumThreads > kMaxEventThreads)
+        inNumThreads = kMaxEventThreads;
+
+    while (sNumEventThreads < inNumThreads)
+    {
+        int theQueue = select_addeventqueue();
+        if (theQueue < 0)
+            break;
+        sEventThreadArray[sNumEventThreads++] = NEW EventThread(theQueue);
+    }
+    return sNumEventThreads;
+}
+
+void Socket::StartThread()
+{
+    for (UInt32 x = 0; x < sNumEventThreads; x++)
+        sEventThreadArray[x]->Start();
+}
+
+EventThread* Socket::PickEventThread()
+{
+    if (sNumEventThreads == 1)
+        return sEventThreadArray[0];
+
+    unsigned int theThread = atomic_add(&sEventThreadPicker, 1);
+    return sEventThreadArray[theThread % sNumEventThreads];
+}
 
 Socket::Socket(Task *notifytask, UInt32 inSocketType)
-:   EventContext(EventContext::kInvalidFileDesc, sEventThread),
+:   EventContext(EventContext::kInvalidFileDesc, sEventThreadArray[0]),
     fState(inSocketType),
     fLocalAddrStrPtr(NULL),
     fLocalDNSStrPtr(NULL),
@@ -87,6 +124,15 @@ void Socket::ReuseAddr()
     Assert(err == 0);   
 }
 
+OS_Error Socket::ReusePort()
+{
+    int one = 1;
+    int err = ::setsockopt(fFileDesc, SOL_SOCKET, SO_REUSEPORT, (char*)&one, sizeof(int));
+    if (err != 0)
+        return (OS_Error)OSThread::GetErrno();
+    return OS_NoErr;
+}
+
 /* ָSocketTCPӳ */
 void Socket::NoDelay()
 {
@@ -43,11 +43,27 @@ class Socket : public EventContext
 
         // This class provides a global event thread.
 		/* һevent thread */
-        static void Initialize() { sEventThread = new EventThread(); }
+        static void Initialize() { sEventThreadArray[0] = new EventThread(0); sNumEventThreads = 1; }
+        //
+        // Adds event threads, each waiting on its own event queue, until there
+        // are inNumThreads of them. Must be called before StartThread. Returns
+        // the number of event threads, which stays at 1 if the event queue
+        // implementation can't be sharded.
+        static UInt32 SetNumEventThreads(UInt32 inNumThreads);
 		/* һevent thread */
-        static void StartThread() { sEventThread->Start(); }
+        static void StartThread();
 		/* ȡһevent thread */
-        static EventThread* GetEventThread() { return sEventThread; }
+        static EventThread* GetEventThread() { return sEventThreadArray[0]; }
+        //
+        // Picks one of the event threads round robin. Sockets that are handed
+        // out to clients (accepted RTSP connections, RTP/RTCP socket pairs) are
+        // spread across the event threads this way.
+        static EventThread* PickEventThread();
+        //
+        // The event thread at inIndex, modulo the number of event threads. Used
+        // to place the listeners of a sharded listen port one per event thread.
+        static EventThread* GetEventThread(UInt32 inIndex) { return sEventThreadArray[inIndex % sNumEventThreads]; }
+        static UInt32       GetNumEventThreads() { return sNumEventThreads; }
         
 		///󶨵ָipַͶ˿
 
@@ -60,6 +76,11 @@ class Socket : public EventContext
 		/* ::setsockopt()ָSocketӦ */
 
         void            ReuseAddr();
+        //
+        // Lets several sockets bind the same address and port, with the kernel
+        // spreading incoming connections across them. Every socket on the port
+        // has to set it. Returns an ERRNO.
+        OS_Error        ReusePort();
         void            NoDelay();
         void            KeepAlive();
         /* ָķͻС */
@@ -160,7 +181,13 @@ class Socket : public EventContext
         
 		// This class provides a global event thread.
 		/************* NOTE !! *************/
-        static EventThread* sEventThread;
+        enum
+        {
+            kMaxEventThreads = 64
+        };
+        static EventThread* sEventThreadArray[kMaxEventThreads];
+        static UInt32       sNumEventThreads;
+        static unsigned int sEventThreadPicker;
         
 };
 
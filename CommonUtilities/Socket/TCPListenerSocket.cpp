@@ -47,7 +47,7 @@ OS_Error TCPListenerSocket::Listen(UInt32 queueLength)
 
 /* ¼:TCP SocketΪģʽ;󶨵ָipͶ˿;ôĻС(96Kֽ);õȴг(128)ʼ */
 /* used in QTSServer::CreateListeners() */
-OS_Error TCPListenerSocket::Initialize(UInt32 addr, UInt16 port)
+OS_Error TCPListenerSocket::Initialize(UInt32 addr, UInt16 port, Bool16 inReusePort)
 {
 	/* SocketΪģʽ */
     OS_Error err = this->TCPSocket::Open();
@@ -58,6 +58,12 @@ OS_Error TCPListenerSocket::Initialize(UInt32 addr, UInt16 port)
         // so don't do it on NT.
         this->ReuseAddr();
 
+        if (inReusePort)
+        {
+            err = this->ReusePort();
+            if (err != 0) break;
+        }
+
 		/* κ½Socket */
         err = this->Bind(addr, port);
         if (err != 0) break; // don't assert this is just a port already in use.
@@ -205,8 +211,12 @@ void TCPListenerSocket::ProcessEvent(int /*eventBits*/)
 		/**************** ע:ͨGetSessionTask()ʹTaskTCPSocket ***********************/
 		/* RTSPSessionеTCPSocketݳԱ趨,ڵRTSPSessionʵ,ʹRTSPSessionTCPSocket */
         theSocket->SetTask(theTask);
+        //hand the connection to one of the event threads; the listener itself stays on the first one
+        theSocket->SetEventThread(Socket::PickEventThread());
 		// ú,սӵRTSPSessionʵTCPSocketTaskThreadClient͵
         theSocket->RequestEvent(EV_RE);
+
+        fNumAccepts++;
     }  
 
 	/* accept()?ٶȵ! */
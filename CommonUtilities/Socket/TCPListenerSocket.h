@@ -28,7 +28,8 @@ class TCPListenerSocket : public TCPSocket, public IdleTask
     public:
 
         TCPListenerSocket() :   TCPSocket(NULL, Socket::kNonBlockingSocketType), IdleTask(),
-                                fAddr(0), fPort(0), fOutOfDescriptors(false), fSleepBetweenAccepts(false) {this->SetTaskName("TCPListenerSocket");}
+                                fAddr(0), fPort(0), fOutOfDescriptors(false), fSleepBetweenAccepts(false),
+                                fNumAccepts(0), fLastSampledAccepts(0) {this->SetTaskName("TCPListenerSocket");}
         virtual ~TCPListenerSocket() {}
         
         //
@@ -37,7 +38,9 @@ class TCPListenerSocket : public TCPSocket, public IdleTask
         //addr = listening address. port = listening port. Automatically
         //starts listening
 		/* ¼:SocketΪģʽ;;ôĻС;õȴг */
-        OS_Error        Initialize(UInt32 addr, UInt16 port);
+        //If inReusePort is true, the socket is opened with SO_REUSEPORT so that
+        //several listeners can share the port, each getting a share of the connections.
+        OS_Error        Initialize(UInt32 addr, UInt16 port, Bool16 inReusePort = false);
 
         //You can query(ѯ) the listener to see if it is failing to accept
         //connections because the OS is out of descriptors.
@@ -45,6 +48,17 @@ class TCPListenerSocket : public TCPSocket, public IdleTask
 
         void        SlowDown() { fSleepBetweenAccepts = true; }
         void        RunNormal() { fSleepBetweenAccepts = false; }
+
+        //
+        // Connections accepted by this listener since it was created. Only the
+        // listener's own event thread changes it.
+        UInt32      GetNumAccepts() { return fNumAccepts; }
+
+        //
+        // Connections accepted since the last call. For the stats task, which is
+        // the only caller.
+        UInt32      GetNumAcceptsSinceLastSample()
+                        { UInt32 theNumAccepts = fNumAccepts; UInt32 theDelta = theNumAccepts - fLastSampledAccepts; fLastSampledAccepts = theNumAccepts; return theDelta; }
         //derived object must implement a way of getting tasks & sockets to this object 
 		/* 麯,עԺ(RTSPListenerSocket,μRTSPListenerSocket::GetSessionTask())ȥȡ,
 		   úTaskoutSocket */
@@ -76,6 +90,9 @@ class TCPListenerSocket : public TCPSocket, public IdleTask
         Bool16          fOutOfDescriptors;
 		/* accept()֮? */
         Bool16          fSleepBetweenAccepts;
+
+        UInt32          fNumAccepts;
+        UInt32          fLastSampledAccepts;
 };
 #endif // __TCPLISTENERSOCKET_H__
 
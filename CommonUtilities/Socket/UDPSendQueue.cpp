@@ -0,0 +1,336 @@
+/***************************************************************************
+
+Copyright (c) 1999-2003 Apple Computer, Inc.  All Rights Reserved.
+2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 UDPSendQueue.cpp
+Description: Collects outgoing datagrams for one UDPSocket and sends them
+             with as few system calls as possible (sendmmsg, UDP GSO).
+Comment:     used by RTPStream to batch the RTP packets of one RTPSession::Run
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-17
+LastUpdate:  2026-10-17
+
+****************************************************************************/
+
+
+#include <string.h>
+#include <errno.h>
+#include <netinet/udp.h>
+
+#include "UDPSendQueue.h"
+#include "OSThread.h"
+#include "OSMemory.h"
+#include "atomic.h"
+#include "MyAssert.h"
+
+#ifndef SOL_UDP
+#define SOL_UDP 17
+#endif
+
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103 // linux/udp.h, older C libraries don't have it yet
+#endif
+
+unsigned int UDPSendQueue::sUnsupported = 0;
+UDPSendQueue::ThreadBuffer* UDPSendQueue::sThreadBuffers[kMaxThreads];
+
+UDPSendQueue::UDPSendQueue()
+:   fSocket(NULL),
+    fAllowGSO(false),
+    fBuffer(NULL),
+    fNumQueued(0),
+    fHeldData(NULL),
+    fNumPacketsSent(0),
+    fNumSendCalls(0)
+{
+    ::memset(&fRemoteAddr, 0, sizeof(fRemoteAddr));
+}
+
+UDPSendQueue::~UDPSendQueue()
+{
+    // Whoever owns us is expected to flush before going away. What a full
+    // socket buffer held back is dropped.
+    Assert(fBuffer == NULL);
+    delete [] fHeldData;
+}
+
+UDPSendQueue::ThreadBuffer* UDPSendQueue::GetThreadBuffer()
+{
+    OSThread* theThread = OSThread::GetCurrent();
+    if (theThread == NULL)
+        return NULL;
+
+    UInt32 theIndex = theThread->GetThreadIndex();
+    if (theIndex >= kMaxThreads)
+        return NULL;
+
+    // Only this thread ever uses the slot, so there is nothing to lock
+    if (sThreadBuffers[theIndex] == NULL)
+    {
+        ThreadBuffer* theBuffer = NEW ThreadBuffer;
+        theBuffer->fUsed = 0;
+        theBuffer->fNumQueues = 0;
+        ::memset(theBuffer->fMsgs, 0, sizeof(theBuffer->fMsgs));
+        sThreadBuffers[theIndex] = theBuffer;
+    }
+    return sThreadBuffers[theIndex];
+}
+
+void UDPSendQueue::FlushAll(ThreadBuffer* inBuffer)
+{
+    // Each Flush takes its queue out of the list
+    while (inBuffer->fNumQueues > 0)
+    {
+        UDPSendQueue* theQueue = inBuffer->fQueues[inBuffer->fNumQueues - 1];
+        theQueue->Flush(theQueue->fAllowGSO);
+    }
+
+    Assert(inBuffer->fUsed == 0);
+}
+
+void UDPSendQueue::SendTo(UDPSocket* inSocket, UInt32 inRemoteAddr, UInt16 inRemotePort,
+                            void* inBuffer, UInt32 inLength, Bool16 inAllowGSO)
+{
+    Assert(inSocket != NULL);
+    Assert(inBuffer != NULL);
+
+    fAllowGSO = inAllowGSO;
+
+    // Everything in one batch goes out the same fd to the same destination.
+    // Whatever a full socket buffer leaves of the old batch is dropped.
+    if ((fNumQueued > 0) &&
+        ((inSocket != fSocket) ||
+         (fRemoteAddr.sin_addr.s_addr != htonl(inRemoteAddr)) ||
+         (fRemoteAddr.sin_port != htons(inRemotePort))))
+    {
+        this->Flush(inAllowGSO);
+        this->HoldBack(fNumQueued);
+    }
+
+    ThreadBuffer* theBuffer = GetThreadBuffer();
+    if ((theBuffer == NULL) || (inLength > kThreadBufferSize))
+    {
+        (void)inSocket->SendTo(inRemoteAddr, inRemotePort, inBuffer, inLength);
+        fNumPacketsSent++;
+        fNumSendCalls++;
+        return;
+    }
+    Assert((fBuffer == NULL) || (fBuffer == theBuffer));
+
+    if (fNumQueued == kMaxQueuedPackets)
+    {
+        this->Flush(inAllowGSO);
+        if (fNumQueued == kMaxQueuedPackets)
+            return; // the socket buffer is still full
+    }
+
+    if ((theBuffer->fUsed + inLength > kThreadBufferSize) ||
+        ((fBuffer == NULL) && (theBuffer->fNumQueues == kMaxBufferQueues)))
+        FlushAll(theBuffer);
+
+    if (fNumQueued == 0)
+    {
+        fSocket = inSocket;
+        fRemoteAddr.sin_family = AF_INET;
+        fRemoteAddr.sin_port = htons(inRemotePort);
+        fRemoteAddr.sin_addr.s_addr = htonl(inRemoteAddr);
+    }
+
+    if (fBuffer == NULL)
+    {
+        fBuffer = theBuffer;
+        theBuffer->fQueues[theBuffer->fNumQueues++] = this;
+    }
+
+    char* theData = &theBuffer->fData[theBuffer->fUsed];
+    ::memcpy(theData, inBuffer, inLength);
+
+    fIOVecs[fNumQueued].iov_base = theData;
+    fIOVecs[fNumQueued].iov_len = inLength;
+
+    theBuffer->fUsed += inLength;
+    fNumQueued++;
+}
+
+void UDPSendQueue::Flush(Bool16 inAllowGSO)
+{
+    if (fNumQueued == 0)
+        return;
+
+    // If all we have is what an earlier Flush held back, the sendmmsg headers
+    // are built in this thread's buffer
+    ThreadBuffer* theBuffer = (fBuffer != NULL) ? fBuffer : GetThreadBuffer();
+    unsigned int theUnsupported = atomic_add(&sUnsupported, 0);
+    Bool16 theUseGSO = inAllowGSO && !(theUnsupported & kGSOUnsupported);
+    Bool16 theSocketFull = false;
+
+    UInt32 theFirstPacket = 0;
+    while ((theBuffer != NULL) && (theFirstPacket < fNumQueued) && !(theUnsupported & kSendmmsgUnsupported))
+    {
+        struct mmsghdr* theMsgs = theBuffer->fMsgs;
+        UInt32 theNumMsgs = this->BuildMessages(theBuffer, theFirstPacket, theUseGSO);
+        int theNumSent = ::sendmmsg(fSocket->GetSocketFD(), theMsgs, theNumMsgs, 0);
+        fNumSendCalls++;
+
+        if (theNumSent > 0)
+        {
+            theFirstPacket = theBuffer->fMsgFirstPacket[theNumSent];
+            continue;
+        }
+
+        // Sending nothing without an error means the first message would have
+        // blocked, same as EAGAIN. errno isn't set then.
+        int theErr = (theNumSent == 0) ? EAGAIN : OSThread::GetErrno();
+        if (theErr == EAGAIN)
+        {
+            // The socket buffer is full, the rest would only be refused too.
+            // Keep it for the next Flush.
+            theSocketFull = true;
+            break;
+        }
+        else if (theErr == ENOSYS)
+        {
+            // old kernel, fall back to sendto below
+            theUnsupported = atomic_or(&sUnsupported, kSendmmsgUnsupported) | kSendmmsgUnsupported;
+        }
+        else if ((theMsgs[0].msg_hdr.msg_controllen > 0) &&
+                 ((theErr == ENOPROTOOPT) || (theErr == EOPNOTSUPP)))
+        {
+            // The kernel doesn't know about UDP_SEGMENT. Resend this run, and
+            // everything after it, as plain datagrams, and don't try again.
+            theUnsupported = atomic_or(&sUnsupported, kGSOUnsupported) | kGSOUnsupported;
+            theUseGSO = false;
+        }
+        else if ((theMsgs[0].msg_hdr.msg_controllen > 0) &&
+                 ((theErr == EINVAL) || (theErr == EIO)))
+        {
+            // This super buffer didn't go, because of its size or the route
+            // it takes. Send its datagrams one by one and carry on with GSO.
+            this->SendOneByOne(theFirstPacket, theBuffer->fMsgFirstPacket[1]);
+            theFirstPacket = theBuffer->fMsgFirstPacket[1];
+        }
+        else
+            theFirstPacket = theBuffer->fMsgFirstPacket[1]; // the first message failed, drop it the way SendTo would
+    }
+
+    if (!theSocketFull && (theFirstPacket < fNumQueued))
+    {
+        this->SendOneByOne(theFirstPacket, fNumQueued);
+        theFirstPacket = fNumQueued;
+    }
+
+    fNumPacketsSent += theFirstPacket;
+    this->HoldBack(theFirstPacket);
+
+    if (fBuffer == NULL)
+        return;
+
+    // Take ourselves out of the thread buffer. Its space can be reused once
+    // nobody has anything queued in it.
+    for (UInt32 x = 0; x < fBuffer->fNumQueues; x++)
+    {
+        if (fBuffer->fQueues[x] == this)
+        {
+            fBuffer->fQueues[x] = fBuffer->fQueues[--fBuffer->fNumQueues];
+            break;
+        }
+    }
+    if (fBuffer->fNumQueues == 0)
+        fBuffer->fUsed = 0;
+    fBuffer = NULL;
+}
+
+// Keeps the queued datagrams from inFirstPacket on, copied out of the buffer they
+// are in, and forgets the ones before. HoldBack(fNumQueued) empties the queue.
+void UDPSendQueue::HoldBack(UInt32 inFirstPacket)
+{
+    char* theOldData = fHeldData;
+    fHeldData = NULL;
+
+    UInt32 theNumHeld = fNumQueued - inFirstPacket;
+    if (theNumHeld > 0)
+    {
+        UInt32 theLength = 0;
+        for (UInt32 x = inFirstPacket; x < fNumQueued; x++)
+            theLength += fIOVecs[x].iov_len;
+
+        fHeldData = NEW char[theLength];
+        char* theData = fHeldData;
+        for (UInt32 x = 0; x < theNumHeld; x++)
+        {
+            UInt32 theDatagramLen = fIOVecs[inFirstPacket + x].iov_len;
+            ::memcpy(theData, fIOVecs[inFirstPacket + x].iov_base, theDatagramLen);
+            fIOVecs[x].iov_base = theData;
+            fIOVecs[x].iov_len = theDatagramLen;
+            theData += theDatagramLen;
+        }
+    }
+
+    fNumQueued = theNumHeld;
+    delete [] theOldData;
+}
+
+// Fills out fMsgs for the datagrams from inFirstPacket on, and returns the number
+// of messages. Other queues' datagrams may sit in between ours in the thread
+// buffer, so a run is described by the iovecs of its datagrams, which the
+// kernel gathers into one super buffer.
+UInt32 UDPSendQueue::BuildMessages(ThreadBuffer* inBuffer, UInt32 inFirstPacket, Bool16 inUseGSO)
+{
+    UInt32 theNumMsgs = 0;
+    UInt32 thePacket = inFirstPacket;
+
+    while (thePacket < fNumQueued)
+    {
+        UInt32 theSegmentSize = fIOVecs[thePacket].iov_len;
+        UInt32 theRunEnd = thePacket + 1;
+        if (inUseGSO)
+        {
+            while ((theRunEnd < fNumQueued) && (fIOVecs[theRunEnd].iov_len == theSegmentSize))
+                theRunEnd++;
+            // only the last segment of a super buffer may be shorter than the others
+            if ((theRunEnd < fNumQueued) && (fIOVecs[theRunEnd].iov_len < theSegmentSize))
+                theRunEnd++;
+        }
+
+        struct msghdr* theHdr = &inBuffer->fMsgs[theNumMsgs].msg_hdr;
+        ::memset(theHdr, 0, sizeof(struct msghdr));
+        theHdr->msg_name = &fRemoteAddr;
+        theHdr->msg_namelen = sizeof(fRemoteAddr);
+        theHdr->msg_iov = &fIOVecs[thePacket];
+        theHdr->msg_iovlen = theRunEnd - thePacket;
+
+        if (theRunEnd - thePacket > 1)
+        {
+            theHdr->msg_control = inBuffer->fMsgControl[theNumMsgs];
+            theHdr->msg_controllen = sizeof(inBuffer->fMsgControl[theNumMsgs]);
+
+            struct cmsghdr* theCmsg = CMSG_FIRSTHDR(theHdr);
+            theCmsg->cmsg_level = SOL_UDP;
+            theCmsg->cmsg_type = UDP_SEGMENT;
+            theCmsg->cmsg_len = CMSG_LEN(sizeof(UInt16));
+            UInt16 theGSOSize = (UInt16)theSegmentSize;
+            ::memcpy(CMSG_DATA(theCmsg), &theGSOSize, sizeof(theGSOSize));
+        }
+
+        inBuffer->fMsgFirstPacket[theNumMsgs] = thePacket;
+        theNumMsgs++;
+        thePacket = theRunEnd;
+    }
+
+    inBuffer->fMsgFirstPacket[theNumMsgs] = fNumQueued;
+    return theNumMsgs;
+}
+
+void UDPSendQueue::SendOneByOne(UInt32 inFirstPacket, UInt32 inLastPacket)
+{
+    UInt32 theRemoteAddr = ntohl(fRemoteAddr.sin_addr.s_addr);
+    UInt16 theRemotePort = ntohs(fRemoteAddr.sin_port);
+
+    for (UInt32 x = inFirstPacket; x < inLastPacket; x++)
+    {
+        (void)fSocket->SendTo(theRemoteAddr, theRemotePort, fIOVecs[x].iov_base, fIOVecs[x].iov_len);
+        fNumSendCalls++;
+    }
+}
@@ -0,0 +1,140 @@
+/***************************************************************************
+
+Copyright (c) 1999-2003 Apple Computer, Inc.  All Rights Reserved.
+2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 UDPSendQueue.h
+Description: Collects outgoing datagrams for one UDPSocket and sends them
+             with as few system calls as possible (sendmmsg, UDP GSO).
+Comment:     used by RTPStream to batch the RTP packets of one RTPSession::Run
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-17
+LastUpdate:  2026-10-17
+
+****************************************************************************/
+
+
+#ifndef __UDPSENDQUEUE_H__
+#define __UDPSENDQUEUE_H__
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include "OSHeaders.h"
+#include "UDPSocket.h"
+
+
+class UDPSendQueue
+{
+    public:
+
+        UDPSendQueue();
+        ~UDPSendQueue();
+
+        //
+        // SendTo
+        //
+        // Copies the datagram into the calling thread's batch buffer, so the
+        // caller may reuse inBuffer as soon as this returns. If the queue is full,
+        // or the datagram goes to another socket or destination than the ones
+        // already queued, the queue is flushed first. If the thread's buffer is
+        // full, every queue with datagrams in it is flushed. These flushes use
+        // inAllowGSO the way Flush does.
+        //
+        // Queued datagrams must be flushed by the thread that queued them, before
+        // it goes on to other work. Threads without a buffer slot send right away.
+        // If the queue is still full after the flush, the datagram is dropped.
+        void    SendTo(UDPSocket* inSocket, UInt32 inRemoteAddr, UInt16 inRemotePort,
+                        void* inBuffer, UInt32 inLength, Bool16 inAllowGSO = false);
+
+        //
+        // Flush
+        //
+        // Sends everything queued. Like UDPSocket::SendTo, datagrams the kernel
+        // refuses are dropped. The exception is a full socket buffer (EAGAIN, or
+        // sendmmsg sending nothing): then the datagrams that didn't go are copied
+        // out of the thread buffer and stay queued, and the next Flush, from any
+        // thread, sends them first. Whatever is still queued when the queue goes
+        // away is dropped.
+        //
+        // If inAllowGSO is true, runs of equal sized datagrams are handed to the
+        // kernel as one UDP_SEGMENT (generic segmentation offload) super buffer,
+        // which the kernel or the NIC splits back into the original datagrams.
+        // A super buffer the kernel rejects is resent as separate datagrams. GSO
+        // is only turned off for good if the kernel says it doesn't have it.
+        void    Flush(Bool16 inAllowGSO = false);
+
+        UInt32  GetNumQueued()  { return fNumQueued; }
+
+        //
+        // Number of datagrams sent and system calls used to send them since the
+        // last call to ResetStats. Callers fold these into the server totals.
+        UInt32  GetNumPacketsSent()     { return fNumPacketsSent; }
+        UInt32  GetNumSendCalls()       { return fNumSendCalls; }
+        void    ResetStats()            { fNumPacketsSent = 0; fNumSendCalls = 0; }
+
+    private:
+
+        enum
+        {
+            kMaxQueuedPackets   = 32,           // datagrams handed to one sendmmsg
+            kMaxThreads         = 128,          // threads that get a batch buffer
+            kThreadBufferSize   = 128 * 1024,   // bytes of datagram data one thread holds on to
+            kMaxBufferQueues    = 16            // queues with datagrams in one thread buffer
+        };
+
+        //
+        // One per thread that sends through a queue. A queue's datagrams sit back
+        // to back in fData, and the space is taken back once every queue in
+        // fQueues is flushed. Only the owning thread ever touches it.
+        struct ThreadBuffer
+        {
+            char                fData[kThreadBufferSize];
+            UInt32              fUsed;
+
+            UDPSendQueue*       fQueues[kMaxBufferQueues];
+            UInt32              fNumQueues;
+
+            // What actually gets passed to sendmmsg. Without GSO there is one message
+            // per queued datagram, with GSO a message may cover a run of them.
+            struct mmsghdr      fMsgs[kMaxQueuedPackets];
+            UInt32              fMsgFirstPacket[kMaxQueuedPackets + 1];
+            char                fMsgControl[kMaxQueuedPackets][CMSG_SPACE(sizeof(UInt16))];
+        };
+
+        static ThreadBuffer*    GetThreadBuffer();
+        static void             FlushAll(ThreadBuffer* inBuffer);
+
+        UInt32  BuildMessages(ThreadBuffer* inBuffer, UInt32 inFirstPacket, Bool16 inUseGSO);
+        void    SendOneByOne(UInt32 inFirstPacket, UInt32 inLastPacket);
+        void    HoldBack(UInt32 inFirstPacket);
+
+        UDPSocket*          fSocket;
+        struct sockaddr_in  fRemoteAddr;
+        Bool16              fAllowGSO;  // from the last SendTo, for the flushes it does
+
+        ThreadBuffer*       fBuffer;    // holds what this thread queued, NULL when nothing is
+        struct iovec        fIOVecs[kMaxQueuedPackets];
+        UInt32              fNumQueued;
+
+        // The datagrams a full socket buffer left behind, at the front of
+        // fIOVecs. NULL if there are none.
+        char*               fHeldData;
+
+        UInt32              fNumPacketsSent;
+        UInt32              fNumSendCalls;
+
+        // Set once the kernel tells us it doesn't know about sendmmsg / UDP GSO.
+        // Any sending thread may set a bit, so it is only changed with atomic_or.
+        enum
+        {
+            kSendmmsgUnsupported    = 1,
+            kGSOUnsupported         = 2
+        };
+        static unsigned int sUnsupported;
+
+        static ThreadBuffer*    sThreadBuffers[kMaxThreads];
+};
+
+#endif //__UDPSENDQUEUE_H__
@@ -17,6 +17,7 @@ LastUpdate:  2010-08-19
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <errno.h>
+#include <string.h>
 #include "UDPSocket.h"
 #include "OSMemory.h"
 
@@ -25,6 +26,22 @@ LastUpdate:  2010-08-19
 #endif
 
 
+Bool16 UDPSocket::sRecvmmsgUnsupported = false;
+
+UDPRecvBatch::UDPRecvBatch()
+:   fNumPackets(0)
+{
+    ::memset(fMsgs, 0, sizeof(fMsgs));
+    for (UInt32 x = 0; x < kMaxPackets; x++)
+    {
+        fLengths[x] = 0;
+        fIovecs[x].iov_base = fBuffers[x];
+        fIovecs[x].iov_len = kMaxPacketSize;
+        fMsgs[x].msg_hdr.msg_name = &fAddrs[x];
+        fMsgs[x].msg_hdr.msg_iov = &fIovecs[x];
+        fMsgs[x].msg_hdr.msg_iovlen = 1;
+    }
+}
 
 /* עǴӸSocket̳,еһRTCPTask,μRTPSocketPool::ConstructUDPSocketPair() */
 UDPSocket::UDPSocket(Task* inTask, UInt32 inSocketType)
@@ -90,6 +107,54 @@ OS_Error UDPSocket::RecvFrom(UInt32* outRemoteAddr, UInt16* outRemotePort,
     return OS_NoErr;        
 }
 
+OS_Error UDPSocket::RecvMultiple(UDPRecvBatch* ioBatch)
+{
+    Assert(ioBatch != NULL);
+    ioBatch->fNumPackets = 0;
+
+    if (!sRecvmmsgUnsupported)
+    {
+        // The kernel overwrites msg_namelen with each datagram's address length
+        for (UInt32 x = 0; x < UDPRecvBatch::kMaxPackets; x++)
+            ioBatch->fMsgs[x].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+
+        int theNumRecvd = ::recvmmsg(fFileDesc, ioBatch->fMsgs, UDPRecvBatch::kMaxPackets, MSG_DONTWAIT, NULL);
+        if (theNumRecvd >= 0)
+        {
+            for (int y = 0; y < theNumRecvd; y++)
+                ioBatch->fLengths[y] = ioBatch->fMsgs[y].msg_len;
+            ioBatch->fNumPackets = (UInt32)theNumRecvd;
+            return OS_NoErr;
+        }
+
+        OS_Error theErr = (OS_Error)OSThread::GetErrno();
+        if (theErr != ENOSYS)
+            return theErr;
+        sRecvmmsgUnsupported = true; // old kernel, fall back to recvfrom below
+    }
+
+    OS_Error theErr = OS_NoErr;
+    while (ioBatch->fNumPackets < UDPRecvBatch::kMaxPackets)
+    {
+        UInt32 theIndex = ioBatch->fNumPackets;
+        socklen_t addrLen = sizeof(struct sockaddr_in);
+        SInt32 theRecvLen = ::recvfrom(fFileDesc, ioBatch->fBuffers[theIndex], UDPRecvBatch::kMaxPacketSize, 0,
+                                        (sockaddr*)&ioBatch->fAddrs[theIndex], &addrLen);
+        if (theRecvLen == -1)
+        {
+            theErr = (OS_Error)OSThread::GetErrno();
+            break;
+        }
+        ioBatch->fLengths[theIndex] = (UInt32)theRecvLen;
+        ioBatch->fNumPackets++;
+    }
+
+    // Running out of datagrams after some were received isn't an error
+    if (ioBatch->fNumPackets > 0)
+        return OS_NoErr;
+    return theErr;
+}
+
 /* öಥṹӦSocket */
 OS_Error UDPSocket::JoinMulticast(UInt32 inRemoteAddr)
 {
@@ -23,6 +23,45 @@ LastUpdate:  2010-08-19
 #include <sys/uio.h>
 #include "Socket.h"
 #include "UDPDemuxer.h"
+#include "StrPtrLen.h"
+
+//
+// The buffers for receiving up to kMaxPackets datagrams with a single
+// UDPSocket::RecvMultiple call. This is big, so don't put it on the stack.
+class UDPRecvBatch
+{
+    public:
+
+        enum
+        {
+            kMaxPackets     = 32,
+            kMaxPacketSize  = 2048
+        };
+
+        UDPRecvBatch();
+        ~UDPRecvBatch() {}
+
+        UInt32      GetNumPackets()             { return fNumPackets; }
+
+        //
+        // The i-th datagram of the last RecvMultiple call, and where it came from.
+        // The packet points into the batch, so it is only good until the next call.
+        void        GetPacket(UInt32 inIndex, StrPtrLen* outPacket)
+                        { Assert(inIndex < fNumPackets); outPacket->Set(fBuffers[inIndex], fLengths[inIndex]); }
+        UInt32      GetRemoteAddr(UInt32 inIndex)   { return ntohl(fAddrs[inIndex].sin_addr.s_addr); }
+        UInt16      GetRemotePort(UInt32 inIndex)   { return ntohs(fAddrs[inIndex].sin_port); }
+
+    private:
+
+        UInt32              fNumPackets;
+        UInt32              fLengths[kMaxPackets];
+        struct sockaddr_in  fAddrs[kMaxPackets];
+        struct iovec        fIovecs[kMaxPackets];
+        struct mmsghdr      fMsgs[kMaxPackets];
+        char                fBuffers[kMaxPackets][kMaxPacketSize];
+
+        friend class UDPSocket;
+};
 
 
 class   UDPSocket : public Socket
@@ -58,6 +97,13 @@ class   UDPSocket : public Socket
         /* Էӷʽ(UDP Socket)һݱԴַͽݳ */                
         OS_Error    RecvFrom(UInt32* outRemoteAddr, UInt16* outRemotePort,
                      void* ioBuffer, UInt32 inBufLen, UInt32* outRecvLen);
+
+        //
+        // Receives whatever datagrams are waiting, up to UDPRecvBatch::kMaxPackets,
+        // with one recvmmsg call (or a recvfrom loop where the kernel doesn't have
+        // recvmmsg). Never blocks. Returns EAGAIN if there was nothing to receive;
+        // a batch that comes back less than full means the socket is drained.
+        OS_Error    RecvMultiple(UDPRecvBatch* ioBatch);
         
         //A UDP socket may or may not have a demuxer() associated with it. The demuxer
         //is a data structure so the socket can associate incoming data with the proper
@@ -71,6 +117,8 @@ class   UDPSocket : public Socket
         UDPDemuxer* fDemuxer;
 		/* ͨUDP SocketMessage(Message handler)Socketַ */
         struct sockaddr_in  fMsgAddr;
+
+        static Bool16       sRecvmmsgUnsupported;
 };
 #endif // __UDPSOCKET_H__
 
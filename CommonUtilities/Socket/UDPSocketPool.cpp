@@ -16,71 +16,125 @@ LastUpdate:  2010-08-19
 
 
 #include "UDPSocketPool.h"
+#include "atomic.h"
 
 
+UDPSocketPairKey::UDPSocketPairKey(UDPSocketPair* inPair)
+:   fLocalAddr(inPair->fSocketA->GetLocalAddr()),
+    fLocalPort(inPair->fSocketA->GetLocalPort())
+{
+}
+
 /* ԴIPַͶ˿ڷ: һʱ,ͨѭҳҪĲdemuxerеUDPSocketPair;½ҪUDPSocketPair */
 UDPSocketPair* UDPSocketPool::GetUDPSocketPair(UInt32 inIPAddr, UInt16 inPort,
                                                 UInt32 inSrcIPAddr, UInt16 inSrcPort)
 {
-    OSMutexLocker locker(&fMutex);
-	/* source IP address or portһʱ,UDPSocketPairɵpool */
-    if ((inSrcIPAddr != 0) || (inSrcPort != 0))
+	/* source IP address or portһʱ,poolв */
+    if ((inSrcIPAddr == 0) && (inSrcPort == 0))
+        return this->CreateUDPSocketPair(inIPAddr, inPort);
+
+    //If port is specified, only the pair bound to that port will do, and the
+    //index by local port finds it. If it can't take this client there is NO WAY
+    //a socket pair can exist that matches the criteria.
+    if (inPort != 0)
     {
-        for (OSQueueIter qIter(&fUDPQueue); !qIter.IsDone(); qIter.Next())
         {
-            //If we find a pair that is a) on the right IP address, and b) doesn't
-            //have this source IP & port in the demuxer already, we can return this pair
-			/* ȡǰUDPSocketPairеQueue elemڵָ,μUDPSocketPairඨ */
-            UDPSocketPair* theElem = (UDPSocketPair*)qIter.GetCurrent()->GetEnclosingObject();
-			/* UDPSocketPairıصַָĵַ,Ҷ˿ҪôΪ0(󶨵Ķ˿ں),ҪôָĶ˿ں */
-            if ((theElem->fSocketA->GetLocalAddr() == inIPAddr) &&
-                ((inPort == 0) || (theElem->fSocketA->GetLocalPort() == inPort)))
+            OSMutexLocker locker(&fMutex);
+            UDPSocketPairKey theKey(inIPAddr, inPort);
+            UDPSocketPair* thePair = fPairTable.Map(&theKey);
+            if (thePair != NULL)
             {
-                //check to make sure this source IP & port is not already in the demuxer.
-                //If not, we can return this socket pair.
-				/* ûеõUDPSocketPairһUDP Socket(RTCP)UDPDemuxerָ(ûи),ҵָ,
-				   ָIPַͶ˿ûзTask,Ӽ, */
-                if ((theElem->fSocketB->GetDemuxer() == NULL) ||
-                    ((!theElem->fSocketB->GetDemuxer()->AddrInMap(0, 0)) &&
-                    (!theElem->fSocketB->GetDemuxer()->AddrInMap(inSrcIPAddr, inSrcPort))))
-                {
-                    theElem->fRefCount++;
-                    return theElem;
-                }
-                //If port is specified, there is NO WAY a socket pair can exist that matches
-                //the criteria (because caller wants a specific ip & port combination)
-				/* inPort,ֻһλ,,ζŲʧ,NULL */
-                else if (inPort != 0)
+                OSMutexLocker shardLocker(&fShards[thePair->fShardIndex].fMutex);
+                //a pair whose last reference is going away is as good as gone
+                if ((thePair->fRefCount == 0) || !this->CanShare(thePair, inIPAddr, inSrcIPAddr, inSrcPort))
                     return NULL;
+                thePair->fRefCount++;
+                return thePair;
             }
         }
+        return this->CreateUDPSocketPair(inIPAddr, inPort, this->GetShardIndex(inIPAddr, inPort));
+    }
+
+    //Otherwise any pair on the right IP address that doesn't have this client in
+    //its demuxer yet will do. Look for one in this client's shard.
+    UInt32 theShardIndex = this->GetShardIndex(inSrcIPAddr, inSrcPort);
+    Shard* theShard = &fShards[theShardIndex];
+    {
+        OSMutexLocker shardLocker(&theShard->fMutex);
+        UInt32 theNumPairs = theShard->fPairQueue.GetLength();
+        for (UInt32 x = 0; x < theNumPairs; x++)
+        {
+            OSQueueElem* theElem = theShard->fPairQueue.GetHead();
+            UDPSocketPair* thePair = (UDPSocketPair*)theElem->GetEnclosingObject();
+            if (this->CanShare(thePair, inIPAddr, inSrcIPAddr, inSrcPort))
+            {
+                thePair->fRefCount++;
+                return thePair;
+            }
+
+            //Move pairs that can't be shared out of the way of the next SETUP. They
+            //are on another IP address, or their demuxer takes everything (0,0).
+            theShard->fPairQueue.Remove(theElem);
+            theShard->fPairQueue.EnQueue(theElem);
+        }
     }
     //if we get here, there is no UDP Socket pair already in the pool that matches the specified criteria, so we have to create a new pair.
     //ǵ,˵ǰUDPSocketPairûзָ׼UDPSocketPair,ֻ½һ,pool
-    return this->CreateUDPSocketPair(inIPAddr, inPort);
+    return this->CreateUDPSocketPair(inIPAddr, inPort, theShardIndex);
+}
+
+//Called with the mutex of the pair's shard held
+Bool16 UDPSocketPool::CanShare(UDPSocketPair* inPair, UInt32 inIPAddr, UInt32 inSrcIPAddr, UInt16 inSrcPort)
+{
+    if (inPair->fSocketA->GetLocalAddr() != inIPAddr)
+        return false;
+
+    //check to make sure this source IP & port is not already in the demuxer.
+    //If not, we can return this socket pair.
+    return ((inPair->fSocketB->GetDemuxer() == NULL) ||
+            ((!inPair->fSocketB->GetDemuxer()->AddrInMap(0, 0)) &&
+            (!inPair->fSocketB->GetDemuxer()->AddrInMap(inSrcIPAddr, inSrcPort))));
 }
 
 /* עԭCritical_Section,UDPSocketPairü.ǵ,ֻеüΪ0ʱ,ŴӶɾȥԪ,UDPSocketPairʵ */
 void UDPSocketPool::ReleaseUDPSocketPair(UDPSocketPair* inPair)
 {
-    OSMutexLocker locker(&fMutex);
-    inPair->fRefCount--;
-    if (inPair->fRefCount == 0)
     {
-        fUDPQueue.Remove(&inPair->fElem);
-        this->DestructUDPSocketPair(inPair);
+        Shard* theShard = &fShards[inPair->fShardIndex];
+        OSMutexLocker shardLocker(&theShard->fMutex);
+        inPair->fRefCount--;
+        if (inPair->fRefCount > 0)
+            return;
+        theShard->fPairQueue.Remove(&inPair->fShardElem);
     }
+
+    OSMutexLocker locker(&fMutex);
+    fUDPQueue.Remove(&inPair->fElem);
+    fPairTable.Remove(inPair);
+    this->DestructUDPSocketPair(inPair);
+}
+
+UDPSocketPair*  UDPSocketPool::CreateUDPSocketPair(UInt32 inAddr, UInt16 inPort)
+{
+    //Pairs that aren't created for a client go round robin over the shards
+    UInt32 theShardIndex = (UInt32)atomic_add(&fNextShard, 1) & (kNumShards - 1);
+    return this->CreateUDPSocketPair(inAddr, inPort, theShardIndex);
 }
 
 /* UDP Socket Pair,󶨵ָIPַͶ˿.˿ڷʱ,ֻһΰ󶨳ɹ;˿Ϊʱ,
    ѭҿ԰ϵĶ˿.󷵻ذ󶨺UDP Socket Pair,򷵻NULL */
-UDPSocketPair*  UDPSocketPool::CreateUDPSocketPair(UInt32 inAddr, UInt16 inPort)
+UDPSocketPair*  UDPSocketPool::CreateUDPSocketPair(UInt32 inAddr, UInt16 inPort, UInt32 inShardIndex)
 {
-    OSMutexLocker locker(&fMutex);
+    //No lock is needed to set up and bind the new pair, only to add it to the pool
 	/* RTPSocketPool(μQTSServer.cpp)UDP Socket Pair,ӷȡRTCPʵָ벢ӦһUDPSocketPairʵ */
     UDPSocketPair* theElem = ConstructUDPSocketPair();
 	/* ȷɳɹ */
     Assert(theElem != NULL);
+
+    //Both sockets of a pair (RTP and RTCP) are watched by the same event thread
+    EventThread* theEventThread = Socket::PickEventThread();
+    theElem->fSocketA->SetEventThread(theEventThread);
+    theElem->fSocketB->SetEventThread(theEventThread);
 	/* ȷUDP Socket Pair˵UDPSocketɳɹ, */
     if (theElem->fSocketA->Open() != OS_NoErr)
     {
@@ -95,7 +149,7 @@ UDPSocketPair*  UDPSocketPool::CreateUDPSocketPair(UInt32 inAddr, UInt16 inPort)
     }
     
     // Set socket options on these new sockets
-	/* RTPSocketPool(μQTSServer.cpp)UDP Socket Pairoptions,: UDP socketԵķbufferջС:
+	/* RTPSocketPool(μQTSServer.cpp)UDP Socket Pairoptions,: UDP socketԵķbufferջС:
 	һù̶,ڶҪ,:UDPSocketPairⷢRTPݵsocket bufferСΪ256Kֽ,Ԥֵʼ,Լ
 	̬RTCP socketbufferĴС */
     this->SetUDPSocketOptions(theElem);
@@ -127,10 +181,20 @@ UDPSocketPair*  UDPSocketPool::CreateUDPSocketPair(UInt32 inAddr, UInt16 inPort)
             {
 				/* ʾҵ˿ */
                 foundPair = true;
-				/* 󶨺UDP Socket PairUDPSocketPairĶ */
-                fUDPQueue.EnQueue(&theElem->fElem);
 				/* UDP Socket Pair1 */
                 theElem->fRefCount++;
+                theElem->fShardIndex = inShardIndex;
+                {
+                    //once in the pool, RTCPTask starts polling the pair
+                    OSMutexLocker locker(&fMutex);
+				    /* 󶨺UDP Socket PairUDPSocketPairĶ */
+                    fUDPQueue.EnQueue(&theElem->fElem);
+                    fPairTable.Add(theElem);
+                }
+                {
+                    OSMutexLocker shardLocker(&fShards[inShardIndex].fMutex);
+                    fShards[inShardIndex].fPairQueue.EnQueue(&theElem->fShardElem);
+                }
 				/* ظUDP Socket Pair */
                 return theElem;
             }
@@ -23,18 +23,51 @@ LastUpdate:  2010-08-19
 #include "UDPSocket.h"
 #include "OSMutex.h"
 #include "OSQueue.h"
+#include "OSHashTable.h"
 
 
 class UDPSocketPair;
 
+//IMPLEMENTATION ONLY:
+//Key of the index of pairs by local address & port (of the RTP socket)
+class UDPSocketPairKey
+{
+    private:
+
+        UDPSocketPairKey(UInt32 inLocalAddr, UInt16 inLocalPort)
+            :   fLocalAddr(inLocalAddr), fLocalPort(inLocalPort) {}
+        UDPSocketPairKey(UDPSocketPair* inPair);
+        ~UDPSocketPairKey() {}
+
+        UInt32      GetHashKey()        { return (fLocalAddr << 16) + fLocalPort; }
+
+        friend int operator ==(const UDPSocketPairKey &key1, const UDPSocketPairKey &key2)
+        {
+            if ((key1.fLocalAddr == key2.fLocalAddr) &&
+                (key1.fLocalPort == key2.fLocalPort))
+                return true;
+            return false;
+        }
+
+        UInt32 fLocalAddr;
+        UInt16 fLocalPort;
+
+        friend class OSHashTable<UDPSocketPair,UDPSocketPairKey>;
+        friend class UDPSocketPool;
+};
+
+typedef OSHashTable<UDPSocketPair, UDPSocketPairKey> UDPSocketPairHashTable;
+
 class UDPSocketPool
 {
     public:
     
-        UDPSocketPool() : fMutex() {}
+        UDPSocketPool() : fPairTable(kPairHashTableSize), fMutex(), fNextShard(0) {}
         virtual ~UDPSocketPool() {}
         
         //Skanky(˷) access to member data
+        //fMutex only guards the queue of all pairs (which RTCPTask walks) and the
+        //index by local port. Finding a pair to share on a SETUP doesn't take it.
         OSMutex*    GetMutex()          { return &fMutex; }
         OSQueue*    GetSocketQueue()    { return &fUDPQueue; }
         
@@ -75,13 +108,37 @@ class UDPSocketPool
         enum
         {
             kLowestUDPPort = 6970,  //UInt16
-            kHighestUDPPort = 65535 //UInt16
+            kHighestUDPPort = 65535, //UInt16
+            kNumShards = 16,        //UInt32, must be a power of 2
+            kPairHashTableSize = 1024 //UInt32, a power of 2
+        };
+
+        //
+        // Pairs that can be shared through their demuxer are spread over kNumShards
+        // shards, each with its own lock. A client always looks in the same shard
+        // (picked by its address & port), and if nothing there will take it, a new
+        // pair goes into that shard. This way the pairs a SETUP has to probe stay
+        // few no matter how many pairs there are, and SETUPs of different clients
+        // rarely wait on each other.
+        struct Shard
+        {
+            OSMutex fMutex;
+            OSQueue fPairQueue;     // pairs of this shard, guarded by fMutex, as are their fRefCounts
         };
+
+        UInt32          GetShardIndex(UInt32 inAddr, UInt16 inPort)
+                            { return (inAddr ^ (inAddr >> 13) ^ (inPort >> 1)) & (kNumShards - 1); } // RTCP ports are all odd
+        Bool16          CanShare(UDPSocketPair* inPair, UInt32 inIPAddr, UInt32 inSrcIPAddr, UInt16 inSrcPort);
+        UDPSocketPair*  CreateUDPSocketPair(UInt32 inAddr, UInt16 inPort, UInt32 inShardIndex);
     
 		/* UDPSocketPairɵĶ */
         OSQueue fUDPQueue;
+        UDPSocketPairHashTable fPairTable;
 		/* UDPSocketPoolӦĻ */
         OSMutex fMutex;
+
+        Shard           fShards[kNumShards];
+        unsigned int    fNextShard;     // round robin, for pairs created without a client
 };
 
 /* UDPSocketϳUDPsocketPair,ΪһԪUDPSocket Pool,UDPSocketPoolͳһά͹ */
@@ -90,7 +147,8 @@ class UDPSocketPair
     public:
         
         UDPSocketPair(UDPSocket* inSocketA, UDPSocket* inSocketB)
-            : fSocketA(inSocketA), fSocketB(inSocketB), fRefCount(0), fElem() {fElem.SetEnclosingObject(this);/* Queue elemڵָ */}
+            : fSocketA(inSocketA), fSocketB(inSocketB), fRefCount(0), fElem(), fShardElem(), fShardIndex(0), fNextHashEntry(NULL)
+            {fElem.SetEnclosingObject(this);/* Queue elemڵָ */ fShardElem.SetEnclosingObject(this);}
         ~UDPSocketPair() {}
     
 		//accessors
@@ -106,8 +164,13 @@ class UDPSocketPair
         UInt32      fRefCount;
 		/* Ԫ */
         OSQueueElem fElem;
+        OSQueueElem fShardElem;
+        UInt32      fShardIndex;
+        UDPSocketPair* fNextHashEntry;
         
         friend class UDPSocketPool;
+        friend class UDPSocketPairKey;
+        friend class OSHashTable<UDPSocketPair,UDPSocketPairKey>;
 };
 #endif // __UDPSOCKETPOOL_H__
 
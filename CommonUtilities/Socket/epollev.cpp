@@ -0,0 +1,234 @@
+/***************************************************************************
+
+Copyright (c) 1999-2003 Apple Computer, Inc.  All Rights Reserved.
+2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 epollev.cpp
+Description: Linux epoll implementation of MacOS X event queue functions.
+Comment:     alternative to the select() shim in ev.cpp, see EPOLL_EVENTQUEUE
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-17
+LastUpdate:  2026-10-17
+
+****************************************************************************/
+
+
+#include "ev.h"
+
+#if EPOLL_EVENTQUEUE
+
+#define EV_DEBUGGING 0 //Enables a lot of printfs
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/errno.h>
+#include <sys/epoll.h>
+
+#include "OS.h"
+#include "OSHeaders.h"
+#include "OSThread.h"
+#include "OSMutex.h"
+#include "OSMemory.h"
+#include "MyAssert.h"
+
+//
+// Unlike select(), epoll keeps the interest set in the kernel, so there is no
+// fd_set to rescan, no MaxFDPos to maintain and no need to wake up the event
+// thread when a mask changes: epoll_ctl takes effect even while the event
+// thread sits in epoll_wait. Each fd is registered EPOLLONESHOT, which gives
+// the same "one event per modwatch" contract the select() shim provides by
+// clearing the fd out of its sets in constructeventreq.
+//
+// Every event queue is a separate epoll instance drained by exactly one
+// EventThread, so the harvested events need no locking.
+
+enum
+{
+    kMaxEventsPerWait = 256,    // ready fds harvested by one epoll_wait
+    kWaitTimeoutInMilSecs = 15000,
+    kMaxEventQueues = 64
+};
+
+struct EventQueue
+{
+    int                 fEpollFD;
+    struct epoll_event  fReturnedEvents[kMaxEventsPerWait];
+    int                 fNumEventsBackFromWait;/* number of ready fds returned by epoll_wait() */
+    int                 fCurrentEventPos;/* next entry of fReturnedEvents to hand out */
+};
+
+static EventQueue*          sEventQueues[kMaxEventQueues];
+static int                  sNumEventQueues = 0;
+static OSMutex              sEventQueuesMutex;
+
+static UInt32   epollmask(int which);
+static UInt64   packeventdata(int fd, void* cookie);
+
+
+void select_startevents()
+{
+    Assert(sNumEventQueues == 0);
+    (void)select_addeventqueue();
+}
+
+int select_addeventqueue()
+{
+    OSMutexLocker locker(&sEventQueuesMutex);
+    if (sNumEventQueues == kMaxEventQueues)
+        return -1;
+
+    // The size argument is only a hint (and ignored by modern kernels), but
+    // epoll_create is available on every 2.6 kernel we still support.
+    int theEpollFD = ::epoll_create(kMaxEventsPerWait);
+    AssertV(theEpollFD != -1, OSThread::GetErrno());
+    if (theEpollFD == -1)
+        return -1;
+
+    EventQueue* theQueue = NEW EventQueue;
+    theQueue->fEpollFD = theEpollFD;
+    theQueue->fNumEventsBackFromWait = 0;
+    theQueue->fCurrentEventPos = 0;
+
+    sEventQueues[sNumEventQueues] = theQueue;
+    return sNumEventQueues++;
+}
+
+int select_removeevent(int which, int inQueue)
+{
+    // Drop the fd from the interest set and close it right away. Any event for
+    // this fd that was already harvested by epoll_wait carries the old cookie,
+    // which EventThread::Entry fails to resolve once the EventContext has been
+    // unregistered, so an fd number reused by a new socket is never confused
+    // with the one we are closing here.
+    struct epoll_event theEvent;
+    ::memset(&theEvent, 0, sizeof(theEvent));
+    (void)::epoll_ctl(sEventQueues[inQueue]->fEpollFD, EPOLL_CTL_DEL, which, &theEvent);
+
+#if EV_DEBUGGING
+    qtss_printf("removeevent: Disabled %d \n", which);
+#endif
+
+    (void)::close(which);
+    return 0;
+}
+
+int select_watchevent(struct eventreq *req, int which, int inQueue)
+{
+    Assert(req->er_data != NULL);//event ID
+
+    struct epoll_event theEvent;
+    ::memset(&theEvent, 0, sizeof(theEvent));
+    theEvent.events = epollmask(which);
+    theEvent.data.u64 = packeventdata(req->er_handle, req->er_data);
+
+#if EV_DEBUGGING
+    qtss_printf("watchevent: Adding %d mask=%d\n", req->er_handle, which);
+#endif
+
+    int theEpollFD = sEventQueues[inQueue]->fEpollFD;
+    int theErr = ::epoll_ctl(theEpollFD, EPOLL_CTL_ADD, req->er_handle, &theEvent);
+    if ((theErr == -1) && (OSThread::GetErrno() == EEXIST))
+        theErr = ::epoll_ctl(theEpollFD, EPOLL_CTL_MOD, req->er_handle, &theEvent);
+
+    return (theErr == -1) ? OSThread::GetErrno() : 0;
+}
+
+int select_modwatch(struct eventreq *req, int which, int inQueue)
+{
+    Assert(req->er_data != NULL);//event ID
+
+    struct epoll_event theEvent;
+    ::memset(&theEvent, 0, sizeof(theEvent));
+    theEvent.events = epollmask(which);
+    theEvent.data.u64 = packeventdata(req->er_handle, req->er_data);
+
+#if EV_DEBUGGING
+    qtss_printf("modwatch: Rearming %d mask=%d\n", req->er_handle, which);
+#endif
+
+    // A context that has been cleaned up and given a new fd still believes
+    // watchevent was called, so fall back to adding the fd if it's not known.
+    int theEpollFD = sEventQueues[inQueue]->fEpollFD;
+    int theErr = ::epoll_ctl(theEpollFD, EPOLL_CTL_MOD, req->er_handle, &theEvent);
+    if ((theErr == -1) && (OSThread::GetErrno() == ENOENT))
+        theErr = ::epoll_ctl(theEpollFD, EPOLL_CTL_ADD, req->er_handle, &theEvent);
+
+    return (theErr == -1) ? OSThread::GetErrno() : 0;
+}
+
+// Fills out the eventreq for one entry returned by epoll_wait
+static int constructeventreq(struct eventreq* req, struct epoll_event* inEvent)
+{
+    UInt64 theData = inEvent->data.u64;
+    req->er_handle = (int)(theData & 0xFFFFFFFF);
+    req->er_data = (void*)(unsigned long)(PointerSizedInt)(theData >> 32);
+
+    // If the fd is readable (or has hung up / errored, which a read reports)
+    // deliver EV_RE, otherwise it can only have been armed for write.
+    if (inEvent->events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+        req->er_eventbits = EV_RE;
+    else
+        req->er_eventbits = EV_WR;
+
+#if EV_DEBUGGING
+    qtss_printf("waitevent: Found an fd: %d bits=%d\n", req->er_handle, req->er_eventbits);
+#endif
+    return 0;
+}
+
+int select_waitevent(struct eventreq *req, void* /*onlyForMacOSX*/, int inQueue)
+{
+    EventQueue* theQueue = sEventQueues[inQueue];
+
+    // Hand out whatever is left over from the last epoll_wait first. This is
+    // O(ready), not O(watched) like walking the returned fd_sets.
+    if (theQueue->fCurrentEventPos < theQueue->fNumEventsBackFromWait)
+        return constructeventreq(req, &theQueue->fReturnedEvents[theQueue->fCurrentEventPos++]);
+
+    theQueue->fCurrentEventPos = 0;
+    theQueue->fNumEventsBackFromWait = 0;
+
+#if EV_DEBUGGING
+    qtss_printf("waitevent: about to call epoll_wait\n");
+#endif
+
+    int theNumEvents = ::epoll_wait(theQueue->fEpollFD, theQueue->fReturnedEvents, kMaxEventsPerWait, kWaitTimeoutInMilSecs);
+
+#if EV_DEBUGGING
+    qtss_printf("waitevent: back from epoll_wait. Result = %d\n", theNumEvents);
+#endif
+
+    if (theNumEvents >= 0)
+    {
+        theQueue->fNumEventsBackFromWait = theNumEvents;
+        return EINTR;   //either we've timed out or gotten some events. Either way, force caller
+                        //to call waitevent again.
+    }
+
+    if (OSThread::GetErrno() == EINTR)
+        return EINTR;   // interrupted by a signal, just wait again
+
+    return theNumEvents;
+}
+
+// Converts EV_RE / EV_WR into a one shot epoll event mask
+UInt32 epollmask(int which)
+{
+    UInt32 theMask = EPOLLONESHOT;
+    if (which & EV_RE)
+        theMask |= EPOLLIN;
+    if (which & EV_WR)
+        theMask |= EPOLLOUT;
+    return theMask;
+}
+
+// The cookie handed to us by EventContext is its unique ID (a PointerSizedInt),
+// so the fd and the cookie both fit in the 64 bits of epoll_data.
+UInt64 packeventdata(int fd, void* cookie)
+{
+    return ((UInt64)(PointerSizedInt)(unsigned long)cookie << 32) | (UInt64)(unsigned int)fd;
+}
+
+#endif //EPOLL_EVENTQUEUE
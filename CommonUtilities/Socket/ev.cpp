@@ -15,6 +15,10 @@ LastUpdate:  2010-08-18
 ****************************************************************************/ 
 
 
+#include "ev.h"
+
+#if !EPOLL_EVENTQUEUE
+
 #define EV_DEBUGGING 0 //Enables a lot of printfs
 
 #include <stdio.h>
@@ -25,7 +29,6 @@ LastUpdate:  2010-08-18
 #include <sys/types.h>
 #include <sys/select.h>
 
-#include "ev.h"
 #include "OS.h"
 #include "OSHeaders.h"
 #include "OSThread.h"
@@ -83,8 +86,15 @@ void select_startevents()
     sMaxFDPos = sPipes[0];
 }
 
+// The select() shim keeps all of its state in one set of globals, so there is
+// only ever one event queue (and hence one EventThread).
+int select_addeventqueue()
+{
+    return -1;
+}
+
 /* ɾָsocket fd,sMaxFDPosMutex(1),socket fdsFDsToCloseArray[],ͬʱдpipe */
-int select_removeevent(int which)
+int select_removeevent(int which, int /*inQueue*/)
 {
 
     {
@@ -139,16 +149,16 @@ int select_removeevent(int which)
     return 0;
 }
 
-int select_watchevent(struct eventreq *req, int which)
+int select_watchevent(struct eventreq *req, int which, int inQueue)
 {
-    return select_modwatch(req, which);
+    return select_modwatch(req, which, inQueue);
 }
 
 /* EV_RE,ָeventreqļfd,дɾ;
    EV_WR,ָeventreqļfdд,Ӷɾ.
    ļsMaxFDPos,¼¼ID req->er_datasCookieArray[],дpipe
 */
-int select_modwatch(struct eventreq *req, int which)
+int select_modwatch(struct eventreq *req, int which, int /*inQueue*/)
 {
     {
         //Manipulating sMaxFDPos is not pre-emptive safe(ռȫ), so we have to wrap it in a mutex
@@ -229,7 +239,7 @@ int constructeventreq(struct eventreq* req, int fd, int event)
 }
 
 /* Ҫĺ:ʹselect()Ƽrd/wr socket,ȡevent,select()() */
-int select_waitevent(struct eventreq *req, void* /*onlyForMacOSX*/)
+int select_waitevent(struct eventreq *req, void* /*onlyForMacOSX*/, int /*inQueue*/)
 {
     //Check to see if we still have some select descriptors to process
     int theFDsProcessed = (int)sNumFDsProcessed;
@@ -458,3 +468,4 @@ bool selecthasdata()
         return true;//we've gotten a real event, return that to the caller
 }
 
+#endif //!EPOLL_EVENTQUEUE
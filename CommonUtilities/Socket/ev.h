@@ -44,13 +44,21 @@ struct eventreq
 
 typedef struct eventreq *er_t;
 
-
-
-int select_watchevent(struct eventreq *req, int which);
-int select_modwatch(struct eventreq *req, int which);/* ĵĺ */
-int select_waitevent(struct eventreq *req, void* onlyForMOSX);//ֱڸļϵȵevent,Linuxƽ̨û
+// Implemented by ev.cpp on top of select(), or by epollev.cpp on top of
+// epoll when EPOLL_EVENTQUEUE is set in PlatformHeader.h.
+//
+// inQueue selects the event queue an fd is watched by. select_startevents
+// creates queue 0, select_addeventqueue creates the next one and returns its
+// index, or -1 if the implementation only supports a single queue (select).
+// An fd must stay on the same queue from watchevent until removeevent.
+
+
+int select_watchevent(struct eventreq *req, int which, int inQueue = 0);
+int select_modwatch(struct eventreq *req, int which, int inQueue = 0);/* ĵĺ */
+int select_waitevent(struct eventreq *req, void* onlyForMOSX, int inQueue = 0);//ֱڸļϵȵevent,Linuxƽ̨û
 void select_startevents();
-int select_removeevent(int which);
+int select_addeventqueue();
+int select_removeevent(int which, int inQueue = 0);
 
 
 #endif /* _SYS_EV_H_ */
@@ -27,7 +27,7 @@ OSMutexRW       TaskThreadPool::sMutexRW;
 static char*    sTaskStateStr="live_"; //Alive
 
 Task::Task()
-:   fEvents(0), fUseThisThread(NULL), fWriteLock(false), fTimerHeapElem(), fTaskQueueElem()
+:   fEvents(0), fUseThisThread(NULL), fWriteLock(false), fTimerElem(), fTaskQueueElem()
 {
 #if DEBUG
     fInRunCount = 0;
@@ -36,7 +36,7 @@ Task::Task()
 
 	/* ݳԱڵ */
 	fTaskQueueElem.SetEnclosingObject(this);
-	fTimerHeapElem.SetEnclosingObject(this);
+	fTimerElem.SetEnclosingObject(this);
 
 }
 
@@ -109,7 +109,7 @@ void Task::Signal(EventFlags events)
             if (TASK_DEBUG) if (fTaskName[0] == 0) ::strcpy(fTaskName, " corrupt task");
             if (TASK_DEBUG) qtss_printf("Task::Signal enque TaskName=%s fUseThisThread=%lu q elem=%lu enclosing=%lu\n", fTaskName, (UInt32) fUseThisThread, (UInt32) &fTaskQueueElem, (UInt32) this);
 			/* ӦĶԪָ뵱ǰ߳ڵTask */
-            fUseThisThread->fTaskQueue.EnQueue(&fTaskQueueElem);
+            fUseThisThread->fSignalQueue.EnQueue(&fTaskQueueElem);
         }
         else /* ѯʽһ߳ */
         {
@@ -121,7 +121,7 @@ void Task::Signal(EventFlags events)
             if (TASK_DEBUG) if (fTaskName[0] == 0) ::strcpy(fTaskName, " corrupt task");
             if (TASK_DEBUG) qtss_printf("Task::Signal enque TaskName=%s thread=%lu q elem=%lu enclosing=%lu\n", fTaskName, (UInt32)TaskThreadPool::sTaskThreadArray[theThread],(UInt32) &fTaskQueueElem,(UInt32) this);
             /* ӦĶԪָ뵱ǰ߳ڵTask */
-			TaskThreadPool::sTaskThreadArray[theThread]->fTaskQueue.EnQueue(&fTaskQueueElem);
+			TaskThreadPool::sTaskThreadArray[theThread]->fSignalQueue.EnQueue(&fTaskQueueElem);
         }
     }
     else/* ԭTaskalive,ɶ²! */
@@ -140,7 +140,7 @@ void Task::GlobalUnlock()
 }
 
 
-/* WaitForTask(),ȴ,Task::Run(),ݺֵ:ظֵʱ,ɾ;Ϊ0ʱ,doneProcessingEvent=0;Ϊֵʱ,TimerHeapElemѯ */
+/* WaitForTask(),ȴ,Task::Run(),ݺֵ:ظֵʱ,ɾ;Ϊ0ʱ,doneProcessingEvent=0;Ϊֵʱ,TimerElemѯ */
 void TaskThread::Entry()
 {
 	//Taskָ
@@ -183,6 +183,7 @@ void TaskThread::Entry()
                 if (TASK_DEBUG) qtss_printf("TaskThread::Entry run global locked TaskName=%s CurMSec=%.3f thread=%ld task=%ld\n", theTask->fTaskName, OS::StartTimeMilli_Float() ,(SInt32) this,(SInt32) theTask);
                 
 				/* ȫ */
+                this->SetCachedMicroseconds(OS::Microseconds());
                 theTimeout = theTask->Run();
 				/*  */
                 theTask->fWriteLock = false;
@@ -193,9 +194,11 @@ void TaskThread::Entry()
                 if (TASK_DEBUG) qtss_printf("TaskThread::Entry run TaskName=%s CurMSec=%.3f thread=%ld task=%ld\n", theTask->fTaskName, OS::StartTimeMilli_Float(), (SInt32) this,(SInt32) theTask);
 
 				/* TaskRun() */
+                this->SetCachedMicroseconds(OS::Microseconds());
                 theTimeout = theTask->Run();
             
             }
+            this->SetCachedMicroseconds(OSThread::kNoCachedTime);
 #if DEBUG
             Assert(this->GetNumLocksHeld() == 0);
             theTask->fInRunCount--;
@@ -210,8 +213,8 @@ void TaskThread::Entry()
                      
                     theTask->fUseThisThread = NULL;
                     
-                    if (NULL != fHeap.Remove(&theTask->fTimerHeapElem)) 
-                        qtss_printf("TaskThread::Entry task still in heap before delete\n");
+                    if (NULL != fTimerWheel.Remove(&theTask->fTimerElem)) 
+                        qtss_printf("TaskThread::Entry task still in timer wheel before delete\n");
                     
                     if (NULL != theTask->fTaskQueueElem.InQueue())
                         qtss_printf("TaskThread::Entry task still in queue before delete\n");
@@ -248,11 +251,9 @@ void TaskThread::Entry()
             {
                 //note that if we get here, we don't reset theTask, so it will get passed into
                 //WaitForTask
-                if (TASK_DEBUG) qtss_printf("TaskThread::Entry insert TaskName=%s in timer heap thread=%lu elem=%lu task=%ld timeout=%.2f\n", theTask->fTaskName,  (UInt32) this, (UInt32) &theTask->fTimerHeapElem,(SInt32) theTask, (float)theTimeout / (float) 1000);
-                /* timer Heap elem */
-				theTask->fTimerHeapElem.SetValue(OS::Milliseconds() + theTimeout);
-				/* ղõtimer Heap elemOSHeapѵ */
-                fHeap.Insert(&theTask->fTimerHeapElem);
+                if (TASK_DEBUG) qtss_printf("TaskThread::Entry insert TaskName=%s in timer wheel thread=%lu elem=%lu task=%ld timeout=%.2f\n", theTask->fTaskName,  (UInt32) this, (UInt32) &theTask->fTimerElem,(SInt32) theTask, (float)theTimeout / (float) 1000);
+                theTask->fTimerElem.SetValue(OS::Milliseconds() + theTimeout);
+                fTimerWheel.Insert(&theTask->fTimerElem);
 				/* ıһfEventsֵ,һIdle bitλ,ǸTaskǸIdle Task */
                 (void)atomic_or(&theTask->fEvents, Task::kIdleEvent);
                 doneProcessingEvent = true;
@@ -282,26 +283,28 @@ void TaskThread::Entry()
     }
 }
 
-/* OSHeapеʱ,ѯʽȴTask,ɾȥسʱȴ */
+// Hands out the next task whose timer has expired, or else waits on the task
+// queue until a task is signalled or the next timer is due
 Task* TaskThread::WaitForTask()
 {
     while (true)
     {
-		/* ȡǰʱ */
         SInt64 theCurrentTime = OS::Milliseconds();
-        
-		/* OSHeapеСOSHeapElementԪǿ,ҴСǰʱ(Ѿִʱ),(ѯʽ)СԪӦ */
-        if ((fHeap.PeekMin() != NULL) && (fHeap.PeekMin()->GetValue() <= theCurrentTime))
-        {    
-            if (TASK_DEBUG) qtss_printf("TaskThread::WaitForTask found timer-task=%s thread %lu fHeap.CurrentHeapSize(%lu) taskElem = %lu enclose=%lu\n",((Task*)fHeap.PeekMin()->GetEnclosingObject())->fTaskName, (UInt32) this, fHeap.CurrentHeapSize(), (UInt32) fHeap.PeekMin(), (UInt32) fHeap.PeekMin()->GetEnclosingObject());
-            return (Task*)fHeap.ExtractMin()->GetEnclosingObject();
+
+        TimingWheelElem* theTimerElem = fTimerWheel.ExtractExpired(theCurrentTime);
+        if (theTimerElem != NULL)
+        {
+            if (TASK_DEBUG) qtss_printf("TaskThread::WaitForTask found timer-task=%s thread %lu fTimerWheel.CurrentWheelSize(%lu) taskElem = %lu enclose=%lu\n",((Task*)theTimerElem->GetEnclosingObject())->fTaskName, (UInt32) this, fTimerWheel.CurrentWheelSize(), (UInt32) theTimerElem, (UInt32) theTimerElem->GetEnclosingObject());
+            return (Task*)theTimerElem->GetEnclosingObject();
         }
-    
+
         //if there is an element waiting for a timeout, figure out how long we should wait.
-		/* ڱȵǰʱԪ(δִʱ),(Ҫȴ)ʱȴʱ */
+        //The wheel may hand us a time somewhat before the real expiration of a far away
+        //timer, in which case we just come back through here early.
         SInt64 theTimeout = 0;
-        if (fHeap.PeekMin() != NULL)
-            theTimeout = fHeap.PeekMin()->GetValue() - theCurrentTime;
+        SInt64 theNextExpiry = fTimerWheel.GetNextExpiry();
+        if (theNextExpiry != -1)
+            theTimeout = theNextExpiry - theCurrentTime;
         Assert(theTimeout >= 0);
         
         //
@@ -313,13 +316,21 @@ Task* TaskThread::WaitForTask()
 		if (theTimeout < 10) 
            theTimeout = 10;
             
+        //Run what was signalled to us first. If there is nothing, help out a
+        //peer that is stuck in a long Run() before going to sleep.
+        OSQueueElem* theElem = this->DeQueueTask();
+        if (theElem == NULL)
+            theElem = this->StealTask();
+
         //wait...
-		/* ɾȥصǰêԪصǰһԪ() */
-		/* ȴtheTimeout ʱӶȡ񷵻 */
-        OSQueueElem* theElem = fTaskQueue.DeQueueBlocking(this, (SInt32) theTimeout);
+        if (theElem == NULL)
+        {
+            fSignalQueue.Wait((SInt32) theTimeout);
+            theElem = this->DeQueueTask();
+        }
         if (theElem != NULL)
         {    
-            if (TASK_DEBUG) qtss_printf("TaskThread::WaitForTask found signal-task=%s thread %lu fTaskQueue.GetLength(%lu) taskElem = %lu enclose=%lu\n", ((Task*)theElem->GetEnclosingObject())->fTaskName,  (UInt32) this, fTaskQueue.GetQueue()->GetLength(), (UInt32)  theElem,  (UInt32)theElem->GetEnclosingObject() );
+            if (TASK_DEBUG) qtss_printf("TaskThread::WaitForTask found signal-task=%s thread %lu fTaskQueue.GetLength(%lu) taskElem = %lu enclose=%lu\n", ((Task*)theElem->GetEnclosingObject())->fTaskName,  (UInt32) this, fTaskQueue.GetLength(), (UInt32)  theElem,  (UInt32)theElem->GetEnclosingObject() );
             return (Task*)theElem->GetEnclosingObject();
         }
 
@@ -330,6 +341,95 @@ Task* TaskThread::WaitForTask()
     }   
 }
 
+// Only ever called by this thread. Other threads only take tasks away from
+// fTaskQueue, so if it looks empty without the lock, it is.
+OSQueueElem* TaskThread::DeQueueTask()
+{
+    this->MoveSignalledTasks();
+    if (fTaskQueue.GetLength() == 0)
+        return NULL;
+
+    OSMutexLocker locker(&fTaskQueueMutex);
+    return fTaskQueue.DeQueue();
+}
+
+void TaskThread::MoveSignalledTasks()
+{
+    OSQueueElem* theElem = fSignalQueue.DeQueueAll();
+    if (theElem == NULL)
+        return;
+
+    OSMutexLocker locker(&fTaskQueueMutex);
+    while (theElem != NULL)
+    {
+        OSQueueElem* theNext = theElem->Next();
+        fTaskQueue.EnQueue(theElem);
+        theElem = theNext;
+    }
+}
+
+// Looks for a task we may run in place of the thread it was signalled to.
+// Tasks that called ForceSameThread (or CallLocked) before going back on a
+// queue must run on that thread and are left alone. Peers with nothing queued
+// are skipped without touching their locks, so idle threads looking for work
+// don't contend with each other.
+OSQueueElem* TaskThread::StealTask()
+{
+    UInt32 theNumThreads = TaskThreadPool::sNumTaskThreads;
+    if ((theNumThreads < 2) || this->IsStopRequested())
+        return NULL;
+
+    for (UInt32 x = 1; x < theNumThreads; x++)
+    {
+        TaskThread* theVictim = TaskThreadPool::sTaskThreadArray[(fPoolIndex + x) % theNumThreads];
+        OSQueueElem* theStolen = NULL;
+
+        // The tasks the peer has already taken off its signal queue first, oldest
+        // first, those have been waiting the longest
+        if (theVictim->fTaskQueue.GetLength() > 0)
+        {
+            OSMutexLocker locker(&theVictim->fTaskQueueMutex);
+            OSQueue* theQueue = &theVictim->fTaskQueue;
+
+            UInt32 theNumScanned = 0;
+            for (OSQueueIter theIter(theQueue); !theIter.IsDone() && (theNumScanned < kMaxStealScan); theIter.Next(), theNumScanned++)
+            {
+                if (((Task*)theIter.GetCurrent()->GetEnclosingObject())->fUseThisThread == NULL)
+                {
+                    theStolen = theIter.GetCurrent();
+                    theQueue->Remove(theStolen);
+                    break;
+                }
+            }
+        }
+
+        // Then the ones it hasn't gotten around to yet. Anything we don't take goes
+        // back on its signal queue, which wakes the peer up if it went to sleep
+        // while we were holding on to them.
+        if ((theStolen == NULL) && !theVictim->fSignalQueue.IsEmpty())
+        {
+            OSQueueElem* theElem = theVictim->fSignalQueue.DeQueueAll();
+            while (theElem != NULL)
+            {
+                OSQueueElem* theNext = theElem->Next();
+                if ((theStolen == NULL) && (((Task*)theElem->GetEnclosingObject())->fUseThisThread == NULL))
+                    theStolen = theElem;
+                else
+                    theVictim->fSignalQueue.EnQueue(theElem);
+                theElem = theNext;
+            }
+        }
+
+        if (theStolen != NULL)
+        {
+            if (TASK_DEBUG) qtss_printf("TaskThread::StealTask TaskName=%s thread=%lu from thread=%lu\n", ((Task*)theStolen->GetEnclosingObject())->fTaskName, (UInt32) this, (UInt32) theVictim);
+            fNumTasksStolen++;
+            return theStolen;
+        }
+    }
+    return NULL;
+}
+
 /* TaskThreadPoolݳԱֵ,ἰʱǵֵ */
 TaskThread** TaskThreadPool::sTaskThreadArray = NULL;
 UInt32       TaskThreadPool::sNumTaskThreads = 0;
@@ -345,6 +445,7 @@ Bool16 TaskThreadPool::AddThreads(UInt32 numToAdd)
     for (UInt32 x = 0; x < numToAdd; x++)
     {
         sTaskThreadArray[x] = NEW TaskThread();
+        sTaskThreadArray[x]->fPoolIndex = x;
 		/* ½߳,μOSThread::Start() */
         sTaskThreadArray[x]->Start();
     }
@@ -365,10 +466,13 @@ void TaskThreadPool::RemoveThreads()
     //all the threads, signalling() each one
     for (UInt32 y = 0; y < sNumTaskThreads; y++)
 		/* μOSQueue::GetCond(), */
-        sTaskThreadArray[y]->fTaskQueue.GetCond()->Signal();
+        sTaskThreadArray[y]->fSignalQueue.Wake();
     
-    //Ok, now wait for the selected threads to terminate, deleting them and removing
-    //them from the queue.
+    //Ok, now wait for the selected threads to terminate. Only delete them once all
+    //of them are gone, a thread may still be looking for work in a peer's queue.
+    for (UInt32 w = 0; w < sNumTaskThreads; w++)
+        sTaskThreadArray[w]->StopAndWaitForThread();
+
     for (UInt32 z = 0; z < sNumTaskThreads; z++)
         delete sTaskThreadArray[z];
     
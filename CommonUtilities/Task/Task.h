@@ -20,7 +20,7 @@ LastUpdate:  2010-08-18
 #define __TASK_H__
 
 #include "OSQueue.h"
-#include "OSHeap.h"
+#include "TimingWheel.h"
 #include "OSThread.h"
 #include "OSMutexRW.h"
 
@@ -129,10 +129,9 @@ class Task
         volatile UInt32 fInRunCount;
 #endif
 
-        //This could later be optimized by using a timing wheel(ʱ) instead of a heap(),
-        //and that way we wouldn't need both a heap elem and a queue elem here (just queue elem)
-		/* ʱԪ */
-        OSHeapElem      fTimerHeapElem;
+        //Where the task waits in its TaskThread's timing wheel between the time
+        //Run() returns a timeout and the time that timeout expires
+        TimingWheelElem fTimerElem;
 
 		/* Ԫ,ÿΪһTask QueueеԪ */
         OSQueueElem     fTaskQueueElem;
@@ -150,41 +149,56 @@ class TaskThread : public OSThread  //refer to OSThread.h
     
         //Implementation detail: all tasks get run on TaskThreads.
         
-                        TaskThread() :  OSThread(), fTaskThreadPoolElem()
+                        TaskThread() :  OSThread(), fTaskThreadPoolElem(), fPoolIndex(0), fNumTasksStolen(0)
                                         {fTaskThreadPoolElem.SetEnclosingObject(this);}/* ̳߳صԪΪǰTask Thread */
 						virtual         ~TaskThread() { this->StopAndWaitForThread(); }
+
+        //Statistics, read without locking by whoever reports them
+        UInt32          GetQueueLength()        { return fTaskQueue.GetLength() + fSignalQueue.GetLength(); }
+        UInt32          GetNumTasksStolen()     { return fNumTasksStolen; }
            
     private:
     
 		/* Сĵȴʱ10ms */
         enum
         {
-            kMinWaitTimeInMilSecs = 10  //UInt32
+            kMinWaitTimeInMilSecs = 10, //UInt32
+            kMaxStealScan = 8           //UInt32, queued tasks a thief looks at in each peer
         };
 
 		/* member functions */
 
 		/* Ҫһ! */
-		/* WaitForTask()ȴ,Task::Run(),ݺֵ:ظֵʱ,ɾ;Ϊ0ʱ,doneProcessingEvent=0;Ϊֵʱ,TimerHeapElemѯ */
+		/* WaitForTask()ȴ,Task::Run(),ݺֵ:ظֵʱ,ɾ;Ϊ0ʱ,doneProcessingEvent=0;Ϊֵʱ,TimerElemѯ */
         virtual void    Entry();
-		/* OSHeapеʱ,ѯʽȴTask,ɾȥسʱȴ */
+		/* hands out the next task whose timer has expired, or waits on fSignalQueue for one */
         Task*           WaitForTask();
+        //Moves whatever has been signalled to us onto fTaskQueue, then takes the
+        //oldest task off it
+        OSQueueElem*    DeQueueTask();
+        void            MoveSignalledTasks();
+        //Takes a task that isn't tied to its thread off the queue of a busy peer
+        OSQueueElem*    StealTask();
 
 		/* data members */
         /* Task ThreadΪTask Thread poolеԪ */
         OSQueueElem     fTaskThreadPoolElem;
         
-		/* ҪϸοOSHeap.cpp */
-		/* ʱѯ */
-		//¼ʱĶѣWaitForTask 
-        OSHeap              fHeap;
-
-		/*ؼݽṹУTask Signal ֱӵ
-		fTaskQueue EnQueue Լ*/
-		/* Task ThreadҪĿ,õOSCond::Signal() */
-		/* ÿ̶߳ڲһOSQueue_Blocking ͵
-		У洢߳Ҫִе */
-        OSQueue_Blocking    fTaskQueue;
+        //Tasks that returned a timeout from Run() and wait for it to expire.
+        //Only this thread touches it, so it needs no locking.
+        TimingWheel         fTimerWheel;
+
+        //Task::Signal puts tasks on fSignalQueue without taking a lock. This thread
+        //moves them to fTaskQueue, where they wait their turn. Threads looking for
+        //work may steal from either; fTaskQueueMutex is only there for them.
+        OSQueue_MPSC        fSignalQueue;
+        OSQueue             fTaskQueue;
+        OSMutex             fTaskQueueMutex;
+
+        //Our index in TaskThreadPool::sTaskThreadArray, and the number of tasks
+        //we have taken off the queues of other threads
+        UInt32              fPoolIndex;
+        UInt32              fNumTasksStolen;
         
         
         friend class Task;
@@ -205,6 +219,9 @@ public:
     static void     SwitchPersonality( char *user = NULL, char *group = NULL);
 	/* ֹͣ,,ɾȥ߳ */
     static void     RemoveThreads();
+
+    static UInt32       GetNumThreads()             { return sNumTaskThreads; }
+    static TaskThread*  GetThread(UInt32 inIndex)   { Assert(inIndex < sNumTaskThreads); return sTaskThreadArray[inIndex]; }
     
 private:
 
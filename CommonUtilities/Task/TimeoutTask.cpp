@@ -33,88 +33,112 @@ void TimeoutTask::Initialize()
     
 }
 
-/* ʼݳԱ,fQueueElemTimeoutTaskThreadQueue */
+// Puts the task on a wheel of the TimeoutTaskThread
 TimeoutTask::TimeoutTask(Task* inTask, SInt64 inTimeoutInMilSecs)
-: fTask(inTask), fQueueElem()
+: fTask(inTask), fTimerElem()
 {
-	/* fQueueElemڵָ */
-	fQueueElem.SetEnclosingObject(this);
-	/* ݳԱfTimeoutInMilSecsfTimeoutInMilSecs */
-    this->SetTimeout(inTimeoutInMilSecs);
+	fTimerElem.SetEnclosingObject(this);
 	/* ûTask,ͽfTaskΪǰ */
     if (NULL == inTask)
 		fTask = (Task *) this;
 	/* עTimeoutTask::Initialize()ù */
     Assert(sThread != NULL); // this can happen if RunServer intializes tasks in the wrong order
 
-    OSMutexLocker locker(&sThread->fMutex);
-	/* fQueueElemTimeoutTaskThreadQueue */
-    sThread->fQueue.EnQueue(&fQueueElem);
+    //spread the tasks over the buckets by address
+    fBucketIndex = (UInt32)(((UInt64)this >> 4) % TimeoutTaskThread::kNumBuckets);
+    this->SetTimeout(inTimeoutInMilSecs);
 }
 
-/* ʹû,ӳʱȥʱ */
+// Takes the task off its wheel
 TimeoutTask::~TimeoutTask()
 {
-    OSMutexLocker locker(&sThread->fMutex);
-    sThread->fQueue.Remove(&fQueueElem);
+    TimeoutTaskThread::Bucket* theBucket = &sThread->fBuckets[fBucketIndex];
+    OSMutexLocker locker(&theBucket->fMutex);
+    theBucket->fWheel.Remove(&fTimerElem);
 }
 
 /* óʱʱ */
 void TimeoutTask::SetTimeout(SInt64 inTimeoutInMilSecs)
 {
+    TimeoutTaskThread::Bucket* theBucket = &sThread->fBuckets[fBucketIndex];
+    OSMutexLocker locker(&theBucket->fMutex);
+
+    SInt64 theCurTime = OS::Milliseconds();
     fTimeoutInMilSecs = inTimeoutInMilSecs;
     if (inTimeoutInMilSecs == 0)
         fTimeoutAtThisTime = 0;
     else
-        fTimeoutAtThisTime = OS::Milliseconds() + fTimeoutInMilSecs;
+        fTimeoutAtThisTime = theCurTime + fTimeoutInMilSecs;
+
+    //The timeout may be sooner than it was, so the task can't wait on the
+    //wheel for the old one
+    sThread->Schedule(this, theCurTime);
+}
+
+void TimeoutTaskThread::Schedule(TimeoutTask* inTask, SInt64 inCurTime)
+{
+    Bucket* theBucket = &fBuckets[inTask->fBucketIndex];
+    theBucket->fWheel.Remove(&inTask->fTimerElem);
+
+    //A task that never times out is looked at again every so often,
+    //in case RefreshTimeout has given it a timeout since
+    SInt64 theTime = inTask->fTimeoutAtThisTime;
+    if (theTime == 0)
+        theTime = inCurTime + kIntervalSeconds * 1000;
+
+    inTask->fTimerElem.SetValue(theTime);
+    theBucket->fWheel.Insert(&inTask->fTimerElem);
 }
 
 SInt64 TimeoutTaskThread::Run()
 {
-    //ok, check for timeouts now. Go through the whole queue
-    OSMutexLocker locker(&fMutex);
+    //ok, check for timeouts now. Only the tasks that are due on the wheels
+    //are looked at, one bucket at a time
     SInt64 curTime = OS::Milliseconds();
-	/* ֵĵҪ,μѭ */
-	SInt64 intervalMilli = kIntervalSeconds * 1000;//always default to 60 seconds but adjust to smallest interval > 0
-	/* TimeoutTask */
-	SInt64 taskInterval = intervalMilli;
-	
-	/* Queueѭ,ֱǰԪָΪʱֹͣ */
-    for (OSQueueIter iter(&fQueue); !iter.IsDone(); iter.Next())
+
+    for (UInt32 theIndex = 0; theIndex < kNumBuckets; theIndex++)
     {
-		/* õǰTimeoutTaskڵĶ */
-        TimeoutTask* theTimeoutTask = (TimeoutTask*)iter.GetCurrent()->GetEnclosingObject();
-        
-        //if it's time to time this task out, signal it
-		/* õĳʱʱ䵽ʱ,Task::kTimeoutEvent */
-        if ((theTimeoutTask->fTimeoutAtThisTime > 0) && (curTime >= theTimeoutTask->fTimeoutAtThisTime))
+        Bucket* theBucket = &fBuckets[theIndex];
+        OSMutexLocker locker(&theBucket->fMutex);
+
+        TimingWheelElem* theElem = NULL;
+        while ((theElem = theBucket->fWheel.ExtractExpired(curTime)) != NULL)
         {
+			/* õǰTimeoutTaskڵĶ */
+            TimeoutTask* theTimeoutTask = (TimeoutTask*)theElem->GetEnclosingObject();
+            SInt64 theTimeoutAtThisTime = theTimeoutTask->fTimeoutAtThisTime;
+
+            //if it's time to time this task out, signal it
+			/* õĳʱʱ䵽ʱ,Task::kTimeoutEvent */
+            if ((theTimeoutAtThisTime > 0) && (curTime >= theTimeoutAtThisTime))
+            {
 #if TIMEOUT_DEBUGGING
-            qtss_printf("TimeoutTask %ld timed out. Curtime = %"_64BITARG_"d, timeout time = %"_64BITARG_"d\n",(SInt32)theTimeoutTask, curTime, theTimeoutTask->fTimeoutAtThisTime);
+                qtss_printf("TimeoutTask %ld timed out. Curtime = %"_64BITARG_"d, timeout time = %"_64BITARG_"d\n",(SInt32)theTimeoutTask, curTime, theTimeoutAtThisTime);
 #endif
-			theTimeoutTask->fTask->Signal(Task::kTimeoutEvent);
-		}
-		else
-		{
-			/* 㻹ж೤ʱͿʼʱ? */
-			taskInterval = theTimeoutTask->fTimeoutAtThisTime - curTime;
-			/* ȴʱʱtaskInterval<ʵʵļʱintervalMilli,ΪDarwin,ҪintervalMilliֵ */
-			if ( (taskInterval > 0) && (theTimeoutTask->fTimeoutInMilSecs > 0) && (intervalMilli > taskInterval) )
-				/* עֵļ,ҪΪֵص */
-				intervalMilli = taskInterval + 1000; // set timeout to 1 second past this task's timeout
+                theTimeoutTask->fTask->Signal(Task::kTimeoutEvent);
+
+                //Keep signalling it until it goes away or is refreshed. A refresh
+                //can't move its timeout any sooner than this.
+                SInt64 theInterval = theTimeoutTask->fTimeoutInMilSecs;
+                if ((theInterval <= 0) || (theInterval > kIntervalSeconds * 1000))
+                    theInterval = kIntervalSeconds * 1000;
+                theElem->SetValue(curTime + theInterval);
+                theBucket->fWheel.Insert(theElem);
+            }
+            else
+            {
 #if TIMEOUT_DEBUGGING
-			qtss_printf("TimeoutTask %ld not being timed out. Curtime = %"_64BITARG_"d. timeout time = %"_64BITARG_"d\n", (SInt32)theTimeoutTask, curTime, theTimeoutTask->fTimeoutAtThisTime);
+                qtss_printf("TimeoutTask %ld not being timed out. Curtime = %"_64BITARG_"d. timeout time = %"_64BITARG_"d\n", (SInt32)theTimeoutTask, curTime, theTimeoutAtThisTime);
 #endif
-		}
-	}
+                //it has been refreshed since it was put on the wheel
+                this->Schedule(theTimeoutTask, curTime);
+            }
+        }
+    }
 	(void)this->GetEvents();//we must clear the event mask!
 	
 	OSThread::ThreadYield();
 	
-#if TIMEOUT_DEBUGGING
-	qtss_printf ("TimeoutTaskThread::Run interval seconds= %ld\n", (SInt32) intervalMilli/1000);
-#endif
-    
 	/* עֵ */
-    return intervalMilli;//don't delete me!
+    return kCheckIntervalMilli;//don't delete me!
 }
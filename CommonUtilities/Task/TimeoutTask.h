@@ -24,7 +24,7 @@ LastUpdate:  2010-08-18
 #include "StrPtrLen.h"
 #include "IdleTask.h"
 #include "OSThread.h"
-#include "OSQueue.h"
+#include "TimingWheel.h"
 #include "OSMutex.h"
 #include "OS.h"
 
@@ -32,26 +32,48 @@ LastUpdate:  2010-08-18
 
 #define TIMEOUT_DEBUGGING 0 //messages to help debugging timeouts
 
+class TimeoutTask;
+
+//
+// TimeoutTasks are kept on timing wheels, by the time they were last known to
+// time out at. RefreshTimeout only moves fTimeoutAtThisTime forward and doesn't
+// touch the wheel, so when a task comes due on the wheel its real timeout is
+// checked, and the task is put back on the wheel for that time if it has been
+// refreshed in the meantime. A pass of the thread therefore costs as much as
+// the tasks it finds due, not as much as all the tasks there are.
+//
+// The tasks are spread over kNumBuckets wheels with a lock each, so that tasks
+// being created and deleted don't wait on each other or on the thread.
 class TimeoutTaskThread : public IdleTask
 {
     public:
     
         //All timeout tasks get timed out from this thread
-                    TimeoutTaskThread() : IdleTask(), fMutex() {this->SetTaskName("TimeoutTask");}
+                    TimeoutTaskThread() : IdleTask() {this->SetTaskName("TimeoutTask");}
         virtual     ~TimeoutTaskThread(){}
 
     private:
         
-        //this thread runs every minute and checks for timeouts
         enum
         {
-			/* used in TimeoutTaskThread::Run() */
-            kIntervalSeconds = 60   //UInt32
+            kNumBuckets = 16,           //UInt32
+            kCheckIntervalMilli = 1000, //UInt32, how often the wheels are looked at
+            kIntervalSeconds = 60       //UInt32, how often tasks that have timed out or never time out are looked at again
+        };
+
+        struct Bucket
+        {
+            OSMutex         fMutex;
+            TimingWheel     fWheel;
         };
 
         virtual SInt64          Run();
-        OSMutex                 fMutex;
-        OSQueue                 fQueue;
+
+        //Puts the task on its wheel, or back on it at the right time
+        //if it already is. Called with the bucket's mutex held.
+        void                    Schedule(TimeoutTask* inTask, SInt64 inCurTime);
+
+        Bucket                  fBuckets[kNumBuckets];
         
         friend class TimeoutTask;
 };
@@ -88,8 +110,10 @@ class TimeoutTask
         SInt64      fTimeoutAtThisTime;
 		/* ʱʱ(ʱ) */
         SInt64      fTimeoutInMilSecs;
-        //for putting on our global queue of timeout tasks
-        OSQueueElem fQueueElem;
+        //for putting on a wheel of the timeout thread. Its value is when the
+        //thread next looks at this task, never later than fTimeoutAtThisTime
+        TimingWheelElem fTimerElem;
+        UInt32      fBucketIndex;
         
         static TimeoutTaskThread*   sThread;
         
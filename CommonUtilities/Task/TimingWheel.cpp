@@ -0,0 +1,349 @@
+/***************************************************************************
+
+Copyright (c) 1999-2003 Apple Computer, Inc.  All Rights Reserved.
+2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 TimingWheel.cpp
+Description: Provide a hierarchical timing wheel with millisecond granularity
+             to use as a task timer.
+Comment:     replaces the OSHeap that TaskThread used to keep its timers in
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-17
+LastUpdate:  2026-10-17
+
+****************************************************************************/
+
+
+#include <string.h>
+
+#include "TimingWheel.h"
+#include "OS.h"
+#include "MyAssert.h"
+
+
+TimingWheel::TimingWheel()
+:   fExpired(NULL),
+    fExpiredTail(NULL),
+    fNumElems(0),
+    fCurrentTick(OS::Milliseconds())
+{
+    ::memset(fLevel0, 0, sizeof(fLevel0));
+    ::memset(fLevels, 0, sizeof(fLevels));
+    ::memset(fLevelCount, 0, sizeof(fLevelCount));
+}
+
+void TimingWheel::Insert(TimingWheelElem* inElem)
+{
+    Assert(inElem != NULL);
+    Assert(inElem->fCurrentWheel == NULL);
+
+    inElem->fCurrentWheel = this;
+    this->Place(inElem);
+    fNumElems++;
+}
+
+TimingWheelElem* TimingWheel::Remove(TimingWheelElem* inElem)
+{
+    Assert(inElem != NULL);
+    if (inElem->fCurrentWheel != this)
+        return NULL;
+
+    if (fExpiredTail == inElem)
+        fExpiredTail = inElem->fPrev;
+
+    if (inElem->fPrev != NULL)
+        inElem->fPrev->fNext = inElem->fNext;
+    else
+        *inElem->fList = inElem->fNext;
+    if (inElem->fNext != NULL)
+        inElem->fNext->fPrev = inElem->fPrev;
+
+    fLevelCount[inElem->fLevel]--;
+    fNumElems--;
+
+    inElem->fNext = NULL;
+    inElem->fPrev = NULL;
+    inElem->fList = NULL;
+    inElem->fCurrentWheel = NULL;
+    return inElem;
+}
+
+TimingWheelElem* TimingWheel::ExtractExpired(SInt64 inCurrentTime)
+{
+    this->Advance(inCurrentTime);
+
+    TimingWheelElem* theElem = fExpired;
+    if (theElem == NULL)
+        return NULL;
+
+    fExpired = theElem->fNext;
+    if (fExpired != NULL)
+        fExpired->fPrev = NULL;
+    else
+        fExpiredTail = NULL;
+
+    fLevelCount[kExpiredList]--;
+    fNumElems--;
+
+    theElem->fNext = NULL;
+    theElem->fList = NULL;
+    theElem->fCurrentWheel = NULL;
+    return theElem;
+}
+
+SInt64 TimingWheel::GetNextExpiry()
+{
+    if (fExpired != NULL)
+        return fCurrentTick - 1; // due already
+    if (fNumElems == 0)
+        return -1;
+
+    SInt64 theNextExpiry = -1;
+
+    // Everything in the first wheel expires within the next kLevel0Slots ms,
+    // one slot per millisecond, so the first busy slot is exact.
+    if (fLevelCount[0] > 0)
+    {
+        for (SInt64 theTick = fCurrentTick; theTick < fCurrentTick + kLevel0Slots; theTick++)
+        {
+            if (fLevel0[theTick & kLevel0Mask] != NULL)
+            {
+                theNextExpiry = theTick;
+                break;
+            }
+        }
+    }
+
+    // For the other wheels all we know is when the first busy slot gets cascaded,
+    // and nothing in it can expire before that.
+    UInt32 theShift = kLevel0Bits;
+    for (UInt32 theLevel = 1; theLevel < kNumLevels; theLevel++, theShift += kLevelBits)
+    {
+        if (fLevelCount[theLevel] == 0)
+            continue;
+
+        SInt64 theSlotTick = fCurrentTick >> theShift;
+        SInt64 theCascadeTime = -1;
+
+        // The current slot gets cascaded at fCurrentTick if that is on a slot
+        // boundary. Otherwise it has already been, and whatever is in there now
+        // is a whole turn of this wheel away.
+        if (fLevels[theLevel - 1][theSlotTick & kLevelMask] != NULL)
+        {
+            if ((fCurrentTick & (((SInt64)1 << theShift) - 1)) == 0)
+                theCascadeTime = fCurrentTick;
+            else
+                theCascadeTime = (theSlotTick + kLevelSlots) << theShift;
+        }
+
+        for (SInt64 theSlot = theSlotTick + 1; theSlot < theSlotTick + kLevelSlots; theSlot++)
+        {
+            if (fLevels[theLevel - 1][theSlot & kLevelMask] != NULL)
+            {
+                if ((theCascadeTime == -1) || ((theSlot << theShift) < theCascadeTime))
+                    theCascadeTime = theSlot << theShift;
+                break;
+            }
+        }
+
+        if ((theCascadeTime != -1) && ((theNextExpiry == -1) || (theCascadeTime < theNextExpiry)))
+            theNextExpiry = theCascadeTime;
+    }
+
+    return theNextExpiry;
+}
+
+// Processes every millisecond up to and including inCurrentTime
+void TimingWheel::Advance(SInt64 inCurrentTime)
+{
+    if (inCurrentTime < fCurrentTick - 1)
+        this->Rebuild(inCurrentTime); // the clock went backwards
+
+    while (fCurrentTick <= inCurrentTime)
+    {
+        // Nothing left to time out, just catch up
+        if (fNumElems == fLevelCount[kExpiredList])
+        {
+            fCurrentTick = inCurrentTime + 1;
+            break;
+        }
+
+        if ((fCurrentTick & kLevel0Mask) == 0)
+            this->Cascade();
+
+        // Nothing can expire before the next cascade, skip ahead to it
+        if (fLevelCount[0] == 0)
+        {
+            SInt64 theNextCascade = (fCurrentTick | kLevel0Mask) + 1;
+            fCurrentTick = (theNextCascade <= inCurrentTime) ? theNextCascade : inCurrentTime + 1;
+            continue;
+        }
+
+        this->MoveSlotToExpired(&fLevel0[fCurrentTick & kLevel0Mask]);
+        fCurrentTick++;
+    }
+}
+
+// Called when fCurrentTick is on a boundary of the first wheel. Moves the
+// elements of the current slot of the next wheel down, and so on up for as
+// long as the wheel above is on a boundary too.
+void TimingWheel::Cascade()
+{
+    SInt64 theSlotTick = fCurrentTick >> kLevel0Bits;
+    for (UInt32 theLevel = 1; theLevel < kNumLevels; theLevel++)
+    {
+        UInt32 theIndex = (UInt32)(theSlotTick & kLevelMask);
+        TimingWheelElem* theElem = this->DetachList(&fLevels[theLevel - 1][theIndex], theLevel);
+        while (theElem != NULL)
+        {
+            TimingWheelElem* theNext = theElem->fNext;
+            this->Place(theElem);
+            theElem = theNext;
+        }
+
+        if (theIndex != 0)
+            break;
+        theSlotTick >>= kLevelBits;
+    }
+}
+
+// Takes everything out and puts it back relative to inCurrentTime
+void TimingWheel::Rebuild(SInt64 inCurrentTime)
+{
+    TimingWheelElem* theAll = this->DetachList(&fExpired, kExpiredList);
+    fExpiredTail = NULL;
+
+    for (UInt32 x = 0; x < kLevel0Slots; x++)
+    {
+        TimingWheelElem* theElem = this->DetachList(&fLevel0[x], 0);
+        while (theElem != NULL)
+        {
+            TimingWheelElem* theNext = theElem->fNext;
+            theElem->fNext = theAll;
+            theAll = theElem;
+            theElem = theNext;
+        }
+    }
+    for (UInt32 theLevel = 1; theLevel < kNumLevels; theLevel++)
+    {
+        for (UInt32 y = 0; y < kLevelSlots; y++)
+        {
+            TimingWheelElem* theElem = this->DetachList(&fLevels[theLevel - 1][y], theLevel);
+            while (theElem != NULL)
+            {
+                TimingWheelElem* theNext = theElem->fNext;
+                theElem->fNext = theAll;
+                theAll = theElem;
+                theElem = theNext;
+            }
+        }
+    }
+
+    fCurrentTick = inCurrentTime;
+    while (theAll != NULL)
+    {
+        TimingWheelElem* theNext = theAll->fNext;
+        this->Place(theAll);
+        theAll = theNext;
+    }
+}
+
+// Puts an element on the right list for its value. Doesn't touch fNumElems.
+void TimingWheel::Place(TimingWheelElem* inElem)
+{
+    SInt64 theExpiry = inElem->fValue;
+    SInt64 theDelta = theExpiry - fCurrentTick;
+
+    if (theDelta < 0)
+    {
+        inElem->fNext = NULL;
+        inElem->fPrev = fExpiredTail;
+        if (fExpiredTail != NULL)
+            fExpiredTail->fNext = inElem;
+        else
+            fExpired = inElem;
+        fExpiredTail = inElem;
+
+        inElem->fList = &fExpired;
+        inElem->fLevel = kExpiredList;
+        fLevelCount[kExpiredList]++;
+        return;
+    }
+
+    if (theDelta < kLevel0Slots)
+    {
+        this->AddToList(inElem, 0, &fLevel0[theExpiry & kLevel0Mask]);
+        return;
+    }
+
+    // Further out than the top wheel reaches. Park it in the last slot the top
+    // wheel has; it gets placed again, with its real value, when that slot is cascaded.
+    if (theDelta >= kMaxDelta)
+    {
+        theExpiry = fCurrentTick + kMaxDelta - 1;
+        theDelta = kMaxDelta - 1;
+    }
+
+    UInt32 theShift = kLevel0Bits;
+    UInt32 theLevel = 1;
+    while (theDelta >= ((SInt64)1 << (theShift + kLevelBits)))
+    {
+        theShift += kLevelBits;
+        theLevel++;
+    }
+    Assert(theLevel < kNumLevels);
+
+    this->AddToList(inElem, theLevel, &fLevels[theLevel - 1][(theExpiry >> theShift) & kLevelMask]);
+}
+
+void TimingWheel::AddToList(TimingWheelElem* inElem, UInt32 inLevel, TimingWheelElem** inList)
+{
+    inElem->fPrev = NULL;
+    inElem->fNext = *inList;
+    if (*inList != NULL)
+        (*inList)->fPrev = inElem;
+    *inList = inElem;
+
+    inElem->fList = inList;
+    inElem->fLevel = inLevel;
+    fLevelCount[inLevel]++;
+}
+
+// Appends a slot of the first wheel to the expired list
+void TimingWheel::MoveSlotToExpired(TimingWheelElem** inSlot)
+{
+    TimingWheelElem* theElem = this->DetachList(inSlot, 0);
+    while (theElem != NULL)
+    {
+        TimingWheelElem* theNext = theElem->fNext;
+        theElem->fNext = NULL;
+        theElem->fPrev = fExpiredTail;
+        if (fExpiredTail != NULL)
+            fExpiredTail->fNext = theElem;
+        else
+            fExpired = theElem;
+        fExpiredTail = theElem;
+
+        theElem->fList = &fExpired;
+        theElem->fLevel = kExpiredList;
+        fLevelCount[kExpiredList]++;
+        theElem = theNext;
+    }
+}
+
+// Empties a list and returns its first element. The elements are still linked
+// through fNext, but belong to no list.
+TimingWheelElem* TimingWheel::DetachList(TimingWheelElem** inList, UInt32 inLevel)
+{
+    TimingWheelElem* theFirst = *inList;
+    *inList = NULL;
+
+    for (TimingWheelElem* theElem = theFirst; theElem != NULL; theElem = theElem->fNext)
+    {
+        theElem->fList = NULL;
+        theElem->fPrev = NULL;
+        fLevelCount[inLevel]--;
+    }
+    return theFirst;
+}
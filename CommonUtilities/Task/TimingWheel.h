@@ -0,0 +1,149 @@
+/***************************************************************************
+
+Copyright (c) 1999-2003 Apple Computer, Inc.  All Rights Reserved.
+2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 TimingWheel.h
+Description: Provide a hierarchical timing wheel with millisecond granularity
+             to use as a task timer.
+Comment:     replaces the OSHeap that TaskThread used to keep its timers in
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-17
+LastUpdate:  2026-10-17
+
+****************************************************************************/
+
+
+#ifndef __TIMINGWHEEL_H__
+#define __TIMINGWHEEL_H__
+
+#include "OSHeaders.h"
+
+class TimingWheelElem;
+
+//
+// Elements are kept in one of four wheels. The first one has a slot per
+// millisecond for the next 256 milliseconds, each of the other three has 64
+// slots that each cover 64 times the span of a slot in the wheel below it.
+// Insert and Remove are O(1); elements move down one wheel at a time as their
+// deadline gets closer, which costs O(1) per element and wheel ("cascading").
+//
+// Unlike OSHeap, which is driven by whatever it finds at its top, the wheel
+// needs to be told what time it is. ExtractExpired does that. Time never runs
+// backwards for the wheel: if the clock does, the wheel is rebuilt around the
+// new time.
+//
+// Like OSHeap there is no locking here, the owner of the wheel must provide it.
+
+class TimingWheel
+{
+    public:
+
+        enum
+        {
+            kLevel0Bits     = 8,                    // 256 one millisecond slots
+            kLevelBits      = 6,                    // 64 slots in every other wheel
+            kNumLevels      = 4                     // covers 2^26 ms, a little over 18 hours
+        };
+
+        TimingWheel();
+        ~TimingWheel() {}
+
+        //ACCESSORS
+
+        UInt32              CurrentWheelSize()  { return fNumElems; }
+
+        //
+        // Returns the time (in milliseconds, same time base as the element
+        // values) at which the earliest element can expire, or -1 if the wheel
+        // is empty. Elements far out in the future are only known to the slot,
+        // not to the millisecond, so this may be early but it is never late.
+        // Callers are expected to call ExtractExpired at that time and ask again.
+        SInt64              GetNextExpiry();
+
+        //MODIFIERS
+
+        //
+        // Adds an element that expires at inElem->GetValue(). Elements that are
+        // already due are handed out by the next call to ExtractExpired.
+        void                Insert(TimingWheelElem* inElem);
+
+        //
+        // Removes and returns the specified element, or returns NULL if the
+        // element isn't in this wheel
+        TimingWheelElem*    Remove(TimingWheelElem* inElem);
+
+        //
+        // Brings the wheel up to inCurrentTime, then removes and returns one
+        // element whose value is <= inCurrentTime, or NULL if none are due.
+        // Elements come out in the order the wheel found them to be due, there
+        // is no particular order among those due in the same millisecond.
+        TimingWheelElem*    ExtractExpired(SInt64 inCurrentTime);
+
+    private:
+
+        enum
+        {
+            kLevel0Slots    = 1 << kLevel0Bits,
+            kLevel0Mask     = kLevel0Slots - 1,
+            kLevelSlots     = 1 << kLevelBits,
+            kLevelMask      = kLevelSlots - 1,
+            kExpiredList    = kNumLevels,           // the list elements wait on once due
+            kMaxDelta       = 1 << (kLevel0Bits + (kNumLevels - 1) * kLevelBits)
+        };
+
+        void                Advance(SInt64 inCurrentTime);
+        void                Cascade();
+        void                Rebuild(SInt64 inCurrentTime);
+        void                Place(TimingWheelElem* inElem);
+        void                AddToList(TimingWheelElem* inElem, UInt32 inLevel, TimingWheelElem** inList);
+        void                MoveSlotToExpired(TimingWheelElem** inSlot);
+        TimingWheelElem*    DetachList(TimingWheelElem** inList, UInt32 inLevel);
+
+        TimingWheelElem*    fLevel0[kLevel0Slots];
+        TimingWheelElem*    fLevels[kNumLevels - 1][kLevelSlots];
+
+        // elements that are due, with a tail pointer so they stay in order
+        TimingWheelElem*    fExpired;
+        TimingWheelElem*    fExpiredTail;
+
+        UInt32              fLevelCount[kNumLevels + 1];
+        UInt32              fNumElems;
+
+        // the next millisecond to process. Everything before it has been moved to fExpired
+        SInt64              fCurrentTick;
+};
+
+class TimingWheelElem
+{
+    public:
+        TimingWheelElem(void* enclosingObject = NULL)
+            : fValue(0), fEnclosingObject(enclosingObject), fNext(NULL), fPrev(NULL),
+              fList(NULL), fLevel(0), fCurrentWheel(NULL) {}
+        ~TimingWheelElem() {}
+
+        //accessors and modifiers
+        void    SetValue(SInt64 newValue)       { fValue = newValue; }
+        SInt64  GetValue()                      { return fValue; }
+        void*   GetEnclosingObject()            { return fEnclosingObject; }
+        void    SetEnclosingObject(void* obj)   { fEnclosingObject = obj; }
+        Bool16  IsMemberOfAnyWheel()            { return fCurrentWheel != NULL; }
+
+    private:
+
+        // the expiration time, in milliseconds
+        SInt64              fValue;
+        void*               fEnclosingObject;
+
+        // slot lists are doubly linked so that Remove is O(1)
+        TimingWheelElem*    fNext;
+        TimingWheelElem*    fPrev;
+        TimingWheelElem**   fList;      // head of the slot (or expired list) we are on
+        UInt32              fLevel;     // which wheel that list belongs to
+        TimingWheel*        fCurrentWheel;
+
+        friend class TimingWheel;
+};
+
+#endif //__TIMINGWHEEL_H__
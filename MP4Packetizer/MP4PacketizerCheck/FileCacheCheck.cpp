@@ -0,0 +1,299 @@
+/***************************************************************************
+
+Copyright (c) 1999-2003 Apple Computer, Inc.  All Rights Reserved.
+2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 FileCacheCheck.cpp
+Description: Opens movies through QTRTPFile over and over, from one thread and
+             from several, and checks the movie cache's hits, misses, evictions
+             and mod date checks against what they should be.
+Comment:     usage: MP4PacketizerCheck filecache movie ...
+             The first movie is copied to a temporary file, whose mod date
+             is changed; the movies themselves are only read.
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-17
+LastUpdate:  2026-10-17
+
+****************************************************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <utime.h>
+#include <sys/stat.h>
+
+#include "SafeStdLib.h"
+#include "OS.h"
+#include "OSThread.h"
+#include "OSMemory.h"
+#include "QTRTPFile.h"
+#include "CheckDriver.h"
+#include "MP4PacketizerCheck.h"
+
+
+enum
+{
+    kNumCachedOpens     = 1000,     //UInt32, per movie
+    kNumOpenThreads     = 8,        //UInt32
+    kNumThreadOpens     = 200,      //UInt32, per thread
+    kNumThreadFiles     = 2         //UInt32, open at once, per thread
+};
+
+//
+// What a DESCRIBE does with a movie: open it, and get its SDP.
+static Bool16 OpenMovie(const char * moviePath, QTRTPFile ** rtpFile)
+{
+    // General vars
+    int             sdpLength;
+
+    *rtpFile = NEW QTRTPFile();
+    if( ((*rtpFile)->Initialize(moviePath) != QTRTPFile::errNoError) || ((*rtpFile)->GetSDPFile(&sdpLength) == NULL) )
+    {
+        delete *rtpFile;
+        *rtpFile = NULL;
+        return false;
+    }
+
+    return true;
+}
+
+//
+// Opens and closes a movie, and returns how long the open took, in microseconds.
+static SInt64 TimeOpen(const char * moviePath)
+{
+    // General vars
+    QTRTPFile       *rtpFile;
+    SInt64          startTime = OS::Microseconds();
+
+    if( !OpenMovie(moviePath, &rtpFile) )
+    {
+        CheckFailed("%s: can't open the movie", moviePath);
+        return 0;
+    }
+
+    SInt64 openTime = OS::Microseconds() - startTime;
+    delete rtpFile;
+    return openTime;
+}
+
+//
+// The cache counters must have moved by exactly this much since they were last checked.
+static UInt64   sLastHits = 0, sLastMisses = 0, sLastEvictions = 0;
+
+static void CheckCounters(const char * step, UInt64 hits, UInt64 misses, UInt64 evictions)
+{
+    UInt64  newHits = QTRTPFile::GetFileCacheHits() - sLastHits;
+    UInt64  newMisses = QTRTPFile::GetFileCacheMisses() - sLastMisses;
+    UInt64  newEvictions = QTRTPFile::GetFileCacheEvictions() - sLastEvictions;
+
+    if( (newHits != hits) || (newMisses != misses) || (newEvictions != evictions) )
+        CheckFailed("%s: %" _64BITARG_ "u hits, %" _64BITARG_ "u misses, %" _64BITARG_ "u evictions, "
+                    "should be %" _64BITARG_ "u, %" _64BITARG_ "u, %" _64BITARG_ "u",
+                    step, newHits, newMisses, newEvictions, hits, misses, evictions);
+
+    sLastHits = QTRTPFile::GetFileCacheHits();
+    sLastMisses = QTRTPFile::GetFileCacheMisses();
+    sLastEvictions = QTRTPFile::GetFileCacheEvictions();
+}
+
+static void CheckNumCachedFiles(const char * step, UInt32 numFiles)
+{
+    if( QTRTPFile::GetNumCachedFiles() != numFiles )
+        CheckFailed("%s: %lu movies cached, should be %lu", step, QTRTPFile::GetNumCachedFiles(), numFiles);
+}
+
+//
+// Copies a file, and returns false if it can't.
+static Bool16 CopyFile(const char * fromPath, const char * toPath)
+{
+    // General vars
+    FILE            *fromFile, *toFile;
+    char            buffer[65536];
+    size_t          numBytes;
+    Bool16          copied = true;
+
+    if( (fromFile = ::fopen(fromPath, "rb")) == NULL )
+        return false;
+    if( (toFile = ::fopen(toPath, "wb")) == NULL )
+    {
+        ::fclose(fromFile);
+        return false;
+    }
+
+    while( (numBytes = ::fread(buffer, 1, sizeof(buffer), fromFile)) > 0 )
+        if( ::fwrite(buffer, 1, numBytes, toFile) != numBytes )
+            copied = false;
+
+    ::fclose(fromFile);
+    if( ::fclose(toFile) != 0 )
+        copied = false;
+    return copied;
+}
+
+//
+// Opens random movies of the list, some of them at once, as the sessions
+// of several RTSP threads do.
+class OpenThread : public OSThread
+{
+public:
+                        OpenThread(char ** moviePaths, UInt32 numMovies, UInt32 seed)
+                            : fMoviePaths(moviePaths), fNumMovies(numMovies), fSeed(seed), fNumFailed(0) {}
+    virtual             ~OpenThread() {}
+
+    virtual void        Entry()
+    {
+        QTRTPFile   *openFiles[kNumThreadFiles];
+
+        for( UInt32 slot = 0; slot < kNumThreadFiles; slot++ )
+            openFiles[slot] = NULL;
+
+        for( UInt32 curOpen = 0; curOpen < kNumThreadOpens; curOpen++ )
+        {
+            UInt32  slot = this->Random() % kNumThreadFiles;
+
+            if( openFiles[slot] != NULL )
+                delete openFiles[slot];
+            if( !OpenMovie(fMoviePaths[this->Random() % fNumMovies], &openFiles[slot]) )
+                fNumFailed++;
+        }
+
+        for( UInt32 slot = 0; slot < kNumThreadFiles; slot++ )
+            if( openFiles[slot] != NULL )
+                delete openFiles[slot];
+    }
+
+    UInt32              GetNumFailed()  { return fNumFailed; }
+
+private:
+    UInt32              Random()        { fSeed = fSeed * 1103515245 + 12345; return (fSeed >> 16) & 0x7FFF; }
+
+    char                **fMoviePaths;
+    UInt32              fNumMovies;
+    UInt32              fSeed;
+    UInt32              fNumFailed;
+};
+
+void FileCacheCheck(int argc, char * argv[])
+{
+    // General vars
+    char            **moviePaths = argv;
+    UInt32          numMovies = argc;
+    char            copyPath[256];
+    struct stat     copyStat;
+    struct utimbuf  copyTimes;
+    QTRTPFile       *heldFile;
+
+    if( argc < 1 )
+    {
+        CheckFailed("no movies to open");
+        return;
+    }
+
+    QTRTPFile::Initialize();
+    QTRTPFile::SetFileCacheSize(numMovies);
+
+    //
+    // The first open of each movie parses it, every later one is a hit.
+    for( UInt32 curMovie = 0; curMovie < numMovies; curMovie++ )
+    {
+        SInt64  firstOpen = TimeOpen(moviePaths[curMovie]);
+        SInt64  cachedOpens = 0;
+
+        for( UInt32 curOpen = 0; curOpen < kNumCachedOpens; curOpen++ )
+            cachedOpens += TimeOpen(moviePaths[curMovie]);
+
+        CheckPrintf("%s: first open %" _64BITARG_ "d us, cached opens %" _64BITARG_ "d us",
+                    moviePaths[curMovie], firstOpen, cachedOpens / kNumCachedOpens);
+    }
+    CheckCounters("first opens", (UInt64)numMovies * kNumCachedOpens, numMovies, 0);
+    CheckNumCachedFiles("first opens", numMovies);
+
+    //
+    // A cache of 0 closes them all, a cache of 1 keeps only the last one used.
+    QTRTPFile::SetFileCacheSize(0);
+    CheckCounters("cache size 0", 0, 0, numMovies);
+    CheckNumCachedFiles("cache size 0", 0);
+
+    QTRTPFile::SetFileCacheSize(1);
+    for( UInt32 curMovie = 0; curMovie < numMovies; curMovie++ )
+        (void)TimeOpen(moviePaths[curMovie]);
+    (void)TimeOpen(moviePaths[numMovies - 1]);
+    CheckCounters("cache size 1", 1, numMovies, numMovies - 1);
+    CheckNumCachedFiles("cache size 1", 1);
+
+    //
+    // A movie that changes is opened again; whoever has the old one open
+    // keeps it until they close it.
+    qtss_snprintf(copyPath, sizeof(copyPath), "/tmp/MP4PacketizerCheck.%d", (int)::getpid());
+    if( !CopyFile(moviePaths[0], copyPath) || (::stat(copyPath, &copyStat) != 0) )
+        CheckFailed("%s: can't copy %s", copyPath, moviePaths[0]);
+    else
+    {
+        QTRTPFile::SetFileCacheSize(numMovies + 1);
+        CheckCounters("copy", 0, 0, 0);
+
+        if( !OpenMovie(copyPath, &heldFile) )
+            CheckFailed("%s: can't open the movie", copyPath);
+        (void)TimeOpen(copyPath);
+
+        copyTimes.actime = copyStat.st_atime;
+        copyTimes.modtime = copyStat.st_mtime + 10;
+        (void)::utime(copyPath, &copyTimes);
+
+        (void)TimeOpen(copyPath);
+        (void)TimeOpen(copyPath);
+        CheckCounters("changed movie", 2, 2, 0);
+        // The old one is out of the table, but still open
+        CheckNumCachedFiles("changed movie", 2);
+
+        if( heldFile != NULL )
+        {
+            if( heldFile->Seek(0.0) != QTRTPFile::errNoError )
+                CheckFailed("the changed movie can't be played by whoever had it open");
+            delete heldFile;
+        }
+        CheckNumCachedFiles("changed movie closed", 2);
+
+        (void)::unlink(copyPath);
+        if( OpenMovie(copyPath, &heldFile) )
+        {
+            CheckFailed("a deleted movie could still be opened");
+            delete heldFile;
+        }
+        CheckCounters("deleted movie", 0, 1, 0);
+        CheckNumCachedFiles("deleted movie", 1);
+        QTRTPFile::SetFileCacheSize(1);
+    }
+
+    //
+    // Several threads opening and closing the movies at once, with a cache
+    // too small for them, so they are evicted and reopened all the time.
+    OpenThread  *threads[kNumOpenThreads];
+    UInt32      numFailed = 0;
+    SInt64      startTime = OS::Microseconds();
+
+    for( UInt32 curThread = 0; curThread < kNumOpenThreads; curThread++ )
+    {
+        threads[curThread] = NEW OpenThread(moviePaths, numMovies, curThread + 1);
+        threads[curThread]->Start();
+    }
+    for( UInt32 curThread = 0; curThread < kNumOpenThreads; curThread++ )
+    {
+        threads[curThread]->Join();
+        numFailed += threads[curThread]->GetNumFailed();
+        delete threads[curThread];
+    }
+
+    UInt64  threadHits = QTRTPFile::GetFileCacheHits() - sLastHits;
+    UInt64  threadMisses = QTRTPFile::GetFileCacheMisses() - sLastMisses;
+    CheckPrintf("%lu threads opened %lu movies each in %" _64BITARG_ "d ms, "
+                "%" _64BITARG_ "u hits, %" _64BITARG_ "u misses, %" _64BITARG_ "u evictions",
+                (UInt32)kNumOpenThreads, (UInt32)kNumThreadOpens, (OS::Microseconds() - startTime) / 1000,
+                threadHits, threadMisses, QTRTPFile::GetFileCacheEvictions() - sLastEvictions);
+    if( (numFailed != 0) || (threadHits + threadMisses != (UInt64)kNumOpenThreads * kNumThreadOpens) )
+        CheckFailed("%lu opens failed", numFailed);
+    CheckNumCachedFiles("threads", 1);
+}
@@ -0,0 +1,32 @@
+/***************************************************************************
+
+Copyright (c) 1999-2003 Apple Computer, Inc.  All Rights Reserved.
+2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 MP4PacketizerCheck.cpp
+Description: Runs behavior checks and timings of QTFileLib outside of the
+             server.
+Comment:     usage: MP4PacketizerCheck check [args]
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-17
+LastUpdate:  2026-10-17
+
+****************************************************************************/
+
+
+#include "OSHeaders.h"
+#include "CheckDriver.h"
+#include "MP4PacketizerCheck.h"
+
+
+static CheckEntry sChecks[] =
+{
+    { "packetizer",     PacketizerCheck,    "[directory]" },
+    { "filecache",      FileCacheCheck,     "movie ..." }
+};
+
+int main(int argc, char * argv[])
+{
+    return RunCheck(argc, argv, sChecks, sizeof(sChecks) / sizeof(CheckEntry));
+}
@@ -0,0 +1,26 @@
+/***************************************************************************
+
+Copyright (c) 1999-2003 Apple Computer, Inc.  All Rights Reserved.
+2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 MP4PacketizerCheck.h
+Description: The checks MP4PacketizerCheck can run.
+Comment:     each one reports what didn't hold through CheckDriver
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-17
+LastUpdate:  2026-10-17
+
+****************************************************************************/
+
+
+#ifndef __MP4PACKETIZERCHECK_H__
+#define __MP4PACKETIZERCHECK_H__
+
+// The H.264 and AAC packets QTRTPFile sends for unhinted movies
+void PacketizerCheck(int argc, char * argv[]);
+
+// The QTRTPFile movie cache, from one thread and from several
+void FileCacheCheck(int argc, char * argv[]);
+
+#endif //__MP4PACKETIZERCHECK_H__
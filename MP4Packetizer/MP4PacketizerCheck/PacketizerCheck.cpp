@@ -0,0 +1,1114 @@
+/***************************************************************************
+
+Copyright (c) 1999-2003 Apple Computer, Inc.  All Rights Reserved.
+2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 PacketizerCheck.cpp
+Description: Writes unhinted H.264 and AAC movies, streams them through
+             QTRTPFile, and puts the access units back together from the
+             packets, which must give back the samples that were written.
+             Each movie is streamed read through fMovieFD and again mapped.
+Comment:     usage: MP4PacketizerCheck packetizer [directory]
+             The movies are written to the directory, /tmp by default, and
+             removed afterwards.
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-17
+LastUpdate:  2026-10-17
+
+****************************************************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "SafeStdLib.h"
+#include "OSMemory.h"
+#include "OS.h"
+#include "OSThread.h"
+#include "QTRTPFile.h"
+#include "QTPacketizer.h"
+#include "CheckDriver.h"
+#include "MP4PacketizerCheck.h"
+
+
+enum
+{
+    kMaxMovieLength     = 1024 * 1024,  //UInt32
+    kMaxSamples         = 64,           //UInt32, per track
+    kMaxNALs            = 8,            //UInt32, per video sample
+    kMaxAULength        = 65536,        //UInt32, an access unit put back together
+    kVideoTimeScale     = 90000,        //UInt32
+    kVideoSampleDelta   = 3000,         //UInt32
+    kAudioSampleDelta   = 1024,         //UInt32
+    kZeroLengthNAL      = 0xFF,         //UInt8, a NAL type that stands for a length field of 0
+    kBadLengthWaitMsec  = 10000,        //SInt64, how long a movie with a bad NAL length may take
+    kMovieSamplesStart  = 32            //UInt32, where MovieWriter puts the samples: after 'ftyp' and the 'mdat' header
+};
+
+static const char   sSPS[] = { 0x67, 0x42, (char)0xC0, 0x1E, (char)0xD9, 0x00, (char)0xA0, 0x47, (char)0xFE, (char)0xC8 };
+static const char   sPPS[] = { 0x68, (char)0xCE, 0x38, (char)0x80 };
+
+//
+// The NAL units of a video sample: type, nal_ref_idc, length. The first ones
+// are laid out so that the packets they go in are known; the rest are random.
+struct NALSpec
+{
+    UInt8       fType;
+    UInt8       fNRI;
+    UInt32      fLength;
+};
+
+struct VideoSampleSpec
+{
+    UInt32      fNumPackets;    // 0 if it isn't checked
+    NALSpec     fNALs[kMaxNALs];
+};
+
+static VideoSampleSpec  sVideoSamples[] =
+{
+    { 4, { { 5, 3, 4000 } } },                                      // parameter sets, then FU-As
+    { 1, { { 6, 0, 20 }, { 1, 2, 100 }, { 1, 2, 200 } } },          // one STAP-A
+    { 1, { { 7, 3, 0 }, { 8, 3, 0 }, { 5, 3, 300 } } },             // has its own parameter sets
+    { 1, { { 1, 2, 50 }, { kZeroLengthNAL, 0, 0 }, { 1, 2, 60 } } },
+    { 1, { { 1, 2, 700 }, { 1, 0, 733 } } },                        // a STAP-A of exactly kMaxPayloadSize
+    { 2, { { 1, 2, 700 }, { 1, 2, 734 } } },                        // one byte too many for it
+    { 1, { { 1, 2, 1438 } } },                                      // a single NAL unit as big as can be
+    { 2, { { 1, 2, 1439 } } },                                      // one byte too big
+    { 2, { { 5, 3, 100 }, { 1, 2, 100 } } }                         // parameter sets, then a STAP-A
+};
+
+static const UInt32 sNumVideoSpecs = sizeof(sVideoSamples) / sizeof(VideoSampleSpec);
+
+//
+// How a movie's audio track is described, and what its SDP must say.
+struct AudioSpec
+{
+    UInt16      fEntryVersion;
+    UInt16      fEntryChannels;     // in the sample entry; version 2 keeps them in a field of its own
+    UInt32      fTimeScale;
+    UInt32      fConfigLength;
+    UInt8       fConfig[3];         // the AudioSpecificConfig
+    const char  *fRTPMap;
+    const char  *fProfileLevelID;
+};
+
+static AudioSpec    sAudioSpecs[] =
+{
+    // AAC LC, stereo
+    { 0, 2, 44100, 2, { 0x12, 0x10 },       "a=rtpmap:97 mpeg4-generic/44100/2", "profile-level-id=41;" },
+    // AAC LC, mono, in an entry that says stereo
+    { 1, 2, 22050, 2, { 0x13, 0x88 },       "a=rtpmap:97 mpeg4-generic/22050/1", "profile-level-id=40;" },
+    // AAC LC with no channel configuration, mono by the version 2 entry
+    { 2, 1, 48000, 2, { 0x11, 0x80 },       "a=rtpmap:97 mpeg4-generic/48000/1", "profile-level-id=41;" },
+    // HE-AAC, 24 kHz AAC LC with SBR to 48 kHz, stereo
+    { 0, 2, 48000, 3, { 0x2B, 0x11, 0x88 }, "a=rtpmap:97 mpeg4-generic/48000/2", "profile-level-id=44;" }
+};
+
+static const UInt32 sNumAudioSpecs = sizeof(sAudioSpecs) / sizeof(AudioSpec);
+
+
+// -------------------------------------
+// Movie writer
+//
+//
+// Writes a movie of one or two tracks, each sample in a chunk of its own,
+// with the samples in an 'mdat' ahead of the 'moov'.
+class MovieWriter
+{
+public:
+    struct Track
+    {
+        OSType      Handler;
+        UInt32      TimeScale, SampleDelta;
+        char        *Entry;
+        UInt32      EntryLength;
+        UInt32      NumSamples;
+        UInt32      SampleOffsets[kMaxSamples], SampleLengths[kMaxSamples];
+    };
+
+                        MovieWriter() : fBuffer(NEW char[kMaxMovieLength]), fLength(0), fDepth(0) {}
+                        ~MovieWriter() { delete [] fBuffer; }
+
+            void        Put8(UInt32 value)  { if( fLength < kMaxMovieLength ) fBuffer[fLength++] = (char)value; }
+            void        Put16(UInt32 value) { Put8(value >> 8); Put8(value); }
+            void        Put32(UInt32 value) { Put16(value >> 16); Put16(value); }
+            void        PutBytes(const char * bytes, UInt32 length) { for( UInt32 curByte = 0; curByte < length; curByte++ ) Put8((UInt8)bytes[curByte]); }
+            void        PutZeros(UInt32 length) { for( UInt32 curByte = 0; curByte < length; curByte++ ) Put8(0); }
+
+            void        BeginAtom(const char * type) { fStarts[fDepth++] = fLength; Put32(0); PutBytes(type, 4); }
+            void        EndAtom(void);
+
+            char *      GetBuffer(void) { return fBuffer; }
+            UInt32      GetLength(void) { return fLength; }
+
+            Bool16      Write(const char * moviePath, char * samples, UInt32 samplesLength, Track * tracks, UInt32 numTracks);
+
+private:
+            void        WriteTrack(Track * track, UInt32 trackID, UInt32 samplesStart);
+
+    char                *fBuffer;
+    UInt32              fLength;
+    UInt32              fStarts[16];
+    UInt32              fDepth;
+};
+
+void MovieWriter::EndAtom(void)
+{
+    UInt32      start = fStarts[--fDepth];
+    UInt32      length = fLength - start;
+
+    fBuffer[start] = (char)(length >> 24);
+    fBuffer[start + 1] = (char)(length >> 16);
+    fBuffer[start + 2] = (char)(length >> 8);
+    fBuffer[start + 3] = (char)length;
+}
+
+void MovieWriter::WriteTrack(Track * track, UInt32 trackID, UInt32 samplesStart)
+{
+    BeginAtom("trak");
+
+    BeginAtom("tkhd");
+    Put32(0x0000000F); Put32(0); Put32(0); Put32(trackID); Put32(0);
+    Put32(track->NumSamples * track->SampleDelta * 1000 / track->TimeScale);
+    PutZeros(8); Put16(0); Put16(0); Put16((track->Handler == FOUR_CHARS_TO_INT('s', 'o', 'u', 'n')) ? 0x0100 : 0); Put16(0);
+    Put32(0x00010000); Put32(0); Put32(0); Put32(0); Put32(0x00010000); Put32(0); Put32(0); Put32(0); Put32(0x40000000);
+    Put32(0); Put32(0);
+    EndAtom();
+
+    BeginAtom("mdia");
+    BeginAtom("mdhd");
+    Put32(0); Put32(0); Put32(0); Put32(track->TimeScale); Put32(track->NumSamples * track->SampleDelta); Put16(0x55C4); Put16(0);
+    EndAtom();
+    BeginAtom("hdlr");
+    Put32(0); Put32(0); Put32(track->Handler); PutZeros(12); Put8(0);
+    EndAtom();
+
+    BeginAtom("minf");
+    BeginAtom("dinf");
+    BeginAtom("dref");
+    Put32(0); Put32(1);
+    BeginAtom("url "); Put32(1); EndAtom();     // the data is in this file
+    EndAtom();
+    EndAtom();
+
+    BeginAtom("stbl");
+    BeginAtom("stsd");
+    Put32(0); Put32(1); PutBytes(track->Entry, track->EntryLength);
+    EndAtom();
+    BeginAtom("stts");
+    Put32(0); Put32(1); Put32(track->NumSamples); Put32(track->SampleDelta);
+    EndAtom();
+    BeginAtom("stsc");
+    Put32(0); Put32(1); Put32(1); Put32(1); Put32(1);
+    EndAtom();
+    BeginAtom("stsz");
+    Put32(0); Put32(0); Put32(track->NumSamples);
+    for( UInt32 curSample = 0; curSample < track->NumSamples; curSample++ )
+        Put32(track->SampleLengths[curSample]);
+    EndAtom();
+    BeginAtom("stco");
+    Put32(0); Put32(track->NumSamples);
+    for( UInt32 curSample = 0; curSample < track->NumSamples; curSample++ )
+        Put32(samplesStart + track->SampleOffsets[curSample]);
+    EndAtom();
+    EndAtom();  // stbl
+    EndAtom();  // minf
+    EndAtom();  // mdia
+
+    EndAtom();  // trak
+}
+
+Bool16 MovieWriter::Write(const char * moviePath, char * samples, UInt32 samplesLength, Track * tracks, UInt32 numTracks)
+{
+    // General vars
+    UInt32      duration = 0;
+    FILE        *movieFile;
+    Bool16      written;
+
+    BeginAtom("ftyp");
+    PutBytes("isom", 4); Put32(0); PutBytes("isommp41", 8);
+    EndAtom();
+
+    BeginAtom("mdat");
+    UInt32      samplesStart = fLength;
+    PutBytes(samples, samplesLength);
+    EndAtom();
+
+    for( UInt32 curTrack = 0; curTrack < numTracks; curTrack++ )
+        if( tracks[curTrack].NumSamples * tracks[curTrack].SampleDelta * 1000 / tracks[curTrack].TimeScale > duration )
+            duration = tracks[curTrack].NumSamples * tracks[curTrack].SampleDelta * 1000 / tracks[curTrack].TimeScale;
+
+    BeginAtom("moov");
+    BeginAtom("mvhd");
+    Put32(0); Put32(0); Put32(0); Put32(1000); Put32(duration); Put32(0x00010000); Put16(0x0100); PutZeros(10);
+    Put32(0x00010000); Put32(0); Put32(0); Put32(0); Put32(0x00010000); Put32(0); Put32(0); Put32(0); Put32(0x40000000);
+    PutZeros(24); Put32(numTracks + 1);
+    EndAtom();
+    for( UInt32 curTrack = 0; curTrack < numTracks; curTrack++ )
+        WriteTrack(&tracks[curTrack], curTrack + 1, samplesStart);
+    EndAtom();
+
+    if( fLength >= kMaxMovieLength )
+        return false;
+
+    if( (movieFile = ::fopen(moviePath, "wb")) == NULL )
+        return false;
+    written = (::fwrite(fBuffer, 1, fLength, movieFile) == fLength);
+    if( ::fclose(movieFile) != 0 )
+        written = false;
+    return written;
+}
+
+
+// -------------------------------------
+// Samples
+//
+static UInt32   sRandom = 1;
+
+static UInt32 Random(void)
+{
+    sRandom = sRandom * 1103515245 + 12345;
+    return (sRandom >> 16) & 0x7FFF;
+}
+
+//
+// Builds the sample entry of the video track: a visual sample entry, and an
+// avcC with one SPS and one PPS.
+static UInt32 MakeVideoEntry(char * entry)
+{
+    MovieWriter     writer;
+
+    writer.BeginAtom("avc1");
+    writer.PutZeros(6); writer.Put16(1);
+    writer.PutZeros(16); writer.Put16(176); writer.Put16(144);
+    writer.Put32(0x00480000); writer.Put32(0x00480000); writer.Put32(0); writer.Put16(1);
+    writer.PutZeros(32); writer.Put16(24); writer.Put16(0xFFFF);
+    writer.BeginAtom("avcC");
+    writer.Put8(1); writer.Put8((UInt8)sSPS[1]); writer.Put8((UInt8)sSPS[2]); writer.Put8((UInt8)sSPS[3]);
+    writer.Put8(0xFF);      // 4 byte NAL lengths
+    writer.Put8(0xE1); writer.Put16(sizeof(sSPS)); writer.PutBytes(sSPS, sizeof(sSPS));
+    writer.Put8(1); writer.Put16(sizeof(sPPS)); writer.PutBytes(sPPS, sizeof(sPPS));
+    writer.EndAtom();
+    writer.EndAtom();
+
+    ::memcpy(entry, writer.GetBuffer(), writer.GetLength());
+    return writer.GetLength();
+}
+
+//
+// Builds the sample entry of an audio track: an audio sample entry of the
+// given version, and an esds with the AudioSpecificConfig.
+static UInt32 MakeAudioEntry(char * entry, AudioSpec * spec)
+{
+    MovieWriter     writer;
+
+    writer.BeginAtom("mp4a");
+    writer.PutZeros(6); writer.Put16(1);
+    writer.Put16(spec->fEntryVersion); writer.Put16(0); writer.Put32(0);
+    if( spec->fEntryVersion == 2 )
+    {
+        writer.Put16(3); writer.Put16(16); writer.Put16(0xFFFE); writer.Put16(0);
+        writer.Put32(0x00010000);
+        writer.Put32(72); writer.Put32(0x40E77000); writer.Put32(0);     // 48000.0
+        writer.Put32(spec->fEntryChannels); writer.Put32(0x7F000000);
+        writer.Put32(16); writer.Put32(0); writer.Put32(0); writer.Put32(1024);
+    }
+    else
+    {
+        writer.Put16(spec->fEntryChannels); writer.Put16(16); writer.Put16(0); writer.Put16(0);
+        writer.Put32(spec->fTimeScale << 16);
+    }
+    if( spec->fEntryVersion == 1 )
+    {
+        writer.Put32(1024); writer.Put32(0); writer.Put32(0); writer.Put32(2);
+    }
+    writer.BeginAtom("esds");
+    writer.Put32(0);
+    writer.Put8(0x03); writer.Put8(3 + 2 + 13 + 2 + spec->fConfigLength + 3); writer.Put16(1); writer.Put8(0);
+    writer.Put8(0x04); writer.Put8(13 + 2 + spec->fConfigLength); writer.Put8(0x40); writer.Put8(0x15);
+    writer.Put8(0); writer.Put16(0x1800); writer.Put32(128000); writer.Put32(128000);
+    writer.Put8(0x05); writer.Put8(spec->fConfigLength);
+    writer.PutBytes((char *)spec->fConfig, spec->fConfigLength);
+    writer.Put8(0x06); writer.Put8(1); writer.Put8(0x02);
+    writer.EndAtom();
+    writer.EndAtom();
+
+    ::memcpy(entry, writer.GetBuffer(), writer.GetLength());
+    return writer.GetLength();
+}
+
+static void PutNAL(char * samples, UInt32 * samplesLength, UInt8 type, UInt8 nri, UInt32 length)
+{
+    char    *nal;
+
+    if( type == kZeroLengthNAL )
+        length = 0;
+    else if( type == 7 )
+        length = sizeof(sSPS);
+    else if( type == 8 )
+        length = sizeof(sPPS);
+
+    samples[*samplesLength] = (char)(length >> 24);
+    samples[*samplesLength + 1] = (char)(length >> 16);
+    samples[*samplesLength + 2] = (char)(length >> 8);
+    samples[*samplesLength + 3] = (char)length;
+    nal = samples + *samplesLength + 4;
+    *samplesLength += 4 + length;
+
+    if( type == 7 )
+        ::memcpy(nal, sSPS, length);
+    else if( type == 8 )
+        ::memcpy(nal, sPPS, length);
+    else if( length > 0 )
+    {
+        nal[0] = (char)((nri << 5) | type);
+        for( UInt32 curByte = 1; curByte < length; curByte++ )
+            nal[curByte] = (char)Random();
+    }
+}
+
+//
+// Adds the video samples: the ones of sVideoSamples, then random ones.
+static void MakeVideoSamples(MovieWriter::Track * track, char * samples, UInt32 * samplesLength, UInt32 numSamples)
+{
+    for( UInt32 curSample = 0; curSample < numSamples; curSample++ )
+    {
+        track->SampleOffsets[curSample] = *samplesLength;
+
+        if( curSample < sNumVideoSpecs )
+        {
+            for( UInt32 curNAL = 0; (curNAL < kMaxNALs) && (sVideoSamples[curSample].fNALs[curNAL].fType != 0); curNAL++ )
+                PutNAL(samples, samplesLength, sVideoSamples[curSample].fNALs[curNAL].fType,
+                       sVideoSamples[curSample].fNALs[curNAL].fNRI, sVideoSamples[curSample].fNALs[curNAL].fLength);
+        }
+        else
+        {
+            UInt32  numNALs = 1 + Random() % 5;
+
+            for( UInt32 curNAL = 0; curNAL < numNALs; curNAL++ )
+            {
+                UInt32  lengths[] = { 1 + Random() % 100, 1 + Random() % 1500, 1 + Random() % 5000 };
+                PutNAL(samples, samplesLength, (Random() % 8 == 0) ? 5 : 1, Random() % 4, lengths[Random() % 3]);
+            }
+        }
+
+        track->SampleLengths[curSample] = *samplesLength - track->SampleOffsets[curSample];
+    }
+    track->NumSamples = numSamples;
+}
+
+static void MakeAudioSamples(MovieWriter::Track * track, char * samples, UInt32 * samplesLength, UInt32 numSamples)
+{
+    // Access units of one packet, of exactly one, just over one, and of the largest AU-size
+    UInt32  lengths[] = { 1434, 1435, 3000, 8191 };
+
+    for( UInt32 curSample = 0; curSample < numSamples; curSample++ )
+    {
+        UInt32  length = (curSample < sizeof(lengths) / sizeof(UInt32)) ? lengths[curSample] : 100 + Random() % 500;
+
+        track->SampleOffsets[curSample] = *samplesLength;
+        track->SampleLengths[curSample] = length;
+        for( UInt32 curByte = 0; curByte < length; curByte++ )
+            samples[(*samplesLength)++] = (char)Random();
+    }
+    track->NumSamples = numSamples;
+}
+
+
+// -------------------------------------
+// Depacketizers
+//
+//
+// Puts the access units of a track back together from its packets, and
+// checks them against the samples, and the packets against how they should
+// have been made.
+class Depacketizer
+{
+public:
+                        Depacketizer(const char * moviePath, MovieWriter::Track * track, char * samples, UInt8 payloadType)
+                            : fMoviePath(moviePath), fTrack(track), fSamples(samples), fPayloadType(payloadType),
+                              fAULength(0), fCurSample(0), fNumAUPackets(0), fNumPackets(0), fNumBytes(0),
+                              fFirstTimestamp(0), fAUTimestamp(0), fLastSequenceNumber(0),
+                              fInFragment(false), fNumSTAPAs(0), fNumFUAs(0), fNumParameterSets(0) {}
+
+            void        AddPacket(char * packet, UInt32 length);
+            void        Finish(void);
+
+            UInt64      GetNumBytes(void) { return fNumBytes; }
+            UInt32      GetNumSTAPAs(void) { return fNumSTAPAs; }
+            UInt32      GetNumFUAs(void) { return fNumFUAs; }
+            UInt32      GetNumParameterSets(void) { return fNumParameterSets; }
+            UInt32      GetNumAccessUnits(void) { return fCurSample; }
+
+private:
+            void        AddNAL(char * nal, UInt32 length);
+            void        AddH264Payload(char * payload, UInt32 length);
+            void        AddAACPayload(char * payload, UInt32 length);
+            void        EndAccessUnit(void);
+            UInt32      ExpectedAccessUnit(char * accessUnit, Bool16 * hasParameterSets);
+
+    const char          *fMoviePath;
+    MovieWriter::Track  *fTrack;
+    char                *fSamples;
+    UInt8               fPayloadType;
+
+    char                fAU[kMaxAULength];
+    UInt32              fAULength;
+    UInt32              fCurSample;
+    UInt32              fNumAUPackets;
+    UInt32              fNumPackets;
+    UInt64              fNumBytes;
+    UInt32              fFirstTimestamp, fAUTimestamp;
+    UInt16              fLastSequenceNumber;
+    Bool16              fInFragment;
+
+    UInt32              fNumSTAPAs, fNumFUAs, fNumParameterSets;
+};
+
+void Depacketizer::AddNAL(char * nal, UInt32 length)
+{
+    if( fAULength + 4 + length > kMaxAULength )
+        return;
+
+    fAU[fAULength] = (char)(length >> 24);
+    fAU[fAULength + 1] = (char)(length >> 16);
+    fAU[fAULength + 2] = (char)(length >> 8);
+    fAU[fAULength + 3] = (char)length;
+    ::memcpy(fAU + fAULength + 4, nal, length);
+    fAULength += 4 + length;
+}
+
+void Depacketizer::AddH264Payload(char * payload, UInt32 length)
+{
+    // General vars
+    UInt8       type = payload[0] & 0x1F;
+
+    if( (type != 28) && fInFragment )
+    {
+        CheckFailed("%s: sample %lu: a fragmented NAL unit has no end", fMoviePath, fCurSample + 1);
+        fInFragment = false;
+    }
+
+    if( (type >= 1) && (type <= 23) )
+        AddNAL(payload, length);
+    else if( type == 24 )
+    {
+        //
+        // A STAP-A: its F bit is the OR of its units', its NRI their highest.
+        UInt32  curPos = 1, numNALs = 0, numParameterSets = 0;
+        UInt8   header = 0;
+
+        while( curPos + 2 <= length )
+        {
+            UInt32  nalLength = ((UInt8)payload[curPos] << 8) | (UInt8)payload[curPos + 1];
+
+            if( (nalLength == 0) || (curPos + 2 + nalLength > length) )
+            {
+                CheckFailed("%s: sample %lu: a STAP-A unit of %lu bytes, at %lu of %lu", fMoviePath, fCurSample + 1,
+                            nalLength, curPos, length);
+                return;
+            }
+            if( (payload[curPos + 2] & 0x60) > (header & 0x60) )
+                header = (header & 0x80) | (payload[curPos + 2] & 0x60);
+            header |= payload[curPos + 2] & 0x80;
+
+            numNALs++;
+            if( ((payload[curPos + 2] & 0x1F) == 7) || ((payload[curPos + 2] & 0x1F) == 8) )
+                numParameterSets++;
+            AddNAL(payload + curPos + 2, nalLength);
+            curPos += 2 + nalLength;
+        }
+        if( (curPos != length) || ((UInt8)(payload[0] & 0xE0) != header) )
+            CheckFailed("%s: sample %lu: a STAP-A with header %02x, should be %02x", fMoviePath, fCurSample + 1,
+                        (UInt8)payload[0], header | 24);
+
+        // Ours are the only STAP-As that hold just an SPS and a PPS
+        if( (numNALs == 2) && (numParameterSets == 2) )
+            fNumParameterSets++;
+        else
+            fNumSTAPAs++;
+    }
+    else if( type == 28 )
+    {
+        //
+        // An FU-A: the first fragment starts the unit, with the header the
+        // FU indicator and header make up, the last ends it.
+        UInt8   start = payload[1] & 0x80, end = payload[1] & 0x40;
+
+        if( start )
+        {
+            if( fInFragment )
+                CheckFailed("%s: sample %lu: a fragmented NAL unit has no end", fMoviePath, fCurSample + 1);
+            fNumFUAs++;
+            fInFragment = true;
+            char    header = (char)((payload[0] & 0xE0) | (payload[1] & 0x1F));
+            AddNAL(&header, 1);
+        }
+        else if( !fInFragment )
+        {
+            CheckFailed("%s: sample %lu: a fragment of a NAL unit that didn't start", fMoviePath, fCurSample + 1);
+            return;
+        }
+
+        //
+        // Add the fragment to the last NAL unit, and fix its length.
+        UInt32  nalStart = fAULength, nalLength = 0;
+        for( UInt32 curPos = 0; curPos < fAULength; curPos += 4 + nalLength )
+        {
+            nalStart = curPos;
+            nalLength = ((UInt8)fAU[curPos] << 24) | ((UInt8)fAU[curPos + 1] << 16) | ((UInt8)fAU[curPos + 2] << 8) | (UInt8)fAU[curPos + 3];
+        }
+        if( fAULength + length - 2 > kMaxAULength )
+            return;
+        ::memcpy(fAU + fAULength, payload + 2, length - 2);
+        fAULength += length - 2;
+        nalLength += length - 2;
+        fAU[nalStart] = (char)(nalLength >> 24);
+        fAU[nalStart + 1] = (char)(nalLength >> 16);
+        fAU[nalStart + 2] = (char)(nalLength >> 8);
+        fAU[nalStart + 3] = (char)nalLength;
+
+        if( end )
+            fInFragment = false;
+    }
+    else
+        CheckFailed("%s: sample %lu: a packet of NAL type %u", fMoviePath, fCurSample + 1, type);
+}
+
+void Depacketizer::AddAACPayload(char * payload, UInt32 length)
+{
+    // General vars
+    UInt32      auSize;
+
+    //
+    // One 16 bit AU header: 13 bits of size, and an index of 0.
+    if( (length < 4) || (payload[0] != 0) || (payload[1] != 16) || ((payload[3] & 0x07) != 0) )
+    {
+        CheckFailed("%s: sample %lu: a packet with a bad AU header", fMoviePath, fCurSample + 1);
+        return;
+    }
+
+    auSize = ((UInt8)payload[2] << 5) | ((UInt8)payload[3] >> 3);
+    if( (fCurSample < fTrack->NumSamples) && (auSize != fTrack->SampleLengths[fCurSample]) )
+        CheckFailed("%s: sample %lu: AU-size %lu, the sample is %lu bytes", fMoviePath, fCurSample + 1,
+                    auSize, fTrack->SampleLengths[fCurSample]);
+
+    if( fAULength + length - 4 <= kMaxAULength )
+    {
+        ::memcpy(fAU + fAULength, payload + 4, length - 4);
+        fAULength += length - 4;
+    }
+}
+
+void Depacketizer::AddPacket(char * packet, UInt32 length)
+{
+    // General vars
+    UInt16      sequenceNumber = ((UInt8)packet[2] << 8) | (UInt8)packet[3];
+    UInt32      timestamp = ((UInt8)packet[4] << 24) | ((UInt8)packet[5] << 16) | ((UInt8)packet[6] << 8) | (UInt8)packet[7];
+    Bool16      marker = (packet[1] & 0x80) != 0;
+
+    if( length > QTPacketizer::kMaxPacketSize )
+        CheckFailed("%s: sample %lu: a packet of %lu bytes", fMoviePath, fCurSample + 1, length);
+
+    if( (fNumPackets > 0) && (sequenceNumber != (UInt16)(fLastSequenceNumber + 1)) )
+        CheckFailed("%s: sample %lu: sequence number %u after %u", fMoviePath, fCurSample + 1, sequenceNumber, fLastSequenceNumber);
+    if( fNumPackets == 0 )
+        fFirstTimestamp = timestamp;
+    if( fNumAUPackets == 0 )
+        fAUTimestamp = timestamp;
+    else if( timestamp != fAUTimestamp )
+        CheckFailed("%s: sample %lu: timestamps %lu and %lu in one access unit", fMoviePath, fCurSample + 1, fAUTimestamp, timestamp);
+
+    fLastSequenceNumber = sequenceNumber;
+    fNumPackets++;
+    fNumAUPackets++;
+    fNumBytes += length;
+
+    if( fPayloadType == 96 )
+        AddH264Payload(packet + QTPacketizer::kRTPHeaderSize, length - QTPacketizer::kRTPHeaderSize);
+    else
+        AddAACPayload(packet + QTPacketizer::kRTPHeaderSize, length - QTPacketizer::kRTPHeaderSize);
+
+    if( marker )
+        EndAccessUnit();
+}
+
+UInt32 Depacketizer::ExpectedAccessUnit(char * accessUnit, Bool16 * hasParameterSets)
+{
+    // General vars
+    char        *sample = fSamples + fTrack->SampleOffsets[fCurSample];
+    UInt32      sampleLength = fTrack->SampleLengths[fCurSample];
+    UInt32      length = 0, nalLength;
+    Bool16      hasIDR = false, hasSPS = false;
+
+    if( fPayloadType != 96 )
+    {
+        ::memcpy(accessUnit, sample, sampleLength);
+        return sampleLength;
+    }
+
+    //
+    // The sample's NAL units, less the empty ones, and our parameter sets
+    // ahead of them if it has an IDR picture and no SPS of its own.
+    for( UInt32 curPos = 0; curPos < sampleLength; curPos += 4 + nalLength )
+    {
+        nalLength = ((UInt8)sample[curPos] << 24) | ((UInt8)sample[curPos + 1] << 16) | ((UInt8)sample[curPos + 2] << 8) | (UInt8)sample[curPos + 3];
+        if( nalLength == 0 )
+            continue;
+        if( (sample[curPos + 4] & 0x1F) == 5 )
+            hasIDR = true;
+        if( (sample[curPos + 4] & 0x1F) == 7 )
+            hasSPS = true;
+    }
+
+    *hasParameterSets = hasIDR && !hasSPS;
+    if( *hasParameterSets )
+    {
+        PutNAL(accessUnit, &length, 7, 0, 0);
+        PutNAL(accessUnit, &length, 8, 0, 0);
+    }
+
+    for( UInt32 curPos = 0; curPos < sampleLength; curPos += 4 + nalLength )
+    {
+        nalLength = ((UInt8)sample[curPos] << 24) | ((UInt8)sample[curPos + 1] << 16) | ((UInt8)sample[curPos + 2] << 8) | (UInt8)sample[curPos + 3];
+        if( nalLength == 0 )
+            continue;
+        ::memcpy(accessUnit + length, sample + curPos, 4 + nalLength);
+        length += 4 + nalLength;
+    }
+
+    return length;
+}
+
+void Depacketizer::EndAccessUnit(void)
+{
+    // General vars
+    char        *expected = NEW char[kMaxAULength];
+    UInt32      expectedLength;
+    Bool16      hasParameterSets = false;
+
+    if( fCurSample >= fTrack->NumSamples )
+    {
+        CheckFailed("%s: more access units than the %lu samples", fMoviePath, fTrack->NumSamples);
+        delete [] expected;
+        return;
+    }
+
+    if( fInFragment )
+        CheckFailed("%s: sample %lu: ends in the middle of a NAL unit", fMoviePath, fCurSample + 1);
+
+    expectedLength = ExpectedAccessUnit(expected, &hasParameterSets);
+    if( (expectedLength != fAULength) || (::memcmp(expected, fAU, fAULength) != 0) )
+        CheckFailed("%s: sample %lu: %lu bytes came back, %lu bytes should have%s", fMoviePath, fCurSample + 1,
+                    fAULength, expectedLength, hasParameterSets ? ", with the parameter sets" : "");
+
+    if( fAUTimestamp - fFirstTimestamp != (UInt32)((UInt64)fCurSample * fTrack->SampleDelta * (fPayloadType == 96 ? kVideoTimeScale : fTrack->TimeScale) / fTrack->TimeScale) )
+        CheckFailed("%s: sample %lu: timestamp %lu after the first", fMoviePath, fCurSample + 1, fAUTimestamp - fFirstTimestamp);
+
+    if( (fPayloadType == 96) && (fCurSample < sNumVideoSpecs) && (sVideoSamples[fCurSample].fNumPackets != fNumAUPackets) )
+        CheckFailed("%s: sample %lu: %lu packets, should be %lu", fMoviePath, fCurSample + 1,
+                    fNumAUPackets, sVideoSamples[fCurSample].fNumPackets);
+
+    delete [] expected;
+    fCurSample++;
+    fAULength = 0;
+    fNumAUPackets = 0;
+}
+
+void Depacketizer::Finish(void)
+{
+    if( (fCurSample != fTrack->NumSamples) || (fNumAUPackets != 0) )
+        CheckFailed("%s: %lu access units of %lu samples came back", fMoviePath, fCurSample, fTrack->NumSamples);
+}
+
+
+// -------------------------------------
+// The check
+//
+//
+// Every line of the SDP that should be there must be.
+static void CheckSDP(const char * moviePath, char * sdp, const char ** lines, UInt32 numLines)
+{
+    for( UInt32 curLine = 0; curLine < numLines; curLine++ )
+        if( ::strstr(sdp, lines[curLine]) == NULL )
+            CheckFailed("%s: the SDP has no \"%s\"", moviePath, lines[curLine]);
+}
+
+//
+// The b=AS of a track must be close to what its packets take.
+static void CheckBandwidth(const char * moviePath, char * sdp, const char * media, MovieWriter::Track * track, UInt64 numBytes)
+{
+    // General vars
+    char        *mediaLine = ::strstr(sdp, media);
+    char        *bandwidthLine = (mediaLine != NULL) ? ::strstr(mediaLine, "b=AS:") : NULL;
+    UInt32      sdpKBits, sentKBits;
+
+    if( bandwidthLine == NULL )
+    {
+        CheckFailed("%s: no b=AS for %s", moviePath, media);
+        return;
+    }
+
+    sdpKBits = (UInt32)::strtoul(bandwidthLine + 5, NULL, 10);
+    sentKBits = (UInt32)(numBytes * 8 * track->TimeScale / ((UInt64)track->NumSamples * track->SampleDelta) / 1000);
+    if( (sdpKBits * 4 < sentKBits * 3) || (sdpKBits * 2 > sentKBits * 3 + 2) )
+        CheckFailed("%s: b=AS:%lu for %s, its packets take %lu kbit/s", moviePath, sdpKBits, media, sentKBits);
+}
+
+static void CheckMovie(const char * moviePath, MovieWriter::Track * tracks, UInt32 numTracks,
+                       char * samples, const char ** sdpLines, UInt32 numSDPLines, Bool16 mapped)
+{
+    // General vars
+    QTRTPFile       rtpFile;
+    char            *sdp, *packet;
+    int             sdpLength, packetLength;
+    Depacketizer    *depacketizers[2];
+    UInt32          numPackets = 0;
+
+    QTFile::SetMapFiles(mapped);
+    if( rtpFile.Initialize(moviePath) != QTRTPFile::errNoError )
+    {
+        QTFile::SetMapFiles(false);
+        CheckFailed("%s: can't open the movie", moviePath);
+        return;
+    }
+    QTFile::SetMapFiles(false);
+
+    if( rtpFile.GetQTFile()->IsMapped() != mapped )
+        CheckFailed("%s: the movie is%s mapped", moviePath, mapped ? " not" : "");
+
+    if( (sdp = rtpFile.GetSDPFile(&sdpLength)) == NULL )
+    {
+        CheckFailed("%s: no SDP", moviePath);
+        return;
+    }
+    CheckSDP(moviePath, sdp, sdpLines, numSDPLines);
+
+    for( UInt32 curTrack = 0; curTrack < numTracks; curTrack++ )
+    {
+        UInt8   payloadType = (tracks[curTrack].Handler == FOUR_CHARS_TO_INT('v', 'i', 'd', 'e')) ? 96 : 97;
+
+        depacketizers[curTrack] = NEW Depacketizer(moviePath, &tracks[curTrack], samples, payloadType);
+        if( rtpFile.AddTrack(curTrack + 1) != QTRTPFile::errNoError )
+            CheckFailed("%s: can't add track %lu", moviePath, curTrack + 1);
+    }
+
+    if( rtpFile.Seek(0.0) != QTRTPFile::errNoError )
+        CheckFailed("%s: can't seek to the start", moviePath);
+
+    for( ;; )
+    {
+        (void)rtpFile.GetNextPacket(&packet, &packetLength);
+        if( packet == NULL )
+            break;
+
+        numPackets++;
+        for( UInt32 curTrack = 0; curTrack < numTracks; curTrack++ )
+            if( (packet[1] & 0x7F) == ((tracks[curTrack].Handler == FOUR_CHARS_TO_INT('v', 'i', 'd', 'e')) ? 96 : 97) )
+                depacketizers[curTrack]->AddPacket(packet, (UInt32)packetLength);
+    }
+
+    for( UInt32 curTrack = 0; curTrack < numTracks; curTrack++ )
+    {
+        Bool16  isVideo = (tracks[curTrack].Handler == FOUR_CHARS_TO_INT('v', 'i', 'd', 'e'));
+
+        depacketizers[curTrack]->Finish();
+        CheckBandwidth(moviePath, sdp, isVideo ? "m=video" : "m=audio", &tracks[curTrack], depacketizers[curTrack]->GetNumBytes());
+        if( isVideo )
+            CheckPrintf("%s%s: %lu video samples, %lu STAP-As, %lu FU-As, parameter sets sent %lu times", moviePath,
+                        mapped ? " (mapped)" : "", tracks[curTrack].NumSamples, depacketizers[curTrack]->GetNumSTAPAs(),
+                        depacketizers[curTrack]->GetNumFUAs(), depacketizers[curTrack]->GetNumParameterSets());
+        else
+            CheckPrintf("%s%s: %lu audio samples", moviePath, mapped ? " (mapped)" : "", tracks[curTrack].NumSamples);
+        delete depacketizers[curTrack];
+    }
+}
+
+//
+// Streams a movie of one video track, and counts the packets of its first
+// sample and of the samples after it.
+class BadLengthThread : public OSThread
+{
+public:
+                        BadLengthThread(const char * moviePath)
+                            : fMoviePath(moviePath), fOpened(false), fNumPackets(0), fNumLaterPackets(0), fDone(false) {}
+    virtual             ~BadLengthThread() {}
+
+    virtual void        Entry()
+    {
+        QTRTPFile   rtpFile;
+        char        *packet;
+        int         packetLength;
+        UInt32      firstTimestamp = 0;
+
+        if( (rtpFile.Initialize(fMoviePath) == QTRTPFile::errNoError) && (rtpFile.AddTrack(1) == QTRTPFile::errNoError)
+            && (rtpFile.Seek(0.0) == QTRTPFile::errNoError) )
+        {
+            fOpened = true;
+            for( ;; )
+            {
+                (void)rtpFile.GetNextPacket(&packet, &packetLength);
+                if( packet == NULL )
+                    break;
+
+                UInt32  timestamp = ((UInt8)packet[4] << 24) | ((UInt8)packet[5] << 16) | ((UInt8)packet[6] << 8) | (UInt8)packet[7];
+                if( fNumPackets + fNumLaterPackets == 0 )
+                    firstTimestamp = timestamp;
+                if( timestamp == firstTimestamp )
+                    fNumPackets++;
+                else
+                    fNumLaterPackets++;
+            }
+        }
+        fDone = true;
+    }
+
+    const char          *fMoviePath;
+    Bool16              fOpened;
+    UInt32              fNumPackets, fNumLaterPackets;
+    volatile Bool16     fDone;
+};
+
+//
+// A NAL length that runs past the end of its sample, and wraps around to
+// the sample's start, must end the stream there and not hang it.
+static void CheckBadNALLength(const char * directory, char * samples)
+{
+    // General vars
+    char                moviePath[256];
+    char                videoEntry[256];
+    UInt32              samplesLength = 0;
+    MovieWriter         writer;
+    MovieWriter::Track  track;
+    BadLengthThread     *thread;
+    SInt64              startTime;
+
+    track.Handler = FOUR_CHARS_TO_INT('v', 'i', 'd', 'e');
+    track.TimeScale = kVideoTimeScale;
+    track.SampleDelta = kVideoSampleDelta;
+    track.Entry = videoEntry;
+    track.EntryLength = MakeVideoEntry(videoEntry);
+
+    track.SampleOffsets[0] = samplesLength;
+    PutNAL(samples, &samplesLength, 5, 3, 100);
+    track.SampleLengths[0] = samplesLength - track.SampleOffsets[0];
+
+    track.SampleOffsets[1] = samplesLength;
+    PutNAL(samples, &samplesLength, 5, 3, 100);
+    samples[track.SampleOffsets[1]] = (char)0xFF;       // 0xFFFFFFFC, back to where it starts
+    samples[track.SampleOffsets[1] + 1] = (char)0xFF;
+    samples[track.SampleOffsets[1] + 2] = (char)0xFF;
+    samples[track.SampleOffsets[1] + 3] = (char)0xFC;
+    track.SampleLengths[1] = samplesLength - track.SampleOffsets[1];
+
+    track.SampleOffsets[2] = samplesLength;
+    PutNAL(samples, &samplesLength, 1, 2, 100);
+    track.SampleLengths[2] = samplesLength - track.SampleOffsets[2];
+    track.NumSamples = 3;
+
+    qtss_snprintf(moviePath, sizeof(moviePath), "%s/MP4PacketizerCheck.%d.badlength.mp4", directory, (int)::getpid());
+    if( !writer.Write(moviePath, samples, samplesLength, &track, 1) )
+    {
+        CheckFailed("%s: can't write the movie", moviePath);
+        return;
+    }
+
+    //
+    // Stream it on a thread of its own, so that a hang is an error and not
+    // the end of the check.
+    thread = NEW BadLengthThread(moviePath);
+    thread->Start();
+    startTime = OS::Milliseconds();
+    while( !thread->fDone && (OS::Milliseconds() - startTime < kBadLengthWaitMsec) )
+        OSThread::Sleep(10);
+
+    if( !thread->fDone )
+    {
+        //
+        // The thread can't be stopped; it goes when the check exits.
+        CheckFailed("%s: still streaming sample 2 after %" _64BITARG_ "d ms", moviePath, OS::Milliseconds() - startTime);
+        (void)::unlink(moviePath);
+        return;
+    }
+
+    thread->Join();
+    if( !thread->fOpened )
+        CheckFailed("%s: can't stream the movie", moviePath);
+    else if( (thread->fNumPackets != 2) || (thread->fNumLaterPackets != 0) )
+        CheckFailed("%s: %lu packets of sample 1 and %lu after it, should be 2 and 0", moviePath,
+                    thread->fNumPackets, thread->fNumLaterPackets);
+    else
+        CheckPrintf("%s: the stream ends at the sample with a bad NAL length", moviePath);
+
+    delete thread;
+    (void)::unlink(moviePath);
+}
+
+//
+// A mapped movie that is cut short while it is being streamed must end the
+// stream where it was cut, and not kill us with SIGBUS.
+static void CheckTruncatedMovie(const char * directory, char * samples)
+{
+    // General vars
+    char                moviePath[256];
+    char                videoEntry[256];
+    UInt32              samplesLength = 0;
+    MovieWriter         writer;
+    MovieWriter::Track  track;
+    QTRTPFile           rtpFile;
+    Depacketizer        *depacketizer;
+    char                *packet;
+    int                 packetLength;
+    UInt32              numSamplesSent;
+    UInt64              truncateAt;
+    Bool16              truncated = false;
+
+    track.Handler = FOUR_CHARS_TO_INT('v', 'i', 'd', 'e');
+    track.TimeScale = kVideoTimeScale;
+    track.SampleDelta = kVideoSampleDelta;
+    track.Entry = videoEntry;
+    track.EntryLength = MakeVideoEntry(videoEntry);
+    sRandom = 1000;
+    MakeVideoSamples(&track, samples, &samplesLength, kMaxSamples);
+
+    qtss_snprintf(moviePath, sizeof(moviePath), "%s/MP4PacketizerCheck.%d.truncated.mp4", directory, (int)::getpid());
+    if( !writer.Write(moviePath, samples, samplesLength, &track, 1) )
+    {
+        CheckFailed("%s: can't write the movie", moviePath);
+        return;
+    }
+
+    //
+    // Cut it at the start of the page that holds the sample three quarters
+    // of the way through, once half of the samples have been sent.
+    truncateAt = (kMovieSamplesStart + track.SampleOffsets[kMaxSamples * 3 / 4]) & ~((UInt64)::getpagesize() - 1);
+    if( truncateAt <= kMovieSamplesStart + track.SampleOffsets[kMaxSamples / 2 + 1] )
+    {
+        CheckFailed("%s: the samples are too short to cut the movie between them", moviePath);
+        (void)::unlink(moviePath);
+        return;
+    }
+
+    QTFile::SetMapFiles(true);
+    if( (rtpFile.Initialize(moviePath) != QTRTPFile::errNoError) || (rtpFile.AddTrack(1) != QTRTPFile::errNoError)
+        || (rtpFile.Seek(0.0) != QTRTPFile::errNoError) )
+    {
+        QTFile::SetMapFiles(false);
+        CheckFailed("%s: can't stream the movie", moviePath);
+        (void)::unlink(moviePath);
+        return;
+    }
+    QTFile::SetMapFiles(false);
+
+    if( !rtpFile.GetQTFile()->IsMapped() )
+        CheckFailed("%s: the movie is not mapped", moviePath);
+
+    //
+    // Every sample that still comes back must be the one that was written,
+    // and not what a mapping of the missing pages reads as.
+    depacketizer = NEW Depacketizer(moviePath, &track, samples, 96);
+    for( ;; )
+    {
+        (void)rtpFile.GetNextPacket(&packet, &packetLength);
+        if( packet == NULL )
+            break;
+
+        depacketizer->AddPacket(packet, (UInt32)packetLength);
+        if( !truncated && (depacketizer->GetNumAccessUnits() == kMaxSamples / 2) )
+        {
+            if( ::truncate(moviePath, (off_t)truncateAt) != 0 )
+            {
+                CheckFailed("%s: can't truncate the movie", moviePath);
+                break;
+            }
+            truncated = true;
+        }
+    }
+    numSamplesSent = depacketizer->GetNumAccessUnits();
+    delete depacketizer;
+
+    if( !truncated )
+        CheckFailed("%s: %lu samples sent, the movie was never cut", moviePath, numSamplesSent);
+    else if( numSamplesSent >= kMaxSamples )
+        CheckFailed("%s: all %lu samples sent after the movie was cut at byte %" _64BITARG_ "u", moviePath, numSamplesSent, truncateAt);
+    else if( rtpFile.GetQTFile()->IsMapped() )
+        CheckFailed("%s: still read through the mapping after it was cut", moviePath);
+    else
+        CheckPrintf("%s: cut at byte %" _64BITARG_ "u, the stream ends after %lu of %lu samples", moviePath,
+                    truncateAt, numSamplesSent, (UInt32)kMaxSamples);
+
+    (void)::unlink(moviePath);
+}
+
+void PacketizerCheck(int argc, char * argv[])
+{
+    // General vars
+    const char      *directory = (argc > 0) ? argv[0] : "/tmp";
+    char            moviePath[256];
+    char            *samples = NEW char[kMaxMovieLength];
+    UInt32          samplesLength;
+    char            videoEntry[256], audioEntry[256];
+    MovieWriter::Track  tracks[2];
+
+    QTRTPFile::Initialize();
+
+    for( UInt32 curSpec = 0; curSpec < sNumAudioSpecs; curSpec++ )
+    {
+        AudioSpec       *audioSpec = &sAudioSpecs[curSpec];
+        MovieWriter     writer;
+        UInt32          numTracks = 0;
+        char            rtpMap[64], config[64];
+        const char      *sdpLines[] = { "a=rtpmap:96 H264/90000",
+                                        "a=fmtp:96 packetization-mode=1;profile-level-id=42C01E;sprop-parameter-sets=Z0LAHtkAoEf+yA==,aM44gA==\r\n",
+                                        rtpMap, config, audioSpec->fProfileLevelID };
+
+        //
+        // The first movie has video and audio, the others only audio.
+        samplesLength = 0;
+        sRandom = curSpec + 1;
+        if( curSpec == 0 )
+        {
+            tracks[numTracks].Handler = FOUR_CHARS_TO_INT('v', 'i', 'd', 'e');
+            tracks[numTracks].TimeScale = kVideoTimeScale;
+            tracks[numTracks].SampleDelta = kVideoSampleDelta;
+            tracks[numTracks].Entry = videoEntry;
+            tracks[numTracks].EntryLength = MakeVideoEntry(videoEntry);
+            MakeVideoSamples(&tracks[numTracks], samples, &samplesLength, kMaxSamples);
+            numTracks++;
+        }
+
+        tracks[numTracks].Handler = FOUR_CHARS_TO_INT('s', 'o', 'u', 'n');
+        tracks[numTracks].TimeScale = audioSpec->fTimeScale;
+        tracks[numTracks].SampleDelta = kAudioSampleDelta;
+        tracks[numTracks].Entry = audioEntry;
+        tracks[numTracks].EntryLength = MakeAudioEntry(audioEntry, audioSpec);
+        MakeAudioSamples(&tracks[numTracks], samples, &samplesLength, kMaxSamples);
+        numTracks++;
+
+        qtss_sprintf(rtpMap, "%s\r\n", audioSpec->fRTPMap);
+        qtss_sprintf(config, "config=");
+        for( UInt32 curByte = 0; curByte < audioSpec->fConfigLength; curByte++ )
+            qtss_sprintf(config + ::strlen(config), "%02X", audioSpec->fConfig[curByte]);
+        qtss_sprintf(config + ::strlen(config), ";");
+
+        qtss_snprintf(moviePath, sizeof(moviePath), "%s/MP4PacketizerCheck.%d.%lu.mp4", directory, (int)::getpid(), curSpec);
+        if( !writer.Write(moviePath, samples, samplesLength, tracks, numTracks) )
+        {
+            CheckFailed("%s: can't write the movie", moviePath);
+            continue;
+        }
+
+        for( UInt32 mapped = 0; mapped < 2; mapped++ )
+            CheckMovie(moviePath, tracks, numTracks, samples,
+                       (numTracks == 2) ? sdpLines : sdpLines + 2, (numTracks == 2) ? 5 : 3, mapped != 0);
+        (void)::unlink(moviePath);
+    }
+
+    CheckBadNALLength(directory, samples);
+    CheckTruncatedMovie(directory, samples);
+
+    delete [] samples;
+}
@@ -89,6 +89,44 @@ public:
 
 
 protected:
+    //
+    // Binary searches of the NumEntries ascending values at Table. They
+    // return the index of the first value not less than (LowerBound) or
+    // greater than (UpperBound) Value, or NumEntries if there is none. The
+    // loop takes the same steps whatever Value is, so the compiler can turn
+    // its one comparison into a conditional move.
+    static inline UInt32 LowerBound(const UInt32 * Table, UInt32 NumEntries, UInt32 Value)
+    {
+        const UInt32    *base = Table;
+
+        if( NumEntries == 0 )
+            return 0;
+
+        while( NumEntries > 1 )
+        {
+            UInt32  half = NumEntries / 2;
+            base = (base[half] < Value) ? base + half : base;
+            NumEntries -= half;
+        }
+        return (UInt32)(base - Table) + (*base < Value);
+    }
+
+    static inline UInt32 UpperBound(const UInt32 * Table, UInt32 NumEntries, UInt32 Value)
+    {
+        const UInt32    *base = Table;
+
+        if( NumEntries == 0 )
+            return 0;
+
+        while( NumEntries > 1 )
+        {
+            UInt32  half = NumEntries / 2;
+            base = (base[half] <= Value) ? base + half : base;
+            NumEntries -= half;
+        }
+        return (UInt32)(base - Table) + (*base <= Value);
+    }
+
     //
     // Protected member variables.
     Bool16              fDebug, fDeepDebug;
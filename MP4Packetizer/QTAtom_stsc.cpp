@@ -127,7 +127,8 @@ void QTAtom_stsc_SampleTableControlBlock::Reset(void)
 //
 QTAtom_stsc::QTAtom_stsc(QTFile * File, QTFile::AtomTOCEntry * TOCEntry, Bool16 Debug, Bool16 DeepDebug)
     : QTAtom(File, TOCEntry, Debug, DeepDebug),
-      fNumEntries(0), fSampleToChunkTable(NULL), fTableSize(0)
+      fNumEntries(0), fSampleToChunkTable(NULL), fTableSize(0),
+      fEntryFirstSample(NULL)
 {
 }
 
@@ -143,6 +144,7 @@ QTAtom_stsc::~QTAtom_stsc(void)
         delete[] fSampleToChunkTable;
 #endif
 
+    delete [] fEntryFirstSample;
 }
 
 
@@ -181,12 +183,56 @@ Bool16 QTAtom_stsc::Initialize(void)
         return false;
     ReadBytes(stscPos_SampleTable, fSampleToChunkTable, fNumEntries * 12);
 #endif
+
+#if QTFILE_SAMPLE_TABLE_INDEX
+    this->BuildSearchTable();
+#endif
     
     //
     // This atom has been successfully read in.
     return true;
 }
 
+void QTAtom_stsc::BuildSearchTable(void)
+{
+    // General vars
+    UInt32      FirstChunk, SamplesPerChunk;
+    UInt32      lastFirstChunk = 1, lastSamplesPerChunk = 1;
+    UInt64      curSample = 1;
+
+    fEntryFirstSample = NEW UInt32[fNumEntries];
+
+    //
+    // Work out where each entry starts the same way SampleToChunkInfo's walk
+    // does. Give up (and leave the lookups to that walk) if the chunks go
+    // backwards, an entry has no samples per chunk or the sample numbers
+    // don't fit in 32 bits, as the answers wouldn't come out the same.
+    for( UInt32 CurEntry = 0; CurEntry < fNumEntries; CurEntry++ )
+    {
+        memcpy(&FirstChunk, fSampleToChunkTable + (CurEntry * 12) + 0, 4);
+        FirstChunk = ntohl(FirstChunk);
+        memcpy(&SamplesPerChunk, fSampleToChunkTable + (CurEntry * 12) + 4, 4);
+        SamplesPerChunk = ntohl(SamplesPerChunk);
+
+        if( FirstChunk < lastFirstChunk )
+            break;
+
+        curSample += (UInt64)(FirstChunk - lastFirstChunk) * lastSamplesPerChunk;
+        if( (SamplesPerChunk == 0) || (curSample > 0xFFFFFFFF) )
+            break;
+
+        fEntryFirstSample[CurEntry] = (UInt32)curSample;
+        lastFirstChunk = FirstChunk;
+        lastSamplesPerChunk = SamplesPerChunk;
+
+        if( CurEntry + 1 == fNumEntries )
+            return;
+    }
+
+    delete [] fEntryFirstSample;
+    fEntryFirstSample = NULL;
+}
+
 
 
 // -------------------------------------
@@ -451,6 +497,53 @@ Bool16 QTAtom_stsc::SampleToChunkInfo(UInt32 SampleNumber,  UInt32 *samplesPerCh
     }
 //  qtss_printf("QTAtom_stsc::SampleToChunkInfo missed cache SampleNumber = %ld\n",SampleNumber);
 
+#if QTFILE_SAMPLE_TABLE_INDEX
+    if( (fEntryFirstSample != NULL) && (SampleNumber >= fEntryFirstSample[0]) )
+    {
+        UInt32  curEntry = STCB->fCurEntry_SampleToChunkInfo - 1;
+
+        //
+        // Find the last entry that starts at or before the given sample,
+        // starting with the one the last lookup ended in.
+        if( !( (STCB->fCurEntry_SampleToChunkInfo > 0) && (curEntry < fNumEntries)
+               && (fEntryFirstSample[curEntry] <= SampleNumber)
+               && ((curEntry + 1 == fNumEntries) || (SampleNumber < fEntryFirstSample[curEntry + 1])) ) )
+            curEntry = UpperBound(fEntryFirstSample, fNumEntries, SampleNumber) - 1;
+
+        memcpy(&FirstChunk, fSampleToChunkTable + (curEntry * 12) + 0, 4);
+        FirstChunk = ntohl(FirstChunk);
+        memcpy(&SamplesPerChunk, fSampleToChunkTable + (curEntry * 12) + 4, 4);
+        SamplesPerChunk = ntohl(SamplesPerChunk);
+        memcpy(&SampleDescription, fSampleToChunkTable + (curEntry * 12) + 8, 4);
+        SampleDescription = ntohl(SampleDescription);
+
+        aChunkNumber = FirstChunk + ((SampleNumber - fEntryFirstSample[curEntry]) / SamplesPerChunk);
+        aSampleDescriptionIndex = SampleDescription;
+        aSampleOffsetInChunk = SampleNumber - (fEntryFirstSample[curEntry] + ((aChunkNumber - FirstChunk) * SamplesPerChunk));
+        aSamplesPerChunk = SamplesPerChunk;
+
+        if( ChunkNumber != NULL )
+            *ChunkNumber = aChunkNumber;
+        if( SampleDescriptionIndex != NULL )
+            *SampleDescriptionIndex = aSampleDescriptionIndex;
+        if( SampleOffsetInChunk != NULL )
+            *SampleOffsetInChunk = aSampleOffsetInChunk;
+        if (NULL != samplesPerChunk) 
+             *samplesPerChunk = aSamplesPerChunk;
+
+        //
+        // Leave the STCB where the linear search would have, so the two can
+        // be mixed.
+        STCB->fCurEntry_SampleToChunkInfo = curEntry + 1;
+        STCB->fCurSample_SampleToChunkInfo = fEntryFirstSample[curEntry];
+        STCB->fLastFirstChunk_SampleToChunkInfo = FirstChunk;
+        STCB->fLastSamplesPerChunk_SampleToChunkInfo = SamplesPerChunk;
+        STCB->fLastSampleDescription_SampleToChunkInfo = SampleDescription;
+
+        goto done;
+    }
+#endif
+
     //
     // Assume that this sample came out of the last chunk.
     aChunkNumber = STCB->fLastFirstChunk_SampleToChunkInfo + ((SampleNumber - STCB->fCurSample_SampleToChunkInfo) / STCB->fLastSamplesPerChunk_SampleToChunkInfo) ;
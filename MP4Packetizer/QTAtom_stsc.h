@@ -137,6 +137,11 @@ public:
 
 
 protected:
+    //
+    // Builds fEntryFirstSample, unless the table is out of order or the
+    // movie is too long for it.
+            void        BuildSearchTable(void);
+
     //
     // Protected member variables.
     UInt8       fVersion;
@@ -145,6 +150,11 @@ protected:
     UInt32      fNumEntries;
     char        *fSampleToChunkTable;
     UInt32      fTableSize;
+
+    //
+    // The first sample number of each entry, or NULL if SampleToChunkInfo
+    // walks fSampleToChunkTable instead.
+    UInt32      *fEntryFirstSample;
 };
 
 #endif // QTAtom_stsc_H
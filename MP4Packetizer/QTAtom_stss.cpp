@@ -68,7 +68,8 @@ const int       stssPos_SampleTable         =  8;
 //
 QTAtom_stss::QTAtom_stss(QTFile * File, QTFile::AtomTOCEntry * TOCEntry, Bool16 Debug, Bool16 DeepDebug)
     : QTAtom(File, TOCEntry, Debug, DeepDebug),
-      fNumEntries(0), fSyncSampleTable(NULL), fTable(NULL), fTableSize(0)
+      fNumEntries(0), fSyncSampleTable(NULL), fTable(NULL), fTableSize(0),
+      fTableIsSorted(false)
 {
 }
 
@@ -150,6 +151,22 @@ Bool16 QTAtom_stss::Initialize(void)
                 fTable[sampleIndex] = ntohl( fTable[sampleIndex] );
             
             }
+
+#if QTFILE_SAMPLE_TABLE_INDEX
+            //
+            // The sync samples should be in ascending order; if they are, the
+            // lookups can binary search the table and still find what a scan
+            // would.
+            fTableIsSorted = true;
+            for ( sampleIndex = 1; sampleIndex < fNumEntries; sampleIndex++ )
+            {
+                if ( fTable[sampleIndex - 1] >= fTable[sampleIndex] )
+                {
+                    fTableIsSorted = false;
+                    break;
+                }
+            }
+#endif
         
         }
 
@@ -170,6 +187,14 @@ void QTAtom_stss::PreviousSyncSample(UInt32 SampleNumber, UInt32 *SyncSampleNumb
     //
     // We assume that we won't find an answer
     *SyncSampleNumber = SampleNumber;
+
+    if( fTableIsSorted )
+    {
+        UInt32  CurEntry = UpperBound(fTable, fNumEntries, SampleNumber);
+        if( CurEntry > 0 )
+            *SyncSampleNumber = fTable[CurEntry - 1];
+        return;
+    }
     
     //
     // Scan the table until we find a sample number greater than our current
@@ -187,6 +212,14 @@ void QTAtom_stss::NextSyncSample(UInt32 SampleNumber, UInt32 *SyncSampleNumber)
     //
     // We assume that we won't find an answer
     *SyncSampleNumber = SampleNumber + 1;
+
+    if( fTableIsSorted )
+    {
+        UInt32  CurEntry = UpperBound(fTable, fNumEntries, SampleNumber);
+        if( CurEntry < fNumEntries )
+            *SyncSampleNumber = fTable[CurEntry];
+        return;
+    }
     
     //
     // Scan the table until we find a sample number greater than our current
@@ -61,6 +61,11 @@ public:
             inline Bool16       IsSyncSample(UInt32 SampleNumber, UInt32 inCursor)
             {
                 Assert(inCursor <= fNumEntries);
+                if (fTableIsSorted)
+                {
+                    UInt32 curEntry = inCursor + LowerBound(fTable + inCursor, fNumEntries - inCursor, SampleNumber);
+                    return (curEntry < fNumEntries) && (fTable[curEntry] == SampleNumber);
+                }
                 for (UInt32 curEntry = inCursor; curEntry < fNumEntries; curEntry++)
                 {
                     if (fTable[curEntry] == SampleNumber)
@@ -88,6 +93,7 @@ protected:
     char        *fSyncSampleTable;
     UInt32      *fTable; // longword-aligned version of the above
     UInt32      fTableSize;
+    Bool16      fTableIsSorted; // binary search fTable instead of scanning it
 };
 
 #endif // QTAtom_stss_H
@@ -70,7 +70,7 @@ const int       stszPos_SampleTable         = 12;
 QTAtom_stsz::QTAtom_stsz(QTFile * File, QTFile::AtomTOCEntry * TOCEntry, Bool16 Debug, Bool16 DeepDebug)
     : QTAtom(File, TOCEntry, Debug, DeepDebug),
       fCommonSampleSize(0),
-      fNumEntries(0), fSampleSizeTable(NULL), fTable(NULL)
+      fNumEntries(0), fTotalSampleSize(0), fSampleSizeTable(NULL), fTable(NULL)
 {
 }
 
@@ -101,16 +101,22 @@ Bool16 QTAtom_stsz::Initialize(void)
 
     ReadInt32(stszPos_SampleSize, &fCommonSampleSize);
     
+    //
+    // The sample count is there either way.
+    ReadInt32(stszPos_NumEntries, &fNumEntries);
+
     //
     // We don't need to read in the table (it doesn't exist anyway) if the
     // SampleSize field is non-zero.
     if( fCommonSampleSize != 0 )
+    {
+        fTotalSampleSize = (UInt64)fCommonSampleSize * fNumEntries;
         return true;
+    }
 
 
     //
     // Build the table..
-    ReadInt32(stszPos_NumEntries, &fNumEntries);
 
     //
     // Validate the size of the sample table.
@@ -130,6 +136,9 @@ Bool16 QTAtom_stsz::Initialize(void)
     
     ReadBytes(stszPos_SampleTable, (char *)fTable, fNumEntries * 4);
 
+    for( UInt32 curEntry = 0; curEntry < fNumEntries; curEntry++ )
+        fTotalSampleSize += ntohl(fTable[curEntry]);
+
     //
     // This atom has been successfully read in.
     return true;
@@ -195,6 +204,13 @@ void QTAtom_stsz::DumpTable(void)
     qtss_printf("  Sample Num   SampleSize\n");
     qtss_printf("  ----------   ----------\n");
     
+    //
+    // Tracks with a constant sample size have no table.
+    if( fTable == NULL ) {
+        qtss_printf("  %10lu samples of %10lu\n", fNumEntries, fCommonSampleSize);
+        return;
+    }
+
     //
     // Print the table.
     for( UInt32 CurEntry = 1; CurEntry <= fNumEntries; CurEntry++ ) {
@@ -77,6 +77,7 @@ public:
 
     inline  UInt32      GetNumEntries() {return fNumEntries;}
     inline  UInt32      GetCommonSampleSize() {return fCommonSampleSize;}
+    inline  UInt64      GetTotalSampleSize() {return fTotalSampleSize;}
 
 protected:
     //
@@ -85,6 +86,7 @@ protected:
     UInt32      fFlags; // 24 bits in the low 3 bytes
     UInt32      fCommonSampleSize;
     UInt32      fNumEntries;
+    UInt64      fTotalSampleSize; // all the samples, summed once in Initialize
     char        *fSampleSizeTable;
     UInt32      *fTable; // longword-aligned version of the above
 };
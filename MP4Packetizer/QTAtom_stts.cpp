@@ -98,7 +98,8 @@ void QTAtom_stts_SampleTableControlBlock::Reset(void)
 //
 QTAtom_stts::QTAtom_stts(QTFile * File, QTFile::AtomTOCEntry * TOCEntry, Bool16 Debug, Bool16 DeepDebug)
     : QTAtom(File, TOCEntry, Debug, DeepDebug),
-      fNumEntries(0), fTimeToSampleTable(NULL), fTableSize(0)
+      fNumEntries(0), fTimeToSampleTable(NULL), fTableSize(0),
+      fEntryFirstSample(NULL), fEntryMediaTime(NULL)
 {
 }
 
@@ -114,6 +115,9 @@ QTAtom_stts::~QTAtom_stts(void)
         delete[] fTimeToSampleTable;
 #endif
 
+    delete [] fEntryFirstSample;
+    delete [] fEntryMediaTime;
+
 
 }
 
@@ -157,11 +161,52 @@ Bool16 QTAtom_stts::Initialize(void)
     ReadBytes(sttsPos_SampleTable, fTimeToSampleTable, fNumEntries * 8);
 #endif
 
+#if QTFILE_SAMPLE_TABLE_INDEX
+    this->BuildSearchTables();
+#endif
+
     //
     // This atom has been successfully read in.
     return true;
 }
 
+void QTAtom_stts::BuildSearchTables(void)
+{
+    // General vars
+    UInt32      SampleCount, SampleDuration;
+    UInt64      curSample = 1, curMediaTime = 0;
+
+    fEntryFirstSample = NEW UInt32[fNumEntries + 1];
+    fEntryMediaTime = NEW UInt32[fNumEntries + 1];
+
+    //
+    // Sum up the entries, giving up (and walking the table on every lookup,
+    // as before) if the totals don't fit the 32 bit lookups.
+    for( UInt32 CurEntry = 0; CurEntry <= fNumEntries; CurEntry++ )
+    {
+        if( (curSample > 0xFFFFFFFF) || (curMediaTime > 0xFFFFFFFF) )
+        {
+            delete [] fEntryFirstSample;
+            delete [] fEntryMediaTime;
+            fEntryFirstSample = fEntryMediaTime = NULL;
+            return;
+        }
+
+        fEntryFirstSample[CurEntry] = (UInt32)curSample;
+        fEntryMediaTime[CurEntry] = (UInt32)curMediaTime;
+        if( CurEntry == fNumEntries )
+            break;
+
+        memcpy(&SampleCount, fTimeToSampleTable + (CurEntry * 8), 4);
+        SampleCount = ntohl(SampleCount);
+        memcpy(&SampleDuration, fTimeToSampleTable + (CurEntry * 8) + 4, 4);
+        SampleDuration = ntohl(SampleDuration);
+
+        curSample += SampleCount;
+        curMediaTime += (UInt64)SampleCount * SampleDuration;
+    }
+}
+
 
 
 // -------------------------------------
@@ -173,6 +218,39 @@ Bool16 QTAtom_stts::MediaTimeToSampleNumber(UInt32 MediaTime, UInt32 * SampleNum
     UInt32      SampleCount, SampleDuration;
     QTAtom_stts_SampleTableControlBlock *tempSTCB = NULL;
     Bool16      result = false;
+
+#if QTFILE_SAMPLE_TABLE_INDEX
+    if( fEntryMediaTime != NULL )
+    {
+        UInt32  curEntry = (STCB != NULL) ? STCB->fMTtSN_CurEntry : 0;
+
+        //
+        // Find the first entry that ends at or after the given media time,
+        // starting with the one the last lookup ended in.
+        if( !( (curEntry < fNumEntries) && (MediaTime <= fEntryMediaTime[curEntry + 1])
+               && ((curEntry == 0) || (fEntryMediaTime[curEntry] < MediaTime)) ) )
+            curEntry = LowerBound(fEntryMediaTime + 1, fNumEntries, MediaTime);
+
+        if( (curEntry >= fNumEntries) || (SampleNumber == NULL) )
+            return false;
+
+        if( STCB != NULL )
+        {
+            STCB->fMTtSN_CurEntry = curEntry;
+            STCB->fMTtSN_CurMediaTime = fEntryMediaTime[curEntry];
+            STCB->fMTtSN_CurSample = fEntryFirstSample[curEntry];
+        }
+
+        memcpy(&SampleDuration, fTimeToSampleTable + (curEntry * 8) + 4, 4);
+        SampleDuration = ntohl(SampleDuration);
+
+        *SampleNumber = fEntryFirstSample[curEntry];
+        if (SampleDuration > 0)
+            *SampleNumber += (MediaTime - fEntryMediaTime[curEntry]) / SampleDuration;
+        return true;
+    }
+#endif
+
     //
     // Use the default STCB if one was not passed in to us.
     if( STCB == NULL )
@@ -240,6 +318,37 @@ Bool16 QTAtom_stts::SampleNumberToMediaTime(UInt32 SampleNumber, UInt32 * MediaT
         return true;
     }
 
+#if QTFILE_SAMPLE_TABLE_INDEX
+    if( fEntryFirstSample != NULL )
+    {
+        UInt32  curEntry = STCB->fSNtMT_CurEntry;
+
+        //
+        // Find the first entry that ends at or after the given sample,
+        // starting with the one the last lookup ended in.
+        if( !( (curEntry < fNumEntries) && (SampleNumber <= fEntryFirstSample[curEntry + 1])
+               && ((curEntry == 0) || (fEntryFirstSample[curEntry] < SampleNumber)) ) )
+            curEntry = LowerBound(fEntryFirstSample + 1, fNumEntries, SampleNumber);
+
+        if( curEntry >= fNumEntries )
+            return false;
+
+        STCB->fSNtMT_CurEntry = curEntry;
+        STCB->fSNtMT_CurMediaTime = fEntryMediaTime[curEntry];
+        STCB->fSNtMT_CurSample = fEntryFirstSample[curEntry];
+
+        memcpy(&SampleDuration, fTimeToSampleTable + (curEntry * 8) + 4, 4);
+        SampleDuration = ntohl(SampleDuration);
+
+        if( MediaTime != NULL )
+            *MediaTime = fEntryMediaTime[curEntry] + ((SampleNumber - fEntryFirstSample[curEntry]) * SampleDuration);
+
+        STCB->fGetSampleMediaTime_SampleNumber = SampleNumber;
+        STCB->fGetSampleMediaTime_MediaTime = *MediaTime;
+
+        return true;
+    }
+#endif
 
     //
     // Reconfigure the STCB if necessary.
@@ -520,7 +629,7 @@ Bool16 QTAtom_ctts::SampleNumberToMediaTimeOffset(UInt32 SampleNumber, UInt32 *
 
         //
         // Can we skip over this entry?
-        if( STCB->fSNtMT_CurSample + SampleCount < SampleNumber ) {
+        if( STCB->fSNtMT_CurSample + SampleCount <= SampleNumber ) {
             STCB->fSNtMT_CurMediaTime += SampleCount * SampleOffset;
             STCB->fSNtMT_CurSample += SampleCount;
             continue;
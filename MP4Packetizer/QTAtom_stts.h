@@ -97,6 +97,11 @@ public:
     virtual void        DumpTable(void);
 
 protected:
+    //
+    // Builds fEntryFirstSample and fEntryMediaTime, unless the movie is too
+    // long for them.
+            void        BuildSearchTables(void);
+
     //
     // Protected member variables.
     UInt8       fVersion;
@@ -105,6 +110,13 @@ protected:
     UInt32      fNumEntries;
     char        *fTimeToSampleTable;
     UInt32      fTableSize;
+
+    //
+    // The first sample number and media time of each entry, and the sample
+    // number and media time just past the last one (so fNumEntries + 1 of
+    // each), or NULL if the lookups walk fTimeToSampleTable instead.
+    UInt32      *fEntryFirstSample;
+    UInt32      *fEntryMediaTime;
     
 };
 
@@ -0,0 +1,83 @@
+/***************************************************************************
+
+Copyright (c) 1999-2003 Apple Computer, Inc.  All Rights Reserved.
+2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 QTBuildPacketIndex.cpp
+Description: Build the packet index sidecar file ("<movie>.pidx") of movies
+             ahead of time, so their seeks don't scan until the server has.
+Comment:     usage: QTBuildPacketIndex movie ...
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-17
+LastUpdate:  2026-10-17
+
+****************************************************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "SafeStdLib.h"
+#include "OS.h"
+#include "OSThread.h"
+#include "QTFile.h"
+#include "QTTrack.h"
+#include "QTPacketIndex.h"
+
+
+static Bool16 BuildPacketIndex(const char * moviePath)
+{
+    // General vars
+    QTFile          file;
+    QTTrack         *track;
+    QTPacketIndex   *index;
+    Bool16          written;
+
+    if( file.Open(moviePath) != QTFile::errNoError )
+    {
+        qtss_fprintf(stderr, "%s: can't open the movie.\n", moviePath);
+        return false;
+    }
+
+    index = QTPacketIndex::Build(&file);
+    if( index == NULL )
+    {
+        qtss_fprintf(stderr, "%s: no tracks to index.\n", moviePath);
+        return false;
+    }
+
+    for( track = NULL; file.NextTrack(&track, track); )
+    {
+        if( index->GetNumEntries(track->GetTrackID()) > 0 )
+            qtss_printf("%s: track %lu, %lu samples, %lu entries\n", moviePath, track->GetTrackID(),
+                        track->GetNumSamples(), index->GetNumEntries(track->GetTrackID()));
+    }
+
+    written = index->Write();
+    if( !written )
+        qtss_fprintf(stderr, "%s: can't write %s.pidx.\n", moviePath, moviePath);
+
+    delete index;
+    return written;
+}
+
+int main(int argc, char * argv[])
+{
+    int     result = 0;
+
+    if( argc < 2 )
+    {
+        qtss_fprintf(stderr, "usage: %s movie ...\n", argv[0]);
+        return 1;
+    }
+
+    OS::Initialize();
+    OSThread::Initialize();
+
+    for( int curArg = 1; curArg < argc; curArg++ )
+        if( !BuildPacketIndex(argv[curArg]) )
+            result = 1;
+
+    return result;
+}
@@ -16,6 +16,10 @@ LastUpdate:  2010-08-19
 
 
 #include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <signal.h>
 #include <netinet/in.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -30,6 +34,7 @@ LastUpdate:  2010-08-19
 
 #include "QTTrack.h"
 #include "QTHintTrack.h"
+#include "QTPacketIndex.h"
 #include "OSMemory.h"
 
 
@@ -45,6 +50,79 @@ LastUpdate:  2010-08-19
 #define DEEP_DEBUG_PRINT(s) if(fDeepDebug) qtss_printf s
 
 
+// -------------------------------------
+// Mapped files
+//
+// Reading a page of a mapping that is past the end of its file raises SIGBUS,
+// which happens when a movie is truncated while it is being played. Every
+// mapping is entered in this table so that our SIGBUS handler can tell such a
+// fault from any other. The handler reads the table without a lock, so an
+// entry's base is set last when it is added and cleared first when it goes.
+struct QTFileMapping {
+    char * volatile     fBase;
+    volatile UInt64     fLength;
+    volatile Bool16     fTruncated;
+};
+
+static const UInt32         kMaxMappedFiles = 1024;
+static QTFileMapping        sMappings[kMaxMappedFiles];
+static OSMutex              sMappingsMutex;
+static Bool16               sBusHandlerInstalled = false;
+static struct sigaction     sOldBusAction;
+static UInt64               sPageSize = 0;
+
+Bool16 QTFile::sMapFiles = false;
+
+static void BusErrorHandler(int /*inSignal*/, siginfo_t* inInfo, void* /*inContext*/)
+{
+    char* theAddr = (char*)inInfo->si_addr;
+    for (UInt32 theSlot = 0; theSlot < kMaxMappedFiles; theSlot++)
+    {
+        char* theBase = sMappings[theSlot].fBase;
+        if ((theBase == NULL) || (theAddr < theBase) || ((UInt64)(theAddr - theBase) >= sMappings[theSlot].fLength))
+            continue;
+
+        //
+        // The file has shrunk under this mapping. Put a page of zeros where
+        // the missing page was, so the faulting read finishes, and mark the
+        // file so that the reads after it go through fMovieFD. Those fail
+        // past the new end of the file, which ends the stream.
+        char* thePage = theBase + ((UInt64)(theAddr - theBase) & ~(sPageSize - 1));
+        if (::mmap(thePage, (size_t)sPageSize, PROT_READ, MAP_PRIVATE | MAP_ANON | MAP_FIXED, -1, 0) != MAP_FAILED)
+        {
+            sMappings[theSlot].fTruncated = true;
+            return;
+        }
+        break;
+    }
+
+    //
+    // Not ours. Put back whatever was there before us, and the fault raises
+    // SIGBUS again when we return.
+    (void)::sigaction(SIGBUS, &sOldBusAction, NULL);
+}
+
+void QTFile::SetMapFiles(Bool16 mapFiles)
+{
+    OSMutexLocker locker(&sMappingsMutex);
+    if (mapFiles && !sBusHandlerInstalled)
+    {
+        sPageSize = (UInt64)::getpagesize();
+
+        struct sigaction theAction;
+        ::memset(&theAction, 0, sizeof(theAction));
+        theAction.sa_sigaction = BusErrorHandler;
+        theAction.sa_flags = SA_SIGINFO;
+        ::sigemptyset(&theAction.sa_mask);
+        if (::sigaction(SIGBUS, &theAction, &sOldBusAction) != 0)
+            return; // without the handler, mapping isn't safe
+        sBusHandlerInstalled = true;
+    }
+
+    sMapFiles = mapFiles;
+}
+
+
 
 // -------------------------------------
 // Constructors and destructors
@@ -61,7 +139,10 @@ QTFile::QTFile(Bool16 Debug, Bool16 DeepDebug)
     fNumTracks(0),
     fFirstTrack(NULL), fLastTrack(NULL),
     fMovieHeaderAtom(NULL), 
-    fFile(-1)
+    fReadMutex(NULL),
+    fPacketIndexMutex(NULL), fPacketIndex(NULL), fPacketIndexOpened(false), fPacketIndexBuilds(0),
+    fFile(-1),
+    fMapBase(NULL), fMapLength(0), fMapSlot(0)
 {
 }
 
@@ -102,11 +183,28 @@ QTFile::~QTFile(void)
             NextTOCEntry = TOCEntry->NextOrdAtom;
     }
     
+    //
+    // Free the packet index.
+    if( fPacketIndex != NULL )
+        delete fPacketIndex;
+
     //
     // Delete our mutexen.
     if( fReadMutex != NULL )
         delete fReadMutex;
+    if( fPacketIndexMutex != NULL )
+        delete fPacketIndexMutex;
     
+    //
+    // Drop the mapping.
+    if( fMapBase != NULL ) {
+        {
+            OSMutexLocker locker(&sMappingsMutex);
+            sMappings[fMapSlot].fBase = NULL;
+        }
+        (void)::munmap(fMapBase, (size_t)fMapLength);
+    }
+
     //
     // Free our path.
     if( fMoviePath != NULL )
@@ -135,6 +233,7 @@ QTFile::ErrorCode QTFile::Open(const char * MoviePath)
     fReadMutex = NEW OSMutex();
     if( fReadMutex == NULL )
         return errInternalError;
+    fPacketIndexMutex = NEW OSMutex();
 
 
     //
@@ -182,6 +281,11 @@ QTFile::ErrorCode QTFile::Open(const char * MoviePath)
     DEBUG_PRINT(("QTFile::Open - Generating Atom TOC.\n"));
     if( !GenerateAtomTOC() )
         return errInvalidQuickTimeFile;
+
+    //
+    // Now that we know it's a movie, map it. This is done after generating the
+    // TOC because ValidTOC looks at where the reads through fMovieFD got to.
+    this->MapFile();
     
 
     //
@@ -271,6 +375,9 @@ QTFile::ErrorCode QTFile::Open(const char * MoviePath)
 
 void QTFile::AllocateBuffers(UInt32 inUnitSizeInK, UInt32 inBufferInc, UInt32 inBufferSizeUnits, UInt32 inMaxBitRateBuffSizeInBlocks, UInt32 inBitrate)
 {
+    // A mapped movie is read without the file cache
+    if (fMapBase != NULL)
+        return;
 
 #if DSS_USE_API_CALLBACKS
     if (fOSFileSourceFD != NULL)
@@ -563,6 +670,22 @@ SInt64 QTFile::GetModDate()
 // Read functions.
 Bool16 QTFile::Read(UInt64 Offset, char * const Buffer, UInt32 Length, QTFile_FileControlBlock * FCB)
 {
+    //
+    // Data in the movie file itself comes straight out of the mapping. An FCB
+    // only has a file of its own for data references to other files.
+    if( this->IsMapped() && ((FCB == NULL) || !FCB->IsValid()) )
+    {
+        if( (Offset > fMapLength) || (Length > fMapLength - Offset) )
+            return false;
+        ::memcpy(Buffer, fMapBase + Offset, Length);
+
+        //
+        // If the file turned out to be truncated while we copied, some of
+        // Buffer is zeros. Read it again through fMovieFD.
+        if( !sMappings[fMapSlot].fTruncated )
+            return true;
+    }
+
     // General vars
     OSMutexLocker   ReadMutex(fReadMutex);
     Bool16 rv = false;
@@ -870,16 +993,135 @@ lbl_SkipAtom:
 }
 
 
+void QTFile::MapFile(void)
+{
+    if( !sMapFiles )
+        return;
+
+    //
+    // Map our own descriptor rather than fMovieFD's, which inside the server
+    // belongs to the file system module. The mapping outlives the descriptor.
+    int theFD = ::open(fMoviePath, O_RDONLY);
+    if( theFD == -1 )
+        return;
+
+    struct stat theStat;
+    if( (::fstat(theFD, &theStat) == 0) && (theStat.st_size > 0) &&
+        ((UInt64)theStat.st_size == (UInt64)(size_t)theStat.st_size) )
+    {
+        void* theAddr = ::mmap(NULL, (size_t)theStat.st_size, PROT_READ, MAP_PRIVATE, theFD, 0);
+        if( theAddr != MAP_FAILED )
+        {
+            //
+            // Enter it in the table first. A mapping the SIGBUS handler
+            // doesn't know about isn't safe to read.
+            OSMutexLocker locker(&sMappingsMutex);
+            for( UInt32 theSlot = 0; theSlot < kMaxMappedFiles; theSlot++ )
+            {
+                if( sMappings[theSlot].fBase != NULL )
+                    continue;
+
+                sMappings[theSlot].fLength = (UInt64)theStat.st_size;
+                sMappings[theSlot].fTruncated = false;
+                sMappings[theSlot].fBase = (char *)theAddr;
+                fMapBase = (char *)theAddr;
+                fMapLength = (UInt64)theStat.st_size;
+                fMapSlot = theSlot;
+                break;
+            }
+        }
+        if( fMapBase == NULL )
+        {
+            if( theAddr != MAP_FAILED )
+                (void)::munmap(theAddr, (size_t)theStat.st_size);
+        }
+        else
+        {
+            // Clients mostly play through the file front to back, let the
+            // kernel read ahead aggressively. AdviseWillNeed does the rest.
+            (void)::madvise(fMapBase, (size_t)fMapLength, MADV_SEQUENTIAL);
+        }
+    }
+    (void)::close(theFD);
+
+    DEBUG_PRINT(("QTFile::MapFile - %s mapped %" _64BITARG_ "u bytes.\n", fMoviePath, fMapLength));
+}
+
+Bool16 QTFile::IsMapped()
+{
+    return (fMapBase != NULL) && !sMappings[fMapSlot].fTruncated;
+}
+
 char *QTFile::MapFileToMem(UInt64 offset, UInt32 length)
 {
-	return NULL;
+    if( !this->IsMapped() || (offset > fMapLength) || (length > fMapLength - offset) )
+        return NULL;
+
+    //
+    // Our caller reads the range whenever it gets to it, after we have gone.
+    // Touch every page of it now, so that a truncated file is found while we
+    // can still say so.
+    if( length > 0 )
+    {
+        UInt64 thePage = offset & ~(sPageSize - 1);
+        for( ; thePage < offset + length; thePage += sPageSize )
+            (void)*(volatile char *)(fMapBase + ((thePage < offset) ? offset : thePage));
+        if( sMappings[fMapSlot].fTruncated )
+            return NULL;
+    }
+
+    return fMapBase + offset;
 }
 
-int QTFile::UnmapMem(char* memPtr, UInt32 length)
+int QTFile::UnmapMem(char* /*memPtr*/, UInt32 /*length*/)
 {
+    // Everything MapFileToMem hands out is part of the one mapping of the
+    // whole file, which goes away with us
     return 0;
 }
 
+void QTFile::AdviseWillNeed(UInt64 offset, UInt32 length)
+{
+    if( !this->IsMapped() || (offset >= fMapLength) )
+        return;
+
+    if( length > fMapLength - offset )
+        length = (UInt32)(fMapLength - offset);
+
+    // madvise wants a page aligned address
+    static const UInt64 sPageMask = (UInt64)::getpagesize() - 1;
+    UInt64 theStart = offset & ~sPageMask;
+    (void)::madvise(fMapBase + theStart, (size_t)(offset + length - theStart), MADV_WILLNEED);
+}
+
+QTPacketIndex* QTFile::GetPacketIndex()
+{
+#if QTFILE_PACKET_INDEX
+    //
+    // Everyone playing the movie shares the index. The first to ask for it
+    // reads it, or has it built; after that the sidecar is only read again
+    // when the builder thread has finished with a movie.
+    OSMutexLocker   locker(fPacketIndexMutex);
+    if( !fPacketIndexOpened )
+    {
+        fPacketIndexBuilds = QTPacketIndex::GetNumBuilds();
+        fPacketIndex = QTPacketIndex::Open(this);
+        fPacketIndexOpened = true;
+
+        DEBUG_PRINT(("QTFile::GetPacketIndex - %s %s.\n", fMoviePath, (fPacketIndex != NULL) ? "indexed" : "not indexed yet"));
+    }
+    else if( (fPacketIndex == NULL) && (fPacketIndexBuilds != QTPacketIndex::GetNumBuilds()) )
+    {
+        fPacketIndexBuilds = QTPacketIndex::GetNumBuilds();
+        fPacketIndex = QTPacketIndex::Read(this);
+    }
+
+    return fPacketIndex;
+#else
+    return NULL;
+#endif
+}
+
 
 // -------------------------------------
 // Debugging functions.
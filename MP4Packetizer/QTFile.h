@@ -30,6 +30,7 @@ class OSFileSource;
 class FileMap;
 class QTAtom_mvhd;
 class QTTrack;
+class QTPacketIndex;
 
 
 //
@@ -88,6 +89,11 @@ public:
                         QTFile(Bool16 Debug = false, Bool16 DeepDebug = false);
     virtual             ~QTFile(void);
 
+    //
+    // Turns memory mapped reads on or off for the movies opened from now on.
+    // They are off until this is called.
+    static  void        SetMapFiles(Bool16 mapFiles);
+
 
     //
     // Open a movie file and generate the atom table of contents.
@@ -132,11 +138,28 @@ public:
 
     inline Bool16       ValidTOC();
             
-            
-            char*      MapFileToMem(UInt64 offset, UInt32 length);
-            
+    //
+    // Memory mapped reads (SetMapFiles). When the movie is mapped, Read
+    // copies straight out of the mapping for data in the movie file itself, and
+    // MapFileToMem returns a pointer to the given range of the file (or NULL if
+    // the file isn't mapped or the range isn't in it). The pointer stays good
+    // for the life of this object, UnmapMem has nothing to do. Once the file is
+    // found to have been truncated under the mapping, IsMapped returns false,
+    // MapFileToMem returns NULL and reads go back through fMovieFD.
+            Bool16      IsMapped();
+            char*       MapFileToMem(UInt64 offset, UInt32 length);
             int         UnmapMem(char *memPtr, UInt32 length);
 
+    //
+    // Tells the VM system we are about to read this range of the mapping
+            void        AdviseWillNeed(UInt64 offset, UInt32 length);
+
+    //
+    // The movie's packet index (QTFILE_PACKET_INDEX), read from its sidecar
+    // file. Returns NULL while the index is being built in the background, and
+    // if the movie can't have one.
+            QTPacketIndex*  GetPacketIndex();
+
     //
     // Debugging functions.
             void        DumpAtomTOC(void);
@@ -145,6 +168,7 @@ protected:
     //
     // Protected member functions.
             Bool16      GenerateAtomTOC(void);
+            void        MapFile(void);
     
     //
     // Protected member variables.
@@ -170,7 +194,19 @@ protected:
     QTAtom_mvhd         *fMovieHeaderAtom;
     
     OSMutex             *fReadMutex;
+    OSMutex             *fPacketIndexMutex;
+    QTPacketIndex       *fPacketIndex;
+    Bool16              fPacketIndexOpened;
+    UInt32              fPacketIndexBuilds; // QTPacketIndex::GetNumBuilds when we last looked
     int                  fFile;
+
+    // the whole movie file, read only (NULL if it couldn't be mapped), and
+    // its slot in the table of mappings the SIGBUS handler looks through
+    char                *fMapBase;
+    UInt64              fMapLength;
+    UInt32              fMapSlot;
+
+    static Bool16       sMapFiles;
                         
 };
 
@@ -126,8 +126,9 @@ QTHintTrack_HintTrackControlBlock::QTHintTrack_HintTrackControlBlock(QTFile_File
     : fFCB(FCB),
     
       fCachedSampleNumber(0),
-      fCachedSample(NULL),
+      fCachedSample(NULL), fSampleBuffer(NULL),
       fCachedSampleSize(0), fCachedSampleLength(0),
+      fAdviseStart(0), fAdviseEnd(0),
 
       fCachedHintTrackSampleNumber(0), fCachedHintTrackSampleOffset(0),
       fCachedHintTrackSample(NULL),
@@ -148,7 +149,7 @@ QTHintTrack_HintTrackControlBlock::QTHintTrack_HintTrackControlBlock(QTFile_File
 QTHintTrack_HintTrackControlBlock::~QTHintTrack_HintTrackControlBlock(void)
 {
     delete fMediaTrackSTSC_STCB;
-    delete []fCachedSample;
+    delete []fSampleBuffer;
     delete []fCachedHintTrackSample;
     
     delete [] fRTPMetaInfoFieldArray;
@@ -575,81 +576,6 @@ QTTrack::ErrorCode QTHintTrack::GetSamplePacketPtr( char ** samplePacketPtr, UIn
 }
 
 
-Bool16 QTHintTrack::GetSamplePtr(UInt32 sampleNumber, char ** samplePtr, UInt32 * length, QTHintTrack_HintTrackControlBlock * htcb)
-{
-    // General vars
-    UInt32      newSampleLength;
-    Assert(htcb != NULL);
-
-    // See if this sample is in our cache, returning it out of the cache if it
-    // is, fetching and caching it if it is not.
-    if( sampleNumber == htcb->fCachedSampleNumber ) 
-    {
-        *samplePtr = htcb->fCachedSample;
-        *length = htcb->fCachedSampleLength;
-        return true;
-    }
-    
-    //TEMP_PRINT( "QTHintTrack::GetSamplePtr; sample not cached\n" );
-    
-    htcb->fLastPacketNumberFetched = 0xFFFF;    // mark to invalid
-    htcb->fPointerToNextPacket = NULL;
-
-    //
-    // Get the length of the new sample.
-    UInt32      sampleDescriptionIndex;
-    UInt64      sampleOffset;
-    
-    if( !this->GetSampleInfo(sampleNumber, &newSampleLength, &sampleOffset, &sampleDescriptionIndex, &htcb->fstscSTCB) )
-        return false;
-    
-    //
-    // Create a new (bigger) cache samplePtr if the sample wouldn't fit in the
-    // old one.
-    if( (htcb->fCachedSample == NULL) || (htcb->fCachedSampleSize < newSampleLength) ) 
-    {
-        //
-        // Free the old cache entry if we had one.
-        if( htcb->fCachedSample != NULL ) 
-        {
-            htcb->fCachedSampleNumber = 0;
-            htcb->fCachedSampleSize = 0;
-            delete[] htcb->fCachedSample;
-        }
-        
-        //
-        // Create a new cache entry.
-        htcb->fCachedSampleLength = htcb->fCachedSampleSize = newSampleLength;
-        htcb->fCachedSample = NEW char[htcb->fCachedSampleSize];
-        if( htcb->fCachedSample == NULL )
-            return false;
-    }
-    
-
-    //
-    // Read in the new sample.
-    htcb->fCachedSampleLength = newSampleLength;
-    
-    //- this did another GetSampleInfo and we already have that data...
-    //if( !this->GetSample(sampleNumber, htcb->fCachedSample, &htcb->fCachedSampleLength, htcb->fFCB, htcb->fstscSTCB) )
-    //  return false;
-    
-    //
-    // Read in the sample
-    if( !fDataReferenceAtom->Read( sampleDescriptionIndex, sampleOffset, htcb->fCachedSample, htcb->fCachedSampleLength, htcb->fFCB ) )
-        return false;
-    //
-    // Return the cached sample.
-    htcb->fCachedSampleNumber = sampleNumber;
-    *samplePtr = htcb->fCachedSample;
-    *length = htcb->fCachedSampleLength;
-    
-    
-    return true;
-}
-
-
-
 // -------------------------------------
 // Packet functions
 //
@@ -92,11 +92,17 @@ public:
     QTAtom_stts_SampleTableControlBlock  fsttsSTCB;
      
     //
-    // Sample cache
+    // Sample cache. fCachedSample points either into fSampleBuffer (of
+    // fCachedSampleSize bytes) or, if the movie is mapped, straight into the file.
     UInt32              fCachedSampleNumber;
     char *              fCachedSample;
+    char *              fSampleBuffer;
     UInt32              fCachedSampleSize, fCachedSampleLength;
 
+    //
+    // The range of a mapped movie we last asked the kernel to page in for us
+    UInt64              fAdviseStart, fAdviseEnd;
+
     //
     // Sample (description) cache
     UInt32              fCachedHintTrackSampleNumber, fCachedHintTrackSampleOffset;
@@ -148,11 +154,12 @@ public:
     inline  UInt64      GetTotalRTPPackets(void) { return fHintInfoAtom ? fHintInfoAtom->GetTotalRTPPackets() : 0; }
 
     inline  UInt32      GetFirstRTPTimestamp(void) { return fFirstRTPTimestamp; }
-    
+
     //
-    // Sample functions
-    Bool16      GetSamplePtr(UInt32 SampleNumber, char ** Buffer, UInt32 * Length,
-                                     QTHintTrack_HintTrackControlBlock * HTCB);
+    // The media tracks this hint track sends packets for. They may not have
+    // been initialized yet.
+    inline  UInt32      GetNumTrackRefs(void) { return fHintTrackReferenceAtom ? fHintTrackReferenceAtom->GetNumReferences() : 0; }
+    inline  QTTrack*    GetTrackRef(UInt32 inIndex) { return fTrackRefs ? fTrackRefs[inIndex] : NULL; }
 
     //
     // Packet functions
@@ -213,7 +220,7 @@ protected:
     {
         kMaxHintTrackRefs = 1024
     };
-    
+
     //
     // Protected member variables.
     QTAtom_hinf         *fHintInfoAtom;
@@ -0,0 +1,634 @@
+/***************************************************************************
+
+Copyright (c) 1999-2003 Apple Computer, Inc.  All Rights Reserved.
+2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 QTPacketIndex.cpp
+Description: An index from sample number, time and RTP-Meta-Info packet number
+             to the packets of a movie's streamed tracks, kept in a sidecar file.
+Comment:     built by its builder thread or by QTBuildPacketIndex
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-17
+LastUpdate:  2026-10-17
+
+****************************************************************************/
+
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <netinet/in.h>
+
+#include "SafeStdLib.h"
+#include "OS.h"
+#include "OSMutex.h"
+#include "OSCond.h"
+#include "OSThread.h"
+#include "OSMemory.h"
+#include "atomic.h"
+#include "FastCopyMacros.h"
+
+#include "QTFile.h"
+#include "QTTrack.h"
+#include "QTHintTrack.h"
+#include "QTPacketizer.h"
+#include "QTRTPFile.h"
+#include "QTPacketIndex.h"
+
+
+// -------------------------------------
+// Byte order helpers
+//
+static void PutUInt32(char ** ptr, UInt32 value)
+{
+    UInt32  tempInt32 = htonl(value);
+    COPY_LONG_WORD(*ptr, &tempInt32);
+    *ptr += 4;
+}
+
+static void PutUInt64(char ** ptr, UInt64 value)
+{
+    PutUInt32(ptr, (UInt32)(value >> 32));
+    PutUInt32(ptr, (UInt32)value);
+}
+
+static UInt32 GetUInt32(char ** ptr)
+{
+    UInt32  tempInt32;
+    COPY_LONG_WORD(&tempInt32, *ptr);
+    *ptr += 4;
+    return ntohl(tempInt32);
+}
+
+static UInt64 GetUInt64(char ** ptr)
+{
+    UInt64  value = (UInt64)GetUInt32(ptr) << 32;
+    return value | GetUInt32(ptr);
+}
+
+
+// -------------------------------------
+// Builder thread
+//
+// Builds and saves the index of each movie queued by QTPacketIndex::Open, with
+// a QTFile of its own, so that the movie can go away while it works.
+class QTPacketIndexBuilder : public OSThread {
+
+public:
+                        QTPacketIndexBuilder(void) : fFirstPath(NULL), fBuildingPath(NULL) {}
+    virtual             ~QTPacketIndexBuilder(void) {}
+
+            void        Add(const char * MoviePath);
+    virtual void        Entry(void);
+
+    static  unsigned int    sNumBuilds;
+
+protected:
+    struct PathEntry
+    {
+        char            *fPath;
+        PathEntry       *fNext;
+    };
+
+    static  void        BuildAndWrite(const char * MoviePath);
+
+    OSMutex             fMutex;
+    OSCond              fCond;
+    PathEntry           *fFirstPath;
+    char                *fBuildingPath;
+};
+
+unsigned int    QTPacketIndexBuilder::sNumBuilds = 0;
+
+static OSMutex              sBuilderMutex;
+static QTPacketIndexBuilder *sBuilder = NULL;
+
+void QTPacketIndexBuilder::Add(const char * moviePath)
+{
+    OSMutexLocker   locker(&fMutex);
+    PathEntry       **lastNext;
+
+    if( (fBuildingPath != NULL) && (::strcmp(fBuildingPath, moviePath) == 0) )
+        return;
+
+    for( lastNext = &fFirstPath; *lastNext != NULL; lastNext = &(*lastNext)->fNext )
+        if( ::strcmp((*lastNext)->fPath, moviePath) == 0 )
+            return;
+
+    PathEntry   *pathEntry = NEW PathEntry;
+    pathEntry->fPath = NEW char[::strlen(moviePath) + 1];
+    ::strcpy(pathEntry->fPath, moviePath);
+    pathEntry->fNext = NULL;
+
+    *lastNext = pathEntry;
+    fCond.Signal();
+}
+
+void QTPacketIndexBuilder::Entry(void)
+{
+    for( ;; )
+    {
+        PathEntry   *pathEntry;
+
+        {
+            OSMutexLocker   locker(&fMutex);
+            while( fFirstPath == NULL )
+                fCond.Wait(&fMutex);
+
+            pathEntry = fFirstPath;
+            fFirstPath = pathEntry->fNext;
+            fBuildingPath = pathEntry->fPath;
+        }
+
+        QTPacketIndexBuilder::BuildAndWrite(pathEntry->fPath);
+
+        {
+            OSMutexLocker   locker(&fMutex);
+            fBuildingPath = NULL;
+        }
+
+        delete [] pathEntry->fPath;
+        delete pathEntry;
+
+        (void)atomic_add(&sNumBuilds, 1);
+    }
+}
+
+void QTPacketIndexBuilder::BuildAndWrite(const char * moviePath)
+{
+    // General vars
+    QTFile          file;
+    QTPacketIndex   *index;
+
+    if( file.Open(moviePath) != QTFile::errNoError )
+        return;
+
+    index = QTPacketIndex::Build(&file);
+    if( index == NULL )
+        return;
+
+    //
+    // Not having somewhere to save it means building it again next time the
+    // movie is opened.
+    (void)index->Write();
+    delete index;
+}
+
+
+// -------------------------------------
+// Constructors and destructors
+//
+QTPacketIndex::QTPacketIndex(QTFile * file, UInt32 numTracks)
+    : fFile(file),
+      fNumTracks(0),
+      fTracks(NULL)
+{
+    if( numTracks > 0 )
+        fTracks = NEW TrackIndex[numTracks];
+}
+
+QTPacketIndex::~QTPacketIndex(void)
+{
+    for( UInt32 curTrack = 0; curTrack < fNumTracks; curTrack++ )
+        delete [] fTracks[curTrack].fEntries;
+
+    delete [] fTracks;
+}
+
+
+// -------------------------------------
+// Open, build and save
+//
+QTPacketIndex* QTPacketIndex::Open(QTFile * file)
+{
+    QTPacketIndex   *index = QTPacketIndex::Read(file);
+    if( index != NULL )
+        return index;
+
+    //
+    // Building it means packetizing the whole movie, so leave it to the
+    // builder thread.
+    {
+        OSMutexLocker   locker(&sBuilderMutex);
+        if( sBuilder == NULL )
+        {
+            sBuilder = NEW QTPacketIndexBuilder();
+            sBuilder->Start();
+        }
+    }
+    sBuilder->Add(file->GetMoviePath());
+
+    return NULL;
+}
+
+UInt32 QTPacketIndex::GetNumBuilds(void)
+{
+    return atomic_add(&QTPacketIndexBuilder::sNumBuilds, 0);
+}
+
+QTPacketIndex* QTPacketIndex::Build(QTFile * file)
+{
+    // General vars
+    QTPacketIndex   *index;
+    QTTrack         *track;
+    UInt32          numHintTracks = 0;
+    Bool16          built;
+
+    //
+    // Index the tracks QTRTPFile streams: the hint tracks, or if there are
+    // none, the tracks it can packetize.
+    for( track = NULL; file->NextTrack(&track, track); )
+        if( file->IsHintTrack(track) )
+            numHintTracks++;
+
+    index = NEW QTPacketIndex(file, (numHintTracks > 0) ? numHintTracks : file->GetNumTracks());
+
+    for( track = NULL; file->NextTrack(&track, track); )
+    {
+        QTPacketizer    *packetizer = NULL;
+
+        if( (numHintTracks > 0) && !file->IsHintTrack(track) )
+            continue;
+
+        {
+            OSMutexLocker locker(file->GetMutex());
+            if( !track->IsInitialized() && (track->Initialize() != QTTrack::errNoError) )
+                continue;
+        }
+
+        if( numHintTracks == 0 )
+        {
+            packetizer = QTPacketizer::Create(track);
+            if( packetizer == NULL )
+                continue;
+        }
+
+        built = index->BuildTrack(&index->fTracks[index->fNumTracks], track, packetizer);
+        delete packetizer;
+
+        //
+        // Leave out a track we couldn't index; seeks on it scan as before.
+        if( !built )
+        {
+            delete [] index->fTracks[index->fNumTracks].fEntries;
+            continue;
+        }
+
+        index->fNumTracks++;
+    }
+
+    if( index->fNumTracks == 0 )
+    {
+        delete index;
+        return NULL;
+    }
+
+    return index;
+}
+
+Bool16 QTPacketIndex::BuildTrack(TrackIndex * trackIndex, QTTrack * track, QTPacketizer * packetizer)
+{
+    // General vars
+    QTHintTrack_HintTrackControlBlock   htcb;
+    char            packet[QTRTPFILE_MAX_PACKET_LENGTH];
+    UInt32          packetLength;
+    Float64         transmitTime;
+    UInt16          numPackets;
+    UInt32          numSamples = track->GetNumSamples();
+    Entry           *entry;
+    QTTrack::ErrorCode  err;
+
+    trackIndex->fTrackID = track->GetTrackID();
+    trackIndex->fNumSamples = numSamples;
+    trackIndex->fNumEntries = 0;
+    trackIndex->fEntries = NEW Entry[(numSamples / kSamplesPerEntry) + 1];
+
+    //
+    // Send every packet of the track the way QTRTPFile does, noting the packet
+    // counters as we reach each entry's sample. A bad sample ends the track
+    // for QTRTPFile, so it ends the index too; the entries before it still hold.
+    for( UInt32 sampleNumber = 1; sampleNumber <= numSamples; sampleNumber++ )
+    {
+        if( ((sampleNumber - 1) % kSamplesPerEntry) == 0 )
+        {
+            entry = &trackIndex->fEntries[trackIndex->fNumEntries];
+            entry->fSampleNumber = sampleNumber;
+            entry->fPacketNumber = htcb.fCurrentPacketNumber;
+            entry->fPacketPosition = htcb.fCurrentPacketPosition;
+            if( !track->GetSampleMediaTime(sampleNumber, &entry->fMediaTime, &htcb.fsttsSTCB) )
+                break;
+
+            trackIndex->fNumEntries++;
+        }
+
+        if( packetizer != NULL )
+            err = packetizer->GetNumPackets(sampleNumber, &numPackets, &htcb);
+        else
+            err = ((QTHintTrack *)track)->GetNumPackets(sampleNumber, &numPackets, &htcb);
+        if( err != QTTrack::errNoError )
+            break;
+
+        for( UInt16 packetNumber = 1; packetNumber <= numPackets; packetNumber++ )
+        {
+            packetLength = sizeof(packet);
+            if( packetizer != NULL )
+                err = packetizer->GetPacket(sampleNumber, packetNumber, packet, &packetLength,
+                                            &transmitTime, 0, &htcb);
+            else
+                err = ((QTHintTrack *)track)->GetPacket(sampleNumber, packetNumber, packet, &packetLength,
+                                                        &transmitTime, false, false, 0, &htcb);
+            if( err != QTTrack::errNoError )
+                return (trackIndex->fNumEntries > 0);
+        }
+    }
+
+    return (trackIndex->fNumEntries > 0) || (numSamples == 0);
+}
+
+Bool16 QTPacketIndex::Write(void)
+{
+    // General vars
+    SInt64          modDate;
+    UInt64          movieLength;
+    UInt32          indexLength = kHeaderSize;
+    char            *indexPath, *tempPath;
+    char            *buffer, *ptr;
+    int             fd;
+    Bool16          written;
+
+    if( !QTPacketIndex::GetMovieStats(fFile, &modDate, &movieLength) )
+        return false;
+
+    for( UInt32 curTrack = 0; curTrack < fNumTracks; curTrack++ )
+        indexLength += kTrackHeaderSize + (fTracks[curTrack].fNumEntries * kEntrySize);
+
+    buffer = ptr = NEW char[indexLength];
+
+    PutUInt32(&ptr, kFileType);
+    PutUInt32(&ptr, kFileVersion);
+    PutUInt64(&ptr, (UInt64)modDate);
+    PutUInt64(&ptr, movieLength);
+    PutUInt32(&ptr, kSamplesPerEntry);
+    PutUInt32(&ptr, fNumTracks);
+
+    for( UInt32 curTrack = 0; curTrack < fNumTracks; curTrack++ )
+    {
+        TrackIndex  *trackIndex = &fTracks[curTrack];
+
+        PutUInt32(&ptr, trackIndex->fTrackID);
+        PutUInt32(&ptr, trackIndex->fNumSamples);
+        PutUInt32(&ptr, trackIndex->fNumEntries);
+
+        for( UInt32 curEntry = 0; curEntry < trackIndex->fNumEntries; curEntry++ )
+        {
+            Entry   *entry = &trackIndex->fEntries[curEntry];
+
+            PutUInt32(&ptr, entry->fSampleNumber);
+            PutUInt32(&ptr, entry->fMediaTime);
+            PutUInt64(&ptr, entry->fPacketNumber);
+            PutUInt64(&ptr, entry->fPacketPosition);
+        }
+    }
+    Assert(ptr == buffer + indexLength);
+
+    //
+    // Write a temporary file and rename it, so that nobody reads half an index.
+    indexPath = QTPacketIndex::GetIndexPath(fFile, ".pidx");
+    tempPath = QTPacketIndex::GetIndexPath(fFile, ".pidx.tmp");
+
+    written = false;
+    fd = ::open(tempPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if( fd != -1 )
+    {
+        written = (::write(fd, buffer, indexLength) == (ssize_t)indexLength);
+        ::close(fd);
+
+        if( written )
+            written = (::rename(tempPath, indexPath) == 0);
+        if( !written )
+            (void)::unlink(tempPath);
+    }
+
+    delete [] buffer;
+    delete [] indexPath;
+    delete [] tempPath;
+
+    return written;
+}
+
+QTPacketIndex* QTPacketIndex::Read(QTFile * file)
+{
+    // General vars
+    SInt64          modDate;
+    UInt64          movieLength;
+    char            *indexPath;
+    struct stat     indexStat;
+    char            *buffer, *ptr, *end;
+    int             fd;
+    Bool16          valid;
+    UInt32          numTracks;
+    QTPacketIndex   *index = NULL;
+
+    if( !QTPacketIndex::GetMovieStats(file, &modDate, &movieLength) )
+        return NULL;
+
+    indexPath = QTPacketIndex::GetIndexPath(file, ".pidx");
+    fd = ::open(indexPath, O_RDONLY);
+    delete [] indexPath;
+    if( fd == -1 )
+        return NULL;
+
+    if( (::fstat(fd, &indexStat) != 0) || (indexStat.st_size < kHeaderSize) )
+    {
+        ::close(fd);
+        return NULL;
+    }
+
+    buffer = NEW char[indexStat.st_size];
+    valid = (::read(fd, buffer, indexStat.st_size) == indexStat.st_size);
+    ::close(fd);
+
+    //
+    // The index holds for the movie it was built from only.
+    ptr = buffer;
+    end = buffer + indexStat.st_size;
+    if( valid )
+        valid = (GetUInt32(&ptr) == (UInt32)kFileType)
+                && (GetUInt32(&ptr) == kFileVersion)
+                && (GetUInt64(&ptr) == (UInt64)modDate)
+                && (GetUInt64(&ptr) == movieLength)
+                && (GetUInt32(&ptr) == kSamplesPerEntry);
+
+    if( valid )
+    {
+        numTracks = GetUInt32(&ptr);
+        index = NEW QTPacketIndex(file, numTracks);
+
+        for( ; valid && (index->fNumTracks < numTracks); index->fNumTracks++ )
+        {
+            TrackIndex  *trackIndex = &index->fTracks[index->fNumTracks];
+            QTTrack     *track;
+
+            trackIndex->fEntries = NULL;
+            if( (UInt32)(end - ptr) < kTrackHeaderSize )
+            {
+                valid = false;
+                break;
+            }
+
+            trackIndex->fTrackID = GetUInt32(&ptr);
+            trackIndex->fNumSamples = GetUInt32(&ptr);
+            trackIndex->fNumEntries = GetUInt32(&ptr);
+
+            //
+            // The tracks nobody has played yet still need their sample tables.
+            valid = file->FindTrack(trackIndex->fTrackID, &track);
+            if( valid )
+            {
+                OSMutexLocker locker(file->GetMutex());
+                valid = track->IsInitialized() || (track->Initialize() == QTTrack::errNoError);
+            }
+
+            valid = valid
+                    && (track->GetNumSamples() == trackIndex->fNumSamples)
+                    && (trackIndex->fNumEntries <= (trackIndex->fNumSamples / kSamplesPerEntry) + 1)
+                    && ((UInt32)(end - ptr) >= trackIndex->fNumEntries * kEntrySize);
+            if( !valid )
+                break;
+
+            trackIndex->fEntries = NEW Entry[trackIndex->fNumEntries + 1];
+            for( UInt32 curEntry = 0; curEntry < trackIndex->fNumEntries; curEntry++ )
+            {
+                Entry   *entry = &trackIndex->fEntries[curEntry];
+
+                entry->fSampleNumber = GetUInt32(&ptr);
+                entry->fMediaTime = GetUInt32(&ptr);
+                entry->fPacketNumber = GetUInt64(&ptr);
+                entry->fPacketPosition = GetUInt64(&ptr);
+            }
+        }
+
+        //
+        // Count the track we stopped at, so that its entries get freed.
+        if( !valid )
+            index->fNumTracks++;
+
+        if( !valid || (ptr != end) || (index->fNumTracks == 0) )
+        {
+            delete index;
+            index = NULL;
+        }
+    }
+
+    delete [] buffer;
+    return index;
+}
+
+
+// -------------------------------------
+// Lookups
+//
+QTPacketIndex::TrackIndex* QTPacketIndex::FindTrackIndex(UInt32 trackID)
+{
+    for( UInt32 curTrack = 0; curTrack < fNumTracks; curTrack++ )
+        if( fTracks[curTrack].fTrackID == trackID )
+            return (fTracks[curTrack].fNumEntries > 0) ? &fTracks[curTrack] : NULL;
+
+    return NULL;
+}
+
+UInt32 QTPacketIndex::GetNumEntries(UInt32 trackID)
+{
+    TrackIndex  *trackIndex = this->FindTrackIndex(trackID);
+    return (trackIndex != NULL) ? trackIndex->fNumEntries : 0;
+}
+
+QTPacketIndex::Entry* QTPacketIndex::FindSampleEntry(UInt32 trackID, UInt32 sampleNumber)
+{
+    TrackIndex  *trackIndex = this->FindTrackIndex(trackID);
+    UInt32      entryNumber;
+
+    if( (trackIndex == NULL) || (sampleNumber == 0) )
+        return NULL;
+
+    //
+    // The entries are evenly spaced, so we can go straight to it.
+    entryNumber = (sampleNumber - 1) / kSamplesPerEntry;
+    if( entryNumber >= trackIndex->fNumEntries )
+        entryNumber = trackIndex->fNumEntries - 1;
+
+    return &trackIndex->fEntries[entryNumber];
+}
+
+QTPacketIndex::Entry* QTPacketIndex::FindPacketEntry(UInt32 trackID, UInt64 packetNumber)
+{
+    TrackIndex  *trackIndex = this->FindTrackIndex(trackID);
+    UInt32      low, high, mid;
+
+    if( trackIndex == NULL )
+        return NULL;
+
+    low = 0;
+    high = trackIndex->fNumEntries - 1;
+    while( low < high )
+    {
+        mid = (low + high + 1) / 2;
+        if( trackIndex->fEntries[mid].fPacketNumber < packetNumber )
+            low = mid;
+        else
+            high = mid - 1;
+    }
+
+    return &trackIndex->fEntries[low];
+}
+
+QTPacketIndex::Entry* QTPacketIndex::FindTimeEntry(UInt32 trackID, UInt32 mediaTime)
+{
+    TrackIndex  *trackIndex = this->FindTrackIndex(trackID);
+    UInt32      low, high, mid;
+
+    if( trackIndex == NULL )
+        return NULL;
+
+    low = 0;
+    high = trackIndex->fNumEntries - 1;
+    while( low < high )
+    {
+        mid = (low + high + 1) / 2;
+        if( trackIndex->fEntries[mid].fMediaTime <= mediaTime )
+            low = mid;
+        else
+            high = mid - 1;
+    }
+
+    return &trackIndex->fEntries[low];
+}
+
+
+// -------------------------------------
+// Utilities
+//
+char* QTPacketIndex::GetIndexPath(QTFile * file, const char * suffix)
+{
+    char    *moviePath = file->GetMoviePath();
+    char    *indexPath = NEW char[::strlen(moviePath) + ::strlen(suffix) + 1];
+
+    ::strcpy(indexPath, moviePath);
+    ::strcat(indexPath, suffix);
+    return indexPath;
+}
+
+Bool16 QTPacketIndex::GetMovieStats(QTFile * file, SInt64 * modDate, UInt64 * length)
+{
+    struct stat     movieStat;
+
+    if( ::stat(file->GetMoviePath(), &movieStat) != 0 )
+        return false;
+
+    *modDate = (SInt64)movieStat.st_mtime;
+    *length = (UInt64)movieStat.st_size;
+    return true;
+}
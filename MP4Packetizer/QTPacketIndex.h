@@ -0,0 +1,135 @@
+/***************************************************************************
+
+Copyright (c) 1999-2003 Apple Computer, Inc.  All Rights Reserved.
+2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 QTPacketIndex.h
+Description: An index from sample number, time and RTP-Meta-Info packet number
+             to the packets of a movie's streamed tracks, kept in a sidecar file.
+Comment:     built by its builder thread or by QTBuildPacketIndex
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-17
+LastUpdate:  2026-10-17
+
+****************************************************************************/
+
+
+#ifndef QTPacketIndex_H
+#define QTPacketIndex_H
+
+#include "OSHeaders.h"
+
+class QTFile;
+class QTTrack;
+class QTPacketizer;
+
+//
+// The packet number and packet position of an RTP-Meta-Info packet count every
+// packet of the track before it, so QTRTPFile can only seek a meta-info stream
+// by generating every packet from the start of the movie. A QTPacketIndex
+// records those counters at every kSamplesPerEntry'th sample of each track
+// QTRTPFile would stream (the hint tracks, or the tracks it packetizes itself
+// if there are none), so a seek can start at the nearest entry instead.
+//
+// The counters are the ones QTRTPFile ends up with when it sends all packets
+// and doesn't drop repeat packets; they don't hold for the thinned quality
+// levels.
+//
+// Building the index means reading every hint sample of the movie, so the
+// index is saved next to the movie (as "<movie>.pidx") and reused for as long
+// as the movie's modification date and length stay the same. A missing index
+// is built by a thread of its own, one movie at a time, so the server isn't
+// held up by it; seeks scan as before until the sidecar is there.
+
+class QTPacketIndex {
+
+public:
+    enum
+    {
+        kSamplesPerEntry    = 64
+    };
+
+    struct Entry
+    {
+        UInt32          fSampleNumber;      // the first sample this entry covers
+        UInt32          fMediaTime;         // its media time, in the track's timescale
+        UInt64          fPacketNumber;      // the packets of the track before it,
+        UInt64          fPacketPosition;    // and the bytes of their payloads
+    };
+
+    //
+    // Returns the index of the movie, read from its sidecar file. If there is
+    // no current sidecar, the movie is queued for the builder thread and NULL
+    // is returned; Read it again once GetNumBuilds changes.
+    static  QTPacketIndex*  Open(QTFile * File);
+
+    //
+    // Reads the index from the sidecar file. Returns NULL if there is none, or
+    // it was built from another version of the movie.
+    static  QTPacketIndex*  Read(QTFile * File);
+
+    //
+    // Builds the index from the movie. Returns NULL if the movie has no tracks
+    // we stream or a sample is bad.
+    static  QTPacketIndex*  Build(QTFile * File);
+
+    //
+    // The number of movies the builder thread has finished with, whether it
+    // could save their index or not.
+    static  UInt32          GetNumBuilds(void);
+
+                        ~QTPacketIndex(void);
+
+    //
+    // Saves the index to the sidecar file. Returns false if it can't be written.
+            Bool16      Write(void);
+
+    //
+    // Accessors.
+    inline  UInt32      GetNumTracks(void) { return fNumTracks; }
+            UInt32      GetNumEntries(UInt32 TrackID);
+
+    //
+    // Lookups. Each returns the last entry of the track at or before the given
+    // sample, before the given packet number (so the entry's sample holds that
+    // packet or one after it), or at or before the given media time. They
+    // return NULL if the track isn't in the index.
+            Entry*      FindSampleEntry(UInt32 TrackID, UInt32 SampleNumber);
+            Entry*      FindPacketEntry(UInt32 TrackID, UInt64 PacketNumber);
+            Entry*      FindTimeEntry(UInt32 TrackID, UInt32 MediaTime);
+
+protected:
+    enum
+    {
+        kFileType       = FOUR_CHARS_TO_INT('Q', 'T', 'P', 'X'),
+        kFileVersion    = 1,
+        kHeaderSize     = 32,   // type, version, mod date, length, samples per entry, tracks
+        kTrackHeaderSize= 12,   // track ID, samples, entries
+        kEntrySize      = 24
+    };
+
+    struct TrackIndex
+    {
+        UInt32          fTrackID;
+        UInt32          fNumSamples;
+        UInt32          fNumEntries;
+        Entry           *fEntries;
+    };
+
+                        QTPacketIndex(QTFile * File, UInt32 NumTracks);
+
+            Bool16      BuildTrack(TrackIndex * Index, QTTrack * Track, QTPacketizer * Packetizer);
+            TrackIndex* FindTrackIndex(UInt32 TrackID);
+
+    static  char*       GetIndexPath(QTFile * File, const char * Suffix);
+    static  Bool16      GetMovieStats(QTFile * File, SInt64 * ModDate, UInt64 * Length);
+
+    //
+    // Protected member variables.
+    QTFile              *fFile;
+    UInt32              fNumTracks;
+    TrackIndex          *fTracks;
+};
+
+#endif // QTPacketIndex_H
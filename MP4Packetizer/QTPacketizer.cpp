@@ -0,0 +1,227 @@
+/***************************************************************************
+
+Copyright (c) 1999-2003 Apple Computer, Inc.  All Rights Reserved.
+2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 QTPacketizer.cpp
+Description: Build RTP packets straight from the samples of a media track, for
+             movies that have no hint tracks.
+Comment:     used by QTRTPFile in place of QTHintTrack for unhinted movies
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-17
+LastUpdate:  2026-10-17
+
+****************************************************************************/
+
+
+#include <string.h>
+
+#include "SafeStdLib.h"
+#include "OSMemory.h"
+#include "MyAssert.h"
+#include "FastCopyMacros.h"
+#include "ResizeableStringFormatter.h"
+
+#include "QTHintTrack.h"
+#include "QTPacketizer.h"
+#include "QTPacketizer_H264.h"
+#include "QTPacketizer_AAC.h"
+
+
+// -------------------------------------
+// Factory
+//
+QTPacketizer* QTPacketizer::Create(QTTrack * track)
+{
+    // General vars
+    QTPacketizer    *packetizer;
+    char            *sampleDescription;
+    UInt32          sampleDescriptionLength;
+    UInt64          mediaBytes, numPackets;
+
+    Assert(track->IsInitialized());
+
+    if( track->FindSampleDescription(FOUR_CHARS_TO_INT('a', 'v', 'c', '1'), &sampleDescription, &sampleDescriptionLength)
+        || track->FindSampleDescription(FOUR_CHARS_TO_INT('a', 'v', 'c', '3'), &sampleDescription, &sampleDescriptionLength) )
+        packetizer = NEW QTPacketizer_H264(track);
+    else if( track->FindSampleDescription(FOUR_CHARS_TO_INT('m', 'p', '4', 'a'), &sampleDescription, &sampleDescriptionLength) )
+        packetizer = NEW QTPacketizer_AAC(track);
+    else
+        return NULL;
+
+    if( !packetizer->Initialize() )
+    {
+        delete packetizer;
+        return NULL;
+    }
+
+    //
+    // Estimate the bytes we will send, for the b=AS line and the server's
+    // buffer sizing; there are no hint statistics to tell us. A sample
+    // takes at most one packet more than its bytes fill.
+    mediaBytes = track->GetTotalSampleSize();
+    numPackets = track->GetNumSamples() + (mediaBytes / kMaxPayloadSize);
+    packetizer->fTotalRTPBytes = mediaBytes + (numPackets * kRTPHeaderSize);
+
+    return packetizer;
+}
+
+
+// -------------------------------------
+// Constructors and destructors
+//
+QTPacketizer::QTPacketizer(QTTrack * track, const char * mediaType, UInt8 payloadType, UInt32 rtpTimescale)
+    : fTrack(track),
+      fMediaType(mediaType),
+      fPayloadType(payloadType),
+      fRTPTimescale(rtpTimescale),
+      fTotalRTPBytes(0),
+      fNextSequenceNumber(0)
+{
+}
+
+
+// -------------------------------------
+// Sample description helpers
+//
+UInt32 QTPacketizer::GetBigEndian(char * ptr, UInt32 numBytes)
+{
+    UInt32      value = 0;
+
+    for( UInt32 curByte = 0; curByte < numBytes; curByte++ )
+        value = (value << 8) | (UInt8)ptr[curByte];
+
+    return value;
+}
+
+Bool16 QTPacketizer::FindChildAtom(char * start, char * end, OSType type, char ** data, UInt32 * length)
+{
+    //
+    // Walk the atoms in [start, end), returning the contents of the first one
+    // of the given type.
+    while( start + 8 <= end )
+    {
+        UInt32  atomLength = GetBigEndian(start, 4);
+        if( (atomLength < 8) || (atomLength > (UInt32)(end - start)) )
+            return false;
+
+        if( GetBigEndian(start + 4, 4) == type )
+        {
+            *data = start + 8;
+            *length = atomLength - 8;
+            return true;
+        }
+
+        start += atomLength;
+    }
+
+    return false;
+}
+
+
+// -------------------------------------
+// SDP function
+//
+char * QTPacketizer::GetSDPFile(int * length)
+{
+    // General vars
+    ResizeableStringFormatter   sdp;
+    char                        sdpLine[256];
+    Float64                     duration = (Float64)(SInt64)fTrack->GetMediaDuration() * fTrack->GetTimeScaleRecip();
+    UInt32                      bitRate = 0;
+    char                        *sdpFile;
+
+    if( duration > 0.0 )
+        bitRate = (UInt32)((Float64)fTotalRTPBytes * 8.0 / duration / 1000.0) + 1;
+
+    qtss_sprintf(sdpLine, "m=%s 0 RTP/AVP %u\r\nb=AS:%lu\r\n", fMediaType, (UInt16)fPayloadType, bitRate);
+    sdp.Put(sdpLine);
+    this->WriteSDPAttributes(&sdp);
+    qtss_sprintf(sdpLine, "a=control:trackID=%lu\r\n", fTrack->GetTrackID());
+    sdp.Put(sdpLine);
+
+    *length = sdp.GetBytesWritten();
+    sdpFile = NEW char[*length + 1];
+    if( sdpFile == NULL )
+        return NULL;
+
+    ::memcpy(sdpFile, sdp.GetBufPtr(), *length);
+    sdpFile[*length] = '\0';
+
+    return sdpFile;
+}
+
+
+// -------------------------------------
+// Packet functions
+//
+QTTrack::ErrorCode QTPacketizer::GetPacket(UInt32 sampleNumber, UInt16 packetNumber, char * buffer, UInt32 * length,
+                                          Float64 * transmitTime, UInt32 ssrc, QTHintTrack_HintTrackControlBlock * htcb)
+{
+    // Temporary vars
+    UInt16      tempInt16;
+    UInt32      tempInt32;
+
+    // General vars
+    UInt32      mediaTime, mediaTimeOffset = 0;
+    SInt64      presentationTime;
+    UInt32      rtpTimestamp;
+    char        *sample;
+    UInt32      sampleLength;
+    UInt16      numPackets;
+    UInt32      payloadLength;
+    Bool16      marker = false;
+
+    Assert(htcb != NULL);
+
+    //
+    // Make sure we know how this sample is split up, and read it.
+    if( this->GetNumPackets(sampleNumber, &numPackets, htcb) != QTTrack::errNoError )
+        return QTTrack::errInvalidQuickTimeFile;
+
+    if( (packetNumber == 0) || (packetNumber > numPackets) )
+        return QTTrack::errParamError;
+
+    if( !fTrack->GetSamplePtr(sampleNumber, &sample, &sampleLength, htcb) )
+        return QTTrack::errInvalidQuickTimeFile;
+
+    //
+    // The RTP timestamp is the presentation time of the sample, the
+    // transmit time its decoding time.
+    if( !fTrack->GetSampleMediaTime(sampleNumber, &mediaTime, &htcb->fsttsSTCB) )
+        return QTTrack::errInvalidQuickTimeFile;
+
+    (void)fTrack->GetSampleMediaTimeOffset(sampleNumber, &mediaTimeOffset, &fcttsSTCB);
+
+    presentationTime = (SInt64)mediaTime + (SInt32)mediaTimeOffset;
+    rtpTimestamp = (UInt32)(SInt64)((Float64)presentationTime * (Float64)fRTPTimescale * fTrack->GetTimeScaleRecip());
+
+    mediaTime += fTrack->GetFirstEditMediaTime();
+    *transmitTime = mediaTime * fTrack->GetTimeScaleRecip();
+
+    //
+    // Write the payload after the header, then the header (which needs the marker).
+    payloadLength = this->WritePayload(sample, sampleLength, packetNumber, buffer + kRTPHeaderSize, &marker);
+    if( payloadLength == 0 )
+        return QTTrack::errInvalidQuickTimeFile;
+
+    tempInt16 = htons((UInt16)(0x8000 | (marker ? 0x0080 : 0) | fPayloadType));
+    COPY_WORD(buffer, &tempInt16);
+
+    tempInt16 = htons(fNextSequenceNumber++);
+    COPY_WORD(buffer + 2, &tempInt16);
+
+    tempInt32 = htonl(rtpTimestamp);
+    COPY_LONG_WORD(buffer + 4, &tempInt32);
+
+    tempInt32 = htonl(ssrc);
+    COPY_LONG_WORD(buffer + 8, &tempInt32);
+
+    *length = kRTPHeaderSize + payloadLength;
+
+    htcb->fCurrentPacketNumber++;
+    htcb->fCurrentPacketPosition += *length;
+
+    return QTTrack::errNoError;
+}
@@ -0,0 +1,110 @@
+/***************************************************************************
+
+Copyright (c) 1999-2003 Apple Computer, Inc.  All Rights Reserved.
+2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 QTPacketizer.h
+Description: Build RTP packets straight from the samples of a media track, for
+             movies that have no hint tracks.
+Comment:     used by QTRTPFile in place of QTHintTrack for unhinted movies
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-17
+LastUpdate:  2026-10-17
+
+****************************************************************************/
+
+
+#ifndef QTPacketizer_H
+#define QTPacketizer_H
+
+#include "OSHeaders.h"
+#include "QTTrack.h"
+#include "StringFormatter.h"
+
+class QTHintTrack_HintTrackControlBlock;
+
+//
+// A QTPacketizer sends the samples of one media track as RTP packets the way a
+// QTHintTrack sends the packets its hint samples describe, so that QTRTPFile
+// can stream a movie nobody hinted. The track is shared by everyone playing
+// the movie, the packetizer is not: like the HTCB passed to it, it belongs to
+// one stream, and holds the layout of the sample being sent and the next
+// sequence number.
+//
+// The payload is copied straight from the sample (in the movie's mapping, or
+// the HTCB's sample buffer) into the caller's packet buffer.
+
+class QTPacketizer {
+
+public:
+    enum
+    {
+        kMaxPacketSize  = 1450,     // what the hinters use by default
+        kRTPHeaderSize  = 12,
+        kMaxPayloadSize = kMaxPacketSize - kRTPHeaderSize
+    };
+
+    //
+    // Returns a packetizer for the track if it holds H.264 ('avc1') or AAC
+    // ('mp4a') media, NULL if it holds anything else. The track must be
+    // initialized.
+    static  QTPacketizer*   Create(QTTrack * Track);
+
+    virtual             ~QTPacketizer(void) {}
+
+    //
+    // Accessors.
+    inline  QTTrack*    GetTrack(void) { return fTrack; }
+    inline  UInt32      GetRTPTimescale(void) { return fRTPTimescale; }
+    inline  UInt64      GetTotalRTPBytes(void) { return fTotalRTPBytes; }
+
+    //
+    // As with QTHintTrack::GetSDPFile, the buffer returned is the caller's to delete.
+            char *      GetSDPFile(int * Length);
+
+    //
+    // Packet functions, which work like the QTHintTrack ones.
+    virtual QTTrack::ErrorCode  GetNumPackets(UInt32 SampleNumber, UInt16 * NumPackets,
+                                              QTHintTrack_HintTrackControlBlock * HTCB) = 0;
+            QTTrack::ErrorCode  GetPacket(UInt32 SampleNumber, UInt16 PacketNumber,
+                                          char * Buffer, UInt32 * Length,
+                                          Float64 * TransmitTime,
+                                          UInt32 SSRC,
+                                          QTHintTrack_HintTrackControlBlock * HTCB);
+
+protected:
+                        QTPacketizer(QTTrack * Track, const char * MediaType, UInt8 PayloadType, UInt32 RTPTimescale);
+
+    //
+    // Reads the sample description. Returns false if it isn't one we can packetize.
+    virtual Bool16      Initialize(void) = 0;
+
+    //
+    // Adds the a=rtpmap and a=fmtp lines of the track to its SDP.
+    virtual void        WriteSDPAttributes(StringFormatter * SDP) = 0;
+
+    //
+    // Writes the payload of the given packet of the sample (at most
+    // kMaxPayloadSize bytes). Returns its length, or 0 if the sample is bad.
+    virtual UInt32      WritePayload(char * Sample, UInt32 SampleLength, UInt16 PacketNumber,
+                                     char * Buffer, Bool16 * Marker) = 0;
+
+    //
+    // Sample description helpers
+    static  UInt32      GetBigEndian(char * Ptr, UInt32 NumBytes);
+    static  Bool16      FindChildAtom(char * Start, char * End, OSType Type, char ** Data, UInt32 * Length);
+
+    //
+    // Protected member variables.
+    QTTrack             *fTrack;
+    const char          *fMediaType;
+    UInt8               fPayloadType;
+    UInt32              fRTPTimescale;
+    UInt64              fTotalRTPBytes;
+
+    UInt16              fNextSequenceNumber;
+    QTAtom_ctts_SampleTableControlBlock fcttsSTCB;
+};
+
+#endif // QTPacketizer_H
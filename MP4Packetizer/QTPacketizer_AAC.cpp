@@ -0,0 +1,313 @@
+/***************************************************************************
+
+Copyright (c) 1999-2003 Apple Computer, Inc.  All Rights Reserved.
+2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 QTPacketizer_AAC.cpp
+Description: Packetize the samples of an AAC ('mp4a') track as RFC 3640 RTP
+             packets, in AAC-hbr mode.
+Comment:     created by QTPacketizer::Create
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-17
+LastUpdate:  2026-10-17
+
+****************************************************************************/
+
+
+#include <string.h>
+
+#include "SafeStdLib.h"
+#include "MyAssert.h"
+
+#include "QTPacketizer_AAC.h"
+
+
+// -------------------------------------
+// Constructors and destructors
+//
+QTPacketizer_AAC::QTPacketizer_AAC(QTTrack * track)
+    : QTPacketizer(track, "audio", kPayloadType, (UInt32)track->GetTimeScale()),
+      fNumChannels(2),
+      fProfileLevelID(kNoAudioProfile)
+{
+    fConfig[0] = '\0';
+}
+
+
+// -------------------------------------
+// Initialization functions
+//
+Bool16 QTPacketizer_AAC::GetDescriptor(char ** ptr, char * end, UInt8 * tag, UInt32 * length)
+{
+    //
+    // A tag, then a size of up to four bytes, seven bits at a time.
+    if( *ptr >= end )
+        return false;
+
+    *tag = (UInt8)*(*ptr)++;
+    *length = 0;
+    for( UInt32 sizeByte = 0; sizeByte < 4; sizeByte++ )
+    {
+        if( *ptr >= end )
+            return false;
+
+        UInt8   nextByte = (UInt8)*(*ptr)++;
+        *length = (*length << 7) | (nextByte & 0x7F);
+        if( (nextByte & 0x80) == 0 )
+            break;
+    }
+
+    return *length <= (UInt32)(end - *ptr);
+}
+
+UInt32 QTPacketizer_AAC::GetBits(char * config, UInt32 configLength, UInt32 * bitPos, UInt32 numBits)
+{
+    // General vars
+    UInt32      value = 0;
+
+    //
+    // Bits past the end of the config read as 0.
+    for( UInt32 curBit = 0; curBit < numBits; curBit++, (*bitPos)++ )
+    {
+        value <<= 1;
+        if( *bitPos < configLength * 8 )
+            value |= ((UInt8)config[*bitPos / 8] >> (7 - (*bitPos % 8))) & 1;
+    }
+
+    return value;
+}
+
+UInt32 QTPacketizer_AAC::GetAudioObjectType(char * config, UInt32 configLength, UInt32 * bitPos)
+{
+    UInt32      objectType = GetBits(config, configLength, bitPos, 5);
+
+    if( objectType == 31 )
+        objectType = 32 + GetBits(config, configLength, bitPos, 6);
+
+    return objectType;
+}
+
+UInt32 QTPacketizer_AAC::GetSamplingFrequency(char * config, UInt32 configLength, UInt32 * bitPos)
+{
+    // General vars
+    static const UInt32 sFrequencies[] = { 96000, 88200, 64000, 48000, 44100, 32000, 24000,
+                                           22050, 16000, 12000, 11025, 8000, 7350 };
+    UInt32      frequencyIndex = GetBits(config, configLength, bitPos, 4);
+
+    if( frequencyIndex == 15 )
+        return GetBits(config, configLength, bitPos, 24);
+    if( frequencyIndex < sizeof(sFrequencies) / sizeof(UInt32) )
+        return sFrequencies[frequencyIndex];
+    return 0;
+}
+
+void QTPacketizer_AAC::ParseAudioSpecificConfig(char * config, UInt32 configLength, UInt32 entryChannels)
+{
+    // General vars
+    static const UInt32 sChannels[] = { 0, 1, 2, 3, 4, 5, 6, 8 };
+    UInt32      bitPos = 0;
+    UInt32      objectType, frequency, channelConfig;
+    Bool16      hasSBR = false, hasPS = false;
+
+    objectType = GetAudioObjectType(config, configLength, &bitPos);
+    frequency = GetSamplingFrequency(config, configLength, &bitPos);
+    channelConfig = GetBits(config, configLength, &bitPos, 4);
+
+    //
+    // SBR and PS, when signalled explicitly, are followed by the output
+    // sampling frequency and then the object type of the core.
+    if( (objectType == kSBRObjectType) || (objectType == kPSObjectType) )
+    {
+        hasSBR = true;
+        hasPS = (objectType == kPSObjectType);
+        frequency = GetSamplingFrequency(config, configLength, &bitPos);
+        objectType = GetAudioObjectType(config, configLength, &bitPos);
+    }
+
+    //
+    // A channel configuration of 0 leaves the layout to a program config
+    // element, so take the count the sample entry gives.
+    if( (channelConfig > 0) && (channelConfig < sizeof(sChannels) / sizeof(UInt32)) )
+        fNumChannels = sChannels[channelConfig];
+    else
+        fNumChannels = entryChannels;
+    if( fNumChannels == 0 )
+        fNumChannels = 1;
+
+    //
+    // The lowest level of the AAC, HE-AAC or HE-AAC v2 profile that takes
+    // the stream (ISO/IEC 14496-3, audioProfileLevelIndication).
+    if( objectType != kLCObjectType )
+        fProfileLevelID = kNoAudioProfile;
+    else if( hasPS )
+        fProfileLevelID = ((fNumChannels <= 2) && (frequency <= 48000)) ? 0x30 : 0x33;
+    else if( hasSBR )
+    {
+        if( (fNumChannels <= 2) && (frequency <= 48000) )
+            fProfileLevelID = 0x2C;
+        else if( (fNumChannels <= 6) && (frequency <= 48000) )
+            fProfileLevelID = 0x2E;
+        else
+            fProfileLevelID = 0x2F;
+    }
+    else if( (fNumChannels <= 2) && (frequency <= 24000) )
+        fProfileLevelID = 0x28;
+    else if( (fNumChannels <= 2) && (frequency <= 48000) )
+        fProfileLevelID = 0x29;
+    else if( (fNumChannels <= 6) && (frequency <= 48000) )
+        fProfileLevelID = 0x2A;
+    else
+        fProfileLevelID = 0x2B;
+}
+
+Bool16 QTPacketizer_AAC::Initialize(void)
+{
+    // General vars
+    char        *sampleDescription, *esds, *curPos, *endPos;
+    UInt32      sampleDescriptionLength, esdsLength;
+    UInt32      entryLength = 36, entryVersion, entryChannels, descriptorLength;
+    UInt8       tag, flags;
+
+    if( !fTrack->FindSampleDescription(FOUR_CHARS_TO_INT('m', 'p', '4', 'a'), &sampleDescription, &sampleDescriptionLength) )
+        return false;
+
+    //
+    // The audio sample entry is 36 bytes long in version 0, and is followed by
+    // 16 or 36 more in versions 1 and 2.
+    if( sampleDescriptionLength < entryLength )
+        return false;
+
+    entryVersion = GetBigEndian(sampleDescription + 16, 2);
+    switch( entryVersion )
+    {
+        case 0: break;
+        case 1: entryLength += 16; break;
+        case 2: entryLength += 36; break;
+        default: return false;
+    }
+
+    if( sampleDescriptionLength < entryLength )
+        return false;
+
+    //
+    // The channel count, for configs that don't give it. Version 2 puts 3 in
+    // the version 0 field and the count in a 32 bit field of its own.
+    if( entryVersion == 2 )
+        entryChannels = GetBigEndian(sampleDescription + 48, 4);
+    else
+        entryChannels = GetBigEndian(sampleDescription + 24, 2);
+
+    if( !FindChildAtom(sampleDescription + entryLength, sampleDescription + sampleDescriptionLength,
+                          FOUR_CHARS_TO_INT('e', 's', 'd', 's'), &esds, &esdsLength) )
+        return false;
+
+    //
+    // Find the AudioSpecificConfig: the DecoderSpecificInfo of the
+    // DecoderConfigDescriptor of the ES_Descriptor.
+    if( esdsLength < 4 )
+        return false;
+    curPos = esds + 4;  // version and flags
+    endPos = esds + esdsLength;
+
+    if( !GetDescriptor(&curPos, endPos, &tag, &descriptorLength) || (tag != 0x03) || (descriptorLength < 3) )
+        return false;
+    endPos = curPos + descriptorLength;
+    flags = (UInt8)curPos[2];
+    curPos += 3;
+    if( flags & 0x80 )      // streamDependenceFlag
+        curPos += 2;
+    if( (flags & 0x40) && (curPos < endPos) )   // URL_Flag
+        curPos += 1 + (UInt8)*curPos;
+    if( flags & 0x20 )      // OCRstreamFlag
+        curPos += 2;
+
+    if( !GetDescriptor(&curPos, endPos, &tag, &descriptorLength) || (tag != 0x04) || (descriptorLength < 13) )
+        return false;
+    endPos = curPos + descriptorLength;
+
+    //
+    // MPEG-4 audio, or one of the MPEG-2 AAC profiles.
+    switch( (UInt8)curPos[0] )
+    {
+        case 0x40: case 0x66: case 0x67: case 0x68: break;
+        default: return false;
+    }
+    curPos += 13;
+
+    if( !GetDescriptor(&curPos, endPos, &tag, &descriptorLength) || (tag != 0x05)
+        || (descriptorLength == 0) || (descriptorLength > kMaxConfigLength) )
+        return false;
+
+    for( UInt32 curByte = 0; curByte < descriptorLength; curByte++ )
+        qtss_sprintf(fConfig + (2 * curByte), "%02X", (UInt8)curPos[curByte]);
+
+    this->ParseAudioSpecificConfig(curPos, descriptorLength, entryChannels);
+
+    return (fRTPTimescale != 0);
+}
+
+
+// -------------------------------------
+// SDP functions
+//
+void QTPacketizer_AAC::WriteSDPAttributes(StringFormatter * sdp)
+{
+    char        sdpLine[128];
+
+    qtss_sprintf(sdpLine, "a=rtpmap:97 mpeg4-generic/%lu/%lu\r\n", fRTPTimescale, fNumChannels);
+    sdp->Put(sdpLine);
+    qtss_sprintf(sdpLine, "a=fmtp:97 streamtype=5;profile-level-id=%lu;mode=AAC-hbr;config=", fProfileLevelID);
+    sdp->Put(sdpLine);
+    sdp->Put(fConfig);
+    sdp->Put(";SizeLength=13;IndexLength=3;IndexDeltaLength=3\r\n");
+}
+
+
+// -------------------------------------
+// Packet functions
+//
+QTTrack::ErrorCode QTPacketizer_AAC::GetNumPackets(UInt32 sampleNumber, UInt16 * numPackets,
+                                                   QTHintTrack_HintTrackControlBlock * /*htcb*/)
+{
+    // General vars
+    UInt32      sampleLength;
+
+    //
+    // The sample size table is all we need to know.
+    if( !fTrack->SampleSize(sampleNumber, &sampleLength) || (sampleLength > kMaxAUSize) )
+        return QTTrack::errInvalidQuickTimeFile;
+
+    *numPackets = (UInt16)((sampleLength + kMaxFragmentLength - 1) / kMaxFragmentLength);
+    if( *numPackets == 0 )
+        *numPackets = 1;
+
+    return QTTrack::errNoError;
+}
+
+UInt32 QTPacketizer_AAC::WritePayload(char * sample, UInt32 sampleLength, UInt16 packetNumber,
+                                     char * buffer, Bool16 * marker)
+{
+    // General vars
+    UInt32      fragmentStart = (packetNumber - 1) * kMaxFragmentLength;
+    UInt32      fragmentLength;
+
+    if( (sampleLength > kMaxAUSize) || ((fragmentStart >= sampleLength) && (fragmentStart > 0)) )
+        return 0;
+
+    fragmentLength = sampleLength - fragmentStart;
+    if( fragmentLength > kMaxFragmentLength )
+        fragmentLength = kMaxFragmentLength;
+
+    *marker = (fragmentStart + fragmentLength == sampleLength);
+
+    //
+    // AU-headers-length in bits, then the AU-size and (zero) AU-index.
+    buffer[0] = 0;
+    buffer[1] = 16;
+    buffer[2] = (char)(sampleLength >> 5);
+    buffer[3] = (char)((sampleLength & 0x1F) << 3);
+    ::memcpy(buffer + kAUHeaderSectionSize, sample + fragmentStart, fragmentLength);
+
+    return kAUHeaderSectionSize + fragmentLength;
+}
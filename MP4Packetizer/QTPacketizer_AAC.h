@@ -0,0 +1,71 @@
+/***************************************************************************
+
+Copyright (c) 1999-2003 Apple Computer, Inc.  All Rights Reserved.
+2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 QTPacketizer_AAC.h
+Description: Packetize the samples of an AAC ('mp4a') track as RFC 3640 RTP
+             packets, in AAC-hbr mode.
+Comment:     created by QTPacketizer::Create
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-17
+LastUpdate:  2026-10-17
+
+****************************************************************************/
+
+
+#ifndef QTPacketizer_AAC_H
+#define QTPacketizer_AAC_H
+
+#include "QTPacketizer.h"
+
+//
+// Each sample is one access unit, sent in a packet of its own behind a single
+// 16 bit AU header (13 bits of size, 3 of index). An access unit too big for a
+// packet is split over several, each with the same AU header, and the marker
+// bit set on the last.
+
+class QTPacketizer_AAC : public QTPacketizer {
+
+public:
+                        QTPacketizer_AAC(QTTrack * Track);
+    virtual             ~QTPacketizer_AAC(void) {}
+
+    virtual QTTrack::ErrorCode  GetNumPackets(UInt32 SampleNumber, UInt16 * NumPackets,
+                                              QTHintTrack_HintTrackControlBlock * HTCB);
+
+protected:
+    enum
+    {
+        kPayloadType        = 97,
+        kAUHeaderSectionSize = 4,       // AU-headers-length and one AU header
+        kMaxFragmentLength  = kMaxPayloadSize - kAUHeaderSectionSize,
+        kMaxAUSize          = (1 << 13) - 1,
+        kMaxConfigLength    = 64,
+
+        kLCObjectType       = 2,        // audio object types of the AudioSpecificConfig
+        kSBRObjectType      = 5,
+        kPSObjectType       = 29,
+        kNoAudioProfile     = 0xFE      // an audioProfileLevelIndication of no profile
+    };
+
+    virtual Bool16      Initialize(void);
+    virtual void        WriteSDPAttributes(StringFormatter * SDP);
+    virtual UInt32      WritePayload(char * Sample, UInt32 SampleLength, UInt16 PacketNumber,
+                                     char * Buffer, Bool16 * Marker);
+
+    static  Bool16      GetDescriptor(char ** Ptr, char * End, UInt8 * Tag, UInt32 * Length);
+    static  UInt32      GetBits(char * Config, UInt32 ConfigLength, UInt32 * BitPos, UInt32 NumBits);
+    static  UInt32      GetAudioObjectType(char * Config, UInt32 ConfigLength, UInt32 * BitPos);
+    static  UInt32      GetSamplingFrequency(char * Config, UInt32 ConfigLength, UInt32 * BitPos);
+            void        ParseAudioSpecificConfig(char * Config, UInt32 ConfigLength, UInt32 EntryChannels);
+
+    //
+    // Protected member variables.
+    UInt32              fNumChannels;
+    UInt32              fProfileLevelID;    // the audioProfileLevelIndication, for the fmtp line
+    char                fConfig[(2 * kMaxConfigLength) + 1];    // the AudioSpecificConfig in hex
+};
+
+#endif // QTPacketizer_AAC_H
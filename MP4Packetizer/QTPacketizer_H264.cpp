@@ -0,0 +1,420 @@
+/***************************************************************************
+
+Copyright (c) 1999-2003 Apple Computer, Inc.  All Rights Reserved.
+2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 QTPacketizer_H264.cpp
+Description: Packetize the samples of an H.264 ('avc1') track as RFC 6184 RTP
+             packets, in packetization mode 1.
+Comment:     created by QTPacketizer::Create
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-17
+LastUpdate:  2026-10-17
+
+****************************************************************************/
+
+
+#include <string.h>
+
+#include "SafeStdLib.h"
+#include "OSMemory.h"
+#include "MyAssert.h"
+#include "base64.h"
+
+#include "QTPacketizer_H264.h"
+
+
+// -------------------------------------
+// Constructors and destructors
+//
+QTPacketizer_H264::QTPacketizer_H264(QTTrack * track)
+    : QTPacketizer(track, "video", kPayloadType, kRTPTimescale),
+      fNALLengthSize(4),
+      fParameterSetsLength(0),
+      fSpropParameterSets(NULL),
+      fPacketTableSampleNumber(0),
+      fPacketTable(NULL),
+      fNumPackets(0), fPacketTableSize(0)
+{
+    fProfileLevelID[0] = '\0';
+}
+
+QTPacketizer_H264::~QTPacketizer_H264(void)
+{
+    if( fSpropParameterSets != NULL )
+        delete [] fSpropParameterSets;
+
+    if( fPacketTable != NULL )
+        delete [] fPacketTable;
+}
+
+
+// -------------------------------------
+// Initialization functions
+//
+Bool16 QTPacketizer_H264::Initialize(void)
+{
+    // General vars
+    char        *sampleDescription, *avcC, *avcCEnd, *curPos;
+    UInt32      sampleDescriptionLength, avcCLength;
+    UInt32      numParameterSets, pass, curSet;
+    UInt32      spropLength = 0;
+    UInt8       nalHeader = 0;
+
+    if( !fTrack->FindSampleDescription(FOUR_CHARS_TO_INT('a', 'v', 'c', '1'), &sampleDescription, &sampleDescriptionLength)
+        && !fTrack->FindSampleDescription(FOUR_CHARS_TO_INT('a', 'v', 'c', '3'), &sampleDescription, &sampleDescriptionLength) )
+        return false;
+
+    //
+    // The avcC follows the 86 bytes of the visual sample entry.
+    if( sampleDescriptionLength < 86 )
+        return false;
+
+    if( !FindChildAtom(sampleDescription + 86, sampleDescription + sampleDescriptionLength,
+                       FOUR_CHARS_TO_INT('a', 'v', 'c', 'C'), &avcC, &avcCLength) )
+        return false;
+
+    if( (avcCLength < 7) || (avcC[0] != 1) )
+        return false;
+
+    avcCEnd = avcC + avcCLength;
+    fNALLengthSize = (avcC[4] & 0x03) + 1;
+    qtss_sprintf(fProfileLevelID, "%02X%02X%02X", (UInt8)avcC[1], (UInt8)avcC[2], (UInt8)avcC[3]);
+
+    //
+    // Size the sprop-parameter-sets, then fill it and our STAP-A in, going
+    // through the SPSs and then the PPSs.
+    curPos = avcC + 5;
+    for( pass = 0; pass < 2; pass++ )
+    {
+        if( curPos >= avcCEnd )
+            return false;
+
+        numParameterSets = (UInt8)*curPos++;
+        if( pass == 0 )
+            numParameterSets &= 0x1F;   // SPSs; the top bits are reserved
+
+        for( curSet = 0; curSet < numParameterSets; curSet++ )
+        {
+            UInt32  setLength;
+
+            if( curPos + 2 > avcCEnd )
+                return false;
+            setLength = GetBigEndian(curPos, 2);
+            if( (setLength == 0) || (curPos + 2 + setLength > avcCEnd) )
+                return false;
+
+            spropLength += Base64encode_len(setLength);
+            curPos += 2 + setLength;
+        }
+    }
+
+    if( spropLength == 0 )
+        return true;    // no out of band parameter sets
+
+    fSpropParameterSets = NEW char[spropLength];
+    fSpropParameterSets[0] = '\0';
+    fParameterSetsLength = 1;
+
+    curPos = avcC + 5;
+    for( pass = 0; pass < 2; pass++ )
+    {
+        numParameterSets = (UInt8)*curPos++;
+        if( pass == 0 )
+            numParameterSets &= 0x1F;
+
+        for( curSet = 0; curSet < numParameterSets; curSet++ )
+        {
+            UInt32  setLength = GetBigEndian(curPos, 2);
+            char    *set = curPos + 2;
+
+            if( fSpropParameterSets[0] != '\0' )
+                ::strcat(fSpropParameterSets, ",");
+            (void)Base64encode(fSpropParameterSets + ::strlen(fSpropParameterSets), set, setLength);
+
+            if( fParameterSetsLength + 2 + setLength <= kMaxParameterSetsLength )
+            {
+                fParameterSets[fParameterSetsLength] = (char)(setLength >> 8);
+                fParameterSets[fParameterSetsLength + 1] = (char)setLength;
+                ::memcpy(fParameterSets + fParameterSetsLength + 2, set, setLength);
+                fParameterSetsLength += 2 + setLength;
+
+                if( (set[0] & 0x60) > (nalHeader & 0x60) )
+                    nalHeader = (nalHeader & 0x80) | (set[0] & 0x60);
+                nalHeader |= set[0] & 0x80;
+            }
+            else
+                fParameterSetsLength = kMaxParameterSetsLength + 1;    // too big, leave them to the SDP
+
+            curPos += 2 + setLength;
+        }
+    }
+
+    if( fParameterSetsLength > kMaxParameterSetsLength )
+        fParameterSetsLength = 0;
+    else
+        fParameterSets[0] = (char)(nalHeader | kSTAPAType);
+
+    return true;
+}
+
+
+// -------------------------------------
+// SDP functions
+//
+void QTPacketizer_H264::WriteSDPAttributes(StringFormatter * sdp)
+{
+    sdp->Put("a=rtpmap:96 H264/90000\r\n");
+    sdp->Put("a=fmtp:96 packetization-mode=1;profile-level-id=");
+    sdp->Put(fProfileLevelID);
+    if( fSpropParameterSets != NULL )
+    {
+        sdp->Put(";sprop-parameter-sets=");
+        sdp->Put(fSpropParameterSets);
+    }
+    sdp->Put("\r\n");
+}
+
+
+// -------------------------------------
+// Packet functions
+//
+QTTrack::ErrorCode QTPacketizer_H264::GetNumPackets(UInt32 sampleNumber, UInt16 * numPackets,
+                                                    QTHintTrack_HintTrackControlBlock * htcb)
+{
+    // General vars
+    char        *sample;
+    UInt32      sampleLength;
+
+    if( sampleNumber != fPacketTableSampleNumber )
+    {
+        if( !fTrack->GetSamplePtr(sampleNumber, &sample, &sampleLength, htcb) )
+            return QTTrack::errInvalidQuickTimeFile;
+
+        if( !this->BuildPacketTable(sampleNumber, sample, sampleLength) )
+            return QTTrack::errInvalidQuickTimeFile;
+    }
+
+    *numPackets = (UInt16)fNumPackets;
+    return QTTrack::errNoError;
+}
+
+QTPacketizer_H264::PacketInfo* QTPacketizer_H264::AddPacket(UInt8 type, UInt32 offset, UInt32 length)
+{
+    // General vars
+    PacketInfo  *packet;
+
+    //
+    // Grow the table if we need to; it ends up as big as the sample with
+    // the most packets.
+    if( fNumPackets == fPacketTableSize )
+    {
+        UInt32      newTableSize = (fPacketTableSize == 0) ? 32 : (fPacketTableSize * 2);
+        PacketInfo  *newTable = NEW PacketInfo[newTableSize];
+
+        if( fPacketTable != NULL )
+        {
+            ::memcpy(newTable, fPacketTable, fNumPackets * sizeof(PacketInfo));
+            delete [] fPacketTable;
+        }
+        fPacketTable = newTable;
+        fPacketTableSize = newTableSize;
+    }
+
+    packet = &fPacketTable[fNumPackets++];
+    packet->fType = type;
+    packet->fOffset = offset;
+    packet->fLength = length;
+    packet->fHeader = 0;
+    packet->fFUFlags = 0;
+
+    return packet;
+}
+
+Bool16 QTPacketizer_H264::BuildPacketTable(UInt32 sampleNumber, char * sample, UInt32 sampleLength)
+{
+    // General vars
+    UInt32      curPos, nalStart, nalLength;
+    UInt8       nalType;
+    Bool16      hasIDR = false, hasSPS = false;
+    Bool16      canAggregate = false;
+    UInt32      aggregateLength = 0;    // payload length of the last packet, if we can add to it
+
+    fPacketTableSampleNumber = 0;
+    fNumPackets = 0;
+
+    //
+    // See whether the access unit needs our parameter sets in front of it.
+    for( curPos = 0; curPos + fNALLengthSize < sampleLength; curPos = nalStart + nalLength )
+    {
+        nalStart = curPos + fNALLengthSize;
+        nalLength = GetBigEndian(sample + curPos, fNALLengthSize);
+        if( nalLength > sampleLength - nalStart )
+            return false;
+
+        if( nalLength == 0 )
+            continue;
+
+        nalType = sample[nalStart] & 0x1F;
+        if( nalType == kIDRType )
+            hasIDR = true;
+        else if( nalType == kSPSType )
+            hasSPS = true;
+    }
+
+    if( hasIDR && !hasSPS && (fParameterSetsLength > 0) )
+        (void)this->AddPacket(kParameterSetsPacket, 0, fParameterSetsLength);
+
+    //
+    // Lay the NAL units out in packets.
+    for( curPos = 0; curPos < sampleLength; curPos = nalStart + nalLength )
+    {
+        if( sampleLength - curPos < fNALLengthSize )
+            return false;
+
+        nalStart = curPos + fNALLengthSize;
+        nalLength = GetBigEndian(sample + curPos, fNALLengthSize);
+        if( nalLength > sampleLength - nalStart )
+            return false;
+
+        if( nalLength == 0 )
+            continue;
+
+        if( nalLength <= kMaxPayloadSize )
+        {
+            //
+            // Turning a single NAL unit packet into a STAP-A costs the STAP-A
+            // header and the first unit's size field as well.
+            UInt32      stapOverhead = 0;
+            if( canAggregate && (fPacketTable[fNumPackets - 1].fType == kSingleNALPacket) )
+                stapOverhead = 1 + 2;
+
+            if( canAggregate && (aggregateLength + stapOverhead + 2 + nalLength <= kMaxPayloadSize) )
+            {
+                PacketInfo  *lastPacket = &fPacketTable[fNumPackets - 1];
+
+                //
+                // Add the NAL unit to the STAP-A the last packet is, or
+                // becomes now.
+                if( lastPacket->fType == kSingleNALPacket )
+                {
+                    lastPacket->fType = kSTAPAPacket;
+                    lastPacket->fHeader = sample[lastPacket->fOffset] & 0xE0;
+                    lastPacket->fOffset -= fNALLengthSize;
+                    aggregateLength += stapOverhead;
+                }
+
+                if( (sample[nalStart] & 0x60) > (lastPacket->fHeader & 0x60) )
+                    lastPacket->fHeader = (lastPacket->fHeader & 0x80) | (sample[nalStart] & 0x60);
+                lastPacket->fHeader |= sample[nalStart] & 0x80;
+
+                lastPacket->fLength = nalStart + nalLength - lastPacket->fOffset;
+                aggregateLength += 2 + nalLength;
+            }
+            else
+            {
+                (void)this->AddPacket(kSingleNALPacket, nalStart, nalLength);
+                canAggregate = true;
+                aggregateLength = nalLength;
+            }
+        }
+        else
+        {
+            //
+            // Fragment the NAL unit, leaving out its header, which the FU
+            // indicator and header carry.
+            UInt32  fragmentStart = nalStart + 1;
+            UInt32  fragmentEnd = nalStart + nalLength;
+
+            while( fragmentStart < fragmentEnd )
+            {
+                UInt32      fragmentLength = fragmentEnd - fragmentStart;
+                PacketInfo  *packet;
+
+                if( fragmentLength > kMaxPayloadSize - 2 )
+                    fragmentLength = kMaxPayloadSize - 2;
+
+                packet = this->AddPacket(kFUAPacket, fragmentStart, fragmentLength);
+                packet->fHeader = sample[nalStart];
+                if( fragmentStart == nalStart + 1 )
+                    packet->fFUFlags |= 0x80;
+                if( fragmentStart + fragmentLength == fragmentEnd )
+                    packet->fFUFlags |= 0x40;
+
+                fragmentStart += fragmentLength;
+            }
+
+            canAggregate = false;
+        }
+    }
+
+    if( fNumPackets > 0xFFFF )
+        return false;
+
+    fPacketTableSampleNumber = sampleNumber;
+    return true;
+}
+
+UInt32 QTPacketizer_H264::WritePayload(char * sample, UInt32 sampleLength, UInt16 packetNumber,
+                                      char * buffer, Bool16 * marker)
+{
+    // General vars
+    PacketInfo  *packet;
+    UInt32      payloadLength = 0;
+
+    Assert((packetNumber > 0) && (packetNumber <= fNumPackets));
+    packet = &fPacketTable[packetNumber - 1];
+    Assert(packet->fOffset + packet->fLength <= sampleLength);
+
+    *marker = (packetNumber == fNumPackets);
+
+    switch( packet->fType )
+    {
+        case kParameterSetsPacket:
+            ::memcpy(buffer, fParameterSets, fParameterSetsLength);
+            payloadLength = fParameterSetsLength;
+            break;
+
+        case kSingleNALPacket:
+            ::memcpy(buffer, sample + packet->fOffset, packet->fLength);
+            payloadLength = packet->fLength;
+            break;
+
+        case kSTAPAPacket:
+        {
+            //
+            // Each NAL unit gets a 16 bit size in place of its length in the sample.
+            UInt32  curPos = packet->fOffset;
+            UInt32  endPos = packet->fOffset + packet->fLength;
+
+            buffer[0] = (char)(packet->fHeader | kSTAPAType);
+            payloadLength = 1;
+
+            while( curPos < endPos )
+            {
+                UInt32  nalLength = GetBigEndian(sample + curPos, fNALLengthSize);
+
+                curPos += fNALLengthSize;
+                if( nalLength == 0 )
+                    continue;
+
+                buffer[payloadLength] = (char)(nalLength >> 8);
+                buffer[payloadLength + 1] = (char)nalLength;
+                ::memcpy(buffer + payloadLength + 2, sample + curPos, nalLength);
+                payloadLength += 2 + nalLength;
+                curPos += nalLength;
+            }
+            break;
+        }
+
+        case kFUAPacket:
+            buffer[0] = (char)((packet->fHeader & 0xE0) | kFUAType);
+            buffer[1] = (char)(packet->fFUFlags | (packet->fHeader & 0x1F));
+            ::memcpy(buffer + 2, sample + packet->fOffset, packet->fLength);
+            payloadLength = 2 + packet->fLength;
+            break;
+    }
+
+    return payloadLength;
+}
@@ -0,0 +1,97 @@
+/***************************************************************************
+
+Copyright (c) 1999-2003 Apple Computer, Inc.  All Rights Reserved.
+2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 QTPacketizer_H264.h
+Description: Packetize the samples of an H.264 ('avc1') track as RFC 6184 RTP
+             packets, in packetization mode 1.
+Comment:     created by QTPacketizer::Create
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-17
+LastUpdate:  2026-10-17
+
+****************************************************************************/
+
+
+#ifndef QTPacketizer_H264_H
+#define QTPacketizer_H264_H
+
+#include "QTPacketizer.h"
+
+//
+// Each sample (access unit) is a run of NAL units, each preceded by its
+// length. NAL units that fit in a packet go alone, or several to a STAP-A if
+// they are small enough to share one; larger ones are split into FU-As. The
+// marker bit is set on the last packet of the access unit.
+//
+// The SPS and PPS from the avcC go into the SDP, and also ahead of every IDR
+// access unit in a STAP-A, for clients that ignore sprop-parameter-sets or
+// join after a seek.
+
+class QTPacketizer_H264 : public QTPacketizer {
+
+public:
+                        QTPacketizer_H264(QTTrack * Track);
+    virtual             ~QTPacketizer_H264(void);
+
+    virtual QTTrack::ErrorCode  GetNumPackets(UInt32 SampleNumber, UInt16 * NumPackets,
+                                              QTHintTrack_HintTrackControlBlock * HTCB);
+
+protected:
+    enum
+    {
+        kRTPTimescale       = 90000,
+        kPayloadType        = 96,
+
+        kSTAPAType          = 24,
+        kFUAType            = 28,
+        kIDRType            = 5,
+        kSPSType            = 7,
+
+        kMaxParameterSetsLength = kMaxPayloadSize   // they must fit in one STAP-A
+    };
+
+    enum PacketType
+    {
+        kParameterSetsPacket,   // our STAP-A of the SPS and PPS
+        kSingleNALPacket,
+        kSTAPAPacket,
+        kFUAPacket
+    };
+
+    //
+    // How one packet of the current sample is made up.
+    struct PacketInfo
+    {
+        UInt32          fOffset;        // kSingleNALPacket: the NAL unit; kSTAPAPacket: the length of its first NAL unit; kFUAPacket: the fragment
+        UInt32          fLength;        // of the above, up to the end of the last NAL unit or the fragment
+        UInt8           fType;          // PacketType
+        UInt8           fHeader;        // kSTAPAPacket: the STAP-A NAL header; kFUAPacket: the fragmented NAL unit's header
+        UInt8           fFUFlags;       // kFUAPacket: S and E bits
+    };
+
+    virtual Bool16      Initialize(void);
+    virtual void        WriteSDPAttributes(StringFormatter * SDP);
+    virtual UInt32      WritePayload(char * Sample, UInt32 SampleLength, UInt16 PacketNumber,
+                                     char * Buffer, Bool16 * Marker);
+
+            Bool16      BuildPacketTable(UInt32 SampleNumber, char * Sample, UInt32 SampleLength);
+            PacketInfo* AddPacket(UInt8 Type, UInt32 Offset, UInt32 Length);
+
+    //
+    // Protected member variables.
+    UInt32              fNALLengthSize;
+
+    char                fParameterSets[kMaxParameterSetsLength];  // STAP-A payload
+    UInt32              fParameterSetsLength;
+    char                fProfileLevelID[7];
+    char                *fSpropParameterSets;
+
+    UInt32              fPacketTableSampleNumber;   // 0 if none
+    PacketInfo          *fPacketTable;
+    UInt32              fNumPackets, fPacketTableSize;
+};
+
+#endif // QTPacketizer_H264_H
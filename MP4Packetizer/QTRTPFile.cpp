@@ -42,6 +42,7 @@
 
 #include "QTTrack.h"
 #include "QTHintTrack.h"
+#include "QTPacketizer.h"
 
 #include "QTRTPFile.h"
 #include "OSMemory.h"
@@ -75,41 +76,105 @@ const RTPMetaInfoPacket::FieldID QTRTPFile::kMetaInfoFields[] =
 // -------------------------------------
 // Protected cache functions and variables.
 //
-OSMutex                         *QTRTPFile::gFileCacheMutex,
-                                *QTRTPFile::gFileCacheAddMutex;
-QTRTPFile::RTPFileCacheEntry    *QTRTPFile::gFirstFileCacheEntry = NULL;
+OSMutex                         *QTRTPFile::gFileCacheMutex = NULL;
+QTRTPFile::RTPFileCacheEntry    **QTRTPFile::gFileCacheHashTable = NULL;
+UInt32                          QTRTPFile::gNumFileCacheHashBuckets = 0;
+UInt32                          QTRTPFile::gNumFileCacheEntries = 0;
+QTRTPFile::RTPFileCacheEntry    *QTRTPFile::gFirstUnusedFileCacheEntry = NULL,
+                                *QTRTPFile::gLastUnusedFileCacheEntry = NULL;
+UInt32                          QTRTPFile::gNumUnusedFileCacheEntries = 0,
+                                QTRTPFile::gMaxUnusedFileCacheEntries = 0;
+UInt64                          QTRTPFile::gFileCacheHits = 0,
+                                QTRTPFile::gFileCacheMisses = 0,
+                                QTRTPFile::gFileCacheEvictions = 0;
 
 void QTRTPFile::Initialize(void)
 {
     QTRTPFile::gFileCacheMutex = NEW OSMutex();
-    QTRTPFile::gFileCacheAddMutex = NEW OSMutex();
 }
 
+void QTRTPFile::SetFileCacheSize(UInt32 inMaxUnusedFiles)
+{
+    // General vars
+    QTRTPFile::RTPFileCacheEntry    *evictedEntries;
+
 
-QTRTPFile::ErrorCode QTRTPFile::new_QTFile(const char * filePath, QTFile ** theQTFile, Bool16 debugFlag, Bool16 deepDebugFlag)
+    {
+        OSMutexLocker   fileCacheMutex(QTRTPFile::gFileCacheMutex);
+
+        QTRTPFile::gMaxUnusedFileCacheEntries = inMaxUnusedFiles;
+        evictedEntries = QTRTPFile::EvictUnusedFiles();
+    }
+
+    QTRTPFile::DeleteFileCacheEntries(evictedEntries);
+}
+
+
+QTRTPFile::ErrorCode QTRTPFile::new_QTFile(const char * filePath, QTFile ** theQTFile, RTPFileCacheEntry ** theCacheEntry,
+                                           Bool16 debugFlag, Bool16 deepDebugFlag)
 {
     // Temporary vars
     QTFile::ErrorCode   rcFile;
+    QTRTPFile::ErrorCode    rc;
 
     // General vars
-    OSMutexLocker       fileCacheAddMutex(QTRTPFile::gFileCacheAddMutex);
-
-    QTRTPFile::RTPFileCacheEntry    *fileCacheEntry;
+    QTRTPFile::RTPFileCacheEntry    *fileCacheEntry = NULL;
+    QTRTPFile::RTPFileCacheEntry    *staleCacheEntry = NULL;
+    SInt64              modDate;
+    UInt64              fileLength;
+    UInt32              hashValue = QTRTPFile::HashFilename(filePath);
+    Bool16              foundEntry;
     
         
     //
-    // Find and return the QTFile object out of our cache, if it exists.
-    if( QTRTPFile::FindAndRefcountFileCacheEntry(filePath, &fileCacheEntry) ) 
+    // Look the file up. If it isn't there, or has changed since it was opened,
+    // add a new entry for it (with its InitMutex held) so that anyone else
+    // opening it waits for us rather than opening it again.
+    QTRTPFile::GetFileStats(filePath, &modDate, &fileLength);
     {
-        fileCacheAddMutex.Unlock();
+        OSMutexLocker   fileCacheMutex(QTRTPFile::gFileCacheMutex);
+
+        foundEntry = QTRTPFile::FindAndRefcountFileCacheEntry(filePath, hashValue, &fileCacheEntry);
+        if( foundEntry && ((fileCacheEntry->ModDate != modDate) || (fileCacheEntry->FileLength != fileLength)) )
+        {
+            //
+            // Whoever is still playing the old file keeps it until they're done.
+            if( fileCacheEntry->IsInTable )
+                QTRTPFile::RemoveFileFromCache(fileCacheEntry);
+            staleCacheEntry = fileCacheEntry;
+            foundEntry = false;
+        }
+
+        if( foundEntry )
+            QTRTPFile::gFileCacheHits++;
+        else
+        {
+            QTRTPFile::gFileCacheMisses++;
+            QTRTPFile::AddFileToCache(filePath, hashValue, modDate, fileLength, &fileCacheEntry); // Grabs InitMutex.
+        }
+    }
+
+    if( staleCacheEntry != NULL )
+        QTRTPFile::delete_QTFile(NULL, staleCacheEntry);
     
-        fileCacheEntry->InitMutex->Lock();  // Guaranteed to block as the mutex
-                                            // is acquired before it is added to
-                                            // the list.
+    *theCacheEntry = fileCacheEntry;
+
+    //
+    // Return the QTFile object out of our cache, if it was there.
+    if( foundEntry )
+    {
+        fileCacheEntry->InitMutex->Lock();  // Blocks until whoever added the
+                                            // entry is done opening the file.
         fileCacheEntry->InitMutex->Unlock();// Because we don't actually need it.
     
         *theQTFile = fileCacheEntry->File;
-        Assert(*theQTFile);
+        if( *theQTFile == NULL )
+        {
+            rc = fileCacheEntry->InitError;
+            QTRTPFile::delete_QTFile(NULL, fileCacheEntry);
+            *theCacheEntry = NULL;
+            return rc;
+        }
         
         return errNoError;
     }
@@ -119,121 +184,126 @@ QTRTPFile::ErrorCode QTRTPFile::new_QTFile(const char * filePath, QTFile ** theQ
     // Construct our file object.
     *theQTFile = NEW QTFile(debugFlag, deepDebugFlag);
     if( *theQTFile == NULL )
-        return errInternalError;
+        rc = errInternalError;
         
     //
     // Open the specified movie.
-    if( (rcFile = (*theQTFile)->Open(filePath)) != QTFile::errNoError ) 
+    else if( (rcFile = (*theQTFile)->Open(filePath)) != QTFile::errNoError ) 
     {
         delete *theQTFile;
+        *theQTFile = NULL;
         
         switch( rcFile ) 
         {
             case errFileNotFound:
-                return errFileNotFound;
+                rc = errFileNotFound;
+                break;
                 
             case errInvalidQuickTimeFile: 
-                return errInvalidQuickTimeFile;
+                rc = errInvalidQuickTimeFile;
+                break;
                 
             default: 
-                return errInternalError;
+                rc = errInternalError;
+                break;
         }
     }
-    
+    else
+        rc = errNoError;
 
     //
-    // Add this file to our cache and release the global add mutex.
-    QTRTPFile::AddFileToCache(filePath, &fileCacheEntry); // Grabs InitMutex.
-    fileCacheAddMutex.Unlock();
-
+    // The file isn't cached if its entry couldn't be allocated..
+    if( fileCacheEntry == NULL )
+        return rc;
 
     //
-    // Finish setting up the fileCacheEntry.
-    if( fileCacheEntry != NULL )
-    {   // it may not have been cached..
-        fileCacheEntry->File = *theQTFile;      
+    // ..or if it couldn't be opened. Take the entry out of the cache, unless
+    // someone found it stale while we were opening it and took it out first,
+    // and let anyone waiting on it know why before dropping our reference.
+    if( rc != errNoError )
+    {
+        {
+            OSMutexLocker   fileCacheMutex(QTRTPFile::gFileCacheMutex);
+            if( fileCacheEntry->IsInTable )
+                QTRTPFile::RemoveFileFromCache(fileCacheEntry);
+        }
+
+        fileCacheEntry->InitError = rc;
         fileCacheEntry->InitMutex->Unlock();
+
+        QTRTPFile::delete_QTFile(NULL, fileCacheEntry);
+        *theCacheEntry = NULL;
+        return rc;
     }
 
+    //
+    // Finish setting up the fileCacheEntry.
+    fileCacheEntry->File = *theQTFile;
+    fileCacheEntry->InitError = errNoError;
+    fileCacheEntry->InitMutex->Unlock();
+
     //
     // Return the file object.
     return errNoError;
 }
 
 
-void QTRTPFile::delete_QTFile(QTFile * theQTFile)
+void QTRTPFile::delete_QTFile(QTFile * theQTFile, RTPFileCacheEntry * theCacheEntry)
 {
-
     // General vars
-    OSMutexLocker                   fileCacheMutex(QTRTPFile::gFileCacheMutex);
-    QTRTPFile::RTPFileCacheEntry    *listEntry;
+    QTRTPFile::RTPFileCacheEntry    *deadEntries = NULL;
 
 
     //
-    // Find the specified cache entry.
-    for ( listEntry = QTRTPFile::gFirstFileCacheEntry; listEntry != NULL; listEntry = listEntry->NextEntry ) 
+    // The object was not in the cache.  Delete it
+    if( theCacheEntry == NULL )
     {
-        //
-        // Check for matches.
-        if( listEntry->File != theQTFile )
-            continue;
-            
-        theQTFile->DecBufferUserCount();
-        //
-        // Delete the object if the reference count has dropped to zero.
-        if ( --listEntry->ReferenceCount == 0 ) 
-        {
-            //
-            // Delete the file.
-            if( theQTFile != NULL )
-            {   delete theQTFile;
-            }
+        if( theQTFile != NULL )
+        {   delete theQTFile;
+        }
+        return;
+    }
 
-            //
-            // Free our other vars.
-            if( listEntry->InitMutex != NULL )
-                delete listEntry->InitMutex;
+    {
+        OSMutexLocker   fileCacheMutex(QTRTPFile::gFileCacheMutex);
 
-            if( listEntry->fFilename != NULL )
-                delete [] listEntry->fFilename;
-            
-            //
-            // Remove this entry from the list.
-            if( listEntry->PrevEntry != NULL )
-                listEntry->PrevEntry->NextEntry = listEntry->NextEntry;
-        
-            if( listEntry->NextEntry != NULL )
-                listEntry->NextEntry->PrevEntry = listEntry->PrevEntry;
-        
-            if( QTRTPFile::gFirstFileCacheEntry == listEntry )
-                QTRTPFile::gFirstFileCacheEntry = listEntry->NextEntry;
-                
-            delete listEntry;
-        }
+        if( theQTFile != NULL )
+            theQTFile->DecBufferUserCount();
 
         //
-        // Return.
-        return;
+        // Keep the file around once nobody is using it, unless it has been
+        // taken out of the cache; then it goes away with the last reference.
+        Assert(theCacheEntry->ReferenceCount > 0);
+        if( --theCacheEntry->ReferenceCount == 0 )
+        {
+            if( theCacheEntry->IsInTable )
+            {
+                QTRTPFile::AddToUnusedList(theCacheEntry);
+                deadEntries = QTRTPFile::EvictUnusedFiles();
+            }
+            else
+            {
+                theCacheEntry->NextEntry = NULL;
+                deadEntries = theCacheEntry;
+            }
+        }
     }
 
     //
-    // The object was not in the cache.  Delete it
-    if( theQTFile != NULL )
-    {   delete theQTFile;
-    }
+    // Close the files outside the lock.
+    QTRTPFile::DeleteFileCacheEntries(deadEntries);
 }
 
 
-void QTRTPFile::AddFileToCache(const char *inFilename, QTRTPFile::RTPFileCacheEntry ** newListEntry)
+void QTRTPFile::AddFileToCache(const char *inFilename, UInt32 inHashValue, SInt64 inModDate, UInt64 inFileLength,
+                               QTRTPFile::RTPFileCacheEntry ** newListEntry)
 {
     // General vars
-    OSMutexLocker                   fileCacheMutex(QTRTPFile::gFileCacheMutex);
-    QTRTPFile::RTPFileCacheEntry*   listEntry;
-    QTRTPFile::RTPFileCacheEntry*   lastListEntry;
+    UInt32      bucket;
     
     
     //
-    // Add this track object to our track list.
+    // Create the entry, with its InitMutex held until the file is open.
     (*newListEntry) = NEW QTRTPFile::RTPFileCacheEntry();
     if( (*newListEntry) == NULL )
         return;
@@ -249,6 +319,9 @@ void QTRTPFile::AddFileToCache(const char *inFilename, QTRTPFile::RTPFileCacheEn
     (*newListEntry)->fFilename = NEW char[(::strlen(inFilename) + 2)];
     ::strcpy((*newListEntry)->fFilename, inFilename);
     (*newListEntry)->File = NULL;
+    (*newListEntry)->InitError = errCallAgain;
+    (*newListEntry)->ModDate = inModDate;
+    (*newListEntry)->FileLength = inFileLength;
     
     (*newListEntry)->ReferenceCount = 1;
 
@@ -256,77 +329,42 @@ void QTRTPFile::AddFileToCache(const char *inFilename, QTRTPFile::RTPFileCacheEn
     (*newListEntry)->NextEntry = NULL;
 
     //
-    // Make this the first entry if there are no entries, otherwise we need to
-    // find out where this file fits in the list and insert it there.
-    if( QTRTPFile::gFirstFileCacheEntry == NULL ) 
-    {
-        QTRTPFile::gFirstFileCacheEntry = (*newListEntry);
-    }
-    else
-    {
-        //
-        // Go through the cache list until we find an inode number greater than
-        // the one that we have now.  Insert it in the list when we find this.
-        for( listEntry = lastListEntry = QTRTPFile::gFirstFileCacheEntry; listEntry != NULL; listEntry = listEntry->NextEntry ) {
-            //
-            // This is the last list entry that we saw (useful for later).
-            lastListEntry = listEntry;
-            
-            //
-            // Skip this entry if this inode number is smaller than the one
-            // for our new entry.
-            if( strcmp(listEntry->fFilename,inFilename) < 0 )
-                continue;
-            
-            //
-            // We've found a larger inode; insert this one in the list.
-            if( listEntry->PrevEntry == NULL )
-                QTRTPFile::gFirstFileCacheEntry = (*newListEntry);
-            else
-                listEntry->PrevEntry->NextEntry = (*newListEntry);
-                
-            (*newListEntry)->PrevEntry = listEntry->PrevEntry;
-            
-            listEntry->PrevEntry = (*newListEntry);
-            
-            (*newListEntry)->NextEntry = listEntry;
-            
-            return;
-        }
-        
-        //
-        // We fell out of our loop; this means that we are the largest inode
-        // in the list; add ourselves to the end of the list.
-        if( lastListEntry == NULL ) { // this can't happen, but..
-            QTRTPFile::gFirstFileCacheEntry = (*newListEntry);
-        }
-        else
-        {
-            lastListEntry->NextEntry = (*newListEntry);
-            (*newListEntry)->PrevEntry = lastListEntry;
-        }
-    }
+    // Add it to the hash table, growing the table to keep the chains short.
+    if( QTRTPFile::gNumFileCacheEntries >= QTRTPFile::gNumFileCacheHashBuckets )
+        QTRTPFile::GrowFileCacheHashTable();
+
+    bucket = inHashValue & (QTRTPFile::gNumFileCacheHashBuckets - 1);
+    (*newListEntry)->HashValue = inHashValue;
+    (*newListEntry)->IsInTable = true;
+    (*newListEntry)->NextHashEntry = QTRTPFile::gFileCacheHashTable[bucket];
+    QTRTPFile::gFileCacheHashTable[bucket] = (*newListEntry);
+    QTRTPFile::gNumFileCacheEntries++;
 }
 
-Bool16 QTRTPFile::FindAndRefcountFileCacheEntry(const char *inFilename, QTRTPFile::RTPFileCacheEntry **cacheEntry)
+Bool16 QTRTPFile::FindAndRefcountFileCacheEntry(const char *inFilename, UInt32 inHashValue, QTRTPFile::RTPFileCacheEntry **cacheEntry)
 {
     // General vars
-    OSMutexLocker                   fileCacheMutex(QTRTPFile::gFileCacheMutex);
     QTRTPFile::RTPFileCacheEntry    *listEntry;
 
 
+    if( QTRTPFile::gFileCacheHashTable == NULL )
+        return false;
+
     //
     // Find the specified cache entry.
-    for( listEntry = QTRTPFile::gFirstFileCacheEntry; listEntry != NULL; listEntry = listEntry->NextEntry )
+    for( listEntry = QTRTPFile::gFileCacheHashTable[inHashValue & (QTRTPFile::gNumFileCacheHashBuckets - 1)];
+         listEntry != NULL; listEntry = listEntry->NextHashEntry )
     {
         //
         // Check for matches.
-        if( ::strcmp(listEntry->fFilename, inFilename) != 0 )
+        if( (listEntry->HashValue != inHashValue) || (::strcmp(listEntry->fFilename, inFilename) != 0) )
             continue;
 
         //
-        // Update the reference count and set the return value.
-        listEntry->ReferenceCount++;
+        // Update the reference count (taking the entry off the unused list if
+        // it was on it) and set the return value.
+        if( listEntry->ReferenceCount++ == 0 )
+            QTRTPFile::RemoveFromUnusedList(listEntry);
         
         *cacheEntry = listEntry;
         
@@ -340,6 +378,181 @@ Bool16 QTRTPFile::FindAndRefcountFileCacheEntry(const char *inFilename, QTRTPFil
     return false;
 }
 
+void QTRTPFile::RemoveFileFromCache(QTRTPFile::RTPFileCacheEntry * cacheEntry)
+{
+    // General vars
+    QTRTPFile::RTPFileCacheEntry    **hashLink;
+
+
+    Assert(cacheEntry->IsInTable);
+
+    hashLink = &QTRTPFile::gFileCacheHashTable[cacheEntry->HashValue & (QTRTPFile::gNumFileCacheHashBuckets - 1)];
+    while( *hashLink != cacheEntry )
+        hashLink = &(*hashLink)->NextHashEntry;
+    *hashLink = cacheEntry->NextHashEntry;
+
+    cacheEntry->NextHashEntry = NULL;
+    cacheEntry->IsInTable = false;
+    QTRTPFile::gNumFileCacheEntries--;
+}
+
+void QTRTPFile::AddToUnusedList(QTRTPFile::RTPFileCacheEntry * cacheEntry)
+{
+    //
+    // The most recently used entry goes on the end.
+    cacheEntry->NextEntry = NULL;
+    cacheEntry->PrevEntry = QTRTPFile::gLastUnusedFileCacheEntry;
+
+    if( QTRTPFile::gLastUnusedFileCacheEntry != NULL )
+        QTRTPFile::gLastUnusedFileCacheEntry->NextEntry = cacheEntry;
+    else
+        QTRTPFile::gFirstUnusedFileCacheEntry = cacheEntry;
+    QTRTPFile::gLastUnusedFileCacheEntry = cacheEntry;
+
+    QTRTPFile::gNumUnusedFileCacheEntries++;
+}
+
+void QTRTPFile::RemoveFromUnusedList(QTRTPFile::RTPFileCacheEntry * cacheEntry)
+{
+    if( cacheEntry->PrevEntry != NULL )
+        cacheEntry->PrevEntry->NextEntry = cacheEntry->NextEntry;
+    else
+        QTRTPFile::gFirstUnusedFileCacheEntry = cacheEntry->NextEntry;
+
+    if( cacheEntry->NextEntry != NULL )
+        cacheEntry->NextEntry->PrevEntry = cacheEntry->PrevEntry;
+    else
+        QTRTPFile::gLastUnusedFileCacheEntry = cacheEntry->PrevEntry;
+
+    cacheEntry->PrevEntry = NULL;
+    cacheEntry->NextEntry = NULL;
+
+    QTRTPFile::gNumUnusedFileCacheEntries--;
+}
+
+QTRTPFile::RTPFileCacheEntry* QTRTPFile::EvictUnusedFiles(void)
+{
+    // General vars
+    QTRTPFile::RTPFileCacheEntry    *cacheEntry;
+    QTRTPFile::RTPFileCacheEntry    *evictedEntries = NULL;
+
+
+    //
+    // Take the least recently used entries out of the cache until we're
+    // within our limit, and return them (linked through NextEntry) for the
+    // caller to delete once it has dropped gFileCacheMutex.
+    while( QTRTPFile::gNumUnusedFileCacheEntries > QTRTPFile::gMaxUnusedFileCacheEntries )
+    {
+        cacheEntry = QTRTPFile::gFirstUnusedFileCacheEntry;
+        QTRTPFile::RemoveFromUnusedList(cacheEntry);
+        if( cacheEntry->IsInTable )
+            QTRTPFile::RemoveFileFromCache(cacheEntry);
+
+        cacheEntry->NextEntry = evictedEntries;
+        evictedEntries = cacheEntry;
+        QTRTPFile::gFileCacheEvictions++;
+    }
+
+    return evictedEntries;
+}
+
+void QTRTPFile::GrowFileCacheHashTable(void)
+{
+    // General vars
+    QTRTPFile::RTPFileCacheEntry    **newHashTable;
+    QTRTPFile::RTPFileCacheEntry    *cacheEntry, *nextEntry;
+    UInt32      newNumBuckets = QTRTPFile::gNumFileCacheHashBuckets * 2;
+    UInt32      bucket;
+
+
+    if( newNumBuckets < kMinFileCacheHashBuckets )
+        newNumBuckets = kMinFileCacheHashBuckets;
+
+    newHashTable = NEW QTRTPFile::RTPFileCacheEntry*[newNumBuckets];
+    ::memset(newHashTable, 0, sizeof(QTRTPFile::RTPFileCacheEntry*) * newNumBuckets);
+
+    //
+    // Rehash every entry into the new table.
+    for( UInt32 curBucket = 0; curBucket < QTRTPFile::gNumFileCacheHashBuckets; curBucket++ )
+    {
+        for( cacheEntry = QTRTPFile::gFileCacheHashTable[curBucket]; cacheEntry != NULL; cacheEntry = nextEntry )
+        {
+            nextEntry = cacheEntry->NextHashEntry;
+
+            bucket = cacheEntry->HashValue & (newNumBuckets - 1);
+            cacheEntry->NextHashEntry = newHashTable[bucket];
+            newHashTable[bucket] = cacheEntry;
+        }
+    }
+
+    delete [] QTRTPFile::gFileCacheHashTable;
+    QTRTPFile::gFileCacheHashTable = newHashTable;
+    QTRTPFile::gNumFileCacheHashBuckets = newNumBuckets;
+}
+
+void QTRTPFile::DeleteFileCacheEntries(QTRTPFile::RTPFileCacheEntry * firstEntry)
+{
+    // General vars
+    QTRTPFile::RTPFileCacheEntry    *nextEntry;
+
+
+    for( ; firstEntry != NULL; firstEntry = nextEntry )
+    {
+        nextEntry = firstEntry->NextEntry;
+
+        //
+        // Delete the file.
+        if( firstEntry->File != NULL )
+            delete firstEntry->File;
+
+        //
+        // Free our other vars.
+        if( firstEntry->InitMutex != NULL )
+            delete firstEntry->InitMutex;
+
+        if( firstEntry->fFilename != NULL )
+            delete [] firstEntry->fFilename;
+
+        delete firstEntry;
+    }
+}
+
+UInt32 QTRTPFile::HashFilename(const char *inFilename)
+{
+    // General vars
+    UInt32      hashValue = 2166136261U;
+
+
+    //
+    // FNV-1a; movie paths tend to differ only near the end.
+    for( ; *inFilename != '\0'; inFilename++ )
+    {
+        hashValue ^= (UInt8)*inFilename;
+        hashValue *= 16777619;
+    }
+
+    return (UInt32)(hashValue & 0xFFFFFFFF);
+}
+
+void QTRTPFile::GetFileStats(const char *inFilename, SInt64 * modDate, UInt64 * fileLength)
+{
+    // General vars
+    struct stat     fileStat;
+
+
+    //
+    // A file we can't stat (a virtual path, say) compares equal to itself,
+    // so it is still cached; a file that goes away doesn't match its entry.
+    *modDate = 0;
+    *fileLength = 0;
+
+    if( ::stat(inFilename, &fileStat) == 0 )
+    {
+        *modDate = (SInt64)fileStat.st_mtime;
+        *fileLength = (UInt64)fileStat.st_size;
+    }
+}
+
 
 
 // -------------------------------------
@@ -349,6 +562,7 @@ QTRTPFile::QTRTPFile(Bool16 debugFlag, Bool16 deepDebugFlag)
     : fDebug(debugFlag)
     , fDeepDebug(deepDebugFlag)
     , fFile(NULL)
+    , fFileCacheEntry(NULL)
     , fFCB(NULL)
     , fNumHintTracks(0)
     , fFirstTrack(NULL)
@@ -386,6 +600,8 @@ QTRTPFile::~QTRTPFile(void)
         // Delete this track entry and move to the next one.
         if( trackEntry->HTCB != NULL )
             delete trackEntry->HTCB;
+        if( trackEntry->Packetizer != NULL )
+            delete trackEntry->Packetizer;
     
         delete trackEntry;
         
@@ -398,7 +614,7 @@ QTRTPFile::~QTRTPFile(void)
     if( fSDPFile != NULL )
         delete[] fSDPFile;
     
-    this->delete_QTFile(fFile);
+    this->delete_QTFile(fFile, fFileCacheEntry);
 
     if( fFCB != NULL )
         delete fFCB;
@@ -420,10 +636,11 @@ QTRTPFile::ErrorCode QTRTPFile::Initialize(const char * filePath)
     
     //
     // Create our file object.
-    rc = this->new_QTFile(filePath, &fFile, fDebug, fDeepDebug);
+    rc = this->new_QTFile(filePath, &fFile, &fFileCacheEntry, fDebug, fDeepDebug);
     if ( rc != errNoError ) 
     {
         fFile = NULL;
+        fFileCacheEntry = NULL;
         return rc;
     }
 
@@ -432,71 +649,50 @@ QTRTPFile::ErrorCode QTRTPFile::Initialize(const char * filePath)
     // Iterate through all of the tracks, adding hint tracks to our list.
     for ( track = NULL; fFile->NextTrack(&track, track); )
     {
-        // General vars
-        QTHintTrack         *hintTrack;
-        RTPTrackListEntry   *listEntry;
-        
         //
         // Skip over anything that's *not* a hint track.
         if( !fFile->IsHintTrack(track) )
             continue;
             
-        hintTrack = (QTHintTrack *)track;
-        
         //
         // Add this track object to our track list.
-        listEntry = NEW RTPTrackListEntry();
-        if( listEntry == NULL )
+        if( !this->AddTrackListEntry(track, (QTHintTrack *)track, NULL) )
             return fErr = errNoHintTracks; 
-
-        listEntry->TrackID = track->GetTrackID();
-        listEntry->HintTrack = hintTrack;
-        
-        listEntry->HTCB = NEW QTHintTrack_HintTrackControlBlock(fFCB);
-        listEntry->IsTrackActive = false;
-        listEntry->IsPacketAvailable = false;
-        listEntry->QualityLevel = kAllPackets;
-        
-        listEntry->Cookie1 = NULL;
-        listEntry->Cookie2 = 0;
-        listEntry->SSRC = 0;
-
-        listEntry->BaseSequenceNumberRandomOffset = 0;
-        listEntry->FileSequenceNumberRandomOffset = 0;
-        listEntry->LastSequenceNumber = 0;
-        listEntry->SequenceNumberAdditive = 0;
-
-        listEntry->BaseTimestampRandomOffset = 0;
-        listEntry->FileTimestampRandomOffset = 0;
-        
-        listEntry->CurSampleNumber = 0;
-        listEntry->ConsecutivePFramesSent = 0;
-        listEntry->TargetPercentage = 0;
-        listEntry->SampleToSeekTo = 0;
-        listEntry->LastSyncSampleNumber = 0;
-        listEntry->NextSyncSampleNumber = 0;
-        listEntry->NumPacketsInThisSample = 0;
-        listEntry->CurPacketNumber = 0;
-        
-        listEntry->CurPacketTime = 0.0;
-        listEntry->CurPacketLength = 0;
-
-        listEntry->NextTrack = NULL;
-
-        if( fFirstTrack == NULL ) {
-            fFirstTrack = fLastTrack = listEntry;
-        } else {
-            fLastTrack->NextTrack = listEntry;
-            fLastTrack = listEntry;
-        }
         
         // One more track..
         fNumHintTracks++;
     }
     
-    // If there aren't any hint tracks, there's no way we can stream this movie,
-    // so notify the caller
+    //
+    // If the movie isn't hinted, packetize whichever of its tracks we know
+    // how to (H.264 and AAC) ourselves.
     if (fNumHintTracks == 0)
+    {
+        for ( track = NULL; fFile->NextTrack(&track, track); )
+        {
+            QTPacketizer    *packetizer;
+            
+            {
+                OSMutexLocker locker(fFile->GetMutex());
+                if( !track->IsInitialized() && (track->Initialize() != QTTrack::errNoError) )
+                    continue;
+            }
+            
+            packetizer = QTPacketizer::Create(track);
+            if( packetizer == NULL )
+                continue;
+            
+            if( !this->AddTrackListEntry(track, NULL, packetizer) )
+            {
+                delete packetizer;
+                return fErr = errNoHintTracks;
+            }
+        }
+    }
+    
+    // If there aren't any hint tracks or tracks we can packetize, there's no
+    // way we can stream this movie, so notify the caller
+    if (fFirstTrack == NULL)
         return fErr = errNoHintTracks; 
     
         
@@ -507,6 +703,64 @@ QTRTPFile::ErrorCode QTRTPFile::Initialize(const char * filePath)
 
 
 
+Bool16 QTRTPFile::AddTrackListEntry(QTTrack * track, QTHintTrack * hintTrack, QTPacketizer * packetizer)
+{
+    // General vars
+    RTPTrackListEntry   *listEntry;
+    
+    
+    listEntry = NEW RTPTrackListEntry();
+    if( listEntry == NULL )
+        return false;
+
+    listEntry->TrackID = track->GetTrackID();
+    listEntry->Track = track;
+    listEntry->HintTrack = hintTrack;
+    listEntry->Packetizer = packetizer;
+    
+    listEntry->HTCB = NEW QTHintTrack_HintTrackControlBlock(fFCB);
+    listEntry->IsTrackActive = false;
+    listEntry->IsPacketAvailable = false;
+    listEntry->QualityLevel = kAllPackets;
+    
+    listEntry->Cookie1 = NULL;
+    listEntry->Cookie2 = 0;
+    listEntry->SSRC = 0;
+
+    listEntry->BaseSequenceNumberRandomOffset = 0;
+    listEntry->FileSequenceNumberRandomOffset = 0;
+    listEntry->LastSequenceNumber = 0;
+    listEntry->SequenceNumberAdditive = 0;
+
+    listEntry->BaseTimestampRandomOffset = 0;
+    listEntry->FileTimestampRandomOffset = 0;
+    
+    listEntry->CurSampleNumber = 0;
+    listEntry->ConsecutivePFramesSent = 0;
+    listEntry->TargetPercentage = 0;
+    listEntry->SampleToSeekTo = 0;
+    listEntry->LastSyncSampleNumber = 0;
+    listEntry->NextSyncSampleNumber = 0;
+    listEntry->NumPacketsInThisSample = 0;
+    listEntry->CurPacketNumber = 0;
+    
+    listEntry->CurPacketTime = 0.0;
+    listEntry->CurPacketLength = 0;
+
+    listEntry->NextTrack = NULL;
+
+    if( fFirstTrack == NULL ) {
+        fFirstTrack = fLastTrack = listEntry;
+    } else {
+        fLastTrack->NextTrack = listEntry;
+        fLastTrack = listEntry;
+    }
+    
+    return true;
+}
+
+
+
 // -------------------------------------
 // Accessors
 //
@@ -539,7 +793,10 @@ UInt64 QTRTPFile::GetAddedTracksRTPBytes(void)
 
         //
         // Add this length to our count.
-        totalRTPBytes += curEntry->HintTrack->GetTotalRTPBytes();
+        if( curEntry->Packetizer != NULL )
+            totalRTPBytes += curEntry->Packetizer->GetTotalRTPBytes();
+        else
+            totalRTPBytes += curEntry->HintTrack->GetTotalRTPBytes();
     }
     
     //
@@ -587,8 +844,16 @@ char * QTRTPFile::GetSDPFile(int * sdpFileLength)
 
 
         //
-        // Get the length of this track's SDP file.
-        if( curEntry->HintTrack->GetSDPFileLength(&trackSDPLength) != QTTrack::errNoError )
+        // Get the length of this track's SDP file. A packetizer has to
+        // build its SDP to know.
+        if( curEntry->Packetizer != NULL )
+        {
+            char    *trackSDP = curEntry->Packetizer->GetSDPFile(&trackSDPLength);
+            if( trackSDP == NULL )
+                continue;
+            delete [] trackSDP;
+        }
+        else if( curEntry->HintTrack->GetSDPFileLength(&trackSDPLength) != QTTrack::errNoError )
             continue;
         
         //
@@ -597,8 +862,9 @@ char * QTRTPFile::GetSDPFile(int * sdpFileLength)
     }
 
     //
-    // See if this movie has a global SDP atom.
-    if( fFile->FindTOCEntry("moov:udta:hnti:rtp ", &globalSDPTOCEntry, NULL) )
+    // See if this movie has a global SDP atom. It describes the hint
+    // tracks, so it is no use when we packetize the movie ourselves.
+    if( (fNumHintTracks > 0) && fFile->FindTOCEntry("moov:udta:hnti:rtp ", &globalSDPTOCEntry, NULL) )
     {
         //
         // Verify that this is an SDP atom.
@@ -641,7 +907,10 @@ char * QTRTPFile::GetSDPFile(int * sdpFileLength)
         
         //
         // Get this track's SDP file and add it to our buffer.
-        trackSDP = curEntry->HintTrack->GetSDPFile(&trackSDPLength);
+        if( curEntry->Packetizer != NULL )
+            trackSDP = curEntry->Packetizer->GetSDPFile(&trackSDPLength);
+        else
+            trackSDP = curEntry->HintTrack->GetSDPFile(&trackSDPLength);
         if( trackSDP == NULL )
             continue;
         
@@ -689,7 +958,7 @@ QTRTPFile::ErrorCode QTRTPFile::AddTrack(UInt32 trackID, Bool16 useRandomOffset)
         OSMutexLocker locker(fFile->GetMutex());
         //
         // Initialize this track.
-        if( trackEntry->HintTrack->Initialize() != QTTrack::errNoError )
+        if( trackEntry->Track->Initialize() != QTTrack::errNoError )
             return fErr = errInternalError;
     }
     
@@ -703,8 +972,13 @@ QTRTPFile::ErrorCode QTRTPFile::AddTrack(UInt32 trackID, Bool16 useRandomOffset)
         trackEntry->BaseTimestampRandomOffset = 0;
     }
 
-    trackEntry->FileSequenceNumberRandomOffset = trackEntry->HintTrack->GetRTPSequenceNumberRandomOffset();
-    trackEntry->FileTimestampRandomOffset = trackEntry->HintTrack->GetRTPTimestampRandomOffset();
+    if( trackEntry->HintTrack != NULL ) {
+        trackEntry->FileSequenceNumberRandomOffset = trackEntry->HintTrack->GetRTPSequenceNumberRandomOffset();
+        trackEntry->FileTimestampRandomOffset = trackEntry->HintTrack->GetRTPTimestampRandomOffset();
+    } else {
+        trackEntry->FileSequenceNumberRandomOffset = 0;
+        trackEntry->FileTimestampRandomOffset = 0;
+    }
     
     trackEntry->LastSequenceNumber = 0;
     trackEntry->SequenceNumberAdditive = 0;
@@ -734,7 +1008,7 @@ Float64 QTRTPFile::GetTrackDuration(UInt32 trackID)
     
     //
     // Return the duration.
-    return trackEntry->HintTrack->GetDurationInSeconds();
+    return trackEntry->Track->GetDurationInSeconds();
 }
 
 UInt32 QTRTPFile::GetTrackTimeScale(UInt32 trackID)
@@ -749,8 +1023,10 @@ UInt32 QTRTPFile::GetTrackTimeScale(UInt32 trackID)
         return 0;
     
     //
-    // Return the duration.
-    return (UInt32)trackEntry->HintTrack->GetTimeScale();
+    // Return the time scale of the RTP timestamps.
+    if( trackEntry->Packetizer != NULL )
+        return trackEntry->Packetizer->GetRTPTimescale();
+    return (UInt32)trackEntry->Track->GetTimeScale();
 }
 
 void QTRTPFile::SetTrackSSRC(UInt32 trackID, UInt32 SSRC)
@@ -810,6 +1086,11 @@ void QTRTPFile::SetTrackRTPMetaInfo(UInt32 TrackID, RTPMetaInfoPacket::FieldID*
     if( !this->FindTrackEntry(TrackID, &trackEntry) )
         return;
     
+    //
+    // Only hint tracks know how to build RTP-Meta-Info packets.
+    if( trackEntry->HintTrack == NULL )
+        return;
+    
     //
     // Set the cookie.
     trackEntry->HTCB->SetupRTPMetaInfo(inFieldArray, isVideo);
@@ -843,7 +1124,7 @@ UInt32 QTRTPFile::GetBytesPerSecond(void)
         if( !curEntry->IsTrackActive )
             continue;
 
-       duration = curEntry->HintTrack->GetDurationInSeconds();
+       duration = curEntry->Track->GetDurationInSeconds();
 
         if (duration > maxDuration)
            maxDuration = duration;
@@ -864,7 +1145,10 @@ UInt32 QTRTPFile::GetBytesPerSecond(void)
 // -------------------------------------
 void QTRTPFile::AllocatePrivateBuffers(UInt32 inUnitSizeInK, UInt32 inNumBuffSizeUnits, UInt32 inMaxBitRateBuffSizeInBlocks)
 {
-    
+    // Reads of a mapped movie never go through the FCB buffers
+    if (fFile->IsMapped())
+        return;
+
     fFCB->EnableCacheBuffers(true);
     UInt32 bytesPerSecond = this->GetBytesPerSecond();
     UInt32 bitRate = bytesPerSecond * 8;
@@ -881,6 +1165,7 @@ QTRTPFile::ErrorCode QTRTPFile::Seek(Float64 seekToTime, Float64 maxBackupTime)
     // General vars
     RTPTrackListEntry   *listEntry;
     Float64             syncToTime = seekToTime;
+    QTPacketIndex       *packetIndex = NULL;
 
     if (fErr == errCallAgain)
     {
@@ -913,27 +1198,27 @@ QTRTPFile::ErrorCode QTRTPFile::Seek(Float64 seekToTime, Float64 maxBackupTime)
         
         //
         // Compute the media time and get the sample at that time.
-        mediaTime = (SInt32)(seekToTime * listEntry->HintTrack->GetTimeScale());
-        mediaTime -= listEntry->HintTrack->GetFirstEditMediaTime();
+        mediaTime = (SInt32)(seekToTime * listEntry->Track->GetTimeScale());
+        mediaTime -= listEntry->Track->GetFirstEditMediaTime();
         if ( mediaTime < 0 )
             mediaTime = 0;
             
-        if ( !listEntry->HintTrack->GetSampleNumberFromMediaTime(mediaTime, &newSampleNumber, &listEntry->HTCB->fsttsSTCB) )
+        if ( !listEntry->Track->GetSampleNumberFromMediaTime(mediaTime, &newSampleNumber, &listEntry->HTCB->fsttsSTCB) )
             continue;   // This track is probably done playing.
         
         //
         // Find the nearest (moving backwards in time) keyframe.
-        listEntry->HintTrack->GetPreviousSyncSample(newSampleNumber, &newSyncSampleNumber);
+        listEntry->Track->GetPreviousSyncSample(newSampleNumber, &newSyncSampleNumber);
         if ( newSampleNumber == newSyncSampleNumber )
             continue;
 
         //
         // Figure out what time this sample is at.
-        if( !listEntry->HintTrack->GetSampleMediaTime(newSyncSampleNumber, &newSampleMediaTime, &listEntry->HTCB->fsttsSTCB) )
+        if( !listEntry->Track->GetSampleMediaTime(newSyncSampleNumber, &newSampleMediaTime, &listEntry->HTCB->fsttsSTCB) )
             return errInvalidQuickTimeFile;
             
-        newSampleMediaTime += listEntry->HintTrack->GetFirstEditMediaTime();
-        newSampleTime = (Float64)newSampleMediaTime * listEntry->HintTrack->GetTimeScaleRecip();
+        newSampleMediaTime += listEntry->Track->GetFirstEditMediaTime();
+        newSampleTime = (Float64)newSampleMediaTime * listEntry->Track->GetTimeScaleRecip();
 
         //
         // Figure out if this is the time that we need to sync to.
@@ -975,6 +1260,9 @@ QTRTPFile::ErrorCode QTRTPFile::Seek(Float64 seekToTime, Float64 maxBackupTime)
     else
         fSeekTime = seekToTime;
     
+    if (fHasRTPMetaInfoFieldArray)
+        packetIndex = this->GetPacketIndex();
+    
     for ( listEntry = fFirstTrack; listEntry != NULL; listEntry = listEntry->NextTrack ) 
     {
         if( !listEntry->IsTrackActive )
@@ -989,28 +1277,36 @@ QTRTPFile::ErrorCode QTRTPFile::Seek(Float64 seekToTime, Float64 maxBackupTime)
 
         //
         // Compute the media time and get the sample at that time.
-        SInt32 mediaTime = (SInt32)(fSeekTime * listEntry->HintTrack->GetTimeScale());
-        mediaTime -= listEntry->HintTrack->GetFirstEditMediaTime();
+        SInt32 mediaTime = (SInt32)(fSeekTime * listEntry->Track->GetTimeScale());
+        mediaTime -= listEntry->Track->GetFirstEditMediaTime();
         if( mediaTime < 0 )
             mediaTime = 0;
 
         listEntry->SampleToSeekTo = 0;
-        if (!listEntry->HintTrack->GetSampleNumberFromMediaTime(mediaTime, &listEntry->SampleToSeekTo, &listEntry->HTCB->fsttsSTCB))
+        if (!listEntry->Track->GetSampleNumberFromMediaTime(mediaTime, &listEntry->SampleToSeekTo, &listEntry->HTCB->fsttsSTCB))
             continue;
         
         //
         // If we are building meta-info packets, we have to build all the packets up until the destination
         // point in the movie, we can't just skip there. So, start by jumping to the beginning of the movie,
         // then PrefetchPacketForAllTracks will move to the right point in the movie
-        if (fHasRTPMetaInfoFieldArray)
+        //
+        // The packet index lets us start at a sample shortly before the one we want instead.
+        QTPacketIndex::Entry *indexEntry = NULL;
+        if ((packetIndex != NULL) && (listEntry->QualityLevel == kAllPackets))
+            indexEntry = packetIndex->FindSampleEntry(listEntry->TrackID, listEntry->SampleToSeekTo);
+        
+        if (indexEntry != NULL)
+            this->StartAtIndexEntry(listEntry, indexEntry);
+        else if (fHasRTPMetaInfoFieldArray)
         {
             mediaTime = 0;
-            mediaTime -= listEntry->HintTrack->GetFirstEditMediaTime();
+            mediaTime -= listEntry->Track->GetFirstEditMediaTime();
             if( mediaTime < 0 )
                 mediaTime = 0;
 
             listEntry->CurSampleNumber = 0;
-            if (!listEntry->HintTrack->GetSampleNumberFromMediaTime(mediaTime, &listEntry->CurSampleNumber, &listEntry->HTCB->fsttsSTCB))
+            if (!listEntry->Track->GetSampleNumberFromMediaTime(mediaTime, &listEntry->CurSampleNumber, &listEntry->HTCB->fsttsSTCB))
                 continue;
         }
         else
@@ -1083,6 +1379,23 @@ QTRTPFile::ErrorCode QTRTPFile::SeekToPacketNumber(UInt32 inTrackID, UInt64 inPa
     // We need to track this so that we don't use the sync sample table if we start thinnning
     fWasLastSeekASeekToPacketNumber = true;
 
+    //
+    // If the movie has a packet index, find the sample at or shortly before the
+    // one holding this packet, and what time that sample is at.
+    QTPacketIndex           *packetIndex = NULL;
+    RTPTrackListEntry       *seekTrack = NULL;
+    QTPacketIndex::Entry    *seekEntry = NULL;
+    Float64                 seekEntryTime = 0.0;
+    
+    if ((inPacketNumber != 0) && this->FindTrackEntry(inTrackID, &seekTrack) && seekTrack->IsTrackActive && (seekTrack->QualityLevel == kAllPackets))
+        packetIndex = this->GetPacketIndex();
+    
+    if (packetIndex != NULL)
+        seekEntry = packetIndex->FindPacketEntry(inTrackID, inPacketNumber);
+    
+    if (seekEntry != NULL)
+        seekEntryTime = (Float64)(seekEntry->fMediaTime + seekTrack->Track->GetFirstEditMediaTime()) * seekTrack->Track->GetTimeScaleRecip();
+
     for (RTPTrackListEntry  *listEntry = fFirstTrack; listEntry != NULL; listEntry = listEntry->NextTrack ) 
     {
         if( !listEntry->IsTrackActive )
@@ -1098,14 +1411,37 @@ QTRTPFile::ErrorCode QTRTPFile::SeekToPacketNumber(UInt32 inTrackID, UInt64 inPa
         //
         // Jump to the beginning of each track
         SInt32 mediaTime = 0;
-        mediaTime -= listEntry->HintTrack->GetFirstEditMediaTime();
+        mediaTime -= listEntry->Track->GetFirstEditMediaTime();
         if( mediaTime < 0 )
             mediaTime = 0;
 
         listEntry->CurSampleNumber = 0;
-        if (!listEntry->HintTrack->GetSampleNumberFromMediaTime(mediaTime, &listEntry->CurSampleNumber, &listEntry->HTCB->fsttsSTCB))
+        if (!listEntry->Track->GetSampleNumberFromMediaTime(mediaTime, &listEntry->CurSampleNumber, &listEntry->HTCB->fsttsSTCB))
             continue;
         
+        //
+        // Start the track holding the packet at its index entry, and the others
+        // at their entries at or before the same time, so that only the packets
+        // from there on have to be built.
+        if (seekEntry != NULL)
+        {
+            QTPacketIndex::Entry *indexEntry = NULL;
+            if (listEntry == seekTrack)
+                indexEntry = seekEntry;
+            else if (listEntry->QualityLevel == kAllPackets)
+            {
+                mediaTime = (SInt32)(seekEntryTime * listEntry->Track->GetTimeScale());
+                mediaTime -= listEntry->Track->GetFirstEditMediaTime();
+                if( mediaTime < 0 )
+                    mediaTime = 0;
+                
+                indexEntry = packetIndex->FindTimeEntry(listEntry->TrackID, (UInt32)mediaTime);
+            }
+            
+            if (indexEntry != NULL)
+                this->StartAtIndexEntry(listEntry, indexEntry);
+        }
+        
         //
         // Clear our current packet information.
         listEntry->NumPacketsInThisSample = 0;
@@ -1132,11 +1468,11 @@ QTRTPFile::ErrorCode    QTRTPFile::ScanToCorrectPacketNumber(UInt32 inTrackID, U
             UInt32          newSampleMediaTime;
             //
             // Figure out what time this sample is at.
-            if( !fLastPacketTrack->HintTrack->GetSampleMediaTime(fLastPacketTrack->CurSampleNumber, &newSampleMediaTime, &fLastPacketTrack->HTCB->fsttsSTCB) )
+            if( !fLastPacketTrack->Track->GetSampleMediaTime(fLastPacketTrack->CurSampleNumber, &newSampleMediaTime, &fLastPacketTrack->HTCB->fsttsSTCB) )
                 return errInvalidQuickTimeFile;
                 
-            newSampleMediaTime += fLastPacketTrack->HintTrack->GetFirstEditMediaTime();
-            fRequestedSeekTime = (Float64)newSampleMediaTime * fLastPacketTrack->HintTrack->GetTimeScaleRecip();
+            newSampleMediaTime += fLastPacketTrack->Track->GetFirstEditMediaTime();
+            fRequestedSeekTime = (Float64)newSampleMediaTime * fLastPacketTrack->Track->GetTimeScaleRecip();
             //fLastPacketTrack = NULL; // So that when we next call GetNextPacket, we actually get the same packet
             return errNoError;
         }
@@ -1151,6 +1487,25 @@ QTRTPFile::ErrorCode    QTRTPFile::ScanToCorrectPacketNumber(UInt32 inTrackID, U
     return errCallAgain;
 }
 
+QTPacketIndex* QTRTPFile::GetPacketIndex()
+{
+    //
+    // The index counts every packet, so it doesn't hold if we drop repeat packets.
+    if (fDropRepeatPackets)
+        return NULL;
+        
+    return fFile->GetPacketIndex();
+}
+
+void QTRTPFile::StartAtIndexEntry(RTPTrackListEntry * trackEntry, QTPacketIndex::Entry * indexEntry)
+{
+    //
+    // Pick up the packet counters where the packets before this sample left them.
+    trackEntry->CurSampleNumber = indexEntry->fSampleNumber;
+    trackEntry->HTCB->fCurrentPacketNumber = indexEntry->fPacketNumber;
+    trackEntry->HTCB->fCurrentPacketPosition = indexEntry->fPacketPosition;
+}
+
 UInt32 QTRTPFile::GetSeekTimestamp(UInt32 trackID)
 {
     // General vars
@@ -1204,6 +1559,78 @@ Float64 QTRTPFile::GetFirstPacketTransmitTime()
     return firstPacketTime;
 }
 
+// Widens [ioStart, ioEnd) to cover the samples of inTrack between the two media
+// times. Samples of a track are laid out in order, so the first and last
+// sample are enough.
+static void AddSamplesToRange(QTTrack* inTrack, UInt32 inStartMediaTime, UInt32 inEndMediaTime, UInt64* ioStart, UInt64* ioEnd)
+{
+    QTAtom_stts_SampleTableControlBlock theSTTS;
+    QTAtom_stsc_SampleTableControlBlock theSTSC;
+    UInt32 theFirstSample = 0, theLastSample = 0;
+
+    if (!inTrack->GetSampleNumberFromMediaTime(inStartMediaTime, &theFirstSample, &theSTTS))
+        return;
+    if (!inTrack->GetSampleNumberFromMediaTime(inEndMediaTime, &theLastSample, &theSTTS))
+        theLastSample = inTrack->GetNumSamples();
+
+    UInt32 theLength = 0, theSampleDescIndex = 0;
+    UInt64 theOffset = 0;
+    if (inTrack->GetSampleInfo(theFirstSample, &theLength, &theOffset, &theSampleDescIndex, &theSTSC))
+    {
+        if (theOffset < *ioStart)
+            *ioStart = theOffset;
+        if (theOffset + theLength > *ioEnd)
+            *ioEnd = theOffset + theLength;
+    }
+    if ((theLastSample > theFirstSample) && inTrack->GetSampleInfo(theLastSample, &theLength, &theOffset, &theSampleDescIndex, &theSTSC))
+    {
+        if (theOffset < *ioStart)
+            *ioStart = theOffset;
+        if (theOffset + theLength > *ioEnd)
+            *ioEnd = theOffset + theLength;
+    }
+}
+
+Bool16 QTRTPFile::GetReadAheadRange(Float64 inSeconds, UInt64* outOffset, UInt32* outLength)
+{
+    UInt64 theStart = (UInt64)-1;
+    UInt64 theEnd = 0;
+
+    for (RTPTrackListEntry* listEntry = fFirstTrack; listEntry != NULL; listEntry = listEntry->NextTrack)
+    {
+        if (!listEntry->IsTrackActive || !listEntry->IsPacketAvailable)
+            continue;
+
+        QTTrack* theSentTrack = listEntry->Track;
+        QTHintTrack* theHintTrack = listEntry->HintTrack;
+        QTAtom_stts_SampleTableControlBlock theSTTS;
+        UInt32 theSampleNumber = (listEntry->CurSampleNumber > 0) ? listEntry->CurSampleNumber : 1;
+        UInt32 theMediaTime = 0;
+        if (!theSentTrack->GetSampleMediaTime(theSampleNumber, &theMediaTime, &theSTTS))
+            continue;
+
+        Float64 theStartTime = theMediaTime * theSentTrack->GetTimeScaleRecip();
+        AddSamplesToRange(theSentTrack, theMediaTime, (UInt32)((theStartTime + inSeconds) * theSentTrack->GetTimeScale()), &theStart, &theEnd);
+
+        // ..and the media the hint samples point into
+        for (UInt32 x = 0; (theHintTrack != NULL) && (x < theHintTrack->GetNumTrackRefs()); x++)
+        {
+            QTTrack* theTrack = theHintTrack->GetTrackRef(x);
+            if ((theTrack == NULL) || !theTrack->IsInitialized())
+                continue;
+            AddSamplesToRange(theTrack, (UInt32)(theStartTime * theTrack->GetTimeScale()),
+                              (UInt32)((theStartTime + inSeconds) * theTrack->GetTimeScale()), &theStart, &theEnd);
+        }
+    }
+
+    if (theEnd <= theStart)
+        return false;
+
+    *outOffset = theStart;
+    *outLength = (theEnd - theStart > kUInt32_Max) ? kUInt32_Max : (UInt32)(theEnd - theStart);
+    return true;
+}
+
 UInt16 QTRTPFile::GetNextTrackSequenceNumber(UInt32 trackID)
 {
     // General vars
@@ -1322,7 +1749,10 @@ SInt32  QTRTPFile::GetMovieHintType()
     for( RTPTrackListEntry  *listEntry = fFirstTrack; listEntry != NULL; listEntry = listEntry->NextTrack )
     {
         //
-        // Check for matches.
+        // Tracks we packetize ourselves have no hint track type.
+        if (listEntry->HintTrack == NULL)
+            continue;
+            
         trackHintType = listEntry->HintTrack->GetHintTrackType();
         if (trackHintType > 0) // always set movie hint type to unoptimized if a track is unoptimized
         {   movieHintType = trackHintType;
@@ -1363,7 +1793,7 @@ Bool16 QTRTPFile::PrefetchNextPacket(RTPTrackListEntry * trackEntry, Bool16 doSe
               && (trackEntry->NumPacketsInThisSample != 0)
             ) 
         {
-            if (trackEntry->HintTrack->IsSyncSample(trackEntry->CurSampleNumber, 0))
+            if (trackEntry->Track->IsSyncSample(trackEntry->CurSampleNumber, 0))
             {
                 trackEntry->LastSyncSampleNumber = trackEntry->CurSampleNumber;
                 if (trackEntry->NextSyncSampleNumber != trackEntry->CurSampleNumber)
@@ -1376,7 +1806,7 @@ Bool16 QTRTPFile::PrefetchNextPacket(RTPTrackListEntry * trackEntry, Bool16 doSe
             // move on.
             if( trackEntry->QualityLevel >= kKeyFramesOnly )
             {
-                trackEntry->HintTrack->GetNextSyncSample(trackEntry->CurSampleNumber, &trackEntry->NextSyncSampleNumber);
+                trackEntry->Track->GetNextSyncSample(trackEntry->CurSampleNumber, &trackEntry->NextSyncSampleNumber);
                 if (!fHasRTPMetaInfoFieldArray && !fWasLastSeekASeekToPacketNumber)
                 {
                      fNumSkippedSamples += trackEntry->NextSyncSampleNumber - trackEntry->CurSampleNumber;
@@ -1408,13 +1838,13 @@ Bool16 QTRTPFile::PrefetchNextPacket(RTPTrackListEntry * trackEntry, Bool16 doSe
 
                                 //
                                 // Only skip this sample if it is not a sync sample
-                if (!trackEntry->HintTrack->IsSyncSample(trackEntry->CurSampleNumber, 0))
+                if (!trackEntry->Track->IsSyncSample(trackEntry->CurSampleNumber, 0))
                 {
                                         //
                                         // figure out where the next sync sample is
                     if (trackEntry->CurSampleNumber >= trackEntry->NextSyncSampleNumber)
                     {
-                        trackEntry->HintTrack->GetNextSyncSample(trackEntry->CurSampleNumber, &trackEntry->NextSyncSampleNumber);
+                        trackEntry->Track->GetNextSyncSample(trackEntry->CurSampleNumber, &trackEntry->NextSyncSampleNumber);
                     }
 
                     // this shouldn't ever be false, but I'm worried about when people skip backwards in movies
@@ -1445,7 +1875,12 @@ Bool16 QTRTPFile::PrefetchNextPacket(RTPTrackListEntry * trackEntry, Bool16 doSe
         // Do we know how many packets are in this sample?  If not, figure it out.
         while ( trackEntry->NumPacketsInThisSample == 0 ) 
         {
-            if ( trackEntry->HintTrack->GetNumPackets(trackEntry->CurSampleNumber, &trackEntry->NumPacketsInThisSample, trackEntry->HTCB) != QTTrack::errNoError )
+            if ( trackEntry->Packetizer != NULL )
+            {
+                if ( trackEntry->Packetizer->GetNumPackets(trackEntry->CurSampleNumber, &trackEntry->NumPacketsInThisSample, trackEntry->HTCB) != QTTrack::errNoError )
+                    return false;
+            }
+            else if ( trackEntry->HintTrack->GetNumPackets(trackEntry->CurSampleNumber, &trackEntry->NumPacketsInThisSample, trackEntry->HTCB) != QTTrack::errNoError )
                 return false;
                 
             if ( trackEntry->NumPacketsInThisSample == 0 )
@@ -1463,7 +1898,14 @@ Bool16 QTRTPFile::PrefetchNextPacket(RTPTrackListEntry * trackEntry, Bool16 doSe
         MicroSecondStopWatch    packetTimer;
         packetTimer.Start();
     #endif
-        getPacketErr = trackEntry->HintTrack->GetPacket(trackEntry->CurSampleNumber, trackEntry->CurPacketNumber,
+        if ( trackEntry->Packetizer != NULL )
+            getPacketErr = trackEntry->Packetizer->GetPacket(trackEntry->CurSampleNumber, trackEntry->CurPacketNumber,
+                                                   trackEntry->CurPacket, &trackEntry->CurPacketLength,
+                                                   &trackEntry->CurPacketTime,
+                                                   trackEntry->SSRC,
+                                                   trackEntry->HTCB);
+        else
+            getPacketErr = trackEntry->HintTrack->GetPacket(trackEntry->CurSampleNumber, trackEntry->CurPacketNumber,
                                                    trackEntry->CurPacket, &trackEntry->CurPacketLength,
                                                    &trackEntry->CurPacketTime,
                                                    (trackEntry->QualityLevel >= kNoBFrames),
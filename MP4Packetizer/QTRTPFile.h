@@ -37,6 +37,7 @@
 #include "MyAssert.h"
 #include "RTPMetaInfoPacket.h"
 #include "QTHintTrack.h"
+#include "QTPacketIndex.h"
 
 #ifndef __Win32__
 #include <sys/stat.h>
@@ -55,6 +56,8 @@ class QTFile;
 class QTFile_FileControlBlock;
 class QTHintTrack;
 class QTHintTrack_HintTrackControlBlock;
+class QTPacketizer;
+class QTTrack;
 
 class QTRTPFile {
 
@@ -83,14 +86,25 @@ public:
         //
         // File information
         char*       fFilename;
-        QTFile      *File;
+        QTFile      *File;          // NULL if the file couldn't be opened
+        ErrorCode   InitError;      // ..and why
+        SInt64      ModDate;        // of the file when it was opened, to notice
+        UInt64      FileLength;     // it being replaced
         
         //
         // Reference count for this cache entry
         int         ReferenceCount; 
+
+        //
+        // Hash table information. Entries are taken out of the table when
+        // their file changes or can't be opened, and deleted when the last
+        // reference goes away.
+        UInt32      HashValue;
+        Bool16      IsInTable;
+        RTPFileCacheEntry   *NextHashEntry;
         
         //
-        // List pointers
+        // List pointers, for the LRU list of unused entries
         RTPFileCacheEntry   *PrevEntry, *NextEntry;
     };
     
@@ -99,7 +113,9 @@ public:
         //
         // Track information
         UInt32          TrackID;
-        QTHintTrack     *HintTrack;
+        QTTrack         *Track;         // HintTrack, or the media track Packetizer sends
+        QTHintTrack     *HintTrack;     // NULL if the movie isn't hinted
+        QTPacketizer    *Packetizer;
         QTHintTrack_HintTrackControlBlock   *HTCB;
         Bool16          IsTrackActive, IsPacketAvailable;
         UInt32          QualityLevel;
@@ -143,6 +159,21 @@ public:
     // Returns a static array of the RTP-Meta-Info fields supported by QTFileLib.
     // It also returns field IDs for the fields it recommends being compressed.
     static const RTPMetaInfoPacket::FieldID*        GetSupportedRTPMetaInfoFields() { return kMetaInfoFields; }
+
+    //
+    // Opened movies are shared by every QTRTPFile playing them, and are kept
+    // open after the last one goes away so the next DESCRIBE or SETUP doesn't
+    // parse the movie again. This sets how many unused movies are kept, the
+    // least recently used ones being closed first; 0 closes a movie as soon
+    // as it is unused.
+    static void         SetFileCacheSize(UInt32 inMaxUnusedFiles);
+
+    //
+    // File cache counters since startup
+    static UInt64       GetFileCacheHits()      { return gFileCacheHits; }
+    static UInt64       GetFileCacheMisses()    { return gFileCacheMisses; }
+    static UInt64       GetFileCacheEvictions() { return gFileCacheEvictions; }
+    static UInt32       GetNumCachedFiles()     { return gNumFileCacheEntries; }
     
     //
     // Constructors and destructor.
@@ -218,6 +249,12 @@ public:
             Float64     GetRequestedSeekTime()  { return fRequestedSeekTime; }
             Float64     GetActualSeekTime()     { return fSeekTime; }
             Float64     GetFirstPacketTransmitTime();
+
+            //
+            // Returns the part of the file holding the hint and media samples of
+            // the next inSeconds of every active track, starting at the packets
+            // about to be sent. Used to read the file ahead of GetNextPacket.
+            Bool16      GetReadAheadRange(Float64 inSeconds, UInt64* outOffset, UInt32* outLength);
             RTPTrackListEntry* GetLastPacketTrack() { return fLastPacketTrack; }
             UInt32      GetNumSkippedSamples() { return fNumSkippedSamples; }
                         
@@ -234,26 +271,53 @@ public:
 protected:
     //
     // Protected cache functions and variables.
-    static  OSMutex             *gFileCacheMutex, *gFileCacheAddMutex;
-    static  RTPFileCacheEntry   *gFirstFileCacheEntry;
+    enum
+    {
+        kMinFileCacheHashBuckets    = 256   // must be a power of 2
+    };
+
+    static  OSMutex             *gFileCacheMutex;
+    static  RTPFileCacheEntry   **gFileCacheHashTable;
+    static  UInt32              gNumFileCacheHashBuckets;
+    static  UInt32              gNumFileCacheEntries;
+    static  RTPFileCacheEntry   *gFirstUnusedFileCacheEntry, *gLastUnusedFileCacheEntry;
+    static  UInt32              gNumUnusedFileCacheEntries, gMaxUnusedFileCacheEntries;
+    static  UInt64              gFileCacheHits, gFileCacheMisses, gFileCacheEvictions;
     
-    static  ErrorCode   new_QTFile(const char * FilePath, QTFile ** File, Bool16 Debug = false, Bool16 DeepDebug = false);
-    static  void        delete_QTFile(QTFile * File);
+    static  ErrorCode   new_QTFile(const char * FilePath, QTFile ** File, RTPFileCacheEntry ** CacheEntry,
+                                   Bool16 Debug = false, Bool16 DeepDebug = false);
+    static  void        delete_QTFile(QTFile * File, RTPFileCacheEntry * CacheEntry);
+
+    //
+    // These are called with gFileCacheMutex held.
+    static  void        AddFileToCache(const char *inFilename, UInt32 inHashValue, SInt64 inModDate, UInt64 inFileLength,
+                                       QTRTPFile::RTPFileCacheEntry ** NewListEntry);
+    static  Bool16      FindAndRefcountFileCacheEntry(const char *inFilename, UInt32 inHashValue, QTRTPFile::RTPFileCacheEntry **CacheEntry);
+    static  void        RemoveFileFromCache(QTRTPFile::RTPFileCacheEntry * CacheEntry);
+    static  void        AddToUnusedList(QTRTPFile::RTPFileCacheEntry * CacheEntry);
+    static  void        RemoveFromUnusedList(QTRTPFile::RTPFileCacheEntry * CacheEntry);
+    static  QTRTPFile::RTPFileCacheEntry*   EvictUnusedFiles(void);
+    static  void        GrowFileCacheHashTable(void);
 
-    static  void        AddFileToCache(const char *inFilename, QTRTPFile::RTPFileCacheEntry ** NewListEntry);
-    static  Bool16      FindAndRefcountFileCacheEntry(const char *inFilename, QTRTPFile::RTPFileCacheEntry **CacheEntry);
+    static  void        DeleteFileCacheEntries(QTRTPFile::RTPFileCacheEntry * FirstEntry);
+    static  UInt32      HashFilename(const char *inFilename);
+    static  void        GetFileStats(const char *inFilename, SInt64 * ModDate, UInt64 * FileLength);
 
     //
     // Protected member functions.
+            Bool16      AddTrackListEntry(QTTrack * Track, QTHintTrack * HintTrack, QTPacketizer * Packetizer);
             Bool16      PrefetchNextPacket(RTPTrackListEntry * TrackEntry, Bool16 doSeek = false);
             ErrorCode   ScanToCorrectSample();
             ErrorCode   ScanToCorrectPacketNumber(UInt32 inTrackID, UInt64 inPacketNumber);
+            QTPacketIndex*  GetPacketIndex();
+            void        StartAtIndexEntry(RTPTrackListEntry * TrackEntry, QTPacketIndex::Entry * IndexEntry);
 
     //
     // Protected member variables.
     Bool16              fDebug, fDeepDebug;
 
     QTFile              *fFile;
+    RTPFileCacheEntry   *fFileCacheEntry;
     QTFile_FileControlBlock *fFCB;
     
     UInt32              fNumHintTracks;
@@ -51,6 +51,7 @@
 #include "QTAtom_stts.h"
 
 #include "QTTrack.h"
+#include "QTHintTrack.h"
 
 #include "OSMemory.h"
 
@@ -448,6 +449,113 @@ Bool16 QTTrack::GetSample(UInt32 SampleNumber, char * Buffer, UInt32 * Length, Q
 }
 
 
+Bool16 QTTrack::GetSamplePtr(UInt32 sampleNumber, char ** samplePtr, UInt32 * length, QTHintTrack_HintTrackControlBlock * htcb)
+{
+    // General vars
+    UInt32      newSampleLength;
+    Assert(htcb != NULL);
+
+    // See if this sample is in our cache, returning it out of the cache if it
+    // is, fetching and caching it if it is not.
+    if( sampleNumber == htcb->fCachedSampleNumber ) 
+    {
+        *samplePtr = htcb->fCachedSample;
+        *length = htcb->fCachedSampleLength;
+        return true;
+    }
+    
+    //TEMP_PRINT( "QTTrack::GetSamplePtr; sample not cached\n" );
+    
+    htcb->fLastPacketNumberFetched = 0xFFFF;    // mark to invalid
+    htcb->fPointerToNextPacket = NULL;
+
+    //
+    // Get the length of the new sample.
+    UInt32      sampleDescriptionIndex;
+    UInt64      sampleOffset;
+    
+    if( !this->GetSampleInfo(sampleNumber, &newSampleLength, &sampleOffset, &sampleDescriptionIndex, &htcb->fstscSTCB) )
+        return false;
+
+    //
+    // If the movie is mapped, use the sample where it is rather than copying it.
+    // Media data is normally interleaved with the hint samples, so this is also
+    // where we keep the kernel paging in the part of the file we play next.
+    if( fFile->IsMapped() && fDataReferenceAtom->IsRefInThisFile(sampleDescriptionIndex) )
+    {
+        char *mappedSample = fFile->MapFileToMem(sampleOffset, newSampleLength);
+        if( mappedSample != NULL )
+        {
+            if( (sampleOffset < htcb->fAdviseStart) || (sampleOffset + (kMappedReadAheadBytes / 2) > htcb->fAdviseEnd) )
+            {
+                fFile->AdviseWillNeed(sampleOffset, kMappedReadAheadBytes);
+                htcb->fAdviseStart = sampleOffset;
+                htcb->fAdviseEnd = sampleOffset + kMappedReadAheadBytes;
+            }
+
+            htcb->fCachedSampleNumber = sampleNumber;
+            htcb->fCachedSample = mappedSample;
+            htcb->fCachedSampleLength = newSampleLength;
+            *samplePtr = htcb->fCachedSample;
+            *length = htcb->fCachedSampleLength;
+            return true;
+        }
+
+        //
+        // Unless MapFileToMem has just found the file truncated, and the
+        // sample is read below like in an unmapped movie, it isn't in the file.
+        if( fFile->IsMapped() )
+            return false;
+    }
+    
+    //
+    // Create a new (bigger) cache samplePtr if the sample wouldn't fit in the
+    // old one.
+    if( (htcb->fSampleBuffer == NULL) || (htcb->fCachedSampleSize < newSampleLength) ) 
+    {
+        //
+        // Free the old cache entry if we had one.
+        if( htcb->fSampleBuffer != NULL ) 
+        {
+            htcb->fCachedSampleNumber = 0;
+            htcb->fCachedSampleSize = 0;
+            delete[] htcb->fSampleBuffer;
+            htcb->fSampleBuffer = NULL;
+        }
+        
+        //
+        // Create a new cache entry.
+        htcb->fCachedSampleLength = htcb->fCachedSampleSize = newSampleLength;
+        htcb->fSampleBuffer = NEW char[htcb->fCachedSampleSize];
+        if( htcb->fSampleBuffer == NULL )
+            return false;
+    }
+    htcb->fCachedSample = htcb->fSampleBuffer;
+    
+
+    //
+    // Read in the new sample.
+    htcb->fCachedSampleLength = newSampleLength;
+    
+    //- this did another GetSampleInfo and we already have that data...
+    //if( !this->GetSample(sampleNumber, htcb->fCachedSample, &htcb->fCachedSampleLength, htcb->fFCB, htcb->fstscSTCB) )
+    //  return false;
+    
+    //
+    // Read in the sample
+    if( !fDataReferenceAtom->Read( sampleDescriptionIndex, sampleOffset, htcb->fCachedSample, htcb->fCachedSampleLength, htcb->fFCB ) )
+        return false;
+    //
+    // Return the cached sample.
+    htcb->fCachedSampleNumber = sampleNumber;
+    *samplePtr = htcb->fCachedSample;
+    *length = htcb->fCachedSampleLength;
+    
+    
+    return true;
+}
+
+
 
 // -------------------------------------
 // Debugging functions
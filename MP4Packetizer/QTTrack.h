@@ -50,6 +50,7 @@ class QTFile;
 class QTFile_FileControlBlock;
 class QTAtom_stsc_SampleTableControlBlock;
 class QTAtom_stts_SampleTableControlBlock;
+class QTHintTrack_HintTrackControlBlock;
 
 
 //
@@ -92,10 +93,13 @@ public:
     inline  Float64     GetTimeScale(void) { return fMediaHeaderAtom->GetTimeScale(); }
     inline  Float64     GetTimeScaleRecip(void) { return fMediaHeaderAtom->GetTimeScaleRecip(); }
     inline  Float64     GetDurationInSeconds(void) { return GetDuration() / (Float64)GetTimeScale(); }
+    inline  UInt64      GetMediaDuration(void) { return fMediaHeaderAtom->GetDuration(); }
     inline  UInt64      GetFirstEditMovieTime(void)
                                               { if(fEditListAtom != NULL) return fEditListAtom->FirstEditMovieTime();
                                                 else return 0; }
     inline  UInt32      GetFirstEditMediaTime(void) { return fFirstEditMediaTime; }
+    inline  UInt32      GetNumSamples(void) { return fSampleSizeAtom->GetNumEntries(); }
+    inline  UInt64      GetTotalSampleSize(void) { return fSampleSizeAtom->GetTotalSampleSize(); }
     
     //
     // Sample functions
@@ -141,6 +145,19 @@ public:
     Bool16      GetSample(UInt32 SampleNumber, char * Buffer, UInt32 * Length,QTFile_FileControlBlock * FCB, 
                                                 QTAtom_stsc_SampleTableControlBlock * STCB);
 
+    //
+    // Returns a pointer to the sample, cached in the HTCB (which is also where
+    // it is read into, unless the movie is mapped).
+    Bool16      GetSamplePtr(UInt32 SampleNumber, char ** Buffer, UInt32 * Length,
+                                     QTHintTrack_HintTrackControlBlock * HTCB);
+
+    //
+    // Returns the sample description with the given data format, if the
+    // track has one (the track must be initialized).
+    inline  Bool16      FindSampleDescription(OSType DataFormat, char ** Buffer, UInt32 * Length)
+                        {   return fSampleDescriptionAtom->FindSampleDescription(DataFormat, Buffer, Length);
+                        }
+
     inline  Bool16      GetSampleMediaTime(UInt32 SampleNumber, UInt32 * const MediaTime, 
                                                 QTAtom_stts_SampleTableControlBlock * STCB)
                         {   return fTimeToSampleAtom->SampleNumberToMediaTime(SampleNumber, MediaTime, STCB); 
@@ -191,6 +208,11 @@ public:
 
 
 protected:
+    enum
+    {
+        kMappedReadAheadBytes = 512 * 1024  // how far ahead of a client we keep a mapped movie paged in
+    };
+
     //
     // Protected member variables.
     Bool16              fDebug, fDeepDebug;
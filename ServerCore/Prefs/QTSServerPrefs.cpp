@@ -122,7 +122,10 @@ QTSSAttrInfoDict::AttrInfo  QTSServerPrefs::sAttributes[] =
     /* 68 */ { "force_logs_close_on_write",             NULL,                   qtssAttrDataTypeBool16,     qtssAttrModeRead | qtssAttrModeWrite },
     /* 69 */ { "disable_thinning",                      NULL,                   qtssAttrDataTypeBool16,     qtssAttrModeRead | qtssAttrModeWrite },
 	/* 70 */ { "player_requires_rtp_header_info",		NULL,					qtssAttrDataTypeCharArray,	qtssAttrModeRead | qtssAttrModeWrite },
-	/* 71 */ { "player_requires_bandwidth_adjustment",	NULL,					qtssAttrDataTypeCharArray,	qtssAttrModeRead | qtssAttrModeWrite }
+	/* 71 */ { "player_requires_bandwidth_adjustment",	NULL,					qtssAttrDataTypeCharArray,	qtssAttrModeRead | qtssAttrModeWrite },
+    /* 72 */ { "run_num_event_threads",                 NULL,                   qtssAttrDataTypeUInt32,     qtssAttrModeRead | qtssAttrModeWrite },
+    /* 73 */ { "enable_udp_gso",                        NULL,                   qtssAttrDataTypeBool16,     qtssAttrModeRead | qtssAttrModeWrite },
+    /* 74 */ { "rtsp_listeners_per_port",               NULL,                   qtssAttrDataTypeUInt32,     qtssAttrModeRead | qtssAttrModeWrite }
     
 
 };
@@ -210,7 +213,10 @@ QTSServerPrefs::PrefInfo QTSServerPrefs::sPrefInfo[] =
 	{ kDontAllowMultipleValues, "false",    NULL                    },  //force_logs_close_on_write,־ÿд󲢲ر
 	{ kDontAllowMultipleValues, "false",    NULL                    },  //disable_thinning,ĬϿԱ
 	{ kAllowMultipleValues,     "Nokia",    sRTP_Header_Players     },  //players_requires_rtp_header_info
-	{ kAllowMultipleValues,     "Nokia",    sAdjust_Bandwidth_Players}  //players_requires_bandwidth_adjustment
+	{ kAllowMultipleValues,     "Nokia",    sAdjust_Bandwidth_Players}, //players_requires_bandwidth_adjustment
+	{ kDontAllowMultipleValues, "0",        NULL                    },  //run_num_event_threads
+	{ kDontAllowMultipleValues, "false",    NULL                    },  //enable_udp_gso
+	{ kDontAllowMultipleValues, "1",        NULL                    }   //rtsp_listeners_per_port
 
 
 };
@@ -268,6 +274,9 @@ QTSServerPrefs::QTSServerPrefs(XMLPrefsParser* inPrefsSource, Bool16 inWriteMiss
     fEnableRTSPDebugPrintfs(false),
     fEnableRTSPServerInfo(true),
     fNumThreads(0),
+    fNumEventThreads(0),
+    fEnableUDPGSO(false),
+    fNumRTSPListenersPerPort(1),
 #if __MacOSX__
     fEnableMonitorStatsFile(false),
 #else
@@ -351,6 +360,9 @@ void QTSServerPrefs::SetupAttributes()
 	this->SetVal(qtssPrefsEnableRTSPDebugPrintfs,       &fEnableRTSPDebugPrintfs,       sizeof(fEnableRTSPDebugPrintfs));
 	this->SetVal(qtssPrefsEnableRTSPServerInfo,         &fEnableRTSPServerInfo,         sizeof(fEnableRTSPServerInfo));
 	this->SetVal(qtssPrefsRunNumThreads,                &fNumThreads,                   sizeof(fNumThreads));
+	this->SetVal(qtssPrefsRunNumEventThreads,           &fNumEventThreads,              sizeof(fNumEventThreads));
+	this->SetVal(qtssPrefsEnableUDPGSO,                 &fEnableUDPGSO,                 sizeof(fEnableUDPGSO));
+	this->SetVal(qtssPrefsRTSPListenersPerPort,         &fNumRTSPListenersPerPort,      sizeof(fNumRTSPListenersPerPort));
 	this->SetVal(qtssPrefsEnableMonitorStatsFile,       &fEnableMonitorStatsFile,       sizeof(fEnableMonitorStatsFile));
 	this->SetVal(qtssPrefsMonitorStatsFileIntervalSec,  &fStatsFileIntervalSeconds,     sizeof(fStatsFileIntervalSeconds));
 
@@ -142,6 +142,9 @@ class QTSServerPrefs : public QTSSPrefs
 		QTSS_AuthScheme GetAuthScheme()     { return fAuthScheme; }
 
 		UInt32  GetNumThreads()             { return fNumThreads; }     
+		UInt32  GetNumEventThreads()        { return fNumEventThreads; }
+		Bool16  IsUDPGSOEnabled()           { return fEnableUDPGSO; }
+		UInt32  GetNumRTSPListenersPerPort() { return fNumRTSPListenersPerPort; }
         
         // Optionally require that reliable UDP content be in certain folders
         Bool16 IsPathInsideReliableUDPDir(StrPtrLen* inPath);
@@ -233,6 +236,9 @@ class QTSServerPrefs : public QTSSPrefs
         Bool16  fEnableRTSPDebugPrintfs;       //ǷӡRTSPЭĵϢ?
         Bool16  fEnableRTSPServerInfo;         //ǷRTSP ResponseзϢ
         UInt32  fNumThreads;                   //̵ָ߳ĸ,Ϊ0,һCPUһ߳
+        UInt32  fNumEventThreads;              //number of socket event threads, 0 means one per CPU
+        Bool16  fEnableUDPGSO;                 //send equal sized RTP packet runs as one UDP GSO buffer?
+        UInt32  fNumRTSPListenersPerPort;      //SO_REUSEPORT listeners per RTSP address and port, 0 means one per event thread
         Bool16  fEnableMonitorStatsFile;       //Ƿʹ״̬ļ?ⲿģ
         UInt32  fStatsFileIntervalSeconds;     //״̬ļʱ(s)
 	
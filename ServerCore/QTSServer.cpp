@@ -197,7 +197,7 @@ Bool16 QTSServer::Initialize(XMLPrefsParser* inPrefsSource,/* PrefsSource* inMes
 	/* ڻUDPSocketPool϶̬RTPSocketPool,Ӷ㽫̬UDPSocketPairUDPSocketPool,ͳһά͹ */
     fSocketPool = new RTPSocketPool();
 	/* СΪ577RTP session map(hash table),ΨһĻỰIDʶ͹еRTPSessionRTSPSession */
-    fRTPMap = new OSRefTable(kRTPSessionMapSize);//577
+    fRTPMap = new OSStripedRefTable(kRTPSessionMapSize);//577
 
     //
     // Load ERROR LOG module only. This is good in case there is a startup error.
@@ -314,7 +314,10 @@ void QTSServer::StartTasks()
     // Start listening
 	/* ÿTCPListenerSocket,ָǷָĶ¼? */
     for (UInt32 x = 0; x < fNumListeners; x++)
+    {
+        this->SetListenerEventThread(fListeners, x);
         fListeners[x]->RequestEvent(EV_RE); // what is EV_RE? event_read
+    }
 }
 
 /* ԤֵȡRTSPipַ,õһ󶨵ipΪĬϵĵ㲥IPӦDNSip address string,ĬϵַΪվͽǽerror log */
@@ -431,6 +434,23 @@ Bool16 QTSServer::CreateListeners(Bool16 startListeningNow, QTSServerPrefs* inPr
     }
     
     delete [] theIPAddrs; //ɾQTSServer::GetRTSPIPAddrs()ж̬IPַ
+
+    //
+    // With more than one listener per port, each address and port gets that many
+    // port tracking structs, and the listeners share the port through SO_REUSEPORT
+    UInt32 theNumShards = this->GetNumListenersPerPort(inPrefs);
+    if (theNumShards > 1)
+    {
+        PortTracking* theShardTrackers = NEW PortTracking[theTotalPortTrackers * theNumShards];
+        for (UInt32 trackerIndex = 0; trackerIndex < theTotalPortTrackers; trackerIndex++)
+        {
+            for (UInt32 shardIndex = 0; shardIndex < theNumShards; shardIndex++)
+                theShardTrackers[(trackerIndex * theNumShards) + shardIndex] = thePortTrackers[trackerIndex];
+        }
+        delete [] thePortTrackers;
+        thePortTrackers = theShardTrackers;
+        theTotalPortTrackers *= theNumShards;
+    }
     
     // Now figure out which of these ports we are *already* listening on.
     // If we already are listening on that port, just move the pointer to the
@@ -451,6 +471,16 @@ Bool16 QTSServer::CreateListeners(Bool16 startListeningNow, QTSServerPrefs* inPr
             if ((fListeners[count2]->GetLocalPort() == thePortTrackers[count].fPort) && 
                 (fListeners[count2]->GetLocalAddr() == thePortTrackers[count].fIPAddr))
             {
+                // Each listener of a sharded port can only stand in for one tracker
+                Bool16 alreadyMoved = false;
+                for (UInt32 movedIndex = 0; movedIndex < curPortIndex; movedIndex++)
+                {
+                    if (newListenerArray[movedIndex] == fListeners[count2])
+                        alreadyMoved = true;
+                }
+                if (alreadyMoved)
+                    continue;
+
                 thePortTrackers[count].fNeedsCreating = false;
 				/* ǰTCP Listener socketƽ½TCP Listener socket */
                 newListenerArray[curPortIndex++] = fListeners[count2];
@@ -472,7 +502,7 @@ Bool16 QTSServer::CreateListeners(Bool16 startListeningNow, QTSServerPrefs* inPr
 			/* עcurPortIndexǽTCP listeners socket,ѭһһ */
             newListenerArray[curPortIndex] = NEW RTSPListenerSocket(); 
 			/* TCP SocketΪģʽ;󶨵ָipͶ˿;ôĻС(96Kֽ);õȴг(128)ʼ */
-            QTSS_Error err = newListenerArray[curPortIndex]->Initialize(thePortTrackers[count3].fIPAddr, thePortTrackers[count3].fPort);
+            QTSS_Error err = newListenerArray[curPortIndex]->Initialize(thePortTrackers[count3].fIPAddr, thePortTrackers[count3].fPort, theNumShards > 1);
 
 			/* ָʽportַ */
             char thePortStr[20];
@@ -496,7 +526,10 @@ Bool16 QTSServer::CreateListeners(Bool16 startListeningNow, QTSServerPrefs* inPr
                 // RTSPListenerSocketʵɹ,ʼɹ,Ҫڿʼ,TaskThread¼
                 // This listener was successfully created.
                 if (startListeningNow)
+                {
+                    this->SetListenerEventThread(newListenerArray, curPortIndex);
                     newListenerArray[curPortIndex]->RequestEvent(EV_RE); 
+                }
                 curPortIndex++;
             }
         }
@@ -533,7 +566,16 @@ Bool16 QTSServer::CreateListeners(Bool16 startListeningNow, QTSServerPrefs* inPr
 	/* ÷˿ */
     for (UInt32 count6 = 0; count6 < fNumListeners; count6++)
     {
-        if  (fListeners[count6]->GetLocalAddr() != INADDR_LOOPBACK)
+        // The other listeners of a sharded port don't add the port again
+        Bool16 isShard = false;
+        for (UInt32 count7 = 0; count7 < count6; count7++)
+        {
+            if ((fListeners[count7]->GetLocalPort() == fListeners[count6]->GetLocalPort()) &&
+                (fListeners[count7]->GetLocalAddr() == fListeners[count6]->GetLocalAddr()))
+                isShard = true;
+        }
+
+        if  ((fListeners[count6]->GetLocalAddr() != INADDR_LOOPBACK) && !isShard)
         {
             UInt16 thePort = fListeners[count6]->GetLocalPort();
             (void)this->SetValue(qtssSvrRTSPPorts, portIndex, &thePort, sizeof(thePort), QTSSDictionary::kDontObeyReadOnly);
@@ -549,6 +591,35 @@ Bool16 QTSServer::CreateListeners(Bool16 startListeningNow, QTSServerPrefs* inPr
     return (fNumListeners > 0);
 }
 
+UInt32 QTSServer::GetNumListenersPerPort(QTSServerPrefs* inPrefs)
+{
+    // 0 means one per event thread. The event threads don't exist yet the
+    // first time through, so count them the way StartServer will
+    UInt32 theNumListeners = inPrefs->GetNumRTSPListenersPerPort();
+    if (theNumListeners == 0)
+        theNumListeners = inPrefs->GetNumEventThreads();
+    if (theNumListeners == 0)
+        theNumListeners = OS::GetNumProcessors();
+    if (theNumListeners == 0)
+        theNumListeners = 1;
+    return theNumListeners;
+}
+
+void QTSServer::SetListenerEventThread(TCPListenerSocket** inListeners, UInt32 inIndex)
+{
+    // A listener that is the n-th on its address and port goes to event thread n,
+    // so that the accepts of a sharded port run in parallel. Unsharded listeners
+    // all stay on the first event thread.
+    UInt32 theShardIndex = 0;
+    for (UInt32 x = 0; x < inIndex; x++)
+    {
+        if ((inListeners[x]->GetLocalPort() == inListeners[inIndex]->GetLocalPort()) &&
+            (inListeners[x]->GetLocalAddr() == inListeners[inIndex]->GetLocalAddr()))
+            theShardIndex++;
+    }
+    inListeners[inIndex]->SetEventThread(Socket::GetEventThread(theShardIndex));
+}
+
 /* Ӱ󶨵ipַȡַĸ*outNumAddrsPtr,ַʮָʽtheIPAddrArray */
 UInt32* QTSServer::GetRTSPIPAddrs(QTSServerPrefs* inPrefs, UInt32* outNumAddrsPtr)
 {
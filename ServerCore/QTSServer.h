@@ -136,6 +136,10 @@ class QTSServer : public QTSServerInterface
 		UInt32*                 GetRTSPIPAddrs(QTSServerPrefs* inPrefs, UInt32* outNumAddrsPtr);
 		// õԤĵ㲥Ķ˿
 		UInt16*                 GetRTSPPorts(QTSServerPrefs* inPrefs, UInt32* outNumPortsPtr);
+        // Number of SO_REUSEPORT listeners to open on each RTSP address and port
+        UInt32                  GetNumListenersPerPort(QTSServerPrefs* inPrefs);
+        // Puts a listener on its own event thread, shard by shard of its address and port
+        void                    SetListenerEventThread(TCPListenerSocket** inListeners, UInt32 inIndex);
 
         static pid_t            sMainPid;
          
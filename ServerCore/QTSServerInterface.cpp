@@ -23,7 +23,10 @@ LastUpdate:  2010-08-16
 #include "RTPPacketResender.h"
 #include "RTSPProtocol.h"
 #include "OSRef.h"
+#include "OSArrayObjectDeleter.h"
 #include "UDPSocketPool.h"
+#include "OSFileBlockCache.h"
+#include "QTRTPFile.h"
 
 
 // STATIC DATA
@@ -83,16 +86,16 @@ QTSSAttrInfoDict::AttrInfo  QTSServerInterface::sAttributes[] =
     /* 7  */ { "qtssSvrRTSPServerHeader",       NULL,   qtssAttrDataTypeCharArray,  qtssAttrModeRead | qtssAttrModePreempSafe },
     /* 8  */ { "qtssSvrState",                  NULL,   qtssAttrDataTypeUInt32,     qtssAttrModeRead | qtssAttrModeWrite  },
     /* 9  */ { "qtssSvrIsOutOfDescriptors",     IsOutOfDescriptors,     qtssAttrDataTypeBool16, qtssAttrModeRead },
-    /* 10 */ { "qtssRTSPCurrentSessionCount",   NULL,   qtssAttrDataTypeUInt32,     qtssAttrModeRead },
-    /* 11 */ { "qtssRTSPHTTPCurrentSessionCount",NULL,  qtssAttrDataTypeUInt32,     qtssAttrModeRead },
+    /* 10 */ { "qtssRTSPCurrentSessionCount",   CurrentRTSPSessions,    qtssAttrDataTypeUInt32, qtssAttrModeRead },
+    /* 11 */ { "qtssRTSPHTTPCurrentSessionCount",CurrentRTSPHTTPSessions,qtssAttrDataTypeUInt32, qtssAttrModeRead },
     /* 12 */ { "qtssRTPSvrNumUDPSockets",       GetTotalUDPSockets,     qtssAttrDataTypeUInt32, qtssAttrModeRead },
     /* 13 */ { "qtssRTPSvrCurConn",             NULL,   qtssAttrDataTypeUInt32,     qtssAttrModeRead },
     /* 14 */ { "qtssRTPSvrTotalConn",           NULL,   qtssAttrDataTypeUInt32,     qtssAttrModeRead },
     /* 15 */ { "qtssRTPSvrCurBandwidth",        NULL,   qtssAttrDataTypeUInt32,     qtssAttrModeRead },
-    /* 16 */ { "qtssRTPSvrTotalBytes",          NULL,   qtssAttrDataTypeUInt64,     qtssAttrModeRead },
+    /* 16 */ { "qtssRTPSvrTotalBytes",          TotalRTPBytes,          qtssAttrDataTypeUInt64, qtssAttrModeRead },
     /* 17 */ { "qtssRTPSvrAvgBandwidth",        NULL,   qtssAttrDataTypeUInt32,     qtssAttrModeRead },
     /* 18 */ { "qtssRTPSvrCurPackets",          NULL,   qtssAttrDataTypeUInt32,     qtssAttrModeRead },
-    /* 19 */ { "qtssRTPSvrTotalPackets",        NULL,   qtssAttrDataTypeUInt64,     qtssAttrModeRead },
+    /* 19 */ { "qtssRTPSvrTotalPackets",        TotalRTPPackets,        qtssAttrDataTypeUInt64, qtssAttrModeRead },
     /* 20 */ { "qtssSvrHandledMethods",         NULL,   qtssAttrDataTypeUInt32,     qtssAttrModeRead | qtssAttrModeWrite | qtssAttrModePreempSafe  },
     /* 21 */ { "qtssSvrModuleObjects",          NULL,   qtssAttrDataTypeQTSS_Object,qtssAttrModeRead | qtssAttrModePreempSafe },
     /* 22 */ { "qtssSvrStartupTime",            NULL,   qtssAttrDataTypeTimeVal,    qtssAttrModeRead },
@@ -115,7 +118,23 @@ QTSSAttrInfoDict::AttrInfo  QTSServerInterface::sAttributes[] =
     /* 38  */ { "qtssSvrServerBuild",           NULL,   qtssAttrDataTypeCharArray,  qtssAttrModeRead | qtssAttrModePreempSafe },
     /* 39  */ { "qtssSvrServerPlatform",        NULL,   qtssAttrDataTypeCharArray,  qtssAttrModeRead | qtssAttrModePreempSafe },
     /* 40  */ { "qtssSvrRTSPServerComment",     NULL,   qtssAttrDataTypeCharArray,  qtssAttrModeRead | qtssAttrModePreempSafe },
-    /* 41  */ { "qtssSvrNumThinned",            NULL,   qtssAttrDataTypeSInt32,     qtssAttrModeRead | qtssAttrModeWrite  }
+    /* 41  */ { "qtssSvrNumThinned",            NULL,   qtssAttrDataTypeSInt32,     qtssAttrModeRead | qtssAttrModeWrite  },
+    /* 42  */ { "qtssRTPSvrTotalUDPSendCalls",  TotalUDPSendCalls,  qtssAttrDataTypeUInt64, qtssAttrModeRead },
+    /* 43  */ { "qtssRTPSvrTotalUDPSendPackets",TotalUDPSendPackets,qtssAttrDataTypeUInt64, qtssAttrModeRead },
+    /* 44  */ { "qtssRTPSvrUDPPacketsPerSendCall",NULL, qtssAttrDataTypeFloat32,    qtssAttrModeRead },
+    /* 45  */ { "qtssSvrTaskThreadQueueLengths",NULL,  qtssAttrDataTypeUInt32,     qtssAttrModeRead },
+    /* 46  */ { "qtssSvrTaskThreadStolenTasks", NULL,   qtssAttrDataTypeUInt32,     qtssAttrModeRead },
+    /* 47  */ { "qtssSvrFileBlockCacheHits",    NULL,   qtssAttrDataTypeUInt64,     qtssAttrModeRead },
+    /* 48  */ { "qtssSvrFileBlockCacheMisses",  NULL,   qtssAttrDataTypeUInt64,     qtssAttrModeRead },
+    /* 49  */ { "qtssSvrFileBlockCacheEvictions",NULL,  qtssAttrDataTypeUInt64,     qtssAttrModeRead },
+    /* 50  */ { "qtssSvrFileBlockCacheBytesUsed",NULL,  qtssAttrDataTypeUInt64,     qtssAttrModeRead },
+    /* 51  */ { "qtssSvrRTSPListenerAccepts",   NULL,   qtssAttrDataTypeUInt32,     qtssAttrModeRead },
+    /* 52  */ { "qtssSvrRTSPListenerAcceptRates",NULL,  qtssAttrDataTypeUInt32,     qtssAttrModeRead },
+    /* 53  */ { "qtssRTPSvrTotalRetransmits",   TotalRTPRetransmits, qtssAttrDataTypeUInt64, qtssAttrModeRead },
+    /* 54  */ { "qtssSvrMovieCacheHits",        NULL,   qtssAttrDataTypeUInt64,     qtssAttrModeRead },
+    /* 55  */ { "qtssSvrMovieCacheMisses",      NULL,   qtssAttrDataTypeUInt64,     qtssAttrModeRead },
+    /* 56  */ { "qtssSvrMovieCacheEvictions",   NULL,   qtssAttrDataTypeUInt64,     qtssAttrModeRead },
+    /* 57  */ { "qtssSvrMovieCacheEntries",     NULL,   qtssAttrDataTypeUInt32,     qtssAttrModeRead }
 };
 
 /* kServerDictIndexkQTSSConnectedUserDictIndexֵ,DSSͷϢ"Server: DSS/5.5.3.7 (Build/489.8; Platform/Linux; Release/Darwin; )" */
@@ -173,20 +192,29 @@ QTSServerInterface::QTSServerInterface()
     fNumListeners(0), /* ķ */
     fStartupTime_UnixMilli(0),
     fGMTOffset(0),
+    fTotalLateCleared(0),
+    fTotalQualityCleared(0),
     fNumRTSPSessions(0),
     fNumRTSPHTTPSessions(0),
     fNumRTPSessions(0),
-    fNumRTPPlayingSessions(0),
     fTotalRTPSessions(0),
     fTotalRTPBytes(0),
     fTotalRTPPackets(0),
-    fTotalRTPPacketsLost(0),
-    fPeriodicRTPBytes(0),
-    fPeriodicRTPPacketsLost(0),
-    fPeriodicRTPPackets(0),
+    fTotalUDPSendPackets(0),
+    fTotalUDPSendCalls(0),
+    fTotalRTPRetransmits(0),
     fCurrentRTPBandwidthInBits(0),
     fAvgRTPBandwidthInBits(0),
     fRTPPacketsPerSecond(0),
+    fUDPPacketsPerSendCall(0),
+    fFileBlockCacheHits(0),
+    fFileBlockCacheMisses(0),
+    fFileBlockCacheEvictions(0),
+    fFileBlockCacheBytesUsed(0),
+    fMovieCacheHits(0),
+    fMovieCacheMisses(0),
+    fMovieCacheEvictions(0),
+    fMovieCacheEntries(0),
     fCPUPercent(0),
     fCPUTimeUsedInSec(0),
     fUDPWastageInBytes(0),/* UDPSocketPairеδʹõֽ(ҲOSBufferPoolе) */
@@ -201,9 +229,7 @@ QTSServerInterface::QTSServerInterface()
     fDebugLevel(0),   /* Ĭ϶0 */
     fDebugOptions(0), /* Ĭ϶0 */   
     fMaxLate(0),
-    fTotalLate(0),
     fCurrentMaxLate(0),
-    fTotalQuality(0),
     fNumThinned(0)
 {
 	/* ʼRolemodule arrayNumModulesInRole,עǶǰ,߽ϵ */
@@ -221,15 +247,11 @@ QTSServerInterface::QTSServerInterface()
     this->SetVal(qtssSvrServerBuildDate,    sServerBuildDateStr.Ptr,    sServerBuildDateStr.Len);           //5
     this->SetVal(qtssSvrRTSPServerHeader,   sServerHeaderPtr.Ptr,       sServerHeaderPtr.Len);              //7
 	this->SetVal(qtssSvrState,              &fServerState,              sizeof(fServerState));              //8
-    this->SetVal(qtssRTSPCurrentSessionCount, &fNumRTSPSessions,        sizeof(fNumRTSPSessions));          //10
-    this->SetVal(qtssRTSPHTTPCurrentSessionCount, &fNumRTSPHTTPSessions,sizeof(fNumRTSPHTTPSessions));      //11
     this->SetVal(qtssRTPSvrCurConn,         &fNumRTPSessions,           sizeof(fNumRTPSessions));           //13
     this->SetVal(qtssRTPSvrTotalConn,       &fTotalRTPSessions,         sizeof(fTotalRTPSessions));         //14
     this->SetVal(qtssRTPSvrCurBandwidth,    &fCurrentRTPBandwidthInBits,sizeof(fCurrentRTPBandwidthInBits));//15
-    this->SetVal(qtssRTPSvrTotalBytes,      &fTotalRTPBytes,            sizeof(fTotalRTPBytes));            //16
     this->SetVal(qtssRTPSvrAvgBandwidth,    &fAvgRTPBandwidthInBits,    sizeof(fAvgRTPBandwidthInBits));    //17
     this->SetVal(qtssRTPSvrCurPackets,      &fRTPPacketsPerSecond,      sizeof(fRTPPacketsPerSecond));      //18
-    this->SetVal(qtssRTPSvrTotalPackets,    &fTotalRTPPackets,          sizeof(fTotalRTPPackets));          //19
     this->SetVal(qtssSvrStartupTime,        &fStartupTime_UnixMilli,    sizeof(fStartupTime_UnixMilli));    //22
     this->SetVal(qtssSvrGMTOffsetInHrs,     &fGMTOffset,                sizeof(fGMTOffset));                //23
     this->SetVal(qtssSvrCPULoadPercent,     &fCPUPercent,               sizeof(fCPUPercent));               //29
@@ -243,6 +265,15 @@ QTSServerInterface::QTSServerInterface()
     this->SetVal(qtssSvrServerPlatform,     sServerPlatformStr.Ptr,     sServerPlatformStr.Len);            //39
     this->SetVal(qtssSvrRTSPServerComment,  sServerCommentStr.Ptr,      sServerCommentStr.Len);             //40
     this->SetVal(qtssSvrNumThinned,         &fNumThinned,               sizeof(fNumThinned));               //41
+    this->SetVal(qtssRTPSvrUDPPacketsPerSendCall, &fUDPPacketsPerSendCall, sizeof(fUDPPacketsPerSendCall)); //44
+    this->SetVal(qtssSvrFileBlockCacheHits,     &fFileBlockCacheHits,   sizeof(fFileBlockCacheHits));       //47
+    this->SetVal(qtssSvrFileBlockCacheMisses,   &fFileBlockCacheMisses, sizeof(fFileBlockCacheMisses));     //48
+    this->SetVal(qtssSvrFileBlockCacheEvictions, &fFileBlockCacheEvictions, sizeof(fFileBlockCacheEvictions)); //49
+    this->SetVal(qtssSvrFileBlockCacheBytesUsed, &fFileBlockCacheBytesUsed, sizeof(fFileBlockCacheBytesUsed)); //50
+    this->SetVal(qtssSvrMovieCacheHits,         &fMovieCacheHits,       sizeof(fMovieCacheHits));           //54
+    this->SetVal(qtssSvrMovieCacheMisses,       &fMovieCacheMisses,     sizeof(fMovieCacheMisses));         //55
+    this->SetVal(qtssSvrMovieCacheEvictions,    &fMovieCacheEvictions,  sizeof(fMovieCacheEvictions));      //56
+    this->SetVal(qtssSvrMovieCacheEntries,      &fMovieCacheEntries,    sizeof(fMovieCacheEntries));        //57
     
     /* ʼָQTSServerInterfaceָ,Ǳʵ */
     sServer = this;
@@ -269,9 +300,9 @@ void QTSServerInterface::LogError(QTSS_ErrorVerbosity inVerbosity, char* inBuffe
 /* ǰRTPSession MapеRTPSession, ɱ¼ȥ֪ͨ߳ɱеRTP Session */
 void QTSServerInterface::KillAllRTPSessions()
 {
-	/* ȡHash TableĻ */
-    OSMutexLocker locker(fRTPMap->GetMutex());
-    for (OSRefHashTableIter theIter(fRTPMap->GetHashTable()); !theIter.IsDone(); theIter.Next())
+    //the iterator only locks the part of the map it is on, so sessions may be
+    //added while we go
+    for (OSStripedRefTableIter theIter(fRTPMap); !theIter.IsDone(); theIter.Next())
     {
 		/* ȡǰHash Table Elem */
         OSRef* theRef = theIter.GetCurrent();
@@ -325,7 +356,8 @@ void QTSServerInterface::SetValueComplete(UInt32 inAttrIndex, QTSSDictionaryMap*
 /************************************* RTPStatsUpdaterTask ************************************/
 
 RTPStatsUpdaterTask::RTPStatsUpdaterTask()
-:   Task(), fLastBandwidthTime(0), fLastBandwidthAvg(0), fLastBytesSent(0), fLastTotalMP3Bytes(0)
+:   Task(), fLastBandwidthTime(0), fLastBandwidthAvg(0), fLastBytesSent(0), fLastTotalMP3Bytes(0),
+    fLastRTPBytes(0), fLastRTPPackets(0), fLastUDPSendPackets(0), fLastUDPSendCalls(0)
 {
     this->SetTaskName("RTPStatsUpdaterTask");
 	/* RTPStatsUpdaterTask̵ָ߳ */
@@ -333,16 +365,16 @@ RTPStatsUpdaterTask::RTPStatsUpdaterTask()
 }
 
 /* ǰRTPSession mapеRTPSession,һ(ǻỰʱ)һRTPSession(ʵRTPSessionInterface) */
-RTPSessionInterface* RTPStatsUpdaterTask::GetNewestSession(OSRefTable* inRTPSessionMap)
+RTPSessionInterface* RTPStatsUpdaterTask::GetNewestSession(OSStripedRefTable* inRTPSessionMap)
 {
-	//Caller must lock down the RTP session map
+	//The session comes back resolved, the caller must release its ref
 	SInt64 theNewestPlayTime = 0;
-	RTPSessionInterface* theNewestSession = NULL;
+	OSCharArrayDeleter theNewestID(NULL);
 
 	//use the session map to iterate through all the sessions, finding the most
 	//recently connected client
 	/* RTPSession map,ֱһյHash Table Elemͣ */
-	for (OSRefHashTableIter theIter(inRTPSessionMap->GetHashTable()); !theIter.IsDone(); theIter.Next())
+	for (OSStripedRefTableIter theIter(inRTPSessionMap); !theIter.IsDone(); theIter.Next())
 	{
 		/* õǰķǿյHash Table Elem */
 		OSRef* theRef = theIter.GetCurrent();
@@ -354,10 +386,20 @@ RTPSessionInterface* RTPStatsUpdaterTask::GetNewestSession(OSRefTable* inRTPSess
 		if (theSession->GetSessionCreateTime() > theNewestPlayTime)
 		{
 			theNewestPlayTime = theSession->GetSessionCreateTime();
-			theNewestSession = theSession;
+			theNewestID = theRef->GetString()->GetAsCString();
 		}
 	}
-	return theNewestSession;
+
+	//The iterator only locks one part of the map at a time, so the session
+	//may be gone by now
+	if (theNewestID.GetObject() == NULL)
+		return NULL;
+
+	StrPtrLen theID(theNewestID.GetObject());
+	OSRef* theRef = inRTPSessionMap->Resolve(&theID);
+	if (theRef == NULL)
+		return NULL;
+	return (RTPSessionInterface*)theRef->GetObject();
 }
 
 /* ȡصǰ̵cpu ʱ */
@@ -381,33 +423,55 @@ SInt64 RTPStatsUpdaterTask::Run()
     /* Ȼȡ̬QTSServerInterfaceָ,ԲѯصԲ */
     QTSServerInterface* theServer = QTSServerInterface::sServer;
     
-    // All of this must happen atomically wrt dictionary values we are manipulating
-    OSMutexLocker locker(&theServer->fMutex);
-    
-    //First update total bytes. This must be done because total bytes is a 64 bit number,
-    //so no atomic functions can apply.
-    //
-    // NOTE: The line below is not thread safe on non-PowerPC platforms. This is
-    // because the fPeriodicRTPBytes variable is being manipulated from within an
-    // atomic_add. On PowerPC, assignments are atomic, so the assignment below is ok.
-    // On a non-PowerPC platform, the following would be thread safe:
-    //unsigned int periodicBytes = atomic_add(&theServer->fPeriodicRTPBytes, 0);
-
-	/********************** עĴͬ *********************************************/
-
-    unsigned int periodicBytes = theServer->fPeriodicRTPBytes;
-    (void)atomic_sub(&theServer->fPeriodicRTPBytes, periodicBytes);
-    theServer->fTotalRTPBytes += periodicBytes;
+    // The counters are summed without taking any lock. The values worked out
+    // below are single words that readers pick up whenever they like, and
+    // SetValue locks the dictionary itself, so nothing here holds up the
+    // sessions that are being set up or torn down meanwhile.
+    UInt64 theTotalRTPBytes = theServer->GetTotalRTPBytes();
+    unsigned int periodicBytes = (unsigned int)(theTotalRTPBytes - fLastRTPBytes);
+    fLastRTPBytes = theTotalRTPBytes;
     
     // Same deal for packet totals
-    unsigned int periodicPackets = theServer->fPeriodicRTPPackets;/* һ(λ)ڵRTP */
-    (void)atomic_sub(&theServer->fPeriodicRTPPackets, periodicPackets);
-    theServer->fTotalRTPPackets += periodicPackets;
-    
-    // ..and for lost packet totals
-    unsigned int periodicPacketsLost = theServer->fPeriodicRTPPacketsLost;
-    (void)atomic_sub(&theServer->fPeriodicRTPPacketsLost, periodicPacketsLost);
-    theServer->fTotalRTPPacketsLost += periodicPacketsLost;
+    UInt64 theTotalRTPPackets = theServer->GetTotalRTPPackets();
+    unsigned int periodicPackets = (unsigned int)(theTotalRTPPackets - fLastRTPPackets);
+    fLastRTPPackets = theTotalRTPPackets;
+
+    // ..and for UDP sends. The packets per send call ratio only covers this interval
+    UInt64 theTotalUDPSendPackets = theServer->GetTotalUDPSendPackets();
+    unsigned int periodicUDPSendPackets = (unsigned int)(theTotalUDPSendPackets - fLastUDPSendPackets);
+    fLastUDPSendPackets = theTotalUDPSendPackets;
+
+    UInt64 theTotalUDPSendCalls = theServer->GetTotalUDPSendCalls();
+    unsigned int periodicUDPSendCalls = (unsigned int)(theTotalUDPSendCalls - fLastUDPSendCalls);
+    fLastUDPSendCalls = theTotalUDPSendCalls;
+
+    if (periodicUDPSendCalls > 0)
+        theServer->fUDPPacketsPerSendCall = (Float32)periodicUDPSendPackets / (Float32)periodicUDPSendCalls;
+    else
+        theServer->fUDPPacketsPerSendCall = 0;
+
+    // ..and the shared file block cache, which keeps its own counters
+    theServer->fFileBlockCacheHits = OSFileBlockCache::GetNumHits();
+    theServer->fFileBlockCacheMisses = OSFileBlockCache::GetNumMisses();
+    theServer->fFileBlockCacheEvictions = OSFileBlockCache::GetNumEvictions();
+    theServer->fFileBlockCacheBytesUsed = OSFileBlockCache::GetBytesUsed();
+
+    // ..and the parsed movie cache
+    theServer->fMovieCacheHits = QTRTPFile::GetFileCacheHits();
+    theServer->fMovieCacheMisses = QTRTPFile::GetFileCacheMisses();
+    theServer->fMovieCacheEvictions = QTRTPFile::GetFileCacheEvictions();
+    theServer->fMovieCacheEntries = QTRTPFile::GetNumCachedFiles();
+
+    // Take a snapshot of every task thread's queue, one value per thread
+    UInt32 theNumTaskThreads = TaskThreadPool::GetNumThreads();
+    for (UInt32 theThreadIndex = 0; theThreadIndex < theNumTaskThreads; theThreadIndex++)
+    {
+        TaskThread* theThread = TaskThreadPool::GetThread(theThreadIndex);
+        UInt32 theQueueLength = theThread->GetQueueLength();
+        UInt32 theNumStolen = theThread->GetNumTasksStolen();
+        (void)theServer->SetValue(qtssSvrTaskThreadQueueLengths, theThreadIndex, &theQueueLength, sizeof(theQueueLength), QTSSDictionary::kDontObeyReadOnly);
+        (void)theServer->SetValue(qtssSvrTaskThreadStolenTasks, theThreadIndex, &theNumStolen, sizeof(theNumStolen), QTSSDictionary::kDontObeyReadOnly);
+    }
 
 	/********************** עĴͬ ***********************************************/
     
@@ -471,6 +535,25 @@ SInt64 RTPStatsUpdaterTask::Run()
 		/* ԶCPU,CPUʹʱٷֱ */
 		if (numProcessors > 1)
 			theServer->fCPUPercent /= numProcessors;
+
+        // Accepts of each RTSP listener, one value per listener. With sharded
+        // listen ports this shows how evenly the kernel spreads the connections.
+        // A prefs reread replaces the listeners while holding fMutex, so it is
+        // held here too; the counters above don't need it.
+        {
+            OSMutexLocker locker(&theServer->fMutex);
+            for (UInt32 theListenerIndex = 0; theListenerIndex < theServer->fNumListeners; theListenerIndex++)
+            {
+                TCPListenerSocket* theListener = theServer->fListeners[theListenerIndex];
+                UInt32 theNumAccepts = theListener->GetNumAccepts();
+                UInt32 theAcceptRate = theListener->GetNumAcceptsSinceLastSample() / theTime;
+                (void)theServer->SetValue(qtssSvrRTSPListenerAccepts, theListenerIndex, &theNumAccepts, sizeof(theNumAccepts), QTSSDictionary::kDontObeyReadOnly);
+                (void)theServer->SetValue(qtssSvrRTSPListenerAcceptRates, theListenerIndex, &theAcceptRate, sizeof(theAcceptRate), QTSSDictionary::kDontObeyReadOnly);
+            }
+            // A prefs reread may have closed some of the listeners
+            theServer->SetNumValues(qtssSvrRTSPListenerAccepts, theServer->fNumListeners);
+            theServer->SetNumValues(qtssSvrRTSPListenerAcceptRates, theServer->fNumListeners);
+        }
     }
 
     
@@ -501,7 +584,7 @@ SInt64 RTPStatsUpdaterTask::Run()
 		/* ǰθʱ */
         UInt32 delta = (UInt32)(curTime - fLastBandwidthAvg);
 		/* ǰͳֽ(ͳֽ-ϴθʱͳֽ) */
-        SInt64 bytesSent = theServer->fTotalRTPBytes - fLastBytesSent;
+        SInt64 bytesSent = theTotalRTPBytes - fLastBytesSent;
         Assert(bytesSent >= 0);
         
         //do the bandwidth computation using floating point divides
@@ -524,7 +607,7 @@ SInt64 RTPStatsUpdaterTask::Run()
 		/* ¼ǰʱ */
         fLastBandwidthAvg = curTime;
 		/* ¼ǰRTPֽ */
-        fLastBytesSent = theServer->fTotalRTPBytes;
+        fLastBytesSent = theTotalRTPBytes;
 		/**************** NOTE!! ********************/
         
         //if the bandwidth is above the bandwidth setting, disconnect 1 user by sending them
@@ -534,16 +617,16 @@ SInt64 RTPStatsUpdaterTask::Run()
 		/* theServer->fAvgRTPBandwidthInBitsֵֵ(100MСb),ͶϿõ㲥 */
         if ((maxKBits > -1) && (theServer->fAvgRTPBandwidthInBits > ((UInt32)maxKBits * 1024)))
         {
-            //we need to make sure that all of this happens atomically wrt the session map
-			/* RTPSession Map */
-            OSMutexLocker locker(theServer->GetRTPSessionMap()->GetMutex());
 			/* øRTPSession MapһRTPSession */
             RTPSessionInterface* theSession = this->GetNewestSession(theServer->fRTPMap);
             if (theSession != NULL)
+            {
 				/* Ͽ10ڽӽһεRTPSession */
                 if ((curTime - theSession->GetSessionCreateTime()) <
                         theServer->GetPrefs()->GetSafePlayDurationInSecs() * 1000)    //ȫŲϵʱֵ10
                     theSession->Signal(Task::kKillEvent);
+                theServer->fRTPMap->Release(theSession->GetRef());
+            }
         }
     }
 	/* ϴμƽʱΪ,˵ʼ,¼ѭʹ. */
@@ -552,7 +635,7 @@ SInt64 RTPStatsUpdaterTask::Run()
 		/**************** NOTE!! ********************/
 		/* ¼ǰʱ */
         fLastBandwidthAvg = curTime;
-        fLastBytesSent = theServer->fTotalRTPBytes;
+        fLastBytesSent = theTotalRTPBytes;
 		/**************** NOTE!! ********************/
     }
     
@@ -638,6 +721,72 @@ void* QTSServerInterface::GetNumWastedBytes(QTSSDictionary* inServer, UInt32* ou
     return &theServer->fUDPWastageInBytes;  
 }
 
+// The statistics counters below are kept per thread (see OSThreadCounters),
+// so each of these adds them up when the attribute is read
+
+void* QTSServerInterface::CurrentRTSPSessions(QTSSDictionary* inServer, UInt32* outLen)
+{
+    QTSServerInterface* theServer = (QTSServerInterface*)inServer;
+    theServer->fNumRTSPSessions = theServer->GetNumRTSPSessions();
+
+    *outLen = sizeof(theServer->fNumRTSPSessions);
+    return &theServer->fNumRTSPSessions;
+}
+
+void* QTSServerInterface::CurrentRTSPHTTPSessions(QTSSDictionary* inServer, UInt32* outLen)
+{
+    QTSServerInterface* theServer = (QTSServerInterface*)inServer;
+    theServer->fNumRTSPHTTPSessions = theServer->GetNumRTSPHTTPSessions();
+
+    *outLen = sizeof(theServer->fNumRTSPHTTPSessions);
+    return &theServer->fNumRTSPHTTPSessions;
+}
+
+void* QTSServerInterface::TotalRTPBytes(QTSSDictionary* inServer, UInt32* outLen)
+{
+    QTSServerInterface* theServer = (QTSServerInterface*)inServer;
+    theServer->fTotalRTPBytes = theServer->GetTotalRTPBytes();
+
+    *outLen = sizeof(theServer->fTotalRTPBytes);
+    return &theServer->fTotalRTPBytes;
+}
+
+void* QTSServerInterface::TotalRTPPackets(QTSSDictionary* inServer, UInt32* outLen)
+{
+    QTSServerInterface* theServer = (QTSServerInterface*)inServer;
+    theServer->fTotalRTPPackets = theServer->GetTotalRTPPackets();
+
+    *outLen = sizeof(theServer->fTotalRTPPackets);
+    return &theServer->fTotalRTPPackets;
+}
+
+void* QTSServerInterface::TotalUDPSendCalls(QTSSDictionary* inServer, UInt32* outLen)
+{
+    QTSServerInterface* theServer = (QTSServerInterface*)inServer;
+    theServer->fTotalUDPSendCalls = theServer->GetTotalUDPSendCalls();
+
+    *outLen = sizeof(theServer->fTotalUDPSendCalls);
+    return &theServer->fTotalUDPSendCalls;
+}
+
+void* QTSServerInterface::TotalUDPSendPackets(QTSSDictionary* inServer, UInt32* outLen)
+{
+    QTSServerInterface* theServer = (QTSServerInterface*)inServer;
+    theServer->fTotalUDPSendPackets = theServer->GetTotalUDPSendPackets();
+
+    *outLen = sizeof(theServer->fTotalUDPSendPackets);
+    return &theServer->fTotalUDPSendPackets;
+}
+
+void* QTSServerInterface::TotalRTPRetransmits(QTSSDictionary* inServer, UInt32* outLen)
+{
+    QTSServerInterface* theServer = (QTSServerInterface*)inServer;
+    theServer->fTotalRTPRetransmits = theServer->GetTotalRTPRetransmits();
+
+    *outLen = sizeof(theServer->fTotalRTPRetransmits);
+    return &theServer->fTotalRTPRetransmits;
+}
+
 /********************************* Param retrieval functions for ServerDict ********************************/
 
 /* Ȼȡʱ,뵱ǰʱ,Ϊʱ(ms),ٶȡֵءעһQTSSConnectedUserDict */
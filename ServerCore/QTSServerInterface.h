@@ -26,6 +26,7 @@ LastUpdate:  2010-08-16
 #include "atomic.h"
 
 #include "OSMutex.h"
+#include "OSThreadCounters.h"
 #include "Task.h"
 #include "TCPListenerSocket.h"
 #include "ResizeableStringFormatter.h"
@@ -61,26 +62,37 @@ class QTSServerInterface : public QTSSDictionary
         
         // STATISTICS MANIPULATION
         // These functions are how the server keeps its statistics current
+        //
+        // Most of them only add to the calling thread's own copy of a counter
+        // (see OSThreadCounters), which the accessors and the attributes
+        // add up when they are read.
         
 		/* µǰRTSPSessionܸ */
         void             AlterCurrentRTSPSessionCount(SInt32 inDifference)
-            { OSMutexLocker locker(&fMutex); fNumRTSPSessions += inDifference; }
+            { fCounters.Add(kRTSPSessionsCounter, inDifference); }
         void             AlterCurrentRTSPHTTPSessionCount(SInt32 inDifference)
-            { OSMutexLocker locker(&fMutex); fNumRTSPHTTPSessions += inDifference; }
+            { fCounters.Add(kRTSPHTTPSessionsCounter, inDifference); }
         void             SwapFromRTSPToHTTP()
-            { OSMutexLocker locker(&fMutex); fNumRTSPSessions--; fNumRTSPHTTPSessions++; }
+            { fCounters.Add(kRTSPSessionsCounter, -1); fCounters.Add(kRTSPHTTPSessionsCounter, 1); }
             
         //total rtp bytes sent by the server
         void            IncrementTotalRTPBytes(UInt32 bytes)
-            { (void)atomic_add(&fPeriodicRTPBytes, bytes); }
+            { fCounters.Add(kRTPBytesCounter, bytes); }
         //total rtp packets sent by the server
         void            IncrementTotalPackets()
-            { (void)atomic_add(&fPeriodicRTPPackets, 1); }
+            { fCounters.Add(kRTPPacketsCounter, 1); }
         //total rtp bytes reported as lost by the clients
         void            IncrementTotalRTPPacketsLost(UInt32 packets)
-            { (void)atomic_add(&fPeriodicRTPPacketsLost, packets); }
+            { fCounters.Add(kRTPPacketsLostCounter, packets); }
+        //rtp packets sent over UDP and the send system calls used to send them
+        void            IncrementUDPSendStats(UInt32 packets, UInt32 sendCalls)
+            { fCounters.Add(kUDPSendPacketsCounter, packets); fCounters.Add(kUDPSendCallsCounter, sendCalls); }
+        //rtp packets sent again by reliable UDP
+        void            IncrementTotalRTPRetransmits(UInt32 packets)
+            { fCounters.Add(kRTPRetransmitsCounter, packets); }
                                         
-        // Also increments current RTP session count
+        // Also increments current RTP session count. The RTP session counts stay
+        // under the server mutex, they go along with the qtssSvrClientSessions attribute.
 		/* used in RTPSession::Activate() */
         void            IncrementTotalRTPSessions()
             { OSMutexLocker locker(&fMutex); fNumRTPSessions++; fTotalRTPSessions++; }            
@@ -90,19 +102,23 @@ class QTSServerInterface : public QTSSDictionary
         //track how many sessions are playing
 		/* used by RTPSession::Play() */
         void            AlterRTPPlayingSessions(SInt32 inDifference)
-            { OSMutexLocker locker(&fMutex); fNumRTPPlayingSessions += inDifference; }
+            { fCounters.Add(kRTPPlayingSessionsCounter, inDifference); }
             
         /* ӳ */
         void            IncrementTotalLate(SInt64 milliseconds)
-           {    OSMutexLocker locker(&fMutex); 
-                fTotalLate += milliseconds;
-                if (milliseconds > fCurrentMaxLate) fCurrentMaxLate = milliseconds;
-                if (milliseconds > fMaxLate) fMaxLate = milliseconds;
+           {    fCounters.Add(kTotalLateCounter, milliseconds);
+                //fMaxLate is never below fCurrentMaxLate, so this is rarely true
+                if (milliseconds > fCurrentMaxLate)
+                {
+                    OSMutexLocker locker(&fMutex); 
+                    if (milliseconds > fCurrentMaxLate) fCurrentMaxLate = milliseconds;
+                    if (milliseconds > fMaxLate) fMaxLate = milliseconds;
+                }
            }
         
 		/* qualitylevel */
         void            IncrementTotalQuality(SInt32 level)
-           { OSMutexLocker locker(&fMutex); fTotalQuality += level; }
+           { fCounters.Add(kTotalQualityCounter, level); }
            
         /* Ӵ(thinning) */   
         void            IncrementNumThinned(SInt32 inDifference)
@@ -110,29 +126,33 @@ class QTSServerInterface : public QTSSDictionary
        
 		// clear
         void            ClearTotalLate()
-           { OSMutexLocker locker(&fMutex); fTotalLate = 0;  }
+           { fTotalLateCleared = fCounters.Sum(kTotalLateCounter);  }
         void            ClearCurrentMaxLate()
            { OSMutexLocker locker(&fMutex); fCurrentMaxLate = 0;  }
         void            ClearTotalQuality()
-           { OSMutexLocker locker(&fMutex); fTotalQuality = 0;  }
+           { fTotalQualityCleared = fCounters.Sum(kTotalQualityCounter);  }
      
 
         // ACCESSORS
         
         QTSS_ServerState    GetServerState()        { return fServerState; }
         UInt32              GetNumRTPSessions()     { return fNumRTPSessions; }
-        UInt32              GetNumRTSPSessions()    { return fNumRTSPSessions; }
-        UInt32              GetNumRTSPHTTPSessions(){ return fNumRTSPHTTPSessions; }
+        UInt32              GetNumRTSPSessions()    { return (UInt32)fCounters.Sum(kRTSPSessionsCounter); }
+        UInt32              GetNumRTSPHTTPSessions(){ return (UInt32)fCounters.Sum(kRTSPHTTPSessionsCounter); }
         
         UInt32              GetTotalRTPSessions()   { return fTotalRTPSessions; }
-        UInt32              GetNumRTPPlayingSessions()   { return fNumRTPPlayingSessions; }
+        UInt32              GetNumRTPPlayingSessions()   { return (UInt32)fCounters.Sum(kRTPPlayingSessionsCounter); }
         
         UInt32              GetCurBandwidthInBits() { return fCurrentRTPBandwidthInBits; }
         UInt32              GetAvgBandwidthInBits() { return fAvgRTPBandwidthInBits; }
         UInt32              GetRTPPacketsPerSec()   { return fRTPPacketsPerSecond; }
-        UInt64              GetTotalRTPBytes()      { return fTotalRTPBytes; }
-        UInt64              GetTotalRTPPacketsLost(){ return fTotalRTPPacketsLost; }
-        UInt64              GetTotalRTPPackets()    { return fTotalRTPPackets; }
+        UInt64              GetTotalRTPBytes()      { return (UInt64)fCounters.Sum(kRTPBytesCounter); }
+        UInt64              GetTotalRTPPacketsLost(){ return (UInt64)fCounters.Sum(kRTPPacketsLostCounter); }
+        UInt64              GetTotalRTPPackets()    { return (UInt64)fCounters.Sum(kRTPPacketsCounter); }
+        UInt64              GetTotalUDPSendCalls()  { return (UInt64)fCounters.Sum(kUDPSendCallsCounter); }
+        UInt64              GetTotalUDPSendPackets(){ return (UInt64)fCounters.Sum(kUDPSendPacketsCounter); }
+        UInt64              GetTotalRTPRetransmits(){ return (UInt64)fCounters.Sum(kRTPRetransmitsCounter); }
+        Float32             GetUDPPacketsPerSendCall() { return fUDPPacketsPerSendCall; }
         Float32             GetCPUPercent()         { return fCPUPercent; }
 
         Bool16              SigIntSet()             { return fSigInt; }
@@ -149,9 +169,9 @@ class QTSServerInterface : public QTSSDictionary
         void                SetDebugOptions(UInt32 debugOptions){ fDebugOptions = debugOptions; }
         
         SInt64              GetMaxLate()                { return fMaxLate; };
-        SInt64              GetTotalLate()              { return fTotalLate; };
+        SInt64              GetTotalLate()              { return fCounters.Sum(kTotalLateCounter) - fTotalLateCleared; };
         SInt64              GetCurrentMaxLate()         { return fCurrentMaxLate; };
-        SInt64              GetTotalQuality()           { return fTotalQuality; };
+        SInt64              GetTotalQuality()           { return fCounters.Sum(kTotalQualityCounter) - fTotalQualityCleared; };
         SInt32              GetNumThinned()             { return fNumThinned; };
 
         // GLOBAL OBJECTS REPOSITORY(ȫֶ)
@@ -165,7 +185,7 @@ class QTSServerInterface : public QTSSDictionary
 		QTSSMessages*       GetMessages()               { return fSrvrMessages; }
         
         //Allows you to map RTP session IDs (strings) to actual RTP session objects
-        OSRefTable*         GetRTPSessionMap()          { return fRTPMap; }
+        OSStripedRefTable*  GetRTPSessionMap()          { return fRTPMap; }
     
         //Server provides a statically created & bound UDPSocket / Demuxer pair
         //for each IP address setup to serve RTP. You access those pairs through
@@ -245,7 +265,7 @@ class QTSServerInterface : public QTSSDictionary
         
         // All RTP sessions are put into this map
 		/* еRTP SessionһHash TableΪRTPSessionMap,ñÿԪһΨһSession ID */
-        OSRefTable*                 fRTPMap;
+        OSStripedRefTable*          fRTPMap;
         
 		// Server prefers,Ԥֵ
         QTSServerPrefs*             fSrvrPrefs;
@@ -298,36 +318,59 @@ class QTSServerInterface : public QTSSDictionary
 
         OSMutex             fMutex;
 
-		//num of current RTSP/HTTP/RTP Session
+        enum
+        {
+            kRTPBytesCounter            = 0,
+            kRTPPacketsCounter          = 1,
+            kRTPPacketsLostCounter      = 2,
+            kUDPSendPacketsCounter      = 3,
+            kUDPSendCallsCounter        = 4,
+            kRTPRetransmitsCounter      = 5,
+            kTotalLateCounter           = 6,
+            kTotalQualityCounter        = 7,
+            kRTSPSessionsCounter        = 8,
+            kRTSPHTTPSessionsCounter    = 9,
+            kRTPPlayingSessionsCounter  = 10
+        };
+
+        //the counters that the statistics functions above bump
+        OSThreadCounters    fCounters;
+        //what the totals were when they were last cleared
+        SInt64              fTotalLateCleared;
+        SInt64              fTotalQualityCleared;
+
+		//num of current RTSP/HTTP/RTP Session. The RTSP ones are copies of the
+		//counters, filled out when the attributes are read
         UInt32              fNumRTSPSessions;
         UInt32              fNumRTSPHTTPSessions;
         UInt32              fNumRTPSessions; //ǰRTPSessionĿ
-
-        //stores the current number of playing connections.
-        UInt32              fNumRTPPlayingSessions;
      
 		//漸ۼ
         //stores the total number of connections since startup.Է,ܵRTPSessionĿ
         UInt32              fTotalRTPSessions;
-        //stores the total number of bytes served since startup
+        //copies of the byte and packet counters, filled out when the attributes are read
         UInt64              fTotalRTPBytes;
-        //total number of rtp packets sent since startup
         UInt64              fTotalRTPPackets;
-        //stores the total number of bytes lost (as reported by clients) since startup
-        UInt64              fTotalRTPPacketsLost;
+        UInt64              fTotalUDPSendPackets;
+        UInt64              fTotalUDPSendCalls;
+        UInt64              fTotalRTPRetransmits;
 
-        //because there is no 64 bit atomic add (for obvious reasons), we efficiently
-        //implement total byte counting by atomic adding to this variable, then every
-        //once in a while updating the sTotalBytes.
-		/* for calculate the above global quantities using theses temp variable,μRTPStatsUpdaterTask::Run() */
-        unsigned int        fPeriodicRTPBytes;
-        unsigned int        fPeriodicRTPPacketsLost;
-        unsigned int        fPeriodicRTPPackets;
         
         //stores the current served bandwidth in BITS per second
         UInt32              fCurrentRTPBandwidthInBits;
         UInt32              fAvgRTPBandwidthInBits;
         UInt32              fRTPPacketsPerSecond;
+        Float32             fUDPPacketsPerSendCall;
+        //copies of the OSFileBlockCache counters, refreshed every stats interval
+        UInt64              fFileBlockCacheHits;
+        UInt64              fFileBlockCacheMisses;
+        UInt64              fFileBlockCacheEvictions;
+        UInt64              fFileBlockCacheBytesUsed;
+        //copies of the QTRTPFile movie cache counters, refreshed every stats interval
+        UInt64              fMovieCacheHits;
+        UInt64              fMovieCacheMisses;
+        UInt64              fMovieCacheEvictions;
+        UInt32              fMovieCacheEntries;
         
 		// CPU
         Float32             fCPUPercent;
@@ -364,9 +407,7 @@ class QTSServerInterface : public QTSSDictionary
 
 		//late
         SInt64              fMaxLate;
-        SInt64              fTotalLate;
         SInt64              fCurrentMaxLate;
-        SInt64              fTotalQuality;
         SInt32              fNumThinned;   //ܱ
 
         // Param retrieval functions for ServerDict, see QTSServerInterface::sAttributes[]ֵ
@@ -375,6 +416,13 @@ class QTSServerInterface : public QTSSDictionary
         static void* IsOutOfDescriptors(QTSSDictionary* inServer, UInt32* outLen);
         static void* GetNumUDPBuffers(QTSSDictionary* inServer, UInt32* outLen);
         static void* GetNumWastedBytes(QTSSDictionary* inServer, UInt32* outLen);
+        static void* CurrentRTSPSessions(QTSSDictionary* inServer, UInt32* outLen);
+        static void* CurrentRTSPHTTPSessions(QTSSDictionary* inServer, UInt32* outLen);
+        static void* TotalRTPBytes(QTSSDictionary* inServer, UInt32* outLen);
+        static void* TotalRTPPackets(QTSSDictionary* inServer, UInt32* outLen);
+        static void* TotalUDPSendCalls(QTSSDictionary* inServer, UInt32* outLen);
+        static void* TotalUDPSendPackets(QTSSDictionary* inServer, UInt32* outLen);
+        static void* TotalRTPRetransmits(QTSSDictionary* inServer, UInt32* outLen);
         
 		/* Ҫ̬: */
         static QTSServerInterface*  sServer; /* ָQTSServerInterfaceָ,ע÷,needed by RTPSession::run() */
@@ -398,7 +446,7 @@ class RTPStatsUpdaterTask : public Task
     
 		/* , */
         virtual SInt64 Run();
-        RTPSessionInterface* GetNewestSession(OSRefTable* inRTPSessionMap);
+        RTPSessionInterface* GetNewestSession(OSStripedRefTable* inRTPSessionMap);
         Float32 GetCPUTimeInSeconds();
         
 		/* ϴδʱ */
@@ -409,6 +457,11 @@ class RTPStatsUpdaterTask : public Task
         SInt64 fLastBytesSent;
 		/* ϴηMP3ֽ  */
         SInt64 fLastTotalMP3Bytes;
+        //the server counters as of the last run, to work out what happened since
+        UInt64 fLastRTPBytes;
+        UInt64 fLastRTPPackets;
+        UInt64 fLastUDPSendPackets;
+        UInt64 fLastUDPSendCalls;
 };
 
 
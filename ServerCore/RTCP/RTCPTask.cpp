@@ -27,11 +27,7 @@ LastUpdate:  2010-08-16
 
 SInt64 RTCPTask::Run()
 {
-    const UInt32 kMaxRTCPPacketSize = 2048;
-	/* RTCPĻС2048ֽ */
-    char thePacketBuffer[kMaxRTCPPacketSize];
-	/* ڴUDPSocketϵõһRTCP,䳤Ϊ0 */
-    StrPtrLen thePacket(thePacketBuffer, 0);
+    StrPtrLen thePacket; // points into fRecvBatch
 
 	/* ȡӿ */
     QTSServerInterface* theServer = QTSServerInterface::GetServer();
@@ -49,9 +45,6 @@ SInt64 RTCPTask::Run()
 		/* UDPSocketPoolеUDPSocketPairɵĶ,ֱյĶԪͣ */
         for (OSQueueIter iter(theServer->GetSocketPool()->GetSocketQueue()); !iter.IsDone(); iter.Next())                 
         {
-            UInt32 theRemoteAddr = 0; //Client˵IP
-            UInt16 theRemotePort = 0; //Client˵Ķ˿
-
 			/* õǰԪڵĶUDPSocketPai */
             UDPSocketPair* thePair = (UDPSocketPair*)iter.GetCurrent()->GetEnclosingObject();
             Assert(thePair != NULL);
@@ -75,25 +68,40 @@ SInt64 RTCPTask::Run()
 					theDemuxer->GetMutex()->Lock();
 					while (true) //get all the outstanding packets for this socket
 					{
-						thePacket.Len = 0;
-						//Client˷ͻRTCP,ָRTCP,С2048ֽ
-						theSocket->RecvFrom(&theRemoteAddr, &theRemotePort, thePacket.Ptr,  kMaxRTCPPacketSize, &thePacket.Len);
-						/* û,Ͷ¼TaskThread */
-						if (thePacket.Len == 0) //no more packets on this socket!
-						{
-							theSocket->RequestEvent(EV_RE);   
-							break; //жwhileѭ
-						}
-                        
-						//if this socket has a demuxer(), find the target RTPStream
-						if (theDemuxer != NULL)
+						//Pull in as many packets as one system call will give us, then
+						//demux them all. Packets from the same client usually come in
+						//together, so only look up the stream when the sender changes.
+						theSocket->RecvMultiple(&fRecvBatch);
+						UInt32 theNumPackets = fRecvBatch.GetNumPackets();
+
+						UInt32 theLastAddr = 0;
+						UInt16 theLastPort = 0;
+						RTPStream* theStream = NULL;
+						for (UInt32 thePacketIndex = 0; thePacketIndex < theNumPackets; thePacketIndex++)
 						{
-							//ݣ临ȡӦRTPSession
-							RTPStream* theStream = (RTPStream*)theDemuxer->GetTask(theRemoteAddr, theRemotePort);
+							fRecvBatch.GetPacket(thePacketIndex, &thePacket);
+							if (thePacket.Len == 0)
+								continue;
+
+							UInt32 theRemoteAddr = fRecvBatch.GetRemoteAddr(thePacketIndex);
+							UInt16 theRemotePort = fRecvBatch.GetRemotePort(thePacketIndex);
+							if ((theLastPort == 0) || (theRemoteAddr != theLastAddr) || (theRemotePort != theLastPort))
+							{
+								theStream = (RTPStream*)theDemuxer->GetTask(theRemoteAddr, theRemotePort);
+								theLastAddr = theRemoteAddr;
+								theLastPort = theRemotePort;
+							}
+
 							if (theStream != NULL)
 								// յRTCP
 								theStream->ProcessIncomingRTCPPacket(&thePacket);
 						}
+
+						if (theNumPackets < UDPRecvBatch::kMaxPackets) //a short batch means no more packets on this socket!
+						{
+							theSocket->RequestEvent(EV_RE);   
+							break; //жwhileѭ
+						}
 					}
 					/* ͷŻ */
 					theDemuxer->GetMutex()->Unlock();
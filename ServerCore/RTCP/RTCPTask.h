@@ -22,6 +22,7 @@ LastUpdate:  2010-08-16
 #define __RTCP_TASK_H__
 
 #include "Task.h"
+#include "UDPSocket.h"
 
 class RTCPTask : public Task
 {
@@ -33,6 +34,8 @@ class RTCPTask : public Task
     
     private:
         virtual SInt64 Run();
+
+        UDPRecvBatch    fRecvBatch;     // RTCP packets are received kMaxPackets at a time
 };
 
 #endif //__RTCP_TASK_H__
@@ -150,7 +150,7 @@ void RTPBandwidthTracker::AdjustWindowForRetransmit()
     fSlowStartByteCount = 0;
     
 	/* ȡǰʱ */
-    SInt64 theTime = OS::Milliseconds();
+    SInt64 theTime = OS::CachedMilliseconds();
 
 	/* TCP㷨УssthreshΪǰcwndһ룬cwndĴСΪһݰĳȣﲻô
 	Ҫط£250msһssthreshcwndСRTPBandwidthTracker::SetWindowSize() */
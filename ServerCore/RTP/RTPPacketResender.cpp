@@ -18,6 +18,7 @@ LastUpdate:  2010-08-16
 
 #include "RTPPacketResender.h"
 #include "RTPStream.h"
+#include "QTSServerInterface.h"
 #include "atomic.h"
 #include "OSMutex.h"
 
@@ -410,7 +411,7 @@ void RTPPacketResender::AddPacket( void * inRTPPacket, UInt32 packetSize, SInt32
 		/************** شṹ帳ֵ  ******************/
         ::memcpy(theEntry->fPacketData, inRTPPacket, packetSize);//RTPʵݷOSBufferPool,רл
         theEntry->fPacketSize = packetSize;
-        theEntry->fAddedTime = OS::Milliseconds();//شĵǰʱ
+        theEntry->fAddedTime = OS::CachedMilliseconds();//شĵǰʱ
 		/* ȡRTPRTO */
         theEntry->fOrigRetransTimeout = fBandwidthTracker->CurRetransmitTimeout();
 		/* ʵΪǰʱ+̵ķʱʱ */
@@ -544,7 +545,7 @@ void RTPPacketResender::ResendDueEntries()
 	/* resend loop count */
     SInt32 numResends = 0;
     RTPResenderEntry* theEntry = NULL; 
-    SInt64 curTime = OS::Milliseconds();
+    SInt64 curTime = OS::CachedMilliseconds();
 
     //ݰһݵԪؿʼ
     for (SInt32 packetIndex = fPacketsInList -1; packetIndex >= 0; packetIndex--) // walk backwards because remove packet moves array members forward
@@ -625,6 +626,9 @@ void RTPPacketResender::ResendDueEntries()
         }
         
     }
+
+    if (numResends > 0)
+        QTSServerInterface::GetServer()->IncrementTotalRTPRetransmits(numResends);
 }
 
 void RTPPacketResender::RemovePacket(RTPResenderEntry* inEntry){ Assert(0); }
@@ -622,7 +622,7 @@ SInt64 RTPSession::Run()
 			// We cannot block() waiting to UnRegister(ע), because we have to
 			// give the RTSPSessionTask a chance to release the RTPSession.
 			/* ȡȫֵ RTP Session map,ԴעRTPSessionıԪ,ɹͷźȥKillRTPSession */
-			OSRefTable* sessionTable = QTSServerInterface::GetServer()->GetRTPSessionMap();
+			OSStripedRefTable* sessionTable = QTSServerInterface::GetServer()->GetRTPSessionMap();
 			Assert(sessionTable != NULL);
 			if (!sessionTable->TryUnRegister(&fRTPMapElem))
 			{
@@ -695,7 +695,12 @@ SInt64 RTPSession::Run()
         //sends a play while we are already playing, this may occur)
 		/* obtain the current time to send RTP packets */
 		//趨ݰʱ䣬ֹǰ,ˢQTSS_RTPSendPackets_Paramsеĵǰʱ
-        theParams.rtpSendPacketsParams.inCurrentTime = OS::Milliseconds();
+        theParams.rtpSendPacketsParams.inCurrentTime = OS::CachedMilliseconds();
+
+        // If the module asked for an event last time it sent packets (it is
+        // waiting on a file read), it gets called again as soon as that comes in
+        if (fModuleState.eventRequested && (events & Task::kReadEvent))
+            fNextSendPacketsTime = theParams.rtpSendPacketsParams.inCurrentTime;
 		/* fNextSendPacketsTime see RTPSessionInterface.h,ʾsend Packetsľʱ */
 		//δʱʱشõȴʱ
         if (fNextSendPacketsTime > theParams.rtpSendPacketsParams.inCurrentTime)
@@ -743,7 +748,16 @@ SInt64 RTPSession::Run()
 
 			/* QTSSFileModuleDispatch(), refer to QTSSFileModule.cpp */
 			/* QTSS_RTPSendPackets_Roleɫͻ˷ýݣ߷ʲôʱģ(ֻQTSSFileModule)QTSS_RTPSendPackets_RoleɫӦٴαá*/
+            fBatchingUDPSends = true;
             (void)fModule->CallDispatch(QTSS_RTPSendPackets_Role, &theParams);
+            fBatchingUDPSends = false;
+
+            // Send the RTP packets the streams queued up during the role
+            RTPStream** theStream = NULL;
+            UInt32 theStreamLen = 0;
+            for (int x = 0; this->GetValuePtr(qtssCliSesStreamObjects, x, (void**)&theStream, &theStreamLen) == QTSS_NoErr; x++)
+                if (theStream && *theStream)
+                    (*theStream)->FlushSendQueue();
     #if RTPSESSION_DEBUGGING
             qtss_printf("RTPSession %ld: back from sendPackets, nextPacketTime = %"_64BITARG_"d\n",(SInt32)this, theParams.rtpSendPacketsParams.outNextPacketTime);
     #endif
@@ -96,6 +96,7 @@ RTPSessionInterface::RTPSessionInterface()
     fPlayTime(0),
     fAdjustedPlayTime(0),/* üRTPSession::Play() */
     fNTPPlayTime(0),
+    fBatchingUDPSends(false),
     fNextSendPacketsTime(0),
     fSessionQualityLevel(0),
     fState(qtssPausedState),/* Ĭͣ״̬ */
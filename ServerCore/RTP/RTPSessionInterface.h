@@ -95,6 +95,11 @@ class RTPSessionInterface : public QTSSDictionary, public Task
         RTPBandwidthTracker* GetBandwidthTracker() { return &fTracker; } /* needed by RTPSession::run() */
         RTPOverbufferWindow* GetOverbufferWindow() { return &fOverbufferWindow; }
         UInt32  GetFramesSkipped() { return fFramesSkipped; }
+
+        // True while RTPSession::Run is inside the module's send packets role.
+        // UDP streams queue their RTP packets during that time, and the session
+        // flushes them (see RTPStream::FlushSendQueue) once the role returns.
+        Bool16  IsBatchingUDPSends()    { return fBatchingUDPSends; }
         
         // MEMORY FOR RTCP PACKETS
         
@@ -190,6 +195,7 @@ class RTPSessionInterface : public QTSSDictionary, public Task
         SInt64      fAdjustedPlayTime;/* ȡǰʱRTSP Request Header RangeеfStartTimeĲֵ,ǳҪ */
         SInt64      fNTPPlayTime;/* ΪSR,fPlayTimeNTPʽֵ */
 		Bool16      fAllTracksInterleaved;/* all stream ͨRTSP channel淢? */
+        Bool16      fBatchingUDPSends;
 
 		/* very important! this is actual absolute timestamp of send the next RTP packets */
         SInt64      fNextSendPacketsTime;/* need by RTPSession::run()/RTPSession::Play() */
@@ -272,6 +272,8 @@ RTPStream::~RTPStream()
     QTSS_Error err = QTSS_NoErr;
     if (fSockets != NULL)
     {
+        this->FlushSendQueue();
+
         // If there is an UDP socket pair associated with this stream, make sure to free it up
         Assert(fSockets->GetSocketB()->GetDemuxer() != NULL);
         fSockets->GetSocketB()->GetDemuxer()->UnregisterTask(fRemoteAddr, fRemoteRTCPPort, this);       
@@ -780,6 +782,17 @@ void    RTPStream::SendRetransmits()
         fResender.ResendDueEntries(); //ǰ,ش,һط 
 }
 
+//FlushSendQueue must be called from a fSession mutex protected caller
+void    RTPStream::FlushSendQueue()
+{
+    fSendQueue.Flush(QTSServerInterface::GetServer()->GetPrefs()->IsUDPGSOEnabled());
+    if (fSendQueue.GetNumSendCalls() == 0)
+        return;
+
+    QTSServerInterface::GetServer()->IncrementUDPSendStats(fSendQueue.GetNumPacketsSent(), fSendQueue.GetNumSendCalls());
+    fSendQueue.ResetStats();
+}
+
 //ReliableRTPWrite must be called from a fSession mutex protected caller
 /* ʹRUDPʽRTP,ʹ,ʹöشͶ;ʹ,ָ,SendTo()ͳȥ */
 QTSS_Error RTPStream::ReliableRTPWrite(void* inBuffer, UInt32 inLen, const SInt64& curPacketDelay)
@@ -1032,7 +1045,7 @@ QTSS_Error  RTPStream::Write(void* inBuffer, UInt32 inLen, UInt32* outLenWritten
 
     QTSS_Error err = QTSS_NoErr;
 	/* ȡǰϵͳʱ,Լӳʱ,ƶͰԷǳҪ! */
-    SInt64 theTime = OS::Milliseconds();
+    SInt64 theTime = OS::CachedMilliseconds();
     
     // Data passed into this version of write must be a QTSS_PacketStruct
 	/* ݸ汾WriteݱضQTSS_PacketStructṹ,ȡǰRTPStreamеİṹ */
@@ -1119,8 +1132,14 @@ QTSS_Error  RTPStream::Write(void* inBuffer, UInt32 inLen, UInt32* outLenWritten
                 err = this->InterleavedWrite( thePacket->packetData, inLen, outLenWritten, fRTPChannel );       
             else if ( fTransportType == qtssRTPTransportTypeReliableUDP )//RUDPд
                 err = this->ReliableRTPWrite( thePacket->packetData, inLen, theCurrentPacketDelay );
+            else if ( inLen > 0 && fSession->IsBatchingUDPSends() )
+                fSendQueue.SendTo(fSockets->GetSocketA(), fRemoteAddr, fRemoteRTPPort, thePacket->packetData, inLen,
+                                    QTSServerInterface::GetServer()->GetPrefs()->IsUDPGSOEnabled());
             else if ( inLen > 0 )//ʹUDPSocket::SendTo()д
+            {
                 (void)fSockets->GetSocketA()->SendTo(fRemoteAddr, fRemoteRTPPort, thePacket->packetData, inLen);
+                QTSServerInterface::GetServer()->IncrementUDPSendStats(1, 1);
+            }
             
             if (err == QTSS_NoErr)
 				/* ɹ,ʹӡrtp */
@@ -1298,7 +1317,7 @@ compound RTCP 
 void RTPStream::ProcessIncomingRTCPPacket(StrPtrLen* inPacket)
 {
     StrPtrLen currentPtr(*inPacket);
-    SInt64 curTime = OS::Milliseconds(); /* ȡǰʱ */
+    SInt64 curTime = OS::CachedMilliseconds(); /* ȡǰʱ */
 
     // Modules are guarenteed atomic access to the session. Also, the RTSP Session accessed
     // below could go away at any time. So we need to lock the RTP session mutex.
@@ -27,6 +27,7 @@ LastUpdate:  2010-08-16
 
 #include "UDPDemuxer.h"
 #include "UDPSocketPool.h"
+#include "UDPSendQueue.h"
 
 #include "RTSPRequestInterface.h"
 #include "RTPSessionInterface.h"
@@ -109,6 +110,12 @@ class RTPStream : public QTSSDictionary, public UDPDemuxerTask //ע
 		/* need by RTPSession::run() */
         void SendRetransmits();
 
+        //
+        // While the session is batching UDP sends (see RTPSessionInterface),
+        // RTP packets written to this stream are queued rather than sent.
+        // This sends whatever is queued. Call with the session mutex held.
+        void FlushSendQueue();
+
         //
         // Update the thinning parameters for this stream to match current prefs
         void SetThinningParams();
@@ -143,6 +150,7 @@ class RTPStream : public QTSSDictionary, public UDPDemuxerTask //ע
         //or fresh ones (only fresh in extreme special cases)
         UDPSocketPair*          fSockets; //ָQTSServerʱȫַUDPSocketPair,μQTSServer::SetupUDPSockets()
         RTPSessionInterface*    fSession;
+        UDPSendQueue            fSendQueue;
 
         // info for kind a reliable UDP
         //DssDurationTimer      fInfoDisplayTimer;	
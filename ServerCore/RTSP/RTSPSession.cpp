@@ -1685,7 +1685,7 @@ void RTSPSession::SetupRequest()
     // let's also refresh RTP session timeout so that it's kept alive in sync with the RTSP session.
     // Attempt to find the RTP session for this request.
 	/* õRTPSessionMapHash Table,ԵõRTPSessionMapԪ */
-    OSRefTable* theMap = QTSServerInterface::GetServer()->GetRTPSessionMap();
+    OSStripedRefTable* theMap = QTSServerInterface::GetServer()->GetRTPSessionMap();
 
 	/* RTSPRequestлȡӦRTPSessionID,ҵʶҳӦHashTableԪ,ҵӦRTPSession;
 	ûҵ,˵һµRTPSession,õǰfLastRTPSessionID[]RTPSession ID,ҵӦRTPSession */
@@ -1866,7 +1866,7 @@ void RTSPSession::CleanupRequest()
     if (fRTPSession != NULL)
     {
         // Release the ref.
-        OSRefTable* theMap = QTSServerInterface::GetServer()->GetRTPSessionMap();
+        OSStripedRefTable* theMap = QTSServerInterface::GetServer()->GetRTPSessionMap();
         theMap->Release(fRTPSession->GetRef());
         
         // NULL out any references to this RTP session
@@ -1900,7 +1900,7 @@ void RTSPSession::CleanupRequest()
 /* RTSP RequestжλǡRTPSession,ʹַ: (1)RTSPRequestлȡӦRTSPSessionID,ҵ
 ʶҳӦHashTableԪ,ҵӦRTPSession; (2)ûҵ,˵һµRTPSession,õǰ
 fLastRTPSessionID[]RTSPSession ID,ҵӦRTPSession */
-QTSS_Error  RTSPSession::FindRTPSession(OSRefTable* inRefTable)
+QTSS_Error  RTSPSession::FindRTPSession(OSStripedRefTable* inRefTable)
 {
     // This function attempts to locate the appropriate RTP session for this RTSP
     // Request. It uses an RTSP session ID as a key to finding the correct RTP session,
@@ -1932,7 +1932,7 @@ QTSS_Error  RTSPSession::FindRTPSession(OSRefTable* inRefTable)
 }
 
 /* ǡʱһRTPSession,ûỰ,һΨһSession ID,עᲢRTPSessionMapinRefTable,RTPSession */
-QTSS_Error  RTSPSession::CreateNewRTPSession(OSRefTable* inRefTable)
+QTSS_Error  RTSPSession::CreateNewRTPSession(OSStripedRefTable* inRefTable)
 {
 	/* ȷһ:ַʼλ,潫RTPSession IDֵ */
     Assert(fLastRTPSessionIDPtr.Ptr == &fLastRTPSessionID[0]);
@@ -2073,31 +2073,32 @@ UInt32 RTSPSession::GenerateNewSessionID(char* ioBuffer)
     QTSServerInterface* theServer = QTSServerInterface::GetServer();
     
     {
-		/* RTPSessionMap */
-        OSMutexLocker locker(theServer->GetRTPSessionMap()->GetMutex());
-		/* RTPSessionMapHash Tableָ */
-        OSRefHashTable* theHashTable = theServer->GetRTPSessionMap()->GetHashTable();
-        if (theHashTable->GetNumEntries() > 0)
+        //The map is only locked a part at a time while we iterate, so sessions
+        //may come and go meanwhile. If we run out, use the last one we saw.
+        //A session is only safe to touch while its part is locked, which is
+        //inside the loop, so its statistics are read there.
+        OSStripedRefTable* theMap = theServer->GetRTPSessionMap();
+        UInt32 theNumSessions = theMap->GetNumRefsInTable();
+        if (theNumSessions > 0)
         {
 			/* һǵǰϣԪ,ٳ2 */
-            theFirstRandom %= theHashTable->GetNumEntries();
+            theFirstRandom %= theNumSessions;
             theFirstRandom >>= 2;
             
-			/* ɲʼOSHashTableĵĶ */
-            OSRefHashTableIter theIter(theHashTable);
+            OSStripedRefTableIter theIter(theMap);
+            UInt32 theSessionRandom = 0;
             //Iterate through the session map, finding a random session
 			/* RTPSessionMap,ҵ׸theFirstRandomHashTableԪ */
-            for (UInt32 theCount = 0; theCount < theFirstRandom; theIter.Next(), theCount++)
-				/* ȷǰHashTableԪǿ */
-                Assert(!theIter.IsDone());
-            
-			/* ȡǰHashTableԪڵRTPSession */
-            RTPSession* theSession = (RTPSession*)theIter.GetCurrent()->GetObject();
+            for (UInt32 theCount = 0; (theCount <= theFirstRandom) && !theIter.IsDone(); theIter.Next(), theCount++)
+            {
+                RTPSession* theSession = (RTPSession*)theIter.GetCurrent()->GetObject();
 			/* ϵǰRTPSession statisticsʹõһø */
-            theFirstRandom += theSession->GetPacketsSent();
-            theFirstRandom += (UInt32)theSession->GetSessionCreateTime();
-            theFirstRandom += (UInt32)theSession->GetPlayTime();
-            theFirstRandom += (UInt32)theSession->GetBytesSent();
+                theSessionRandom = theSession->GetPacketsSent();
+                theSessionRandom += (UInt32)theSession->GetSessionCreateTime();
+                theSessionRandom += (UInt32)theSession->GetPlayTime();
+                theSessionRandom += (UInt32)theSession->GetBytesSent();
+            }
+            theFirstRandom += theSessionRandom;
         }
     }
 
@@ -2270,7 +2271,7 @@ void RTSPSession::HandleIncomingDataPacket()
     }
     
 	/* RTPSession MapҵָỰIDref,ӶõڵRTPSession */
-    OSRefTable* theMap = QTSServerInterface::GetServer()->GetRTPSessionMap();
+    OSStripedRefTable* theMap = QTSServerInterface::GetServer()->GetRTPSessionMap();
     OSRef* theRef = theMap->Resolve(theSessionID);
     
     if (theRef != NULL)
@@ -47,9 +47,9 @@ class RTSPSession : public RTSPSessionInterface
         
 		/*************  RTPSession related ***************/
         // Gets & creates RTP session for this request.
-        QTSS_Error  FindRTPSession(OSRefTable* inTable);
+        QTSS_Error  FindRTPSession(OSStripedRefTable* inTable);
 		/* ǡʱһRTPSession,ûỰ,һΨһSession ID,עᲢRTPSessionMapinRefTable,RTPSession */
-        QTSS_Error  CreateNewRTPSession(OSRefTable* inTable);
+        QTSS_Error  CreateNewRTPSession(OSStripedRefTable* inTable);
         void        SetupClientSessionAttrs();
         
         // Does request prep & request cleanup, respectively
@@ -140,6 +140,19 @@ QTSS_ServerState StartServer(XMLPrefsParser* inPrefsSource,/* PrefsSource* inMes
     #if DEBUG
         qtss_printf("Number of task threads: %lu\n",numThreads);
     #endif
+
+        // Client sockets are sharded across the socket event threads. Like the
+        // task threads, default to one event thread per processor.
+        UInt32 numEventThreads = sServer->GetPrefs()->GetNumEventThreads();
+        if (numEventThreads == 0)
+            numEventThreads = OS::GetNumProcessors();
+        if (numEventThreads == 0)
+            numEventThreads = 1;
+        numEventThreads = Socket::SetNumEventThreads(numEventThreads);
+
+    #if DEBUG
+        qtss_printf("Number of event threads: %lu\n",numEventThreads);
+    #endif
     
         // Start up the server's global tasks, and start listening
 		/* TimeoutTaskThreadעһͨTaskʵ,IdleThread޹أ,IdleTask::Initialize() */